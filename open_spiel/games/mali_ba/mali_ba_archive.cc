@@ -0,0 +1,424 @@
+// mali_ba_archive.cc
+// Binary game archive writer and memory-mapped reader
+
+#include "open_spiel/games/mali_ba/mali_ba_archive.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <utility>
+
+#include "open_spiel/abseil-cpp/absl/strings/str_cat.h"
+#include "open_spiel/games/mali_ba/mali_ba_game.h"
+#include "open_spiel/games/mali_ba/mali_ba_state.h"
+#include "open_spiel/spiel_utils.h"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "mali_ba archives are written and mapped as little-endian"
+#endif
+
+namespace open_spiel {
+namespace mali_ba {
+namespace {
+
+constexpr char kArchiveMagic[8] = {'M', 'B', 'A', 'R', 'C', 'H', 'I', 'V'};
+constexpr char kGameMagic[4] = {'M', 'B', 'G', 'M'};
+constexpr uint32_t kArchiveVersion = 1;
+constexpr uint32_t kGameTerminal = 1;
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t index_offset;   // 0 until the writer closes the archive
+  uint64_t num_games;
+  uint64_t game_string_size;
+};
+
+struct GameHeader {
+  char magic[4];
+  uint32_t flags;
+  int64_t game_id;
+  uint64_t size;           // Whole game section, padding included
+  uint32_t num_moves;
+  uint32_t num_keyframes;
+  uint32_t num_players;
+  uint32_t setup_size;
+};
+
+struct KeyframeEntry {
+  uint32_t move;
+  uint32_t size;
+  uint64_t offset;         // From the start of the game section
+};
+
+struct IndexEntry {
+  uint64_t offset;
+  uint64_t size;
+};
+
+static_assert(sizeof(FileHeader) == 40 && sizeof(GameHeader) == 40 &&
+                  sizeof(KeyframeEntry) == 16 && sizeof(IndexEntry) == 16,
+              "archive structs are part of the file format");
+
+uint64_t Align8(uint64_t value) { return (value + 7) & ~uint64_t{7}; }
+
+// Offsets of a game's fixed sections, from its counts alone.
+struct GameLayout {
+  uint64_t actions, players, returns, keyframes, setup, end;
+
+  GameLayout(uint64_t num_moves, uint64_t num_players, uint64_t num_keyframes,
+             uint64_t setup_size) {
+    actions = sizeof(GameHeader);
+    players = actions + sizeof(int32_t) * num_moves;
+    returns = Align8(players + num_moves);
+    keyframes = returns + sizeof(double) * num_players;
+    setup = keyframes + sizeof(KeyframeEntry) * num_keyframes;
+    end = Align8(setup + setup_size);
+  }
+};
+
+}  // namespace
+
+// =====================================================================
+// GameArchiveRecorder
+// =====================================================================
+
+GameArchiveRecorder::GameArchiveRecorder(int keyframe_interval)
+    : keyframe_interval_(keyframe_interval) {
+  SPIEL_CHECK_GT(keyframe_interval_, 0);
+}
+
+void GameArchiveRecorder::Begin(const Mali_BaState& state, int64_t game_id) {
+  game_id_ = game_id;
+  num_players_ = state.NumPlayers();
+  setup_json_ = state.CreateSetupJson(game_id, /*pretty=*/false);
+  actions_.clear();
+  players_.clear();
+  returns_.clear();
+  keyframes_.clear();
+  for (const State::PlayerAction& entry : state.FullHistory()) {
+    actions_.push_back(static_cast<int32_t>(entry.action));
+    players_.push_back(static_cast<int8_t>(entry.player));
+  }
+  keyframes_.push_back({num_moves(), state.SerializeBinary()});
+  if (state.IsTerminal()) returns_ = state.Returns();
+}
+
+void GameArchiveRecorder::Update(const Mali_BaState& state) {
+  SPIEL_CHECK_FALSE(keyframes_.empty());
+  const std::vector<State::PlayerAction>& history = state.FullHistory();
+  SPIEL_CHECK_GE(history.size(), actions_.size());
+  if (history.size() == actions_.size()) return;
+
+  bool after_chance = false;
+  for (size_t i = actions_.size(); i < history.size(); ++i) {
+    if (after_chance) {
+      SpielFatalError("GameArchiveRecorder: Update() must run after every chance move");
+    }
+    actions_.push_back(static_cast<int32_t>(history[i].action));
+    players_.push_back(static_cast<int8_t>(history[i].player));
+    after_chance = history[i].player == kChancePlayerId;
+  }
+  if (after_chance || num_moves() - keyframes_.back().move >= keyframe_interval_) {
+    keyframes_.push_back({num_moves(), state.SerializeBinary()});
+  }
+  if (state.IsTerminal()) returns_ = state.Returns();
+}
+
+// =====================================================================
+// GameArchiveWriter
+// =====================================================================
+
+GameArchiveWriter::GameArchiveWriter(const std::string& path, const Game& game)
+    : path_(path) {
+  file_ = std::fopen(path.c_str(), "wb");
+  if (file_ == nullptr) {
+    SpielFatalError(absl::StrCat("GameArchiveWriter: cannot create '", path, "': ",
+                                 std::strerror(errno)));
+  }
+  const std::string game_string = game.ToString();
+  FileHeader header{};
+  std::memcpy(header.magic, kArchiveMagic, sizeof(kArchiveMagic));
+  header.version = kArchiveVersion;
+  header.game_string_size = game_string.size();
+  Write(&header, sizeof(header));
+  Write(game_string.data(), game_string.size());
+  Pad();
+}
+
+GameArchiveWriter::~GameArchiveWriter() { Close(); }
+
+void GameArchiveWriter::Write(const void* data, size_t size) {
+  if (size == 0) return;
+  if (std::fwrite(data, 1, size, file_) != size) {
+    SpielFatalError(absl::StrCat("GameArchiveWriter: write to '", path_, "' failed: ",
+                                 std::strerror(errno)));
+  }
+  offset_ += size;
+}
+
+void GameArchiveWriter::Pad() {
+  static constexpr char kZeros[8] = {};
+  Write(kZeros, Align8(offset_) - offset_);
+}
+
+int GameArchiveWriter::Add(const GameArchiveRecorder& recorder) {
+  SPIEL_CHECK_FALSE(recorder.keyframes_.empty());
+  const GameLayout layout(recorder.actions_.size(), recorder.num_players_,
+                          recorder.keyframes_.size(), recorder.setup_json_.size());
+
+  // Lay the whole section out in memory, then append it under the lock.
+  uint64_t section_size = layout.end;
+  std::vector<KeyframeEntry> entries;
+  entries.reserve(recorder.keyframes_.size());
+  for (const auto& keyframe : recorder.keyframes_) {
+    entries.push_back({static_cast<uint32_t>(keyframe.move),
+                       static_cast<uint32_t>(keyframe.data.size()), section_size});
+    section_size = Align8(section_size + keyframe.data.size());
+  }
+  std::string section(section_size, '\0');
+  GameHeader header{};
+  std::memcpy(header.magic, kGameMagic, sizeof(kGameMagic));
+  header.flags = recorder.returns_.empty() ? 0 : kGameTerminal;
+  header.game_id = recorder.game_id_;
+  header.size = section_size;
+  header.num_moves = static_cast<uint32_t>(recorder.actions_.size());
+  header.num_keyframes = static_cast<uint32_t>(entries.size());
+  header.num_players = static_cast<uint32_t>(recorder.num_players_);
+  header.setup_size = static_cast<uint32_t>(recorder.setup_json_.size());
+  std::memcpy(&section[0], &header, sizeof(header));
+  std::memcpy(&section[layout.actions], recorder.actions_.data(),
+              sizeof(int32_t) * recorder.actions_.size());
+  std::memcpy(&section[layout.players], recorder.players_.data(), recorder.players_.size());
+  if (!recorder.returns_.empty()) {
+    SPIEL_CHECK_EQ(recorder.returns_.size(), static_cast<size_t>(recorder.num_players_));
+    std::memcpy(&section[layout.returns], recorder.returns_.data(),
+                sizeof(double) * recorder.returns_.size());
+  }
+  std::memcpy(&section[layout.keyframes], entries.data(), sizeof(KeyframeEntry) * entries.size());
+  std::memcpy(&section[layout.setup], recorder.setup_json_.data(), recorder.setup_json_.size());
+  for (size_t k = 0; k < entries.size(); ++k) {
+    const std::string& data = recorder.keyframes_[k].data;
+    std::memcpy(&section[entries[k].offset], data.data(), data.size());
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (file_ == nullptr) SpielFatalError("GameArchiveWriter: Add() after Close()");
+  game_offsets_.push_back(offset_);
+  game_sizes_.push_back(section_size);
+  Write(section.data(), section.size());
+  return static_cast<int>(game_offsets_.size()) - 1;
+}
+
+void GameArchiveWriter::Flush() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (file_ != nullptr && std::fflush(file_) != 0) {
+    SpielFatalError(absl::StrCat("GameArchiveWriter: flushing '", path_, "' failed: ",
+                                 std::strerror(errno)));
+  }
+}
+
+void GameArchiveWriter::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (file_ == nullptr) return;
+  const uint64_t index_offset = offset_;
+  for (size_t i = 0; i < game_offsets_.size(); ++i) {
+    const IndexEntry entry{game_offsets_[i], game_sizes_[i]};
+    Write(&entry, sizeof(entry));
+  }
+  // Patch index_offset and num_games last, so a crash before this leaves an
+  // index-less archive the reader can still walk.
+  const uint64_t patch[2] = {index_offset, game_offsets_.size()};
+  static_assert(offsetof(FileHeader, num_games) ==
+                    offsetof(FileHeader, index_offset) + sizeof(uint64_t),
+                "patched header fields must be adjacent");
+  if (std::fseek(file_, offsetof(FileHeader, index_offset), SEEK_SET) != 0 ||
+      std::fwrite(patch, sizeof(uint64_t), 2, file_) != 2 || std::fclose(file_) != 0) {
+    file_ = nullptr;
+    SpielFatalError(absl::StrCat("GameArchiveWriter: closing '", path_, "' failed: ",
+                                 std::strerror(errno)));
+  }
+  file_ = nullptr;
+}
+
+int GameArchiveWriter::num_games() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return static_cast<int>(game_offsets_.size());
+}
+
+// =====================================================================
+// GameArchiveReader
+// =====================================================================
+
+GameArchiveReader::GameArchiveReader(const std::string& path) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    SpielFatalError(absl::StrCat("GameArchiveReader: cannot open '", path, "': ",
+                                 std::strerror(errno)));
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(FileHeader))) {
+    close(fd);
+    SpielFatalError(absl::StrCat("GameArchiveReader: '", path, "' is not a game archive"));
+  }
+  size_ = static_cast<size_t>(info.st_size);
+  void* mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    SpielFatalError(absl::StrCat("GameArchiveReader: cannot map '", path, "': ",
+                                 std::strerror(errno)));
+  }
+  data_ = static_cast<const char*>(mapped);
+
+  FileHeader header;
+  std::memcpy(&header, data_, sizeof(header));
+  if (std::memcmp(header.magic, kArchiveMagic, sizeof(kArchiveMagic)) != 0 ||
+      header.version != kArchiveVersion ||
+      header.game_string_size > size_ - sizeof(FileHeader)) {
+    SpielFatalError(absl::StrCat("GameArchiveReader: '", path,
+                                 "' is not a game archive of this version"));
+  }
+  game_string_.assign(data_ + sizeof(FileHeader), header.game_string_size);
+  const uint64_t first_game = Align8(sizeof(FileHeader) + header.game_string_size);
+
+  if (header.index_offset == 0) {
+    // Never closed: keep every whole game up to the first torn one.
+    uint64_t offset = first_game;
+    while (offset + sizeof(GameHeader) <= size_) {
+      GameHeader game;
+      std::memcpy(&game, data_ + offset, sizeof(game));
+      if (!AddGame(offset, game.size)) break;
+      offset += game.size;
+    }
+    return;
+  }
+  if (header.index_offset < first_game || header.index_offset > size_ ||
+      header.num_games > (size_ - header.index_offset) / sizeof(IndexEntry)) {
+    SpielFatalError(absl::StrCat("GameArchiveReader: '", path, "' has a bad index"));
+  }
+  games_.reserve(header.num_games);
+  for (uint64_t i = 0; i < header.num_games; ++i) {
+    IndexEntry entry;
+    std::memcpy(&entry, data_ + header.index_offset + i * sizeof(IndexEntry), sizeof(entry));
+    if (!AddGame(entry.offset, entry.size)) {
+      SpielFatalError(absl::StrCat("GameArchiveReader: game ", i, " of '", path,
+                                   "' is malformed"));
+    }
+  }
+}
+
+GameArchiveReader::~GameArchiveReader() {
+  if (data_ != nullptr) munmap(const_cast<char*>(data_), size_);
+}
+
+bool GameArchiveReader::AddGame(uint64_t offset, uint64_t size) {
+  if (offset % 8 != 0 || size < sizeof(GameHeader) || offset > size_ || size > size_ - offset) {
+    return false;
+  }
+  GameHeader header;
+  std::memcpy(&header, data_ + offset, sizeof(header));
+  if (std::memcmp(header.magic, kGameMagic, sizeof(kGameMagic)) != 0 ||
+      header.size != size || header.num_keyframes == 0) {
+    return false;
+  }
+  const GameLayout layout(header.num_moves, header.num_players, header.num_keyframes,
+                          header.setup_size);
+  if (layout.end > size) return false;
+
+  GameView view;
+  view.base = data_ + offset;
+  view.game_id = header.game_id;
+  view.num_moves = static_cast<int>(header.num_moves);
+  view.num_keyframes = static_cast<int>(header.num_keyframes);
+  view.num_players = static_cast<int>(header.num_players);
+  view.terminal = (header.flags & kGameTerminal) != 0;
+  view.actions = reinterpret_cast<const int32_t*>(view.base + layout.actions);
+  view.players = reinterpret_cast<const int8_t*>(view.base + layout.players);
+  view.returns = reinterpret_cast<const double*>(view.base + layout.returns);
+  view.keyframes = view.base + layout.keyframes;
+  view.setup_json = absl::string_view(view.base + layout.setup, header.setup_size);
+
+  uint32_t previous_move = 0;
+  for (int k = 0; k < view.num_keyframes; ++k) {
+    KeyframeEntry entry;
+    std::memcpy(&entry, view.keyframes + k * sizeof(KeyframeEntry), sizeof(entry));
+    if (entry.move > header.num_moves || (k > 0 && entry.move < previous_move) ||
+        entry.offset < layout.end || entry.offset > size || entry.size > size - entry.offset) {
+      return false;
+    }
+    previous_move = entry.move;
+  }
+  games_.push_back(view);
+  return true;
+}
+
+const GameArchiveReader::GameView& GameArchiveReader::View(int game) const {
+  SPIEL_CHECK_GE(game, 0);
+  SPIEL_CHECK_LT(game, NumGames());
+  return games_[game];
+}
+
+int64_t GameArchiveReader::GameId(int game) const { return View(game).game_id; }
+
+int GameArchiveReader::NumMoves(int game) const { return View(game).num_moves; }
+
+int GameArchiveReader::FirstSeekableMove(int game) const {
+  KeyframeEntry entry;
+  std::memcpy(&entry, View(game).keyframes, sizeof(entry));
+  return static_cast<int>(entry.move);
+}
+
+bool GameArchiveReader::IsTerminal(int game) const { return View(game).terminal; }
+
+std::vector<double> GameArchiveReader::Returns(int game) const {
+  const GameView& view = View(game);
+  if (!view.terminal) return {};
+  return std::vector<double>(view.returns, view.returns + view.num_players);
+}
+
+absl::string_view GameArchiveReader::SetupJson(int game) const { return View(game).setup_json; }
+
+absl::Span<const int32_t> GameArchiveReader::Actions(int game) const {
+  const GameView& view = View(game);
+  return absl::MakeConstSpan(view.actions, view.num_moves);
+}
+
+absl::Span<const int8_t> GameArchiveReader::Players(int game) const {
+  const GameView& view = View(game);
+  return absl::MakeConstSpan(view.players, view.num_moves);
+}
+
+std::unique_ptr<State> GameArchiveReader::StateAt(const Mali_BaGame& mali_ba_game, int game,
+                                                  int move) const {
+  const GameView& view = View(game);
+  SPIEL_CHECK_GE(move, FirstSeekableMove(game));
+  SPIEL_CHECK_LE(move, view.num_moves);
+
+  // Keyframe moves ascend; take the last one at or before `move`.
+  KeyframeEntry keyframe;
+  std::memcpy(&keyframe, view.keyframes, sizeof(keyframe));
+  for (int k = 1; k < view.num_keyframes; ++k) {
+    KeyframeEntry entry;
+    std::memcpy(&entry, view.keyframes + k * sizeof(KeyframeEntry), sizeof(entry));
+    if (static_cast<int>(entry.move) > move) break;
+    keyframe = entry;
+  }
+  std::unique_ptr<State> state = mali_ba_game.DeserializeBinary(
+      std::string(view.base + keyframe.offset, keyframe.size));
+  for (int i = static_cast<int>(keyframe.move); i < move; ++i) {
+    // Chance moves are always followed by a keyframe, so none is replayed.
+    SPIEL_CHECK_NE(view.players[i], kChancePlayerId);
+    state->ApplyAction(view.actions[i]);
+  }
+  return state;
+}
+
+}  // namespace mali_ba
+}  // namespace open_spiel
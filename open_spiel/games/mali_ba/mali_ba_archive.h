@@ -0,0 +1,162 @@
+// mali_ba_archive.h
+// Binary game archives: many recorded games in one file, any move of any game
+// reachable without reading the others.
+//
+// A game is stored as its setup JSON (CreateSetupJson()), the player and
+// action id of every move, its final returns, and keyframes: the
+// SerializeBinary() state every `keyframe_interval` moves and after every
+// chance move, whose outcome the action id alone does not determine. The
+// file ends with an index of game offsets. A reader maps the file and
+// reaches move m by deserializing the nearest keyframe at or before m and
+// applying the few actions after it.
+//
+// File layout (little-endian, every section 8-byte aligned):
+//   FileHeader, game string (Game::ToString() of the archived games)
+//   per game: GameHeader, actions int32[n], players int8[n], returns
+//             double[num_players], KeyframeEntry[k], setup JSON, keyframe bytes
+//   IndexEntry[num_games]
+// An archive whose writer never closed it has no index; the reader then
+// finds the complete games by walking the game headers.
+#ifndef OPEN_SPIEL_GAMES_MALI_BA_ARCHIVE_H_
+#define OPEN_SPIEL_GAMES_MALI_BA_ARCHIVE_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "open_spiel/abseil-cpp/absl/strings/string_view.h"
+#include "open_spiel/abseil-cpp/absl/types/span.h"
+#include "open_spiel/spiel.h"
+
+namespace open_spiel {
+namespace mali_ba {
+
+class Mali_BaGame;
+class Mali_BaState;
+
+// Collects one game as it is played. Call Begin() once, then Update() after
+// every ApplyAction(); Update() picks up the new history entries.
+class GameArchiveRecorder {
+ public:
+  explicit GameArchiveRecorder(int keyframe_interval = 32);
+
+  // Starts a new game at `state`, which becomes its first keyframe. Moves in
+  // its history so far are recorded too, but cannot be seeked to.
+  void Begin(const Mali_BaState& state, int64_t game_id = -1);
+  void Update(const Mali_BaState& state);
+
+  int64_t game_id() const { return game_id_; }
+  int num_moves() const { return static_cast<int>(actions_.size()); }
+
+ private:
+  friend class GameArchiveWriter;
+  struct Keyframe {
+    int move;  // History length of the serialized state
+    std::string data;
+  };
+
+  int keyframe_interval_;
+  int64_t game_id_ = -1;
+  int num_players_ = 0;
+  std::string setup_json_;
+  std::vector<int32_t> actions_;
+  std::vector<int8_t> players_;
+  std::vector<double> returns_;  // Set once the recorded state is terminal
+  std::vector<Keyframe> keyframes_;
+};
+
+// Appends recorded games to an archive file. Add() may be called from several
+// threads at once.
+class GameArchiveWriter {
+ public:
+  // Creates (truncates) `path`; failure to open it is fatal.
+  GameArchiveWriter(const std::string& path, const Game& game);
+  // Close()s if still open.
+  ~GameArchiveWriter();
+
+  GameArchiveWriter(const GameArchiveWriter&) = delete;
+  GameArchiveWriter& operator=(const GameArchiveWriter&) = delete;
+
+  // Writes the recorded game and returns its index in the archive.
+  int Add(const GameArchiveRecorder& recorder);
+  // Pushes the games added so far to the file. Readers already see them as an
+  // index-less archive, so a crash loses at most the unflushed games.
+  void Flush();
+  // Writes the index; later Add() calls are fatal.
+  void Close();
+
+  const std::string& path() const { return path_; }
+  int num_games() const;
+
+ private:
+  void Write(const void* data, size_t size);
+  void Pad();
+
+  std::string path_;
+  mutable std::mutex mutex_;
+  std::FILE* file_ = nullptr;
+  uint64_t offset_ = 0;
+  std::vector<uint64_t> game_offsets_;
+  std::vector<uint64_t> game_sizes_;
+};
+
+// Read-only view of an archive file, memory-mapped. Malformed files are fatal.
+class GameArchiveReader {
+ public:
+  explicit GameArchiveReader(const std::string& path);
+  ~GameArchiveReader();
+
+  GameArchiveReader(const GameArchiveReader&) = delete;
+  GameArchiveReader& operator=(const GameArchiveReader&) = delete;
+
+  const std::string& GameString() const { return game_string_; }
+  int NumGames() const { return static_cast<int>(games_.size()); }
+
+  int64_t GameId(int game) const;
+  // Moves recorded, including any before the first keyframe.
+  int NumMoves(int game) const;
+  // Earliest move StateAt() can reach: the first keyframe's.
+  int FirstSeekableMove(int game) const;
+  bool IsTerminal(int game) const;
+  // Final returns; empty unless IsTerminal().
+  std::vector<double> Returns(int game) const;
+  absl::string_view SetupJson(int game) const;
+  absl::Span<const int32_t> Actions(int game) const;
+  absl::Span<const int8_t> Players(int game) const;
+
+  // The state after the first `move` moves of `game`, in `mali_ba_game`
+  // (which must be the game the archive was written for).
+  std::unique_ptr<State> StateAt(const Mali_BaGame& mali_ba_game, int game, int move) const;
+
+ private:
+  // Pointers into the mapping for one validated game.
+  struct GameView {
+    const char* base = nullptr;  // Start of the game's section
+    int64_t game_id = -1;
+    int num_moves = 0;
+    int num_keyframes = 0;
+    int num_players = 0;
+    bool terminal = false;
+    const int32_t* actions = nullptr;
+    const int8_t* players = nullptr;
+    const double* returns = nullptr;
+    const char* keyframes = nullptr;  // KeyframeEntry[num_keyframes]
+    absl::string_view setup_json;
+  };
+  const GameView& View(int game) const;
+  // Validates and adds the game at `offset`; false if it is not a whole game.
+  bool AddGame(uint64_t offset, uint64_t size);
+
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+  std::string game_string_;
+  std::vector<GameView> games_;
+};
+
+}  // namespace mali_ba
+}  // namespace open_spiel
+
+#endif  // OPEN_SPIEL_GAMES_MALI_BA_ARCHIVE_H_
@@ -0,0 +1,400 @@
+// mali_ba_benchmark.cc
+// Google-benchmark suite for the engine hot paths.
+//
+// Every benchmark runs on two boards: the built-in default board and the
+// custom board of mali_ba.ini (pass --mali_ba_config=<path> to use another
+// file, or an empty path to skip it). Both games load with a fixed rng_seed,
+// which places the default board's cities, and the fixture positions come
+// from one heuristic game per board played from a fixed seed, so a given
+// commit always measures the same boards and states: "mid" is taken halfway
+// through that game and "late" at 90% of it. Compare runs with benchmark's
+// compare.py.
+//
+// This binary replaces the global operator new to count heap allocations per
+// thread. LegalActions, ApplyUndo and Clone report them per iteration as
+// "allocs", and the allocations of the counting containers
+// (mali_ba_memory.h) as "hot_allocs".
+//
+//   mali_ba_benchmark --benchmark_filter=LegalActions --benchmark_repetitions=5
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "open_spiel/games/mali_ba/mali_ba_board_config.h"
+#include "open_spiel/games/mali_ba/mali_ba_common.h"
+#include "open_spiel/games/mali_ba/mali_ba_game.h"
+#include "open_spiel/games/mali_ba/mali_ba_memory.h"
+#include "open_spiel/games/mali_ba/mali_ba_state.h"
+#include "open_spiel/spiel.h"
+#include "open_spiel/spiel_utils.h"
+
+namespace {
+thread_local uint64_t t_heap_allocations = 0;
+}  // namespace
+
+// Sized, array and nothrow forms all end up here; the aligned forms are not
+// counted.
+void* operator new(std::size_t size) {
+  ++t_heap_allocations;
+  if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+  throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+namespace open_spiel {
+namespace mali_ba {
+namespace {
+
+constexpr uint32_t kFixtureSeed = 20250901;
+// Game seed: places the default board's cities, so it must be fixed too.
+constexpr int kBoardSeed = 20250902;
+constexpr uint32_t kPlayoutSeed = 7;
+
+// mali_ba.ini sits next to this file in the source tree.
+std::string DefaultConfigPath() {
+  const std::string file = __FILE__;
+  const size_t slash = file.find_last_of('/');
+  return (slash == std::string::npos ? std::string(".") : file.substr(0, slash)) +
+         "/mali_ba.ini";
+}
+
+const Mali_BaState& AsMaliBa(const State& state) {
+  return static_cast<const Mali_BaState&>(state);
+}
+
+Mali_BaState& AsMaliBa(State& state) { return static_cast<Mali_BaState&>(state); }
+
+std::string PhaseName(Phase phase) {
+  std::ostringstream out;
+  out << phase;
+  return out.str();
+}
+
+// Plays one game with SelectHeuristicRandomAction(); chance nodes take their
+// only outcome. Returns the number of actions applied.
+int PlayHeuristicGame(State* state, std::vector<Action>* trace) {
+  int num_actions = 0;
+  while (!state->IsTerminal()) {
+    const Action action = state->IsChanceNode()
+                              ? state->LegalActions()[0]
+                              : AsMaliBa(*state).SelectHeuristicRandomAction();
+    if (action == kInvalidAction) break;
+    if (trace != nullptr) trace->push_back(action);
+    state->ApplyAction(action);
+    ++num_actions;
+  }
+  return num_actions;
+}
+
+struct BoardFixture {
+  std::string name;
+  std::shared_ptr<const Game> game;
+  std::vector<Action> trace;               // The fixture game, from the initial state
+  std::unique_ptr<State> mid;
+  std::unique_ptr<State> late;
+  std::map<Phase, std::unique_ptr<State>> first_of_phase;  // Decision nodes only
+  std::unique_ptr<State> play_start;       // First kPlay state, for route setups
+  Action mid_action = kInvalidAction;      // The traced action taken from `mid`
+  Action late_action = kInvalidAction;
+};
+
+// Replays the fixture game and keeps the states named above. `mid` and
+// `late` move forward past chance nodes so every fixture is a decision node.
+std::unique_ptr<BoardFixture> MakeFixture(const std::string& name,
+                                          const GameParameters& params) {
+  auto fixture = std::make_unique<BoardFixture>();
+  fixture->name = name;
+  fixture->game = LoadGame("mali_ba", params);
+  SPIEL_CHECK_TRUE(fixture->game != nullptr);
+
+  std::unique_ptr<State> state = fixture->game->NewInitialState();
+  AsMaliBa(*state).GetRNG().seed(kFixtureSeed);
+  PlayHeuristicGame(state.get(), &fixture->trace);
+  const int length = static_cast<int>(fixture->trace.size());
+  SPIEL_CHECK_GT(length, 0);
+
+  const int mid_target = length / 2;
+  const int late_target = length * 9 / 10;
+  state = fixture->game->NewInitialState();
+  AsMaliBa(*state).GetRNG().seed(kFixtureSeed);
+  for (int i = 0; i < length; ++i) {
+    if (!state->IsChanceNode()) {
+      const Phase phase = AsMaliBa(*state).CurrentPhase();
+      if (!fixture->first_of_phase.count(phase)) fixture->first_of_phase[phase] = state->Clone();
+      if (phase == Phase::kPlay && !fixture->play_start) fixture->play_start = state->Clone();
+      if (i >= mid_target && !fixture->mid) {
+        fixture->mid = state->Clone();
+        fixture->mid_action = fixture->trace[i];
+      }
+      if (i >= late_target && !fixture->late) {
+        fixture->late = state->Clone();
+        fixture->late_action = fixture->trace[i];
+      }
+    }
+    state->ApplyAction(fixture->trace[i]);
+  }
+  SPIEL_CHECK_TRUE(fixture->mid != nullptr);
+  SPIEL_CHECK_TRUE(fixture->late != nullptr);
+  SPIEL_CHECK_TRUE(fixture->play_start != nullptr);
+  return fixture;
+}
+
+// Heap and counting-container allocations made on this thread, as two
+// readings whose difference covers the code between them.
+struct AllocationReading {
+  uint64_t heap = t_heap_allocations;
+  uint64_t hot = ThreadAllocationCounts().allocations;
+};
+
+// Adds "allocs" and "hot_allocs", per iteration, since `start`.
+void ReportAllocations(benchmark::State& bm, const AllocationReading& start) {
+  const AllocationReading end;
+  bm.counters["allocs"] =
+      benchmark::Counter(end.heap - start.heap, benchmark::Counter::kAvgIterations);
+  bm.counters["hot_allocs"] =
+      benchmark::Counter(end.hot - start.hot, benchmark::Counter::kAvgIterations);
+}
+
+// Fixtures live for the whole run; benchmarks only read them or clone them.
+std::vector<std::unique_ptr<BoardFixture>>& Fixtures() {
+  static auto* fixtures = new std::vector<std::unique_ptr<BoardFixture>>();
+  return *fixtures;
+}
+
+// =====================================================================
+// Benchmarks
+// =====================================================================
+
+// Cold generation: the cache is dropped before every call.
+void BM_LegalActions(benchmark::State& bm, const State* fixture) {
+  std::unique_ptr<State> state = fixture->Clone();
+  Mali_BaState& mali_ba_state = AsMaliBa(*state);
+  int64_t num_actions = 0;
+  const AllocationReading start;
+  for (auto _ : bm) {
+    mali_ba_state.ClearCaches();
+    LegalActionsResult result = mali_ba_state.GetLegalActionsAndCounts();
+    num_actions += result.actions.size();
+    benchmark::DoNotOptimize(result);
+  }
+  ReportAllocations(bm, start);
+  bm.counters["actions"] = benchmark::Counter(num_actions, benchmark::Counter::kAvgIterations);
+}
+
+void BM_ApplyUndo(benchmark::State& bm, const State* fixture, Action action) {
+  std::unique_ptr<State> state = fixture->Clone();
+  const Player player = state->CurrentPlayer();
+  // "apply_allocs" counts ApplyAction() alone, "allocs" the pair.
+  uint64_t apply_heap = 0;
+  uint64_t apply_hot = 0;
+  const AllocationReading start;
+  for (auto _ : bm) {
+    const AllocationReading before;
+    state->ApplyAction(action);
+    const AllocationReading applied;
+    apply_heap += applied.heap - before.heap;
+    apply_hot += applied.hot - before.hot;
+    state->UndoAction(player, action);
+  }
+  ReportAllocations(bm, start);
+  bm.counters["apply_allocs"] = benchmark::Counter(apply_heap, benchmark::Counter::kAvgIterations);
+  bm.counters["apply_hot_allocs"] = benchmark::Counter(apply_hot, benchmark::Counter::kAvgIterations);
+}
+
+void BM_Clone(benchmark::State& bm, const State* fixture) {
+  const AllocationReading start;
+  for (auto _ : bm) {
+    std::unique_ptr<State> clone = fixture->Clone();
+    benchmark::DoNotOptimize(clone.get());
+  }
+  ReportAllocations(bm, start);
+  bm.counters["state_bytes"] = AsMaliBa(*fixture).MemoryFootprint().TotalBytes();
+}
+
+void BM_Serialize(benchmark::State& bm, const State* fixture) {
+  int64_t bytes = 0;
+  for (auto _ : bm) {
+    std::string data = fixture->Serialize();
+    bytes += data.size();
+    benchmark::DoNotOptimize(data.data());
+  }
+  bm.SetBytesProcessed(bytes);
+}
+
+void BM_Deserialize(benchmark::State& bm, const State* fixture) {
+  const std::string data = fixture->Serialize();
+  const Game& game = *fixture->GetGame();
+  for (auto _ : bm) {
+    std::unique_ptr<State> state = game.DeserializeState(data);
+    benchmark::DoNotOptimize(state.get());
+  }
+  bm.SetBytesProcessed(static_cast<int64_t>(bm.iterations()) * data.size());
+}
+
+void BM_ObservationTensor(benchmark::State& bm, const State* fixture) {
+  std::vector<float> values(fixture->GetGame()->ObservationTensorSize());
+  const Player player = fixture->CurrentPlayer();
+  for (auto _ : bm) {
+    AsMaliBa(*fixture).ObservationTensor(player, absl::MakeSpan(values));
+    benchmark::DoNotOptimize(values.data());
+  }
+}
+
+// Player 0 holds centers on the bm.range(0) non-city hexes nearest the first
+// city. Routes are capped at five hexes, as in move generation.
+void BM_FindTradeRoutes(benchmark::State& bm, const BoardFixture* fixture) {
+  const auto* game = static_cast<const Mali_BaGame*>(fixture->game.get());
+  std::unique_ptr<State> state = fixture->play_start->Clone();
+  Mali_BaState& mali_ba_state = AsMaliBa(*state);
+  const PlayerColor color = mali_ba_state.GetPlayerColor(0);
+
+  const HexCoord origin = game->GetCities().front().location;
+  std::vector<HexCoord> candidates;
+  for (const HexCoord& hex : game->GetValidHexes()) {
+    if (game->GetCityAt(hex) == nullptr) candidates.push_back(hex);
+  }
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [&](const HexCoord& a, const HexCoord& b) {
+                     return a.Distance(origin) < b.Distance(origin);
+                   });
+  const int num_centers = static_cast<int>(bm.range(0));
+  if (num_centers > static_cast<int>(candidates.size())) {
+    bm.SkipWithError("Board has too few hexes for this many centers");
+    return;
+  }
+  for (int i = 0; i < num_centers; ++i) {
+    mali_ba_state.TestOnly_SetTradePost(candidates[i], color, TradePostType::kCenter);
+  }
+
+  // Mali_BaWhatIf does not memoize routes, so every call is a full search.
+  const Mali_BaWhatIf what_if(mali_ba_state);
+  int64_t num_routes = 0;
+  for (auto _ : bm) {
+    std::vector<std::vector<HexCoord>> routes =
+        what_if.FindPossibleTradeRoutes(color, /*is_valid_per_rules=*/true, nullptr,
+                                        /*max_hexes=*/5);
+    num_routes += routes.size();
+    benchmark::DoNotOptimize(routes);
+  }
+  bm.counters["routes"] = benchmark::Counter(num_routes, benchmark::Counter::kAvgIterations);
+}
+
+// The RNG is reseeded every iteration so the sampled action does not vary
+// with the iteration count.
+void BM_SelectHeuristic(benchmark::State& bm, const State* fixture) {
+  std::unique_ptr<State> state = fixture->Clone();
+  Mali_BaState& mali_ba_state = AsMaliBa(*state);
+  for (auto _ : bm) {
+    mali_ba_state.GetRNG().seed(kFixtureSeed);
+    benchmark::DoNotOptimize(mali_ba_state.SelectHeuristicRandomAction());
+  }
+}
+
+// Whole games from the initial state; game i is seeded with kPlayoutSeed + i.
+void BM_HeuristicPlayout(benchmark::State& bm, const Game* game) {
+  uint32_t seed = kPlayoutSeed;
+  int64_t num_moves = 0;
+  for (auto _ : bm) {
+    std::unique_ptr<State> state = game->NewInitialState();
+    AsMaliBa(*state).GetRNG().seed(seed++);
+    num_moves += PlayHeuristicGame(state.get(), nullptr);
+  }
+  bm.counters["games/s"] = benchmark::Counter(bm.iterations(), benchmark::Counter::kIsRate);
+  bm.counters["moves/s"] = benchmark::Counter(num_moves, benchmark::Counter::kIsRate);
+}
+
+// Game construction from an INI. With `cold` the in-process board cache is
+// dropped first, as in a freshly spawned actor, so the disk cache is read.
+void BM_LoadGame(benchmark::State& bm, GameParameters params, bool cold) {
+  for (auto _ : bm) {
+    if (cold) ClearBoardConfigCache();
+    benchmark::DoNotOptimize(LoadGame("mali_ba", params));
+  }
+}
+
+void RegisterBenchmarks(const BoardFixture& f) {
+  const std::string& b = f.name;
+  for (const auto& [phase, state] : f.first_of_phase) {
+    benchmark::RegisterBenchmark(("LegalActions/" + b + "/" + PhaseName(phase)).c_str(),
+                                 BM_LegalActions, state.get());
+  }
+  benchmark::RegisterBenchmark(("LegalActions/" + b + "/mid").c_str(), BM_LegalActions,
+                               f.mid.get());
+  benchmark::RegisterBenchmark(("LegalActions/" + b + "/late").c_str(), BM_LegalActions,
+                               f.late.get());
+
+  const std::pair<const char*, const State*> positions[] = {{"mid", f.mid.get()},
+                                                            {"late", f.late.get()}};
+  benchmark::RegisterBenchmark(("ApplyUndo/" + b + "/mid").c_str(), BM_ApplyUndo, f.mid.get(),
+                               f.mid_action);
+  benchmark::RegisterBenchmark(("ApplyUndo/" + b + "/late").c_str(), BM_ApplyUndo, f.late.get(),
+                               f.late_action);
+  for (const auto& [label, state] : positions) {
+    const std::string suffix = "/" + b + "/" + label;
+    benchmark::RegisterBenchmark(("Clone" + suffix).c_str(), BM_Clone, state);
+    benchmark::RegisterBenchmark(("Serialize" + suffix).c_str(), BM_Serialize, state);
+    benchmark::RegisterBenchmark(("Deserialize" + suffix).c_str(), BM_Deserialize, state);
+    benchmark::RegisterBenchmark(("ObservationTensor" + suffix).c_str(), BM_ObservationTensor,
+                                 state);
+    benchmark::RegisterBenchmark(("SelectHeuristic" + suffix).c_str(), BM_SelectHeuristic, state);
+  }
+  benchmark::RegisterBenchmark(("FindTradeRoutes/" + b).c_str(), BM_FindTradeRoutes, &f)
+      ->ArgName("centers")
+      ->DenseRange(2, 8, 2);
+  benchmark::RegisterBenchmark(("HeuristicPlayout/" + b).c_str(), BM_HeuristicPlayout,
+                               f.game.get())
+      ->Unit(benchmark::kMillisecond);
+}
+
+}  // namespace
+}  // namespace mali_ba
+}  // namespace open_spiel
+
+int main(int argc, char** argv) {
+  using namespace open_spiel::mali_ba;
+  std::string config_path = DefaultConfigPath();
+  std::vector<char*> args;
+  const std::string flag = "--mali_ba_config=";
+  for (int i = 0; i < argc; ++i) {
+    if (std::string(argv[i]).rfind(flag, 0) == 0) {
+      config_path = std::string(argv[i]).substr(flag.size());
+    } else {
+      args.push_back(argv[i]);
+    }
+  }
+  int num_args = static_cast<int>(args.size());
+  benchmark::Initialize(&num_args, args.data());
+  if (benchmark::ReportUnrecognizedArguments(num_args, args.data())) return 1;
+
+  // Logging would dominate every timing.
+  g_mali_ba_logging_enabled = false;
+  SetAllocationCountingEnabled(true);
+
+  open_spiel::GameParameters params;
+  params["rng_seed"] = open_spiel::GameParameter(kBoardSeed);
+  Fixtures().push_back(MakeFixture("default", params));
+  if (!config_path.empty()) {
+    params["config_file"] = open_spiel::GameParameter(config_path);
+    params["LoggingEnabled"] = open_spiel::GameParameter(false);
+    Fixtures().push_back(MakeFixture("ini", params));
+  }
+  for (const auto& fixture : Fixtures()) RegisterBenchmarks(*fixture);
+  if (!config_path.empty()) {
+    benchmark::RegisterBenchmark("LoadGame/ini/warm", BM_LoadGame, params, false);
+    benchmark::RegisterBenchmark("LoadGame/ini/cold", BM_LoadGame, params, true);
+  }
+
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,197 @@
+// mali_ba_board.h
+// Dense, index-addressed per-hex board storage used by Mali_BaState.
+//
+// Every valid hex owns exactly one HexCell, stored in a contiguous vector and
+// addressed by Mali_BaGame::CoordToIndex(). Tokens and meeples are kept as
+// fixed-size count arrays and posts/centers as one bit per PlayerColor, so
+// board queries never touch the heap and copying the board is a flat memcpy.
+// SharedBoard makes that copy lazy: state copies share one cell array until
+// one of them writes to it.
+#ifndef OPEN_SPIEL_GAMES_MALI_BA_BOARD_H_
+#define OPEN_SPIEL_GAMES_MALI_BA_BOARD_H_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "open_spiel/games/mali_ba/mali_ba_common.h"
+
+namespace open_spiel {
+namespace mali_ba {
+
+// Number of distinct (non-empty) PlayerColor / MeepleColor values.
+constexpr int kNumPlayerColors = 5;
+constexpr int kNumMeepleColors = 10;
+
+inline uint8_t PlayerColorBit(PlayerColor color) {
+  return static_cast<uint8_t>(1u << static_cast<int>(color));
+}
+
+struct HexCell {
+  std::array<uint8_t, kNumPlayerColors> token_counts{};   // Tokens per PlayerColor
+  std::array<uint8_t, kNumMeepleColors> meeple_counts{};  // Meeples per MeepleColor
+  uint8_t num_tokens = 0;
+  uint8_t num_meeples = 0;
+  uint8_t post_mask = 0;    // Bit c set => PlayerColor c has a trading post here
+  uint8_t center_mask = 0;  // Bit c set => PlayerColor c has a trading center here
+
+  // --- Tokens ---
+  int TokenCount(PlayerColor color) const {
+    return token_counts[static_cast<int>(color)];
+  }
+  bool HasToken(PlayerColor color) const { return TokenCount(color) > 0; }
+  void AddToken(PlayerColor color) {
+    ++token_counts[static_cast<int>(color)];
+    ++num_tokens;
+  }
+  bool RemoveToken(PlayerColor color) {
+    uint8_t& count = token_counts[static_cast<int>(color)];
+    if (count == 0) return false;
+    --count;
+    --num_tokens;
+    return true;
+  }
+  void ClearTokens() {
+    token_counts.fill(0);
+    num_tokens = 0;
+  }
+  // Lowest-numbered color with a token here, or kEmpty.
+  PlayerColor FirstToken() const {
+    if (num_tokens == 0) return PlayerColor::kEmpty;
+    for (int c = 0; c < kNumPlayerColors; ++c) {
+      if (token_counts[c] > 0) return static_cast<PlayerColor>(c);
+    }
+    return PlayerColor::kEmpty;
+  }
+
+  // --- Meeples ---
+  // Meeples have no identity beyond their color, so the canonical order of the
+  // meeples on a hex is ascending MeepleColor.
+  int MeepleCount(MeepleColor color) const {
+    return meeple_counts[static_cast<int>(color)];
+  }
+  void AddMeeple(MeepleColor color) {
+    ++meeple_counts[static_cast<int>(color)];
+    ++num_meeples;
+  }
+  bool RemoveMeeple(MeepleColor color) {
+    uint8_t& count = meeple_counts[static_cast<int>(color)];
+    if (count == 0) return false;
+    --count;
+    --num_meeples;
+    return true;
+  }
+  void ClearMeeples() {
+    meeple_counts.fill(0);
+    num_meeples = 0;
+  }
+  // The meeple at position `index` in canonical order, or kEmpty.
+  MeepleColor MeepleAt(int index) const {
+    if (index < 0 || index >= num_meeples) return MeepleColor::kEmpty;
+    for (int c = 0; c < kNumMeepleColors; ++c) {
+      if (index < meeple_counts[c]) return static_cast<MeepleColor>(c);
+      index -= meeple_counts[c];
+    }
+    return MeepleColor::kEmpty;
+  }
+  void AppendMeeples(std::vector<MeepleColor>* out) const {
+    for (int c = 0; c < kNumMeepleColors; ++c) {
+      out->insert(out->end(), meeple_counts[c], static_cast<MeepleColor>(c));
+    }
+  }
+
+  // --- Trading posts & centers ---
+  bool HasPost(PlayerColor color) const { return post_mask & PlayerColorBit(color); }
+  bool HasCenter(PlayerColor color) const { return center_mask & PlayerColorBit(color); }
+  bool HasPostOrCenter(PlayerColor color) const {
+    return (post_mask | center_mask) & PlayerColorBit(color);
+  }
+  TradePostType PostTypeOf(PlayerColor color) const {
+    if (HasCenter(color)) return TradePostType::kCenter;
+    if (HasPost(color)) return TradePostType::kPost;
+    return TradePostType::kNone;
+  }
+  // A player holds at most one post or center per hex; kNone removes it.
+  void SetPost(PlayerColor color, TradePostType type) {
+    const uint8_t bit = PlayerColorBit(color);
+    post_mask &= ~bit;
+    center_mask &= ~bit;
+    if (type == TradePostType::kPost) post_mask |= bit;
+    if (type == TradePostType::kCenter) center_mask |= bit;
+  }
+  int NumCenters() const { return __builtin_popcount(center_mask); }
+  bool HasAnyPost() const { return (post_mask | center_mask) != 0; }
+  // Posts/centers in ascending PlayerColor order.
+  void AppendTradePosts(std::vector<TradePost>* out) const {
+    for (int c = 0; c < kNumPlayerColors; ++c) {
+      PlayerColor color = static_cast<PlayerColor>(c);
+      TradePostType type = PostTypeOf(color);
+      if (type != TradePostType::kNone) out->push_back({color, type});
+    }
+  }
+};
+
+using BoardCells = std::vector<HexCell>;
+
+// Copy-on-write handle to a BoardCells array. Copying a SharedBoard only bumps
+// a reference count; the first Mutable() call on a shared board takes a
+// private copy of the cells. Reads never copy.
+class SharedBoard {
+ public:
+  SharedBoard() : cells_(std::make_shared<BoardCells>()) {}
+
+  void assign(int num_hexes, const HexCell& cell) {
+    cells_ = std::make_shared<BoardCells>(num_hexes, cell);
+  }
+  size_t size() const { return cells_->size(); }
+  const HexCell& operator[](int index) const { return (*cells_)[index]; }
+  BoardCells::const_iterator begin() const { return cells_->begin(); }
+  BoardCells::const_iterator end() const { return cells_->end(); }
+  const BoardCells& cells() const { return *cells_; }
+
+  HexCell& Mutable(int index) {
+    if (cells_.use_count() > 1) cells_ = std::make_shared<BoardCells>(*cells_);
+    return (*cells_)[index];
+  }
+  // True if another state still references the same cell array.
+  bool IsShared() const { return cells_.use_count() > 1; }
+
+ private:
+  std::shared_ptr<BoardCells> cells_;
+};
+
+// Read view of a board with a few cells replaced, for "what if" questions
+// asked during move generation. Replaced cells live in a small flat list, so
+// building a view costs O(changes) rather than a copy of the board. The base
+// board must outlive the view.
+class BoardOverlay {
+ public:
+  explicit BoardOverlay(const SharedBoard& base) : base_(&base) {}
+
+  size_t size() const { return base_->size(); }
+  const HexCell& operator[](int index) const {
+    for (const auto& entry : overrides_) {
+      if (entry.first == index) return entry.second;
+    }
+    return (*base_)[index];
+  }
+  // The view's own copy of a cell; valid until the next Mutable() call.
+  HexCell& Mutable(int index) {
+    for (auto& entry : overrides_) {
+      if (entry.first == index) return entry.second;
+    }
+    overrides_.emplace_back(index, (*base_)[index]);
+    return overrides_.back().second;
+  }
+
+ private:
+  const SharedBoard* base_;
+  std::vector<std::pair<int, HexCell>> overrides_;
+};
+
+}  // namespace mali_ba
+}  // namespace open_spiel
+
+#endif  // OPEN_SPIEL_GAMES_MALI_BA_BOARD_H_
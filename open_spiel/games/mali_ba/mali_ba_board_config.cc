@@ -0,0 +1,591 @@
+// mali_ba_board_config.cc
+// INI parsing, topology building and the in-process and on-disk caches
+
+#include "open_spiel/games/mali_ba/mali_ba_board_config.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include "open_spiel/abseil-cpp/absl/strings/match.h"
+#include "open_spiel/abseil-cpp/absl/strings/str_cat.h"
+#include "open_spiel/abseil-cpp/absl/strings/str_split.h"
+#include "open_spiel/games/mali_ba/mali_ba_common.h"
+
+namespace open_spiel {
+namespace mali_ba {
+namespace {
+
+constexpr char kCacheMagic[4] = {'M', 'B', 'B', 'C'};
+// Bump whenever BoardConfig, the parse or the file layout changes.
+constexpr uint8_t kCacheVersion = 2;
+
+std::string Trim(const std::string& str) {
+  const size_t first = str.find_first_not_of(" \t\n\r");
+  if (first == std::string::npos) return str;
+  const size_t last = str.find_last_not_of(" \t\n\r");
+  return str.substr(first, last - first + 1);
+}
+
+uint64_t Fnv1a(const std::string& bytes) {
+  uint64_t hash = 0xCBF29CE484222325ULL;
+  for (unsigned char c : bytes) {
+    hash ^= c;
+    hash *= 0x100000001B3ULL;
+  }
+  return hash;
+}
+
+HexCoord ParseHexCoord(const std::string& coord_str) {
+  std::vector<std::string> parts = absl::StrSplit(coord_str, ',', absl::SkipEmpty());
+  if (parts.size() != 3) {
+    throw std::invalid_argument("Invalid coordinate format: " + coord_str);
+  }
+  return HexCoord(std::stoi(Trim(parts[0])), std::stoi(Trim(parts[1])),
+                  std::stoi(Trim(parts[2])));
+}
+
+// "x,y,z:x,y,z:..."; bad entries are logged and skipped.
+std::set<HexCoord> ParseHexList(const std::string& hex_string) {
+  std::set<HexCoord> hexes;
+  std::vector<std::string> coords_list = absl::StrSplit(hex_string, ':', absl::SkipEmpty());
+  for (const std::string& coord_str : coords_list) {
+    try {
+      HexCoord hex = ParseHexCoord(coord_str);
+      if (hex.x + hex.y + hex.z == 0) {
+        hexes.insert(hex);
+      } else {
+        LOG_WARN("Invalid hex coordinate ", coord_str, " (x+y+z != 0)");
+      }
+    } catch (const std::exception& e) {
+      LOG_ERROR("Could not parse hex coordinate: ", coord_str);
+    }
+  }
+  return hexes;
+}
+
+// Hop distances are the only table worth storing; pass them in when read
+// from the disk cache, otherwise they are computed with one BFS per hex.
+std::shared_ptr<BoardTopology> BuildTopology(std::vector<HexCoord> hexes,
+                                             std::vector<int16_t> hop_distances) {
+  auto topology = std::make_shared<BoardTopology>();
+  topology->hexes = std::move(hexes);
+  const int n = topology->NumHexes();
+  for (const HexCoord& hex : topology->hexes) {
+    topology->span = std::max({topology->span, std::abs(hex.x), std::abs(hex.y)});
+  }
+  const int width = 2 * topology->span + 1;
+  topology->grid.assign(static_cast<size_t>(width) * width, -1);
+  for (int i = 0; i < n; ++i) {
+    const HexCoord& hex = topology->hexes[i];
+    topology->grid[(hex.x + topology->span) * width + (hex.y + topology->span)] = i;
+  }
+
+  topology->neighbors.assign(n, {});
+  for (int i = 0; i < n; ++i) {
+    for (int dir = 0; dir < 6; ++dir) {
+      topology->neighbors[i][dir] =
+          static_cast<int16_t>(topology->IndexOf(topology->hexes[i] + kHexDirections[dir]));
+    }
+  }
+
+  if (hop_distances.size() == static_cast<size_t>(n) * n) {
+    topology->hop_distances = std::move(hop_distances);
+  } else {
+    topology->hop_distances.assign(static_cast<size_t>(n) * n, -1);
+    std::vector<int> frontier;
+    for (int source = 0; source < n; ++source) {
+      int16_t* row = &topology->hop_distances[static_cast<size_t>(source) * n];
+      row[source] = 0;
+      frontier.assign(1, source);
+      for (size_t head = 0; head < frontier.size(); ++head) {
+        const int current = frontier[head];
+        for (int16_t neighbor : topology->neighbors[current]) {
+          if (neighbor < 0 || row[neighbor] >= 0) continue;
+          row[neighbor] = static_cast<int16_t>(row[current] + 1);
+          frontier.push_back(neighbor);
+        }
+      }
+    }
+  }
+
+  topology->cube_distances.resize(static_cast<size_t>(n) * n);
+  for (int from = 0; from < n; ++from) {
+    for (int to = 0; to < n; ++to) {
+      topology->cube_distances[static_cast<size_t>(from) * n + to] =
+          static_cast<int16_t>(topology->hexes[from].Distance(topology->hexes[to]));
+    }
+  }
+  return topology;
+}
+
+struct Caches {
+  std::mutex mutex;
+  std::map<uint64_t, std::shared_ptr<const BoardConfig>> configs;
+  std::map<std::vector<HexCoord>, std::shared_ptr<const BoardTopology>> topologies;
+};
+
+Caches& GetCaches() {
+  static auto* caches = new Caches();
+  return *caches;
+}
+
+// Keeps whichever topology for these hexes got registered first, so racing
+// builders still end up sharing one.
+std::shared_ptr<const BoardTopology> InternTopology(std::shared_ptr<const BoardTopology> topology) {
+  Caches& caches = GetCaches();
+  std::lock_guard<std::mutex> lock(caches.mutex);
+  return caches.topologies.emplace(topology->hexes, topology).first->second;
+}
+
+// Identifies the code that wrote a cache file: the format version, the
+// layout of the types it decodes into and the build of this file, so a
+// rebuilt parser never trusts files an older one wrote.
+uint64_t BuildFingerprint() {
+#ifdef __VERSION__
+  constexpr char kCompiler[] = __VERSION__;
+#else
+  constexpr char kCompiler[] = "";
+#endif
+  static const uint64_t fingerprint =
+      Fnv1a(absl::StrCat(static_cast<int>(kCacheVersion), ":", sizeof(BoardConfig), ":",
+                         sizeof(HexCoord), ":", __DATE__, " ", __TIME__, ":", kCompiler));
+  return fingerprint;
+}
+
+// --- Disk cache format ---
+// Magic, version, build fingerprint, content hash and size, then the
+// BoardConfig fields in declaration order, then the topology's hop distances
+// for custom boards, then an 8-byte FNV-1a checksum of everything before it.
+
+class CacheWriter {
+ public:
+  void Byte(uint8_t value) { out_.push_back(static_cast<char>(value)); }
+  void Varint(uint64_t value) {
+    while (value >= 0x80) {
+      Byte(static_cast<uint8_t>(value | 0x80));
+      value >>= 7;
+    }
+    Byte(static_cast<uint8_t>(value));
+  }
+  void Signed(int64_t value) {
+    Varint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+  }
+  void String(const std::string& value) {
+    Varint(value.size());
+    out_.append(value);
+  }
+  void StringMap(const std::map<std::string, std::string>& values) {
+    Varint(values.size());
+    for (const auto& [key, value] : values) {
+      String(key);
+      String(value);
+    }
+  }
+  void Hex(const HexCoord& hex) {
+    Signed(hex.x);
+    Signed(hex.y);
+  }
+  const std::string& data() const { return out_; }
+
+ private:
+  std::string out_;
+};
+
+// A cache file is only a hint, so a bad read sets a flag instead of failing.
+class CacheReader {
+ public:
+  explicit CacheReader(const std::string& data) : data_(data) {}
+
+  bool ok() const { return ok_; }
+  bool AtEnd() const { return pos_ == data_.size(); }
+
+  uint8_t Byte() {
+    if (pos_ >= data_.size()) {
+      ok_ = false;
+      return 0;
+    }
+    return static_cast<uint8_t>(data_[pos_++]);
+  }
+  uint64_t Varint() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64 && ok_; shift += 7) {
+      const uint8_t byte = Byte();
+      value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0) return value;
+    }
+    ok_ = false;
+    return 0;
+  }
+  int64_t Signed() {
+    const uint64_t value = Varint();
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+  }
+  // Each element takes at least one byte, which bounds any count.
+  size_t Count() {
+    const uint64_t count = Varint();
+    if (count > data_.size() - pos_) ok_ = false;
+    return ok_ ? static_cast<size_t>(count) : 0;
+  }
+  std::string String() {
+    const size_t size = Count();
+    std::string value = data_.substr(pos_, size);
+    pos_ += size;
+    return value;
+  }
+  std::map<std::string, std::string> StringMap() {
+    std::map<std::string, std::string> values;
+    for (size_t n = Count(); n > 0 && ok_; --n) {
+      std::string key = String();
+      values[key] = String();
+    }
+    return values;
+  }
+  HexCoord Hex() {
+    const int x = static_cast<int>(Signed());
+    const int y = static_cast<int>(Signed());
+    return HexCoord(x, y);
+  }
+
+ private:
+  const std::string& data_;
+  size_t pos_ = 0;
+  bool ok_ = true;
+};
+
+std::string EncodeCacheFile(const BoardConfig& config) {
+  CacheWriter writer;
+  for (char c : kCacheMagic) writer.Byte(static_cast<uint8_t>(c));
+  writer.Byte(kCacheVersion);
+  writer.Varint(BuildFingerprint());
+  writer.Varint(config.content_hash);
+  writer.Varint(config.content_size);
+  writer.StringMap(config.params);
+  writer.StringMap(config.board_section);
+  writer.StringMap(config.heuristics_section);
+  writer.StringMap(config.training_section);
+  writer.String(config.custom_cities);
+  writer.Varint(config.region_names.size());
+  for (const auto& [id, name] : config.region_names) {
+    writer.Signed(id);
+    writer.String(name);
+  }
+  writer.Byte(config.custom_board_defined ? 1 : 0);
+  // valid_hexes is exactly the keys of hex_regions.
+  writer.Varint(config.hex_regions.size());
+  for (const auto& [hex, region] : config.hex_regions) {
+    writer.Hex(hex);
+    writer.Signed(region);
+  }
+  writer.Varint(config.coastal_hexes.size());
+  for (const HexCoord& hex : config.coastal_hexes) writer.Hex(hex);
+  if (config.topology) {
+    writer.Varint(config.topology->hop_distances.size());
+    for (int16_t distance : config.topology->hop_distances) writer.Signed(distance);
+  } else {
+    writer.Varint(0);
+  }
+  std::string data = writer.data();
+  const uint64_t checksum = Fnv1a(data);
+  for (int shift = 0; shift < 64; shift += 8) {
+    data.push_back(static_cast<char>((checksum >> shift) & 0xFF));
+  }
+  return data;
+}
+
+// Null unless the file is intact and was written for exactly this INI.
+std::shared_ptr<const BoardConfig> DecodeCacheFile(const std::string& file, uint64_t hash,
+                                                   uint64_t size) {
+  if (file.size() < sizeof(uint64_t)) return nullptr;
+  const std::string data = file.substr(0, file.size() - sizeof(uint64_t));
+  uint64_t checksum = 0;
+  for (int i = 0; i < 8; ++i) {
+    checksum |= static_cast<uint64_t>(static_cast<uint8_t>(file[data.size() + i])) << (8 * i);
+  }
+  if (checksum != Fnv1a(data)) return nullptr;
+
+  CacheReader reader(data);
+  for (char c : kCacheMagic) {
+    if (reader.Byte() != static_cast<uint8_t>(c)) return nullptr;
+  }
+  if (reader.Byte() != kCacheVersion || reader.Varint() != BuildFingerprint()) return nullptr;
+  if (reader.Varint() != hash || reader.Varint() != size || !reader.ok()) return nullptr;
+
+  auto config = std::make_shared<BoardConfig>();
+  config->content_hash = hash;
+  config->content_size = size;
+  config->params = reader.StringMap();
+  config->board_section = reader.StringMap();
+  config->heuristics_section = reader.StringMap();
+  config->training_section = reader.StringMap();
+  config->custom_cities = reader.String();
+  for (size_t n = reader.Count(); n > 0 && reader.ok(); --n) {
+    const int id = static_cast<int>(reader.Signed());
+    config->region_names[id] = reader.String();
+  }
+  config->custom_board_defined = reader.Byte() != 0;
+  for (size_t n = reader.Count(); n > 0 && reader.ok(); --n) {
+    const HexCoord hex = reader.Hex();
+    config->valid_hexes.insert(hex);
+    config->hex_regions[hex] = static_cast<int>(reader.Signed());
+  }
+  for (size_t n = reader.Count(); n > 0 && reader.ok(); --n) {
+    config->coastal_hexes.insert(reader.Hex());
+  }
+  std::vector<int16_t> hop_distances(reader.Count());
+  for (int16_t& distance : hop_distances) distance = static_cast<int16_t>(reader.Signed());
+  if (!reader.ok() || !reader.AtEnd()) return nullptr;
+
+  if (config->custom_board_defined) {
+    const size_t n = config->valid_hexes.size();
+    if (hop_distances.size() != n * n) return nullptr;
+    config->topology = InternTopology(BuildTopology(
+        std::vector<HexCoord>(config->valid_hexes.begin(), config->valid_hexes.end()),
+        std::move(hop_distances)));
+  }
+  return config;
+}
+
+bool ReadFile(const std::string& path, std::string* contents) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) return false;
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  *contents = buffer.str();
+  return true;
+}
+
+// Creates `cache_dir` (0700) if needed and checks that only this user can
+// plant files in it: it must be a real directory owned by us and not
+// writable by group or others. False means the disk cache stays off.
+bool PrepareCacheDir(const std::string& cache_dir) {
+  std::error_code error;
+  if (std::filesystem::create_directories(cache_dir, error)) {
+    std::filesystem::permissions(cache_dir, std::filesystem::perms::owner_all,
+                                 std::filesystem::perm_options::replace, error);
+  }
+  struct stat info;
+  if (lstat(cache_dir.c_str(), &info) != 0 || !S_ISDIR(info.st_mode)) {
+    LOG_DEBUG("Board cache: no directory at ", cache_dir);
+    return false;
+  }
+  if (info.st_uid != geteuid() || (info.st_mode & (S_IWGRP | S_IWOTH)) != 0) {
+    LOG_WARN("Board cache: ignoring ", cache_dir,
+             ", which is not a private directory of the current user");
+    return false;
+  }
+  return true;
+}
+
+// Only regular files this user wrote are read back; symlinks are not followed.
+bool IsOwnedRegularFile(const std::string& path) {
+  struct stat info;
+  return lstat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode) &&
+         info.st_uid == geteuid();
+}
+
+// Written to a fresh temporary name (0600, never through an existing file or
+// symlink) and renamed into place, so concurrent processes never read a
+// half-written file.
+void WriteCacheFile(const std::string& path, const std::string& data) {
+  std::error_code error;
+  const std::string temp_path = absl::StrCat(
+      path, ".tmp.", getpid(), ".", std::hash<std::thread::id>()(std::this_thread::get_id()),
+      ".", std::chrono::steady_clock::now().time_since_epoch().count());
+  const int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW, 0600);
+  if (fd < 0) {
+    LOG_DEBUG("Board cache: cannot write ", temp_path);
+    return;
+  }
+  size_t written = 0;
+  while (written < data.size()) {
+    const ssize_t n = write(fd, data.data() + written, data.size() - written);
+    if (n <= 0) break;
+    written += static_cast<size_t>(n);
+  }
+  if (close(fd) != 0 || written != data.size()) {
+    std::remove(temp_path.c_str());
+    return;
+  }
+  std::filesystem::rename(temp_path, path, error);
+  if (error) {
+    LOG_DEBUG("Board cache: cannot rename ", temp_path, ": ", error.message());
+    std::remove(temp_path.c_str());
+  }
+}
+
+}  // namespace
+
+std::shared_ptr<const BoardTopology> GetBoardTopology(const std::set<HexCoord>& hexes) {
+  std::vector<HexCoord> key(hexes.begin(), hexes.end());
+  {
+    Caches& caches = GetCaches();
+    std::lock_guard<std::mutex> lock(caches.mutex);
+    auto it = caches.topologies.find(key);
+    if (it != caches.topologies.end()) return it->second;
+  }
+  return InternTopology(BuildTopology(std::move(key), {}));
+}
+
+std::shared_ptr<const BoardConfig> ParseBoardConfig(const std::string& contents) {
+  auto config = std::make_shared<BoardConfig>();
+  config->content_hash = Fnv1a(contents);
+  config->content_size = contents.size();
+
+  std::map<std::string, std::string> region_section;
+  std::string current_section;
+  std::istringstream content_stream(contents);
+  std::string line;
+  while (std::getline(content_stream, line)) {
+    line = Trim(line);
+    if (line.empty() || line[0] == ';' || line[0] == '#') continue;
+    if (line[0] == '[' && line.back() == ']') {
+      current_section = Trim(line.substr(1, line.length() - 2));
+      continue;
+    }
+    const size_t eq_pos = line.find('=');
+    if (eq_pos == std::string::npos) continue;
+    const std::string key = Trim(line.substr(0, eq_pos));
+    const std::string value = Trim(line.substr(eq_pos + 1));
+    if (current_section == "Board") {
+      config->board_section[key] = value;
+    } else if (current_section == "Cities" && absl::StartsWith(key, "city")) {
+      if (!config->custom_cities.empty()) config->custom_cities += ":";
+      config->custom_cities += value;
+    } else if (current_section == "Regions") {
+      region_section[key] = value;
+    } else if (current_section == "Heuristics") {
+      config->heuristics_section[key] = value;
+    } else if (current_section == "Training") {
+      config->training_section[key] = value;
+    } else {
+      config->params[key] = value;
+    }
+  }
+
+  const std::string region_prefix = "region";
+  for (const auto& [key, name] : region_section) {
+    if (!absl::StartsWith(key, region_prefix)) continue;
+    try {
+      const int region_id = std::stoi(key.substr(region_prefix.length()));
+      config->region_names[region_id] = name;
+      LOG_DEBUG("Loaded Region Name: ID ", region_id, " -> '", name, "'");
+    } catch (const std::exception& e) {
+      LOG_WARN("Could not parse region ID from key: ", key);
+    }
+  }
+
+  const std::string hexes_prefix = "custom_hexes";
+  for (const auto& [key, value] : config->board_section) {
+    if (!absl::StartsWith(key, hexes_prefix)) continue;
+    config->custom_board_defined = true;
+    int region_id = 0;
+    const std::string region_num_str = key.substr(hexes_prefix.length());
+    if (!region_num_str.empty()) {
+      try {
+        region_id = std::stoi(region_num_str);
+      } catch (const std::exception& e) {
+        LOG_WARN("Could not parse region ID from key: ", key);
+        continue;
+      }
+    }
+    LOG_DEBUG("Parsing hexes for region ", region_id, " from key '", key, "'");
+    for (const HexCoord& hex : ParseHexList(value)) {
+      if (config->hex_regions.count(hex)) {
+        LOG_WARN("Hex ", hex.ToString(), " is defined in multiple regions. Overwriting with region ",
+                 region_id);
+      }
+      config->valid_hexes.insert(hex);
+      config->hex_regions[hex] = region_id;
+    }
+  }
+
+  auto coastal = config->board_section.find("coastal_hexes");
+  if (coastal != config->board_section.end()) {
+    config->coastal_hexes = ParseHexList(coastal->second);
+  }
+  if (config->custom_board_defined) config->topology = GetBoardTopology(config->valid_hexes);
+  return config;
+}
+
+std::shared_ptr<const BoardConfig> LoadBoardConfig(const std::string& path,
+                                                   const std::string& cache_dir) {
+  std::string contents;
+  if (!ReadFile(path, &contents)) return nullptr;
+  const uint64_t hash = Fnv1a(contents);
+  Caches& caches = GetCaches();
+  {
+    std::lock_guard<std::mutex> lock(caches.mutex);
+    auto it = caches.configs.find(hash);
+    if (it != caches.configs.end() && it->second->content_size == contents.size()) {
+      return it->second;
+    }
+  }
+
+  std::shared_ptr<const BoardConfig> config;
+  const std::string cache_path = !cache_dir.empty() && PrepareCacheDir(cache_dir)
+                                     ? BoardCacheFilePath(cache_dir, hash)
+                                     : "";
+  std::string cached;
+  if (!cache_path.empty() && IsOwnedRegularFile(cache_path) && ReadFile(cache_path, &cached)) {
+    config = DecodeCacheFile(cached, hash, contents.size());
+    if (config) {
+      LOG_DEBUG("Board cache: loaded ", path, " from ", cache_path);
+    } else {
+      LOG_WARN("Board cache: ignoring unreadable or stale ", cache_path);
+    }
+  }
+  if (!config) {
+    config = ParseBoardConfig(contents);
+    if (!cache_path.empty()) WriteCacheFile(cache_path, EncodeCacheFile(*config));
+  }
+
+  std::lock_guard<std::mutex> lock(caches.mutex);
+  auto [it, inserted] = caches.configs.emplace(hash, config);
+  if (!inserted && it->second->content_size != contents.size()) it->second = config;
+  return it->second;
+}
+
+std::string DefaultBoardCacheDir() {
+  std::filesystem::path base;
+  const char* xdg_cache = std::getenv("XDG_CACHE_HOME");
+  const char* home = std::getenv("HOME");
+  if (xdg_cache != nullptr && xdg_cache[0] == '/') {
+    base = xdg_cache;
+  } else if (home != nullptr && home[0] == '/') {
+    base = std::filesystem::path(home) / ".cache";
+  } else {
+    return "";
+  }
+  return (base / "mali_ba_board_cache").string();
+}
+
+std::string BoardCacheFilePath(const std::string& cache_dir, uint64_t content_hash) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "board_%016llx.bin",
+                static_cast<unsigned long long>(content_hash ^ BuildFingerprint()));
+  return (std::filesystem::path(cache_dir) / name).string();
+}
+
+void ClearBoardConfigCache() {
+  Caches& caches = GetCaches();
+  std::lock_guard<std::mutex> lock(caches.mutex);
+  caches.configs.clear();
+  caches.topologies.clear();
+}
+
+}  // namespace mali_ba
+}  // namespace open_spiel
@@ -0,0 +1,106 @@
+// mali_ba_board_config.h
+// Parsed INI board configurations and board topologies, built once per
+// process and shared by every Mali_BaGame that uses them.
+//
+// LoadBoardConfig() keys a configuration by a hash of the INI file's bytes,
+// so loading the same file again (another pyspiel.load_game, another actor)
+// returns the instance already in memory, and editing the file picks up the
+// change. Parsed configurations are also written to an on-disk binary cache,
+// so a freshly spawned process skips the text parse too. A missing, stale or
+// corrupt cache file is ignored and rewritten. Cache files are keyed by the
+// INI bytes and a fingerprint of the build that wrote them, and are only
+// read from a directory private to the current user.
+//
+// A BoardTopology holds the dense per-hex tables derived from a set of valid
+// hexes: the coordinate grid behind CoordToIndex(), neighbors, hop and cube
+// distances. Games on the same board share one.
+#ifndef OPEN_SPIEL_GAMES_MALI_BA_BOARD_CONFIG_H_
+#define OPEN_SPIEL_GAMES_MALI_BA_BOARD_CONFIG_H_
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "open_spiel/games/mali_ba/hex_grid.h"
+
+namespace open_spiel {
+namespace mali_ba {
+
+struct BoardTopology {
+  // Valid hexes in std::set order; a hex's position here is its index.
+  std::vector<HexCoord> hexes;
+  // Largest |x| or |y| of any hex; the grid spans [-span, span] on both.
+  int span = 0;
+  // (x + span) * (2 * span + 1) + (y + span) -> hex index, -1 if not on the board.
+  std::vector<int> grid;
+  std::vector<std::array<int16_t, 6>> neighbors;  // kHexDirections order, -1 off-board
+  std::vector<int16_t> hop_distances;             // hexes x hexes, -1 if not connected
+  std::vector<int16_t> cube_distances;            // hexes x hexes
+
+  int NumHexes() const { return static_cast<int>(hexes.size()); }
+  int IndexOf(const HexCoord& hex) const {
+    if (hex.x + hex.y + hex.z != 0 || hex.x < -span || hex.x > span ||
+        hex.y < -span || hex.y > span) {
+      return -1;
+    }
+    return grid[(hex.x + span) * (2 * span + 1) + (hex.y + span)];
+  }
+};
+
+// The topology of a board with exactly these hexes, shared with every other
+// caller asking for the same set.
+std::shared_ptr<const BoardTopology> GetBoardTopology(const std::set<HexCoord>& hexes);
+
+struct BoardConfig {
+  // FNV-1a hash and size of the INI bytes this was parsed from.
+  uint64_t content_hash = 0;
+  uint64_t content_size = 0;
+
+  // Keys outside the named sections: game parameter overrides, raw values.
+  std::map<std::string, std::string> params;
+  std::map<std::string, std::string> board_section;
+  std::map<std::string, std::string> heuristics_section;
+  std::map<std::string, std::string> training_section;
+  // [Cities] cityN values joined with ':', in key order; empty if none.
+  std::string custom_cities;
+  // [Regions] regionN names, by N.
+  std::map<int, std::string> region_names;
+
+  // True if [Board] has any custom_hexesN key; the board is then exactly
+  // the hexes below, each in the last region that listed it.
+  bool custom_board_defined = false;
+  std::set<HexCoord> valid_hexes;
+  std::map<HexCoord, int> hex_regions;
+  std::set<HexCoord> coastal_hexes;
+  // Topology of valid_hexes; null unless custom_board_defined.
+  std::shared_ptr<const BoardTopology> topology;
+};
+
+// Parses INI text; never touches either cache.
+std::shared_ptr<const BoardConfig> ParseBoardConfig(const std::string& contents);
+
+// The configuration in the INI file at `path`, or null if it cannot be read.
+// `cache_dir` is where the on-disk cache lives; empty disables it, and so
+// does a directory that is not owned by and private to the current user.
+std::shared_ptr<const BoardConfig> LoadBoardConfig(const std::string& path,
+                                                   const std::string& cache_dir);
+
+// $XDG_CACHE_HOME/mali_ba_board_cache, else ~/.cache/mali_ba_board_cache;
+// empty (no disk cache) if neither variable is set.
+std::string DefaultBoardCacheDir();
+// Cache file this build's LoadBoardConfig() uses for INI contents with this
+// hash.
+std::string BoardCacheFilePath(const std::string& cache_dir, uint64_t content_hash);
+
+// Drops the in-process caches (not the files); later loads re-read the disk
+// cache. Games already constructed keep what they hold.
+void ClearBoardConfigCache();
+
+}  // namespace mali_ba
+}  // namespace open_spiel
+
+#endif  // OPEN_SPIEL_GAMES_MALI_BA_BOARD_CONFIG_H_
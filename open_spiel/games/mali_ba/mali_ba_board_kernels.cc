@@ -0,0 +1,113 @@
+// mali_ba_board_kernels.cc
+// Board scan instantiations and the choice between them
+
+#include "open_spiel/games/mali_ba/mali_ba_board_kernels.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "open_spiel/spiel_utils.h"
+
+namespace open_spiel {
+namespace mali_ba {
+namespace {
+
+constexpr int RegularBoardHexes(int radius) { return 3 * radius * (radius + 1) + 1; }
+
+static_assert(RegularBoardHexes(5) <= kMaxHexes, "the largest specialized board must fit");
+
+// kNumHexes > 0 fixes the trip count at compile time; 0 reads num_hexes.
+// The bit is or-ed in unconditionally so the loop body has no branch.
+template <int kNumHexes, typename Pred>
+HexMask Scan(const HexCell* cells, int num_hexes, Pred pred) {
+  const int n = kNumHexes > 0 ? kNumHexes : num_hexes;
+  HexMask mask;
+  for (int i = 0; i < n; ++i) {
+    mask.words[i >> 6] |= static_cast<uint64_t>(pred(cells[i])) << (i & 63);
+  }
+  return mask;
+}
+
+template <int kNumHexes>
+HexMask TokenScan(const HexCell* cells, int num_hexes, PlayerColor color) {
+  const int c = static_cast<int>(color);
+  return Scan<kNumHexes>(cells, num_hexes,
+                         [c](const HexCell& cell) { return cell.token_counts[c] != 0; });
+}
+
+template <int kNumHexes>
+HexMask PostScan(const HexCell* cells, int num_hexes, PlayerColor color) {
+  const uint8_t bit = PlayerColorBit(color);
+  return Scan<kNumHexes>(cells, num_hexes,
+                         [bit](const HexCell& cell) { return (cell.post_mask & bit) != 0; });
+}
+
+template <int kNumHexes>
+HexMask TokenFreeScan(const HexCell* cells, int num_hexes) {
+  return Scan<kNumHexes>(cells, num_hexes,
+                         [](const HexCell& cell) { return cell.num_tokens == 0; });
+}
+
+template <int kNumHexes>
+HexMask OccupiedScan(const HexCell* cells, int num_hexes) {
+  return Scan<kNumHexes>(cells, num_hexes, [](const HexCell& cell) {
+    return (cell.num_tokens | cell.num_meeples | cell.post_mask | cell.center_mask) != 0;
+  });
+}
+
+template <int kNumHexes>
+constexpr BoardKernels::Scans MakeScans() {
+  return {&TokenScan<kNumHexes>, &PostScan<kNumHexes>, &TokenFreeScan<kNumHexes>,
+          &OccupiedScan<kNumHexes>};
+}
+
+// Radius of the regular board these hexes form, 0 if they form none. A set
+// of hexes within cube distance r of the origin is the whole radius-r board
+// exactly when it has that board's hex count.
+int RegularRadius(const BoardTopology& topology) {
+  int radius = 0;
+  for (const HexCoord& hex : topology.hexes) {
+    radius = std::max({radius, std::abs(hex.x), std::abs(hex.y), std::abs(hex.z)});
+  }
+  return topology.NumHexes() == RegularBoardHexes(radius) ? radius : 0;
+}
+
+}  // namespace
+
+BoardKernels::BoardKernels(const BoardTopology& topology, bool specialize)
+    : num_hexes_(topology.NumHexes()) {
+  SPIEL_CHECK_LE(num_hexes_, kHexMaskWords * 64);
+  const int radius = specialize ? RegularRadius(topology) : 0;
+  switch (radius) {
+    case 3: scans_ = MakeScans<RegularBoardHexes(3)>(); break;
+    case 4: scans_ = MakeScans<RegularBoardHexes(4)>(); break;
+    case 5: scans_ = MakeScans<RegularBoardHexes(5)>(); break;
+    default: scans_ = MakeScans<0>(); break;
+  }
+  specialized_radius_ = (radius >= 3 && radius <= 5) ? radius : 0;
+
+  // within_hops_[start][h] holds every hex 1..h steps away; an unreachable
+  // hex (-1) is in none of them.
+  max_hops_ = 0;
+  for (int16_t hops : topology.hop_distances) max_hops_ = std::max<int>(max_hops_, hops);
+  const int row = max_hops_ + 1;
+  within_hops_.assign(static_cast<size_t>(num_hexes_) * row, HexMask());
+  for (int start = 0; start < num_hexes_; ++start) {
+    HexMask* masks = &within_hops_[static_cast<size_t>(start) * row];
+    for (int to = 0; to < num_hexes_; ++to) {
+      const int hops = topology.hop_distances[static_cast<size_t>(start) * num_hexes_ + to];
+      if (hops >= 1) masks[hops].Set(to);
+    }
+    for (int h = 1; h < row; ++h) masks[h] |= masks[h - 1];
+  }
+}
+
+const HexMask& BoardKernels::WithinHops(int start, int max_hops) const {
+  SPIEL_CHECK_GE(start, 0);
+  SPIEL_CHECK_LT(start, num_hexes_);
+  const int hops = std::max(0, std::min(max_hops, max_hops_));
+  return within_hops_[static_cast<size_t>(start) * (max_hops_ + 1) + hops];
+}
+
+}  // namespace mali_ba
+}  // namespace open_spiel
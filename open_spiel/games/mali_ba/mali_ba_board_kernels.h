@@ -0,0 +1,147 @@
+// mali_ba_board_kernels.h
+// Per-hex board scans, specialized at compile time for the regular boards.
+//
+// The hot loops over the board (which hexes hold the mover's tokens or
+// posts, which cells the observation must write, which hexes a mancala move
+// can reach) all produce a set of hex indices. Here they produce a HexMask,
+// one bit per hex: kMaxHexes fits in two 64-bit words.
+//
+// GenerateRegularBoard() boards of radius 3, 4 and 5 (37, 61 and 91 hexes)
+// get scans instantiated with their hex count as a constant, so the cell
+// loops have a fixed trip count and the compiler unrolls and vectorizes
+// them. Any other board, such as a custom INI board, gets the instantiation
+// that reads the count at runtime. BoardKernels picks one when the game is
+// built; callers never see which.
+#ifndef OPEN_SPIEL_GAMES_MALI_BA_BOARD_KERNELS_H_
+#define OPEN_SPIEL_GAMES_MALI_BA_BOARD_KERNELS_H_
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "open_spiel/games/mali_ba/mali_ba_board.h"
+#include "open_spiel/games/mali_ba/mali_ba_board_config.h"
+#include "open_spiel/games/mali_ba/mali_ba_common.h"
+
+namespace open_spiel {
+namespace mali_ba {
+
+constexpr int kHexMaskWords = (kMaxHexes + 63) / 64;
+
+// A set of hex indices, one bit each.
+struct HexMask {
+  std::array<uint64_t, kHexMaskWords> words{};
+
+  void Set(int index) { words[index >> 6] |= uint64_t{1} << (index & 63); }
+  void Reset(int index) { words[index >> 6] &= ~(uint64_t{1} << (index & 63)); }
+  bool Test(int index) const { return (words[index >> 6] >> (index & 63)) & 1; }
+  bool Any() const {
+    for (uint64_t word : words) {
+      if (word != 0) return true;
+    }
+    return false;
+  }
+  int Count() const {
+    int count = 0;
+    for (uint64_t word : words) count += __builtin_popcountll(word);
+    return count;
+  }
+  HexMask& operator&=(const HexMask& other) {
+    for (int w = 0; w < kHexMaskWords; ++w) words[w] &= other.words[w];
+    return *this;
+  }
+  HexMask& operator|=(const HexMask& other) {
+    for (int w = 0; w < kHexMaskWords; ++w) words[w] |= other.words[w];
+    return *this;
+  }
+  // Removes every hex in `other`.
+  HexMask& Remove(const HexMask& other) {
+    for (int w = 0; w < kHexMaskWords; ++w) words[w] &= ~other.words[w];
+    return *this;
+  }
+  bool operator==(const HexMask& other) const { return words == other.words; }
+  bool operator!=(const HexMask& other) const { return words != other.words; }
+
+  // The n-th (0-based) hex of the set in ascending index order; -1 if the
+  // set has n or fewer hexes.
+  int Nth(int n) const {
+    if (n < 0) return -1;
+    for (int w = 0; w < kHexMaskWords; ++w) {
+      const int in_word = __builtin_popcountll(words[w]);
+      if (n >= in_word) {
+        n -= in_word;
+        continue;
+      }
+      uint64_t word = words[w];
+      for (; n > 0; --n) word &= word - 1;
+      return w * 64 + __builtin_ctzll(word);
+    }
+    return -1;
+  }
+
+  // Calls fn(index) for every hex in the set, in ascending index order.
+  template <typename Fn>
+  void ForEach(Fn&& fn) const {
+    for (int w = 0; w < kHexMaskWords; ++w) {
+      for (uint64_t word = words[w]; word != 0; word &= word - 1) {
+        fn(w * 64 + __builtin_ctzll(word));
+      }
+    }
+  }
+};
+
+inline HexMask operator&(HexMask a, const HexMask& b) { return a &= b; }
+inline HexMask operator|(HexMask a, const HexMask& b) { return a |= b; }
+
+class BoardKernels {
+ public:
+  // With `specialize` false the generic scans are used even on a regular
+  // board; tests compare the two.
+  explicit BoardKernels(const BoardTopology& topology, bool specialize = true);
+
+  int NumHexes() const { return num_hexes_; }
+  // Radius of the regular board the scans were specialized for; 0 if generic.
+  int SpecializedRadius() const { return specialized_radius_; }
+
+  // Hexes whose cell holds a token of `color`.
+  HexMask TokenHexes(const BoardCells& cells, PlayerColor color) const {
+    return scans_.tokens(cells.data(), num_hexes_, color);
+  }
+  // Hexes where `color` has a trading post (not a center).
+  HexMask PostHexes(const BoardCells& cells, PlayerColor color) const {
+    return scans_.posts(cells.data(), num_hexes_, color);
+  }
+  // Hexes with no token of any color.
+  HexMask TokenFreeHexes(const BoardCells& cells) const {
+    return scans_.token_free(cells.data(), num_hexes_);
+  }
+  // Hexes with any token, meeple, post or center.
+  HexMask OccupiedHexes(const BoardCells& cells) const {
+    return scans_.occupied(cells.data(), num_hexes_);
+  }
+  // Hexes 1 to `max_hops` on-board steps from `start` (never `start` itself).
+  const HexMask& WithinHops(int start, int max_hops) const;
+  // This object plus its within-hops table.
+  size_t MemoryBytes() const { return sizeof(*this) + within_hops_.capacity() * sizeof(HexMask); }
+
+  // The scans, for one hex count; the count is a template constant in the
+  // specialized instantiations and ignored there.
+  struct Scans {
+    HexMask (*tokens)(const HexCell* cells, int num_hexes, PlayerColor color);
+    HexMask (*posts)(const HexCell* cells, int num_hexes, PlayerColor color);
+    HexMask (*token_free)(const HexCell* cells, int num_hexes);
+    HexMask (*occupied)(const HexCell* cells, int num_hexes);
+  };
+
+ private:
+  int num_hexes_ = 0;
+  int specialized_radius_ = 0;
+  Scans scans_;
+  int max_hops_ = 0;                  // Largest finite hop distance on the board
+  std::vector<HexMask> within_hops_;  // [start * (max_hops_ + 1) + hops]
+};
+
+}  // namespace mali_ba
+}  // namespace open_spiel
+
+#endif  // OPEN_SPIEL_GAMES_MALI_BA_BOARD_KERNELS_H_
@@ -6,6 +6,7 @@
 #include <iostream>
 #include <chrono>
 #include <iomanip>
+#include <mutex>
 #include <sstream>
 
 namespace open_spiel {
@@ -49,6 +50,11 @@ void LogMBCore(LogLevel level, const std::string& message, bool print_to_termina
         return;
     }
 
+    // Self-play workers log from several threads; keep lines whole and
+    // std::localtime (not reentrant) serialized.
+    static std::mutex log_mutex;
+    std::lock_guard<std::mutex> lock(log_mutex);
+
     auto now = std::chrono::system_clock::now();
     auto in_time_t = std::chrono::system_clock::to_time_t(now);
     
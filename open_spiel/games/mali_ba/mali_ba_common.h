@@ -16,6 +16,7 @@
 #define OPEN_SPIEL_GAMES_MALI_BA_COMMON_H_
 
 #include <array>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <map>
@@ -26,6 +27,7 @@
 #include <ctime>    // for std::tm and std::time
 #include <algorithm> // For std::transform
 #include <cctype>    // For std::tolower
+#include <type_traits>
 
 #include "open_spiel/spiel.h"
 #include "open_spiel/spiel_utils.h"
@@ -213,12 +215,18 @@ namespace open_spiel
     };
 
     // --- Structs ---
+    // Goods are interned: GoodsManager gives each of the 15 common and 15 rare
+    // goods an id (its alphabetical rank), and counts are kept in fixed arrays
+    // indexed by it. Names are only used at the JSON/pybind/text boundary.
+    constexpr int kNumGoodTypes = 15;
+    using GoodCounts = std::array<int, kNumGoodTypes>;
+
     struct TradeRoute
     {
       int id;
       PlayerColor owner;
       std::vector<HexCoord> hexes;
-      std::map<std::string, int> goods;
+      GoodCounts goods{};  // Common goods, by GoodsManager id
       bool active;
     };
 
@@ -246,6 +254,8 @@ namespace open_spiel
       HexCoord location;
       std::string common_good;
       std::string rare_good;
+      int common_good_id = -1;  // GoodsManager ids, filled in by Mali_BaGame
+      int rare_good_id = -1;
 
       City() : id(-1) {}
 
@@ -293,6 +303,61 @@ namespace open_spiel
         }
     };
 
+    // Fixed-size form of the moves the generators build, for buffers that are
+    // filled and cleared many times per search. Hexes are board indices
+    // (Mali_BaGame::CoordToIndex), so copying one is a 16-byte copy and
+    // comparing two compares bytes rather than HexCoord vectors.
+    // Mali_BaState::UnpackMove() turns one back into the rich Move the GUI and
+    // pybind use. Income moves are identified by their goods string and stay
+    // Moves.
+    constexpr int kMaxPackedRouteHexes = 8;
+
+    struct PackedMove {
+        enum Flags : uint8_t {
+            kPlacePost = 1 << 0,      // Move::place_trading_post
+            kDeclaresRoute = 1 << 1,  // Move::declares_trade_route
+        };
+
+        int8_t player = -1;     // PlayerColor
+        int8_t type = 0;        // ActionType
+        uint8_t flags = 0;
+        int8_t start = -1;      // Hex index of Move::start_hex
+        int8_t end = -1;        // Hex index of a mancala destination (Move::path[0])
+        uint8_t route_len = 0;
+        int16_t route_id = -1;
+        // Hex indices of a created route (Move::path) or of a compound move's
+        // trade_route_path; entries past route_len stay 0.
+        std::array<int8_t, kMaxPackedRouteHexes> route{};
+
+        ActionType Type() const { return static_cast<ActionType>(type); }
+        bool HasFlag(Flags flag) const { return (flags & flag) != 0; }
+
+        bool operator<(const PackedMove& other) const {
+            if (player != other.player) return player < other.player;
+            if (type != other.type) return type < other.type;
+            if (start != other.start) return start < other.start;
+            if (end != other.end) return end < other.end;
+            if (flags != other.flags) return flags < other.flags;
+            if (route_len != other.route_len || route != other.route) {
+                return std::lexicographical_compare(
+                    route.begin(), route.begin() + route_len,
+                    other.route.begin(), other.route.begin() + other.route_len);
+            }
+            return route_id < other.route_id;
+        }
+
+        bool operator==(const PackedMove& other) const {
+            return player == other.player && type == other.type &&
+                   flags == other.flags && start == other.start &&
+                   end == other.end && route_len == other.route_len &&
+                   route_id == other.route_id && route == other.route;
+        }
+    };
+    static_assert(std::is_trivially_copyable<PackedMove>::value,
+                  "PackedMove must stay a plain byte copy");
+    static_assert(sizeof(PackedMove) == 16, "PackedMove layout changed");
+    static_assert(kMaxHexes <= 127, "hex indices must fit PackedMove's int8_t");
+
     // City type details for city creation and lookup
     struct CityTypeDetails
     {
@@ -330,6 +395,35 @@ namespace open_spiel
         }
     };
 
+    // Allocation-free counterpart of GoodsCollection, indexed by GoodsManager ids
+    struct GoodsCounts {
+        GoodCounts common_goods{};
+        GoodCounts rare_goods{};
+
+        bool IsEmpty() const {
+            return TotalCommon() == 0 && TotalRare() == 0;
+        }
+
+        int TotalCommon() const {
+            int total = 0;
+            for (int count : common_goods) total += count;
+            return total;
+        }
+
+        int TotalRare() const {
+            int total = 0;
+            for (int count : rare_goods) total += count;
+            return total;
+        }
+    };
+
+    // Conversions to and from the named forms. Unknown names are dropped with
+    // a warning; zero counts are left out of the maps.
+    GoodCounts GoodCountsFromMap(const std::map<std::string, int>& goods, bool rare);
+    std::map<std::string, int> GoodCountsToMap(const GoodCounts& counts, bool rare);
+    GoodsCounts ToGoodsCounts(const GoodsCollection& collection);
+    GoodsCollection ToGoodsCollection(const GoodsCounts& counts);
+
     // Goods formatting and parsing functions
     std::map<std::string, int> ParseGoodsString(const std::string& goods_str);
     std::string FormatGoodsString(const std::map<std::string, int>& goods);
@@ -337,6 +431,8 @@ namespace open_spiel
                                       const std::vector<City>& cities);
     std::string FormatGoodsCollection(const GoodsCollection& collection);
     std::string FormatGoodsCollectionCompact(const GoodsCollection& collection);
+    // As FormatGoodsCollectionCompact(ToGoodsCollection(counts)), without the maps
+    std::string FormatGoodsCountsCompact(const GoodsCounts& counts);
 
     struct GameRules {
       // Turn structure
@@ -535,6 +631,36 @@ namespace open_spiel
         LegalActionCounts counts;
     };
 
+    // The groups LegalActions() is made of, in the order it lists them. A
+    // sampler can weigh the groups by their sizes and only then ask the state
+    // for one action of the group it picked.
+    enum class LegalActionCategory {
+        kChance = 0,
+        kPass = 1,
+        kIncome = 2,
+        kPlaceToken = 3,
+        kMancalaStart = 4,
+        kUpgrade = 5,
+        kMancalaStep = 6,
+        kPlacePost = 7,
+        kPayment = 8,
+        kTradeRoute = 9,
+    };
+    constexpr int kNumLegalActionCategories = 10;
+
+    // Number of legal actions in each category.
+    struct LegalActionCategoryCounts {
+        std::array<int, kNumLegalActionCategories> counts{};
+
+        int& operator[](LegalActionCategory category) { return counts[static_cast<int>(category)]; }
+        int operator[](LegalActionCategory category) const { return counts[static_cast<int>(category)]; }
+        int Total() const {
+            int total = 0;
+            for (int count : counts) total += count;
+            return total;
+        }
+    };
+
     class GoodsManager {
     public:
         // Singleton access pattern
@@ -545,6 +671,8 @@ namespace open_spiel
 
         int GetCommonGoodIndex(const std::string& good_name) const;
         int GetRareGoodIndex(const std::string& good_name) const;
+        const std::string& GetCommonGoodName(int index) const { return common_goods_list_[index]; }
+        const std::string& GetRareGoodName(int index) const { return rare_goods_list_[index]; }
         const std::vector<std::string>& GetCommonGoodsList() const { return common_goods_list_; }
         const std::vector<std::string>& GetRareGoodsList() const { return rare_goods_list_; }
 
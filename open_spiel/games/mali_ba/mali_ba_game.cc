@@ -1,9 +1,11 @@
 // mali_ba_game.cc
 
 #include "open_spiel/games/mali_ba/mali_ba_game.h"
+#include "open_spiel/games/mali_ba/mali_ba_board_config.h"
 #include "open_spiel/games/mali_ba/mali_ba_state.h"
 #include "open_spiel/games/mali_ba/hex_grid.h"
 #include "open_spiel/games/mali_ba/mali_ba_observer.h"
+#include "open_spiel/games/mali_ba/mali_ba_perf.h"
 
 #include <memory>
 #include <vector>
@@ -17,6 +19,7 @@
 #include <map>
 #include <algorithm>
 #include <cctype>
+#include <limits>
 
 #include "open_spiel/abseil-cpp/absl/strings/str_split.h"
 #include "open_spiel/abseil-cpp/absl/strings/str_join.h"
@@ -150,8 +153,8 @@ namespace open_spiel
             }
 
             // Sanity check
-            SPIEL_CHECK_EQ(common_goods_list_.size(), 15);
-            SPIEL_CHECK_EQ(rare_goods_list_.size(), 15);
+            SPIEL_CHECK_EQ(common_goods_list_.size(), kNumGoodTypes);
+            SPIEL_CHECK_EQ(rare_goods_list_.size(), kNumGoodTypes);
         }
 
         int GoodsManager::GetCommonGoodIndex(const std::string& good_name) const {
@@ -185,10 +188,14 @@ namespace open_spiel
                 {"grid_radius", GameParameter(5)},
                 {"tokens_per_player", GameParameter(3)},
                 {"enable_move_logging", GameParameter(false)}, // Logging of each move state for replay mode
+                {"move_log_path", GameParameter(std::string(""))}, // Empty = /tmp/mali_ba.states.<datetime>.pid-<pid>.log
+                {"move_log_format", GameParameter(std::string("sections"))}, // "sections" (replay) or "jsonl"
+                {"move_log_compress", GameParameter(false)}, // gzip the move log (needs zlib support)
                 {"LoggingEnabled", GameParameter(true)}, // Logging in general
                 {"rng_seed", GameParameter(-1)},
                 {"RngSeed", GameParameter(-1)}, // Add alias for INI file
                 {"config_file", GameParameter(std::string(""))},
+                {"board_cache_dir", GameParameter(std::string(""))}, // Parsed-INI cache; empty = ~/.cache/mali_ba_board_cache, "none" = off
                 {"posts_per_player", GameParameter(6)},
                 {"free_action_trade_routes", GameParameter(true)},
                 {"endgm_cond_numroutes", GameParameter(4)},
@@ -240,126 +247,45 @@ namespace open_spiel
             // --- End of lambda ---
 
             // --- Board and City Parsing Logic ---
-            bool custom_board_defined = false;
-            std::map<std::string, std::string> board_section_params;
-            std::map<std::string, std::string> heuristics_section_params;
-            std::map<std::string, std::string> training_section_params; 
-
+            // The INI is parsed once per distinct file contents and shared; see
+            // mali_ba_board_config.h for the in-process and on-disk caches.
+            static const BoardConfig kNoBoardConfig;
+            std::shared_ptr<const BoardConfig> board_config;
             if (!config_file_path.empty()) {
                 LOG_DEBUG("Found 'config_file', attempting to parse: ", config_file_path);
-                std::ifstream file(config_file_path);
-                if (file.is_open()) {
-                    std::stringstream buffer;
-                    buffer << file.rdbuf();
-                    std::string file_contents = buffer.str();
-                    file.close();
-
-                    std::string current_section;
-                    std::string custom_cities_raw_str;
-                    // A map to temporarily hold region names from the INI ---
-                    std::map<std::string, std::string> region_section_params;
-
-                    std::istringstream content_stream(file_contents);
-                    std::string line;
-                    while (std::getline(content_stream, line)) {
-                        line = trim(line);
-                        if (line.empty() || line[0] == ';' || line[0] == '#') continue;
-
-                        if (line[0] == '[' && line.back() == ']') {
-                            current_section = trim(line.substr(1, line.length() - 2));
-                            continue;
-                        }
-                        
-                        auto eq_pos = line.find('=');
-                        if (eq_pos != std::string::npos) {
-                            std::string key = trim(line.substr(0, eq_pos));
-                            std::string value_str = trim(line.substr(eq_pos + 1));
-                            
-                            if (current_section == "Board") {
-                                board_section_params[key] = value_str;
-                            } else if (current_section == "Cities" && absl::StartsWith(key, "city")) {
-                                if (!custom_cities_raw_str.empty()) custom_cities_raw_str += ":";
-                                custom_cities_raw_str += value_str;
-                            // --- Handle the [Regions] section ---
-                            } else if (current_section == "Regions") {
-                                region_section_params[key] = value_str;
-                            } else if (current_section == "Heuristics") { 
-                                heuristics_section_params[key] = value_str;
-                            } else if (current_section == "Training") {
-                                training_section_params[key] = value_str;
-                            } else {
-                                effective_params[key] = ParseParameterValue(value_str);
-                            }
-                        }
-                    }
-
-                    // --- Process the parsed region names ---
-                    region_id_to_name_map_.clear();
-                    std::string region_prefix = "region";
-                    for (const auto& [key, name] : region_section_params) {
-                        if (absl::StartsWith(key, region_prefix)) {
-                            std::string region_num_str = key.substr(region_prefix.length());
-                            try {
-                                int region_id = std::stoi(region_num_str);
-                                region_id_to_name_map_[region_id] = name;
-                                LOG_DEBUG("Loaded Region Name: ID ", region_id, " -> '", name, "'");
-                            } catch (const std::exception& e) {
-                                LOG_WARN("Could not parse region ID from key: ", key);
-                            }
-                        }
-                    }                    
-                    valid_hexes_.clear();
-                    hex_to_region_map_.clear();
-                    std::string prefix = "custom_hexes";
-
-                    for (const auto& [key, value_str] : board_section_params) {
-                        if (absl::StartsWith(key, prefix)) {
-                            custom_board_defined = true;
-                            int region_id = -1;
-                            std::string region_num_str = key.substr(prefix.length());
-                            if (!region_num_str.empty()) {
-                                try {
-                                    region_id = std::stoi(region_num_str);
-                                } catch (const std::exception& e) {
-                                    LOG_WARN("Could not parse region ID from key: ", key);
-                                    continue;
-                                }
-                            } else {
-                                region_id = 0;
-                            }
-
-                            LOG_DEBUG("Parsing hexes for region ", region_id, " from key '", key, "'");
-                            std::set<HexCoord> region_hexes = ParseHexList(value_str);
-                            
-                            valid_hexes_.insert(region_hexes.begin(), region_hexes.end());
-
-                            for (const auto& hex : region_hexes) {
-                                if (hex_to_region_map_.count(hex)) {
-                                    LOG_WARN("Hex ", hex.ToString(), " is defined in multiple regions. Overwriting with region ", region_id);
-                                }
-                                hex_to_region_map_[hex] = region_id;
-                            }
-                        } else if (key == "grid_radius") {
-                            effective_params[key] = GameParameter(std::stoi(value_str));
-                        }
-                    }
-
-                    if (!custom_cities_raw_str.empty()) {
-                        effective_params["custom_cities"] = GameParameter(custom_cities_raw_str);
-                    }
-                    LOG_DEBUG("Successfully parsed INI file. Parameters have been overlaid.");
-                } else {
-                    LOG_WARN("Could not open INI file: ", config_file_path);
+                std::string cache_dir = ParameterValue<std::string>("board_cache_dir");
+                if (cache_dir.empty()) {
+                    cache_dir = DefaultBoardCacheDir();
+                } else if (cache_dir == "none") {
+                    cache_dir.clear();
                 }
+                board_config = LoadBoardConfig(config_file_path, cache_dir);
+                if (!board_config) LOG_WARN("Could not open INI file: ", config_file_path);
             }
+            const BoardConfig& config = board_config ? *board_config : kNoBoardConfig;
 
-            // parse coastal_hexes
-            if (board_section_params.count("coastal_hexes")) {
-                std::string coastal_hexes_str = board_section_params["coastal_hexes"];
-                coastal_hexes_ = ParseHexList(coastal_hexes_str);
-                if (!coastal_hexes_.empty()) {
-                    LOG_DEBUG("Loaded ", coastal_hexes_.size(), " coastal hexes from INI file.");
-                }
+            for (const auto& [key, value_str] : config.params) {
+                effective_params[key] = ParseParameterValue(value_str);
+            }
+            auto grid_radius_it = config.board_section.find("grid_radius");
+            if (grid_radius_it != config.board_section.end()) {
+                effective_params["grid_radius"] = GameParameter(std::stoi(grid_radius_it->second));
+            }
+            if (!config.custom_cities.empty()) {
+                effective_params["custom_cities"] = GameParameter(config.custom_cities);
+            }
+            region_id_to_name_map_.clear();
+            for (const auto& [region_id, name] : config.region_names) {
+                region_id_to_name_map_[region_id] = name;
+            }
+            const bool custom_board_defined = config.custom_board_defined;
+            const std::map<std::string, std::string>& heuristics_section_params = config.heuristics_section;
+            const std::map<std::string, std::string>& training_section_params = config.training_section;
+            if (board_config) LOG_DEBUG("Successfully parsed INI file. Parameters have been overlaid.");
+
+            coastal_hexes_ = config.coastal_hexes;
+            if (!coastal_hexes_.empty()) {
+                LOG_DEBUG("Loaded ", coastal_hexes_.size(), " coastal hexes from INI file.");
             }
 
             // --- Initialization logic uses the defined lambda ---
@@ -369,7 +295,18 @@ namespace open_spiel
             LoggingEnabled_ = get_effective_param("LoggingEnabled", get_effective_param("LoggingEnabled", true));
             //g_mali_ba_logging_enabled = LoggingEnabled_;
             enable_move_logging_ = get_effective_param("enable_move_logging_", get_effective_param("enable_move_logging", false));
-            int seed_val = get_effective_param("RngSeed", get_effective_param("rng_seed", -1));
+            move_log_config_.path = get_effective_param("move_log_path", std::string(""));
+            move_log_config_.compress = get_effective_param("move_log_compress", false);
+            std::string move_log_format = StrLower(get_effective_param("move_log_format", std::string("sections")));
+            if (move_log_format == "jsonl") {
+                move_log_config_.format = MoveLogFormat::kJsonLines;
+            } else if (move_log_format != "sections") {
+                LOG_WARN("Unknown move_log_format '", move_log_format, "'; using 'sections'.");
+            }
+            // An INI's "RngSeed = -1" means unset, so it does not override an
+            // explicit rng_seed parameter.
+            int seed_val = get_effective_param("RngSeed", -1);
+            if (seed_val == -1) seed_val = get_effective_param("rng_seed", -1);
             prune_moves_for_ai_ = get_effective_param("prune_moves_for_ai", get_effective_param("prune_moves_for_ai", true));
             std::string player_types_str = get_effective_param("player_types", std::string("ai,ai,ai"));
             player_types_ = ParsePlayerTypes(player_types_str, num_players_);
@@ -389,7 +326,10 @@ namespace open_spiel
             if (!custom_board_defined) {
                 LOG_WARN("No regional 'custom_hexesX' found. Generating regular board with radius: ", grid_radius_);
                 valid_hexes_ = GenerateRegularBoard(grid_radius_);
+                board_topology_ = GetBoardTopology(valid_hexes_);
             } else {
+                valid_hexes_ = config.valid_hexes;
+                board_topology_ = config.topology;
                 // If a custom board was defined, we calculate its true radius.
                 int effective_radius = CalculateEffectiveRadius(valid_hexes_);
                 
@@ -401,7 +341,7 @@ namespace open_spiel
                 // This is now the single source of truth for the board's dimensions.
                 grid_radius_ = effective_radius;
 
-                LOG_DEBUG("Constructed board from ", hex_to_region_map_.size(), " hexes across custom regions.");
+                LOG_DEBUG("Constructed board from ", config.hex_regions.size(), " hexes across custom regions.");
             }
 
             std::string custom_cities_str = get_effective_param("custom_cities", std::string(""));
@@ -616,7 +556,8 @@ namespace open_spiel
 
 
             LOG_INFO("Mali_BaGame: Final configuration complete.");
-            InitializeLookups();
+            InitializeLookups(config.hex_regions);
+            default_observer_ = std::make_shared<MaliBaObserver>(IIGObservationType{});
         }
 
         // =======================================================================
@@ -636,6 +577,15 @@ namespace open_spiel
             return state;
         }
 
+        // Created on first use and shared by every state of this game, so games
+        // played concurrently from one Mali_BaGame write to a single log.
+        std::shared_ptr<MoveLogSink> Mali_BaGame::GetMoveLogSink() const {
+            std::call_once(move_log_once_, [this]() {
+                move_log_sink_ = std::make_shared<MoveLogSink>(move_log_config_);
+            });
+            return move_log_sink_;
+        }
+
         std::unique_ptr<State> Mali_BaGame::NewInitialState(const std::string &str) const {
             return DeserializeState(str);
         }
@@ -648,31 +598,105 @@ namespace open_spiel
         }
 
         const City *Mali_BaGame::GetCityAt(const HexCoord &location) const {
+            const int index = CoordToIndex(location);
+            if (index >= 0) {
+                const int city = hex_city_ids_[index];
+                return city >= 0 ? &cities_[city] : nullptr;
+            }
+            // Cities listed off the board are never on a hex index
             for (const auto& city : cities_) if (city.location == location) return &city;
             return nullptr;
         }
 
-        void Mali_BaGame::InitializeLookups() { 
-            coord_to_index_map_.clear();
-            index_to_coord_vec_.clear();
-            int current_index = 0;
-            for (const HexCoord &hex : valid_hexes_) {
-                coord_to_index_map_[hex] = current_index;
-                index_to_coord_vec_.push_back(hex);
-                current_index++;
+        void Mali_BaGame::InitializeLookups(const std::map<HexCoord, int>& hex_regions) {
+            // Index order, neighbors and distances come from the shared topology
+            // of this set of hexes; the rest depends on the cities and regions.
+            SPIEL_CHECK_TRUE(board_topology_ != nullptr);
+            num_hexes_ = board_topology_->NumHexes();
+
+            board_kernels_ = std::make_shared<const BoardKernels>(*board_topology_);
+
+            hex_city_ids_.assign(num_hexes_, -1);
+            city_hexes_ = HexMask();
+            for (int c = 0; c < static_cast<int>(cities_.size()); ++c) {
+                const int index = CoordToIndex(cities_[c].location);
+                if (index >= 0 && hex_city_ids_[index] < 0) hex_city_ids_[index] = c;
+                if (index >= 0) city_hexes_.Set(index);
+            }
+            nearest_city_ids_.assign(num_hexes_, {});
+            for (int i = 0; i < num_hexes_; ++i) {
+                int min_distance = std::numeric_limits<int>::max();
+                for (int c = 0; c < static_cast<int>(cities_.size()); ++c) {
+                    const int distance = board_topology_->hexes[i].Distance(cities_[c].location);
+                    if (distance < min_distance) {
+                        min_distance = distance;
+                        nearest_city_ids_[i].clear();
+                    }
+                    if (distance == min_distance) nearest_city_ids_[i].push_back(c);
+                }
+            }
+
+            // Regions, for the scoring counters
+            valid_region_ids_.clear();
+            for (const auto& [region_id, region_name] : region_id_to_name_map_) {
+                valid_region_ids_.push_back(region_id);
+            }
+            std::sort(valid_region_ids_.begin(), valid_region_ids_.end());
+            hex_region_ids_.assign(num_hexes_, -1);
+            hex_region_slots_.assign(num_hexes_, -1);
+            for (int i = 0; i < num_hexes_; ++i) {
+                auto region = hex_regions.find(board_topology_->hexes[i]);
+                hex_region_ids_[i] = region != hex_regions.end() ? region->second : -1;
+                auto slot = std::lower_bound(valid_region_ids_.begin(), valid_region_ids_.end(),
+                                             hex_region_ids_[i]);
+                if (slot != valid_region_ids_.end() && *slot == hex_region_ids_[i]) {
+                    hex_region_slots_[i] = static_cast<int>(slot - valid_region_ids_.begin());
+                }
+            }
+            // Interned goods ids, and the region each rare good comes from
+            const GoodsManager& goods_manager = GoodsManager::GetInstance();
+            rare_good_regions_.assign(kNumGoodTypes, -1);
+            for (City &city : cities_) {
+                city.common_good_id = goods_manager.GetCommonGoodIndex(city.common_good);
+                city.rare_good_id = goods_manager.GetRareGoodIndex(city.rare_good);
+                SPIEL_CHECK_GE(city.common_good_id, 0);
+                SPIEL_CHECK_GE(city.rare_good_id, 0);
+                if (rare_good_regions_[city.rare_good_id] < 0) {
+                    rare_good_regions_[city.rare_good_id] = GetRegionForHex(city.location);
+                }
+            }
+            num_named_regions_ = 0;
+            for (int i = 1; i <= 6; ++i) {
+                const std::string name = GetRegionName(i);
+                if (!name.empty() && name.find("Unknown") == std::string::npos) num_named_regions_++;
             }
-            num_hexes_ = current_index;
-        }
 
-        int Mali_BaGame::CoordToIndex(const HexCoord &hex) const { 
-            auto it = coord_to_index_map_.find(hex);
-            return (it != coord_to_index_map_.end()) ? it->second : -1;
+            // Observation plane offsets (offset coordinates centred on the grid radius)
+            const int height = observation_tensor_shape_[1];
+            const int width = observation_tensor_shape_[2];
+            auto tensor_offset = [&](const HexCoord &hex) {
+                auto [col, row] = CubeToOffset(hex);
+                col += grid_radius_;
+                row += grid_radius_;
+                return (row < 0 || row >= height || col < 0 || col >= width) ? -1 : row * width + col;
+            };
+            hex_tensor_offsets_.clear();
+            for (const HexCoord &hex : board_topology_->hexes) {
+                hex_tensor_offsets_.push_back(tensor_offset(hex));
+            }
+            city_tensor_offsets_.clear();
+            for (const City &city : cities_) {
+                const int index = CoordToIndex(city.location);
+                if (index >= 0 && hex_tensor_offsets_[index] >= 0) {
+                    city_tensor_offsets_.push_back(hex_tensor_offsets_[index]);
+                }
+            }
         }
 
         HexCoord Mali_BaGame::IndexToCoord(int index) const {
             SPIEL_CHECK_GE(index, 0);
             SPIEL_CHECK_LT(index, num_hexes_);
-            return index_to_coord_vec_[index];
+            return board_topology_->hexes[index];
         }
 
         std::set<HexCoord> Mali_BaGame::GenerateRegularBoard(int radius) const {
@@ -688,57 +712,6 @@ namespace open_spiel
             return hexes;
         }
 
-        // --- Parsing helpers moved from BoardConfig ---
-        std::string Mali_BaGame::StripWhitespace(const std::string& str) const {
-            size_t start = str.find_first_not_of(" \t\r\n");
-            if (start == std::string::npos) return "";
-            size_t end = str.find_last_not_of(" \t\r\n");
-            return str.substr(start, end - start + 1);
-        }
-
-        std::vector<std::string> Mali_BaGame::SplitString(const std::string& str, char delimiter) const {
-            std::vector<std::string> result;
-            std::stringstream ss(str);
-            std::string item;
-            while (std::getline(ss, item, delimiter)) {
-                if (!item.empty()) result.push_back(item);
-            }
-            return result;
-        }
-
-        HexCoord Mali_BaGame::ParseHexCoord(const std::string& coord_str) const {
-            std::vector<std::string> parts = SplitString(coord_str, ',');
-            if (parts.size() != 3) {
-                throw std::invalid_argument("Invalid coordinate format: " + coord_str);
-            }
-            int x = std::stoi(StripWhitespace(parts[0]));
-            int y = std::stoi(StripWhitespace(parts[1]));
-            int z = std::stoi(StripWhitespace(parts[2]));
-            return HexCoord(x, y, z);
-        }
-        
-        std::set<HexCoord> Mali_BaGame::ParseHexList(const std::string& hex_string) const {
-            std::set<HexCoord> hexes;
-            // Use absl::StrSplit with a Delimiter that skips empty parts.
-            std::vector<std::string> coords_list = absl::StrSplit(hex_string, ':', absl::SkipEmpty());
-            
-            for (const std::string& coord_str : coords_list) {
-                // `coord_str` will already be trimmed if there was no extra whitespace.
-                try {
-                    HexCoord hex = ParseHexCoord(coord_str);
-                    if (hex.x + hex.y + hex.z == 0) {
-                        hexes.insert(hex);
-                    } else {
-                        LOG_WARN("Invalid hex coordinate ", coord_str, " (x+y+z != 0)");
-                    }
-                } catch (const std::exception& e) {
-                    LOG_ERROR("Could not parse hex coordinate: ", coord_str);
-                }
-            }
-            return hexes;
-        }
-
-
         int Mali_BaGame::FindCityIdByName(const std::string& name) const {
             for (const auto& [id, details] : kCityDetailsMap) {
                 if (StrLower(details.name) == StrLower(name)) {
@@ -813,11 +786,8 @@ namespace open_spiel
 
         // --- Getter Implementation for what region a hex is in ---
         int Mali_BaGame::GetRegionForHex(const HexCoord& hex) const {
-            auto it = hex_to_region_map_.find(hex);
-            if (it != hex_to_region_map_.end()) {
-                return it->second;
-            }
-            return -1; // Return -1 if the hex is not found in any region
+            const int index = CoordToIndex(hex);
+            return index >= 0 ? hex_region_ids_[index] : -1; // -1 if the hex is not in any region
         }
 
         // --- Implementation of the region name getter ---
@@ -830,21 +800,14 @@ namespace open_spiel
             return "Unknown Region " + std::to_string(region_id);
         }
 
-        // --- Implementation of the region IDs getter ---
-        std::vector<int> Mali_BaGame::GetValidRegionIds() const {
-            std::vector<int> region_ids;
-            region_ids.reserve(region_id_to_name_map_.size());
-            
-            for (const auto& [region_id, region_name] : region_id_to_name_map_) {
-                region_ids.push_back(region_id);
-            }
-            // Sort to ensure consistent iteration order
-            std::sort(region_ids.begin(), region_ids.end());
-            return region_ids;
+        int Mali_BaGame::RareGoodRegion(int rare_good_id) const {
+            if (rare_good_id < 0 || rare_good_id >= static_cast<int>(rare_good_regions_.size())) return -1;
+            return rare_good_regions_[rare_good_id];
         }
 
         std::unique_ptr<State> Mali_BaGame::DeserializeState(const std::string &str) const
         {
+            MALI_BA_PERF_SCOPE(kDeserialize);
             // The deserialization logic remains largely the same, as it only deals with
             // the dynamic parts of the state. The state object itself will get the static
             // board info from the Game object it's constructed with.
@@ -874,7 +837,7 @@ namespace open_spiel
                                     colors.push_back(static_cast<PlayerColor>(color_int.get<int>()));
                                 }
                                 if (!colors.empty()) {
-                                    state->player_token_locations_[*hex] = colors;
+                                    state->SetTokensAt(*hex, colors);
                                 }
                             }
                         }
@@ -884,18 +847,22 @@ namespace open_spiel
                 if (j.contains("hexMeeples")) {
                     for (auto const &[hex_str, j_list] : j.at("hexMeeples").items()) {
                          if (auto hex = JsonStringToHexCoord(hex_str)) {
-                             for (const auto &mc_val : j_list) state->hex_meeples_[*hex].push_back(static_cast<MeepleColor>(mc_val.get<int>()));
+                             std::vector<MeepleColor> meeples;
+                             for (const auto &mc_val : j_list) meeples.push_back(static_cast<MeepleColor>(mc_val.get<int>()));
+                             state->SetMeeplesAt(*hex, meeples);
                          }
                     }
                 }
                 if (j.contains("tradePosts")) {
                     for (auto const &[hex_str, j_list] : j.at("tradePosts").items()) {
                          if (auto hex = JsonStringToHexCoord(hex_str)) {
+                             std::vector<TradePost> posts;
                              for (const auto &j_post : j_list) {
                                  PlayerColor owner = static_cast<PlayerColor>(j_post.at("owner").get<int>());
                                  TradePostType type = static_cast<TradePostType>(j_post.at("type").get<int>());
-                                 state->trade_posts_locations_[*hex].push_back({owner, type});
+                                 posts.push_back({owner, type});
                              }
+                             state->SetTradePostsAt(*hex, posts);
                          }
                     }
                 }
@@ -926,13 +893,19 @@ namespace open_spiel
                         route.id = j_route.at("id").get<int>();
                         route.owner = static_cast<PlayerColor>(j_route.at("owner").get<int>());
                         if(j_route.contains("hexes")) for(const auto& h_str : j_route.at("hexes")) if(auto h=JsonStringToHexCoord(h_str)) route.hexes.push_back(*h);
-                        if(j_route.contains("goods")) route.goods = j_route.at("goods").get<std::map<std::string, int>>();
+                        if(j_route.contains("goods")) route.goods = GoodCountsFromMap(j_route.at("goods").get<std::map<std::string, int>>(), /*rare=*/false);
                         route.active = j_route.value("active", true);
                         route.hexes = state->GetCanonicalRoute(route.hexes); // make sure hexes are sorted properly
                         state->trade_routes_.push_back(route);
                         if (route.id >= state->next_route_id_) state->next_route_id_ = route.id + 1;
                     }
                 }
+                if (j.contains("moveNumber")) state->move_number_ = j.at("moveNumber").get<int>();
+                if (j.contains("rng")) {
+                    const json& j_rng = j.at("rng");
+                    state->rng_.Restore(j_rng.at("stream").get<uint64_t>(), j_rng.at("move").get<uint64_t>(),
+                                        j_rng.at("counter").get<uint64_t>());
+                }
                 // Mid-Turn State Deserialization ---
                 if (j.contains("midTurnState")) {
                     auto j_mid = j.at("midTurnState");
@@ -969,6 +942,20 @@ namespace open_spiel
             }
 
             state->ClearCaches();
+            state->InvalidateScoreCounters();
+            state->InvalidateHashKey();
+            state->RefreshTerminalStatus();
+            return state;
+        }
+
+        std::unique_ptr<State> Mali_BaGame::DeserializeBinary(const std::string &data) const
+        {
+            MALI_BA_PERF_SCOPE(kDeserialize);
+            std::unique_ptr<Mali_BaState> state = std::make_unique<Mali_BaState>(shared_from_this());
+            state->DecodeBinary(data);
+            state->ClearCaches();
+            state->InvalidateScoreCounters();
+            state->InvalidateHashKey();
             state->RefreshTerminalStatus();
             return state;
         }
@@ -3,19 +3,26 @@
 #ifndef OPEN_SPIEL_GAMES_MALI_BA_GAME_H_
 #define OPEN_SPIEL_GAMES_MALI_BA_GAME_H_
 
+#include <array>
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include <string>
 #include <random>
 #include <set>
 #include <map>
+#include <mutex>
 
 #include "open_spiel/spiel.h"
 #include "open_spiel/observer.h"
 #include "open_spiel/game_parameters.h"
 #include "open_spiel/abseil-cpp/absl/types/optional.h"
 #include "open_spiel/abseil-cpp/absl/container/flat_hash_map.h"
+#include "open_spiel/games/mali_ba/mali_ba_board_config.h"
+#include "open_spiel/games/mali_ba/mali_ba_board_kernels.h"
 #include "open_spiel/games/mali_ba/mali_ba_common.h"
+#include "open_spiel/games/mali_ba/mali_ba_memory.h"
+#include "open_spiel/games/mali_ba/mali_ba_move_log.h"
 
 namespace open_spiel
 {
@@ -24,6 +31,7 @@ namespace open_spiel
 
     // Forward declaration
     class Mali_BaState;
+    class MaliBaObserver;
 
     class Mali_BaGame : public Game
     {
@@ -40,7 +48,10 @@ namespace open_spiel
       // Make this override non-const so it can cache the result, or calculate it on the fly.
       // For simplicity, we will calculate it and store it during construction.
       std::vector<int> ObservationTensorShape() const override { return observation_tensor_shape_; }
+      const std::vector<int>& GetObservationTensorShape() const { return observation_tensor_shape_; }
       std::unique_ptr<State> DeserializeState(const std::string &str) const override;
+      // Inverse of Mali_BaState::SerializeBinary(); malformed input is fatal.
+      std::unique_ptr<State> DeserializeBinary(const std::string &data) const;
       std::shared_ptr<Observer> MakeObserver(
           absl::optional<IIGObservationType> iig_obs_type,
           const GameParameters &params) const override;
@@ -63,6 +74,10 @@ namespace open_spiel
       const TrainingParameters& GetTrainingParameters() const { return training_params_; }
       const std::vector<PlayerType>& GetPlayerTypes() const { return player_types_; }
       int GetMaxGameLength() { return MaxGameLength(); }
+      bool GetMoveLoggingEnabled() const { return enable_move_logging_; }
+      const MoveLogConfig& GetMoveLogConfig() const { return move_log_config_; }
+      // Move log shared by all states of this game; opened on first call.
+      std::shared_ptr<MoveLogSink> GetMoveLogSink() const;
 
       // --- Board Configuration Accessors ---
       const std::set<HexCoord>& GetValidHexes() const { return valid_hexes_; }
@@ -73,29 +88,58 @@ namespace open_spiel
       // Returns the region ID for a given hex, or -1 if the hex is not in a region.
       int GetRegionForHex(const HexCoord& hex) const;
       std::string GetRegionName(int region_id) const;
-      std::vector<int> GetValidRegionIds() const;
+      // Sorted ids of the regions that have a name.
+      const std::vector<int>& GetValidRegionIds() const { return valid_region_ids_; }
+      // Region of a hex index (-1 if none), and that region's position in
+      // GetValidRegionIds() (-1 if it has no name).
+      int RegionOfHex(int index) const { return hex_region_ids_[index]; }
+      int RegionSlotOfHex(int index) const { return hex_region_slots_[index]; }
+      // Region of the first city producing a rare good (by GoodsManager id), -1 if none does.
+      int RareGoodRegion(int rare_good_id) const;
+      // Regions 1-6 with a configured name; the most the "rare good from N
+      // regions" end condition can ask for.
+      int NumNamedRegions() const { return num_named_regions_; }
 
       // --- Board LUT Accessors ---
       int NumHexes() const { return num_hexes_; }
-      int CoordToIndex(const HexCoord &hex) const;
+      int CoordToIndex(const HexCoord &hex) const { return board_topology_->IndexOf(hex); }
       HexCoord IndexToCoord(int index) const;
+      // Per hex index: row * width + col of that hex in an observation plane
+      // (-1 if outside the tensor), and the same offsets for every city hex.
+      const std::vector<int>& HexTensorOffsets() const { return hex_tensor_offsets_; }
+      const std::vector<int>& CityTensorOffsets() const { return city_tensor_offsets_; }
+      // Neighbor indices of a hex in kHexDirections order, -1 where off-board.
+      const std::array<int16_t, 6>& NeighborIndices(int index) const { return board_topology_->neighbors[index]; }
+      // Fewest on-board steps between two hexes, -1 if not connected.
+      int HopDistance(int from, int to) const { return board_topology_->hop_distances[from * num_hexes_ + to]; }
+      // Cube (straight-line) distance between two hexes, as HexCoord::Distance().
+      int CubeDistance(int from, int to) const { return board_topology_->cube_distances[from * num_hexes_ + to]; }
+      // Index into GetCities() of the city on a hex, -1 if none.
+      int CityIdAtIndex(int index) const { return hex_city_ids_[index]; }
+      // Every hex with a city on it.
+      const HexMask& CityHexes() const { return city_hexes_; }
+      // Board scans, specialized for this board's size when it is a regular one.
+      const BoardKernels& GetBoardKernels() const { return *board_kernels_; }
+      // Indices into GetCities() of the cities at minimum cube distance from a hex.
+      const std::vector<int>& NearestCityIds(int index) const { return nearest_city_ids_[index]; }
+      // One observer shared by every state; ObservationTensor() uses it.
+      const MaliBaObserver& GetDefaultObserver() const { return *default_observer_; }
+      // Bytes held by the board configuration and lookup tables (mali_ba_memory.h).
+      MemoryBreakdown MemoryFootprint() const;
 
 
     private:
       // --- Private Helper methods for INI parsing ---
       void ParseCustomCitiesFromString(const std::string& cities_str);
-      std::set<HexCoord> ParseHexList(const std::string& hex_string) const;
-      HexCoord ParseHexCoord(const std::string& coord_str) const;
       int FindCityIdByName(const std::string& name) const;
-      std::string StripWhitespace(const std::string& str) const;
-      std::vector<std::string> SplitString(const std::string& str, char delimiter) const;
 
       // --- Private Helper methods for board generation ---
       std::set<HexCoord> GenerateRegularBoard(int radius) const;
       std::vector<City> GetDefaultCitiesWithTimbuktu() const;
 
-      // Helper to initialize LUTs during construction
-      void InitializeLookups();
+      // Helper to initialize LUTs during construction; hex_regions maps a
+      // custom board's hexes to their region ids.
+      void InitializeLookups(const std::map<HexCoord, int>& hex_regions);
 
       // --- Game Configuration (read from parameters and INI) ---
       std::vector<int> observation_tensor_shape_; // Will store the dynamically calculated shape
@@ -107,6 +151,9 @@ namespace open_spiel
       int tokens_per_player_;
       bool LoggingEnabled_;
       bool enable_move_logging_;
+      MoveLogConfig move_log_config_;
+      mutable std::once_flag move_log_once_;
+      mutable std::shared_ptr<MoveLogSink> move_log_sink_;
       std::mt19937::result_type rng_seed_;
       bool prune_moves_for_ai_;
       std::vector<PlayerType> player_types_;
@@ -121,10 +168,21 @@ namespace open_spiel
       int num_hexes_ = 0;
 
       // --- Board Hexes Lookup Tables (LUTs) ---
-      absl::flat_hash_map<HexCoord, int> coord_to_index_map_;
-      std::vector<HexCoord> index_to_coord_vec_;
-      absl::flat_hash_map<HexCoord, int> hex_to_region_map_; // Member to store region data
+      // Shared with every game on the same set of hexes
+      std::shared_ptr<const BoardTopology> board_topology_;
+      std::vector<int> hex_tensor_offsets_;
+      std::vector<int> hex_city_ids_;
+      HexMask city_hexes_;
+      std::shared_ptr<const BoardKernels> board_kernels_;
+      std::vector<std::vector<int>> nearest_city_ids_;
+      std::vector<int> city_tensor_offsets_;
+      std::shared_ptr<const MaliBaObserver> default_observer_;
       absl::flat_hash_map<int, std::string> region_id_to_name_map_; // For region names
+      std::vector<int> valid_region_ids_;
+      std::vector<int> hex_region_ids_;
+      std::vector<int> hex_region_slots_;
+      std::vector<int> rare_good_regions_;  // Indexed by rare good id
+      int num_named_regions_ = 0;
 
     };
 
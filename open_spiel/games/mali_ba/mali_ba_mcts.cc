@@ -0,0 +1,294 @@
+// mali_ba_mcts.cc
+// Native PUCT search with virtual loss and batched leaf evaluation
+
+#include "open_spiel/games/mali_ba/mali_ba_mcts.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#include "open_spiel/games/mali_ba/mali_ba_game.h"
+#include "open_spiel/games/mali_ba/mali_ba_observer.h"
+#include "open_spiel/games/mali_ba/mali_ba_state.h"
+#include "open_spiel/spiel_utils.h"
+
+namespace open_spiel {
+namespace mali_ba {
+
+Mali_BaMcts::Mali_BaMcts(const MctsConfig& config, BatchedEvaluator evaluator)
+    : config_(config), evaluator_(std::move(evaluator)) {
+  SPIEL_CHECK_TRUE(evaluator_ != nullptr);
+  SPIEL_CHECK_GT(config_.num_simulations, 0);
+  SPIEL_CHECK_GT(config_.batch_size, 0);
+  if (config_.transposition_slots > 0) {
+    table_ = std::make_unique<Mali_BaTranspositionTable>(config_.transposition_slots);
+  }
+}
+
+MctsResult Mali_BaMcts::Search(const Mali_BaState& root) {
+  SPIEL_CHECK_FALSE(root.IsTerminal());
+  SPIEL_CHECK_FALSE(root.IsChanceNode());
+
+  const Mali_BaGame* game = root.GetGame();
+  num_players_ = game->NumPlayers();
+  num_actions_ = game->NumDistinctActions();
+  observation_size_ = game->ObservationTensorSize();
+
+  rng_ = root.GetRNG().Fork(config_.seed);
+  nodes_.clear();
+  nodes_.emplace_back();  // Root
+  node_values_.clear();
+  ++generation_;
+
+  MctsResult result;
+  std::vector<PendingLeaf> batch;
+  batch.reserve(config_.batch_size);
+  std::vector<float> terminal_values(num_players_);
+  bool noise_added = false;
+  int simulations = 0;
+
+  while (simulations < config_.num_simulations) {
+    batch.clear();
+    const int wanted = std::min(config_.batch_size, config_.num_simulations - simulations);
+    int collected = 0;
+    while (collected < wanted) {
+      PendingLeaf leaf;
+      if (!SelectLeaf(root, &leaf.path, &leaf.state)) break;
+      ++collected;
+      if (leaf.state->IsTerminal()) {
+        std::vector<double> returns = leaf.state->Returns();
+        for (int p = 0; p < num_players_; ++p) terminal_values[p] = returns[p];
+        Backup(leaf.path, terminal_values);
+        continue;
+      }
+      if (table_ && ExpandFromTransposition(leaf)) {
+        result.num_transposition_hits++;
+        continue;
+      }
+      nodes_[leaf.path.back()].pending = true;
+      batch.push_back(std::move(leaf));
+    }
+
+    if (!batch.empty()) EvaluateBatch(&batch, &result);
+    simulations += collected;
+
+    if (!noise_added && nodes_[0].expanded) {
+      AddRootNoise();
+      noise_added = true;
+    }
+  }
+
+  // Read the policy off the root's children.
+  const Node& root_node = nodes_[0];
+  result.policy.assign(num_actions_, 0.0);
+  int total_visits = 0;
+  int best_visits = -1;
+  double value_sum = 0.0;
+  for (int i = 0; i < root_node.num_children; ++i) {
+    const Node& child = nodes_[root_node.first_child + i];
+    result.actions.push_back(child.action);
+    result.visit_counts.push_back(child.visit_count);
+    result.policy[child.action] = child.visit_count;
+    total_visits += child.visit_count;
+    value_sum += child.total_value;
+    if (child.visit_count > best_visits) {
+      best_visits = child.visit_count;
+      result.best_action = child.action;
+    }
+  }
+  if (total_visits > 0) {
+    for (double& p : result.policy) p /= total_visits;
+    result.root_value = value_sum / total_visits;
+  } else {
+    for (Action action : result.actions) result.policy[action] = 1.0 / result.actions.size();
+  }
+  return result;
+}
+
+bool Mali_BaMcts::SelectLeaf(const Mali_BaState& root, std::vector<int>* path,
+                             std::unique_ptr<State>* state) {
+  path->clear();
+  path->push_back(0);
+  *state = root.CloneForSearch();
+  nodes_[0].virtual_visits++;
+
+  int node_index = 0;
+  while (true) {
+    while ((*state)->IsChanceNode()) ApplyChanceOutcome(state->get());
+    const Node& node = nodes_[node_index];
+    if ((*state)->IsTerminal() || !node.expanded || node.num_children == 0) break;
+    const int child = SelectChild(node);
+    (*state)->ApplyAction(nodes_[child].action);
+    nodes_[child].virtual_visits++;
+    path->push_back(child);
+    node_index = child;
+  }
+
+  if (nodes_[node_index].pending) {
+    for (int index : *path) nodes_[index].virtual_visits--;
+    return false;
+  }
+  return true;
+}
+
+// PUCT with virtual loss. Unvisited children have Q = 0.
+int Mali_BaMcts::SelectChild(const Node& parent) const {
+  const double sqrt_parent =
+      std::sqrt(std::max(1, parent.visit_count + parent.virtual_visits));
+  int best_child = parent.first_child;
+  double best_score = -std::numeric_limits<double>::infinity();
+  for (int i = 0; i < parent.num_children; ++i) {
+    const int index = parent.first_child + i;
+    const Node& child = nodes_[index];
+    const int visits = child.visit_count + child.virtual_visits;
+    const double q = (visits > 0)
+        ? (child.total_value - child.virtual_visits * config_.virtual_loss) / visits
+        : 0.0;
+    const double u = config_.c_puct * child.prior * sqrt_parent / (1 + visits);
+    if (q + u > best_score) {
+      best_score = q + u;
+      best_child = index;
+    }
+  }
+  return best_child;
+}
+
+void Mali_BaMcts::Expand(int node_index, const State& state, absl::Span<const float> priors) {
+  if (nodes_[node_index].expanded) return;
+
+  const std::vector<Action> legal_actions = state.LegalActions();
+  const Player player = state.CurrentPlayer();
+  double prior_sum = 0.0;
+  for (Action action : legal_actions) prior_sum += std::max(0.0f, priors[action]);
+
+  const int first_child = static_cast<int>(nodes_.size());
+  for (Action action : legal_actions) {
+    Node child;
+    child.action = action;
+    child.player = player;
+    child.prior = (prior_sum > 0.0)
+        ? static_cast<float>(std::max(0.0f, priors[action]) / prior_sum)
+        : 1.0f / legal_actions.size();
+    nodes_.push_back(child);
+  }
+
+  Node& node = nodes_[node_index];
+  node.first_child = first_child;
+  node.num_children = static_cast<int>(legal_actions.size());
+  node.expanded = true;
+}
+
+void Mali_BaMcts::Backup(const std::vector<int>& path, absl::Span<const float> values) {
+  for (int index : path) {
+    Node& node = nodes_[index];
+    node.visit_count++;
+    node.virtual_visits--;
+    if (node.player >= 0) node.total_value += values[node.player];
+  }
+}
+
+bool Mali_BaMcts::ExpandFromTransposition(const PendingLeaf& leaf) {
+  const uint64_t key = static_cast<const Mali_BaState*>(leaf.state.get())->HashKey();
+  uint64_t data = 0;
+  if (!table_->Probe(key, &data) || static_cast<uint32_t>(data >> 32) != generation_) return false;
+  const int source = static_cast<int>(data & 0xFFFFFFFFu);
+  const int leaf_index = leaf.path.back();
+  // The root's priors carry Dirichlet noise; do not spread it.
+  if (source <= 0 || source == leaf_index || source >= static_cast<int>(nodes_.size()) ||
+      !nodes_[source].expanded || nodes_[source].value_offset < 0) {
+    return false;
+  }
+
+  const int first_child = static_cast<int>(nodes_.size());
+  const int source_first = nodes_[source].first_child;
+  const int num_children = nodes_[source].num_children;
+  for (int i = 0; i < num_children; ++i) {
+    const Node& from = nodes_[source_first + i];
+    Node child;
+    child.action = from.action;
+    child.player = from.player;
+    child.prior = from.prior;
+    nodes_.push_back(child);
+  }
+  Node& node = nodes_[leaf_index];
+  node.first_child = first_child;
+  node.num_children = num_children;
+  node.expanded = true;
+  node.value_offset = nodes_[source].value_offset;
+  Backup(leaf.path,
+         absl::MakeConstSpan(node_values_).subspan(node.value_offset, num_players_));
+  return true;
+}
+
+void Mali_BaMcts::EvaluateBatch(std::vector<PendingLeaf>* batch, MctsResult* result) {
+  const int batch_size = static_cast<int>(batch->size());
+  observation_buffer_.resize(static_cast<size_t>(batch_size) * observation_size_);
+  prior_buffer_.assign(static_cast<size_t>(batch_size) * num_actions_, 0.0f);
+  value_buffer_.assign(static_cast<size_t>(batch_size) * num_players_, 0.0f);
+
+  batch_states_.clear();
+  for (const PendingLeaf& leaf : *batch) {
+    batch_states_.push_back(static_cast<const Mali_BaState*>(leaf.state.get()));
+  }
+  ObservationTensorBatch(batch_states_, absl::MakeSpan(observation_buffer_));
+
+  evaluator_(absl::MakeConstSpan(observation_buffer_), batch_size,
+             absl::MakeSpan(prior_buffer_), absl::MakeSpan(value_buffer_));
+  result->num_evaluator_calls++;
+
+  for (int i = 0; i < batch_size; ++i) {
+    PendingLeaf& leaf = (*batch)[i];
+    const int leaf_index = leaf.path.back();
+    Expand(leaf_index, *leaf.state,
+           absl::MakeConstSpan(prior_buffer_).subspan(i * num_actions_, num_actions_));
+    nodes_[leaf_index].pending = false;
+    nodes_[leaf_index].value_offset = static_cast<int>(node_values_.size());
+    node_values_.insert(node_values_.end(), value_buffer_.begin() + i * num_players_,
+                        value_buffer_.begin() + (i + 1) * num_players_);
+    if (table_) {
+      table_->Store(static_cast<const Mali_BaState*>(leaf.state.get())->HashKey(),
+                    static_cast<uint64_t>(generation_) << 32 | static_cast<uint32_t>(leaf_index));
+    }
+    Backup(leaf.path,
+           absl::MakeConstSpan(value_buffer_).subspan(i * num_players_, num_players_));
+  }
+}
+
+void Mali_BaMcts::AddRootNoise() {
+  Node& root = nodes_[0];
+  if (config_.dirichlet_alpha <= 0.0 || root.num_children == 0) return;
+
+  std::gamma_distribution<double> gamma(config_.dirichlet_alpha, 1.0);
+  std::vector<double> noise(root.num_children);
+  double noise_sum = 0.0;
+  for (double& n : noise) {
+    n = gamma(rng_);
+    noise_sum += n;
+  }
+  if (noise_sum <= 0.0) return;
+
+  const double eps = config_.dirichlet_epsilon;
+  for (int i = 0; i < root.num_children; ++i) {
+    Node& child = nodes_[root.first_child + i];
+    child.prior = static_cast<float>((1.0 - eps) * child.prior + eps * noise[i] / noise_sum);
+  }
+}
+
+void Mali_BaMcts::ApplyChanceOutcome(State* state) {
+  const std::vector<std::pair<Action, double>> outcomes = state->ChanceOutcomes();
+  SPIEL_CHECK_FALSE(outcomes.empty());
+  std::uniform_real_distribution<double> dist(0.0, 1.0);
+  double draw = dist(rng_);
+  for (const auto& [action, prob] : outcomes) {
+    draw -= prob;
+    if (draw <= 0.0) {
+      state->ApplyAction(action);
+      return;
+    }
+  }
+  state->ApplyAction(outcomes.back().first);
+}
+
+}  // namespace mali_ba
+}  // namespace open_spiel
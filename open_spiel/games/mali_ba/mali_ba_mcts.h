@@ -0,0 +1,125 @@
+// mali_ba_mcts.h
+// Native PUCT search over Mali_BaState with batched leaf evaluation.
+//
+// One Search() call runs a full AlphaZero-style search from a root state and
+// returns the visit-count policy. Simulations are collected in groups of
+// `batch_size` leaves; virtual loss steers the simulations of a group down
+// different paths, and each group goes to the evaluator in a single call so a
+// neural network sees one inference batch instead of one call per leaf.
+// With a transposition table, a leaf whose position (by HashKey()) was
+// already evaluated in this search reuses that evaluation and child list.
+#ifndef OPEN_SPIEL_GAMES_MALI_BA_MCTS_H_
+#define OPEN_SPIEL_GAMES_MALI_BA_MCTS_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "open_spiel/spiel.h"
+#include "open_spiel/abseil-cpp/absl/types/span.h"
+#include "open_spiel/games/mali_ba/mali_ba_rng.h"
+#include "open_spiel/games/mali_ba/mali_ba_transposition.h"
+
+namespace open_spiel {
+namespace mali_ba {
+
+class Mali_BaState;
+
+struct MctsConfig {
+  int num_simulations = 50;         // Leaf evaluations (or terminal visits) per search
+  int batch_size = 8;               // Max leaves handed to the evaluator at once
+  double c_puct = 2.0;              // Exploration constant in the PUCT formula
+  double virtual_loss = 1.0;        // Value subtracted per in-flight simulation
+  double dirichlet_alpha = 0.2;     // Root noise shape; <= 0 disables noise
+  double dirichlet_epsilon = 0.25;  // Root noise mixing weight
+  uint64_t seed = 0;                // Root stream channel for noise and chance sampling
+  int transposition_slots = 0;      // Transposition table size; 0 = no sharing
+};
+
+// Evaluates `batch_size` leaves at once.
+//   observations: batch_size * ObservationTensorSize() floats, row-major.
+//   priors (out): batch_size * NumDistinctActions() floats. Any non-negative
+//                 scores; they are masked to the legal actions and normalized.
+//   values (out): batch_size * NumPlayers() floats, one value per player.
+using BatchedEvaluator = std::function<void(
+    absl::Span<const float> observations, int batch_size,
+    absl::Span<float> priors, absl::Span<float> values)>;
+
+struct MctsResult {
+  std::vector<Action> actions;     // Root legal actions
+  std::vector<int> visit_counts;   // Visits per entry of `actions`
+  std::vector<double> policy;      // Normalized visits over NumDistinctActions()
+  Action best_action = kInvalidAction;  // Most visited root action
+  double root_value = 0.0;         // Mean value for the player to move at the root
+  int num_evaluator_calls = 0;
+  int num_transposition_hits = 0;  // Leaves answered from an earlier evaluation
+};
+
+class Mali_BaMcts {
+ public:
+  Mali_BaMcts(const MctsConfig& config, BatchedEvaluator evaluator);
+
+  // Searches from `root`, which is not modified. Must not be terminal.
+  MctsResult Search(const Mali_BaState& root);
+
+  const MctsConfig& config() const { return config_; }
+
+ private:
+  struct Node {
+    Action action = kInvalidAction;  // Action that led here from the parent
+    Player player = kInvalidPlayer;  // Player who took `action`
+    float prior = 0.0f;
+    int visit_count = 0;
+    int virtual_visits = 0;          // Simulations currently passing through
+    double total_value = 0.0;        // Sum of values for `player`
+    int first_child = -1;            // Children are contiguous in nodes_
+    int num_children = 0;
+    bool expanded = false;
+    bool pending = false;            // Leaf queued in the current batch
+    int value_offset = -1;           // Evaluator values in node_values_, once evaluated
+  };
+
+  struct PendingLeaf {
+    std::vector<int> path;           // Node indices from the root to the leaf
+    std::unique_ptr<State> state;
+  };
+
+  // Walks from the root to an unexpanded or terminal node, applying virtual
+  // loss along the way. Returns false if the walk hit a leaf that is already
+  // queued, in which case the virtual loss has been rolled back.
+  bool SelectLeaf(const Mali_BaState& root, std::vector<int>* path,
+                  std::unique_ptr<State>* state);
+  int SelectChild(const Node& parent) const;
+  void Expand(int node_index, const State& state, absl::Span<const float> priors);
+  void Backup(const std::vector<int>& path, absl::Span<const float> values);
+  // Expands the leaf from an evaluated node with the same hash and backs up
+  // that node's values. False if the table has no such node.
+  bool ExpandFromTransposition(const PendingLeaf& leaf);
+  void EvaluateBatch(std::vector<PendingLeaf>* batch, MctsResult* result);
+  void AddRootNoise();
+  void ApplyChanceOutcome(State* state);
+
+  MctsConfig config_;
+  BatchedEvaluator evaluator_;
+  Mali_BaRng rng_;                  // Forked from the root's stream per search
+  std::vector<Node> nodes_;
+  std::vector<float> node_values_;  // num_players_ per evaluated node
+  std::unique_ptr<Mali_BaTranspositionTable> table_;  // Payload: generation << 32 | node
+  uint32_t generation_ = 0;         // Search() count; tells this search's entries apart
+
+  // Reused evaluator buffers
+  std::vector<float> observation_buffer_;
+  std::vector<float> prior_buffer_;
+  std::vector<float> value_buffer_;
+  std::vector<const Mali_BaState*> batch_states_;
+  int num_players_ = 0;
+  int num_actions_ = 0;
+  int observation_size_ = 0;
+};
+
+}  // namespace mali_ba
+}  // namespace open_spiel
+
+#endif  // OPEN_SPIEL_GAMES_MALI_BA_MCTS_H_
@@ -0,0 +1,177 @@
+// mali_ba_memory.cc
+// Memory accounting: allocation counters and the state and game footprints
+
+#include "open_spiel/games/mali_ba/mali_ba_memory.h"
+
+#include <algorithm>
+#include <numeric>
+#include <sstream>
+
+#include "open_spiel/games/mali_ba/mali_ba_game.h"
+#include "open_spiel/games/mali_ba/mali_ba_state.h"
+
+namespace open_spiel {
+namespace mali_ba {
+
+namespace memory_internal {
+std::atomic<bool> g_count_allocations{false};
+thread_local AllocationCounts t_allocation_counts;
+}  // namespace memory_internal
+
+void SetAllocationCountingEnabled(bool enabled) {
+  memory_internal::g_count_allocations.store(enabled, std::memory_order_relaxed);
+}
+
+size_t MemoryBreakdown::TotalBytes() const {
+  return std::accumulate(components.begin(), components.end(), size_t{0},
+                         [](size_t sum, const MemoryComponent& c) { return sum + c.bytes; });
+}
+
+size_t MemoryBreakdown::OwnedBytes() const {
+  return std::accumulate(components.begin(), components.end(), size_t{0},
+                         [](size_t sum, const MemoryComponent& c) {
+                           return c.shared ? sum : sum + c.bytes;
+                         });
+}
+
+std::string MemoryBreakdown::ToString() const {
+  std::vector<MemoryComponent> sorted = components;
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [](const MemoryComponent& a, const MemoryComponent& b) {
+                     return a.bytes > b.bytes;
+                   });
+  std::ostringstream out;
+  for (const MemoryComponent& c : sorted) {
+    out << c.name << ": " << c.bytes << (c.shared ? " (shared)" : "") << "\n";
+  }
+  out << "total: " << TotalBytes() << "\nowned: " << OwnedBytes() << "\n";
+  return out.str();
+}
+
+namespace {
+
+size_t RouteBytes(const TradeRoute& route) { return VectorBytes(route.hexes); }
+
+size_t MoveBytes(const Move& move) {
+  return VectorBytes(move.path) + VectorBytes(move.trade_route_path) +
+         StringBytes(move.action_string);
+}
+
+size_t RoutesBytes(const std::vector<TradeRoute>& routes) {
+  size_t bytes = VectorBytes(routes);
+  for (const TradeRoute& route : routes) bytes += RouteBytes(route);
+  return bytes;
+}
+
+size_t PathsBytes(const std::vector<std::vector<HexCoord>>& paths) {
+  size_t bytes = VectorBytes(paths);
+  for (const auto& path : paths) bytes += VectorBytes(path);
+  return bytes;
+}
+
+size_t IntListsBytes(const std::vector<std::vector<int>>& lists) {
+  size_t bytes = VectorBytes(lists);
+  for (const auto& list : lists) bytes += VectorBytes(list);
+  return bytes;
+}
+
+}  // namespace
+
+// =====================================================================
+// Mali_BaState
+// =====================================================================
+MemoryBreakdown Mali_BaState::MemoryFootprint() const {
+  MemoryBreakdown breakdown;
+  breakdown.Add("object", sizeof(Mali_BaState) - sizeof(rng_));
+  breakdown.Add("rng", sizeof(rng_));
+  breakdown.Add("board", board_.size() * sizeof(HexCell), board_.IsShared());
+
+  size_t journal = VectorBytes(undo_journal_);
+  for (const UndoFrame& frame : undo_journal_) {
+    journal += VectorBytes(frame.entries) + RoutesBytes(frame.removed_routes) +
+               VectorBytes(frame.meeples_in_hand_) + VectorBytes(frame.current_mancala_path_);
+  }
+  breakdown.Add("undo_journal", journal);
+
+  size_t moves = VectorBytes(moves_history_);
+  for (const Move& move : moves_history_) moves += MoveBytes(move);
+  breakdown.Add("moves_history", moves);
+  breakdown.Add("history", VectorBytes(history_));
+
+  breakdown.Add("trade_routes", RoutesBytes(trade_routes_));
+  breakdown.Add("goods", VectorBytes(common_goods_) + VectorBytes(rare_goods_) +
+                             VectorBytes(player_posts_supply_));
+  breakdown.Add("mid_turn", VectorBytes(meeples_in_hand_) + VectorBytes(current_mancala_path_));
+
+  if (cached_legal_actions_result_) {
+    breakdown.Add("legal_actions_cache",
+                  sizeof(LegalActionsResult) + VectorBytes(cached_legal_actions_result_->actions),
+                  cached_legal_actions_result_.use_count() > 1);
+  }
+  if (cached_trade_routes_) {
+    size_t bytes = sizeof(TradeRouteCache) + VectorBytes(*cached_trade_routes_);
+    for (const auto& entry : *cached_trade_routes_) bytes += PathsBytes(entry.second);
+    breakdown.Add("trade_route_cache", bytes, cached_trade_routes_.use_count() > 1);
+  }
+  if (route_connectivity_) {
+    breakdown.Add("route_connectivity",
+                  sizeof(RouteConnectivity) + IntListsBytes(route_connectivity_->routes_through) +
+                      IntListsBytes(route_connectivity_->connected_cities),
+                  route_connectivity_.use_count() > 1);
+  }
+  if (obs_board_planes_) {
+    breakdown.Add("observation_planes", sizeof(std::vector<float>) + VectorBytes(*obs_board_planes_),
+                  obs_board_planes_.use_count() > 1);
+  }
+
+  size_t counters = VectorBytes(score_counters_);
+  for (const PlayerScoreCounters& c : score_counters_) {
+    counters += VectorBytes(c.rare_good_regions) + VectorBytes(c.centers_per_region);
+  }
+  breakdown.Add("score_counters", counters);
+  breakdown.Add("misc", VectorBytes(cumulative_returns_) + VectorBytes(obs_dirty_cells_) +
+                            VectorBytes(hash_pending_cells_) + StringBytes(game_end_reason_));
+
+  if (change_feed_) {
+    size_t bytes = sizeof(ChangeFeed) + VectorBytes(change_feed_->entries);
+    for (const std::string& entry : change_feed_->entries) bytes += StringBytes(entry);
+    breakdown.Add("change_feed", bytes);
+  }
+  return breakdown;
+}
+
+// =====================================================================
+// Mali_BaGame
+// =====================================================================
+MemoryBreakdown Mali_BaGame::MemoryFootprint() const {
+  MemoryBreakdown breakdown;
+  breakdown.Add("object", sizeof(Mali_BaGame));
+
+  // Shared with every game loaded on the same hexes.
+  const BoardTopology& topology = *board_topology_;
+  breakdown.Add("board_topology",
+                sizeof(BoardTopology) + VectorBytes(topology.hexes) + VectorBytes(topology.grid) +
+                    VectorBytes(topology.neighbors) + VectorBytes(topology.hop_distances) +
+                    VectorBytes(topology.cube_distances),
+                board_topology_.use_count() > 1);
+  breakdown.Add("board_kernels", board_kernels_->MemoryBytes(), board_kernels_.use_count() > 1);
+
+  size_t config = SetBytes(valid_hexes_) + SetBytes(coastal_hexes_) + VectorBytes(cities_);
+  for (const City& city : cities_) {
+    config += StringBytes(city.name) + StringBytes(city.culture) +
+              StringBytes(city.common_good) + StringBytes(city.rare_good);
+  }
+  for (const auto& [id, name] : region_id_to_name_map_) config += StringBytes(name);
+  config += region_id_to_name_map_.capacity() * (sizeof(std::pair<const int, std::string>) + 1);
+  breakdown.Add("board_config", config);
+
+  breakdown.Add("lookup_tables",
+                VectorBytes(hex_tensor_offsets_) + VectorBytes(hex_city_ids_) +
+                    IntListsBytes(nearest_city_ids_) + VectorBytes(city_tensor_offsets_) +
+                    VectorBytes(valid_region_ids_) + VectorBytes(hex_region_ids_) +
+                    VectorBytes(hex_region_slots_) + VectorBytes(rare_good_regions_));
+  return breakdown;
+}
+
+}  // namespace mali_ba
+}  // namespace open_spiel
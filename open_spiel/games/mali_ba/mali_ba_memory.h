@@ -0,0 +1,125 @@
+// mali_ba_memory.h
+// Memory accounting: per-component byte counts for states and games, and an
+// optional per-thread allocation counter for the hot containers.
+//
+// Mali_BaState::MemoryFootprint() and Mali_BaGame::MemoryFootprint() add up
+// what each component holds, using container capacities. Allocator
+// bookkeeping is not included. A component held through a shared_ptr that
+// another state or game also references, such as the copy-on-write board or
+// the legal-action cache, is flagged `shared`. OwnedBytes() leaves those
+// out, so it can be summed over many states without counting a shared
+// buffer once per state.
+//
+// Containers declared with CountingAllocator report every allocation to the
+// calling thread's AllocationCounts while counting is enabled. It is off by
+// default, and then an allocation costs one relaxed atomic load. Build with
+// -DMALI_BA_NO_PERF to compile the counting out, as for the perf counters.
+#ifndef OPEN_SPIEL_GAMES_MALI_BA_MEMORY_H_
+#define OPEN_SPIEL_GAMES_MALI_BA_MEMORY_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace open_spiel {
+namespace mali_ba {
+
+struct MemoryComponent {
+  std::string name;
+  size_t bytes = 0;
+  bool shared = false;  // Also referenced by another state or game
+};
+
+struct MemoryBreakdown {
+  std::vector<MemoryComponent> components;
+
+  void Add(std::string name, size_t bytes, bool shared = false) {
+    components.push_back({std::move(name), bytes, shared});
+  }
+  size_t TotalBytes() const;
+  // Leaves out the shared components.
+  size_t OwnedBytes() const;
+  // One "name: bytes" line per component, largest first, then the totals.
+  std::string ToString() const;
+};
+
+// Heap bytes behind common containers, from their capacities.
+template <typename T, typename A>
+size_t VectorBytes(const std::vector<T, A>& v) {
+  return v.capacity() * sizeof(T);
+}
+// 0 while the string fits in its inline buffer.
+inline size_t StringBytes(const std::string& s) {
+  static const size_t kInlineCapacity = std::string().capacity();
+  return s.capacity() > kInlineCapacity ? s.capacity() + 1 : 0;
+}
+// A red-black tree node holds the value plus about four pointers' worth of
+// links and colour.
+template <typename T>
+size_t SetBytes(const std::set<T>& s) {
+  return s.size() * (sizeof(T) + 4 * sizeof(void*));
+}
+
+struct AllocationCounts {
+  uint64_t allocations = 0;
+  uint64_t bytes = 0;
+};
+
+namespace memory_internal {
+extern std::atomic<bool> g_count_allocations;
+extern thread_local AllocationCounts t_allocation_counts;
+}  // namespace memory_internal
+
+void SetAllocationCountingEnabled(bool enabled);
+inline bool AllocationCountingEnabled() {
+  return memory_internal::g_count_allocations.load(std::memory_order_relaxed);
+}
+// What the calling thread's counting containers have allocated since its
+// last reset. Callers diff two readings around the code they measure.
+inline AllocationCounts ThreadAllocationCounts() {
+  return memory_internal::t_allocation_counts;
+}
+inline void ResetThreadAllocationCounts() {
+  memory_internal::t_allocation_counts = AllocationCounts();
+}
+
+// std::allocator that counts its allocations. It is stateless, so containers
+// using it copy, move and swap like ordinary std::vectors.
+template <typename T>
+struct CountingAllocator {
+  using value_type = T;
+
+  CountingAllocator() noexcept = default;
+  template <typename U>
+  CountingAllocator(const CountingAllocator<U>&) noexcept {}
+
+  T* allocate(size_t n) {
+#ifndef MALI_BA_NO_PERF
+    if (AllocationCountingEnabled()) {
+      AllocationCounts& counts = memory_internal::t_allocation_counts;
+      ++counts.allocations;
+      counts.bytes += n * sizeof(T);
+    }
+#endif
+    return std::allocator<T>().allocate(n);
+  }
+  void deallocate(T* p, size_t n) noexcept { std::allocator<T>().deallocate(p, n); }
+
+  template <typename U>
+  bool operator==(const CountingAllocator<U>&) const noexcept { return true; }
+  template <typename U>
+  bool operator!=(const CountingAllocator<U>&) const noexcept { return false; }
+};
+
+template <typename T>
+using CountedVector = std::vector<T, CountingAllocator<T>>;
+
+}  // namespace mali_ba
+}  // namespace open_spiel
+
+#endif  // OPEN_SPIEL_GAMES_MALI_BA_MEMORY_H_
@@ -0,0 +1,312 @@
+// mali_ba_move_log.cc
+// Asynchronous move-log sink: lock-free queue, background writer, batched output
+
+#include "open_spiel/games/mali_ba/mali_ba_move_log.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <utility>
+
+#ifdef MALI_BA_MOVE_LOG_ZLIB
+#include <zlib.h>
+#endif
+
+#include "open_spiel/games/mali_ba/mali_ba_common.h"
+#include "open_spiel/spiel_utils.h"
+#include "json.hpp"
+
+namespace open_spiel {
+namespace mali_ba {
+namespace {
+
+uint64_t RoundUpToPowerOfTwo(int value) {
+  uint64_t result = 2;
+  while (result < static_cast<uint64_t>(value)) result <<= 1;
+  return result;
+}
+
+std::string DefaultMoveLogPath() {
+  return "/tmp/mali_ba.states." + GetCurrentDateTime() + ".pid-" +
+         std::to_string(getpid()) + ".log";
+}
+
+}  // namespace
+
+// =====================================================================
+// MoveLogQueue
+// =====================================================================
+
+// Each slot's sequence number says whose turn it is: equal to the position
+// means free for the producer at that position, position + 1 means filled
+// for the consumer.
+MoveLogQueue::MoveLogQueue(int capacity) {
+  const uint64_t size = RoundUpToPowerOfTwo(std::max(capacity, 2));
+  slots_ = std::make_unique<Slot[]>(size);
+  mask_ = size - 1;
+  for (uint64_t i = 0; i < size; ++i) {
+    slots_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+bool MoveLogQueue::TryPush(MoveLogRecord* record) {
+  uint64_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+  while (true) {
+    Slot& slot = slots_[pos & mask_];
+    const uint64_t seq = slot.sequence.load(std::memory_order_acquire);
+    const int64_t diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+    if (diff == 0) {
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        slot.record = std::move(*record);
+        slot.sequence.store(pos + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (diff < 0) {
+      return false;  // Full
+    } else {
+      pos = enqueue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+bool MoveLogQueue::TryPop(MoveLogRecord* record) {
+  uint64_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+  while (true) {
+    Slot& slot = slots_[pos & mask_];
+    const uint64_t seq = slot.sequence.load(std::memory_order_acquire);
+    const int64_t diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos + 1);
+    if (diff == 0) {
+      if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        *record = std::move(slot.record);
+        slot.sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (diff < 0) {
+      return false;  // Empty
+    } else {
+      pos = dequeue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+// =====================================================================
+// Output file (plain or gzip)
+// =====================================================================
+class MoveLogSink::Output {
+ public:
+  Output(const std::string& path, bool compress) {
+#ifdef MALI_BA_MOVE_LOG_ZLIB
+    if (compress) {
+      gz_ = gzopen(path.c_str(), "wb");
+      return;
+    }
+#endif
+    file_.open(path, std::ios::out | std::ios::binary);
+  }
+
+  ~Output() {
+#ifdef MALI_BA_MOVE_LOG_ZLIB
+    if (gz_ != nullptr) gzclose(gz_);
+#endif
+  }
+
+  bool is_open() const {
+#ifdef MALI_BA_MOVE_LOG_ZLIB
+    if (gz_ != nullptr) return true;
+#endif
+    return file_.is_open();
+  }
+
+  void Write(const std::string& data) {
+#ifdef MALI_BA_MOVE_LOG_ZLIB
+    if (gz_ != nullptr) {
+      gzwrite(gz_, data.data(), static_cast<unsigned>(data.size()));
+      return;
+    }
+#endif
+    file_.write(data.data(), data.size());
+  }
+
+  void Flush() {
+#ifdef MALI_BA_MOVE_LOG_ZLIB
+    if (gz_ != nullptr) {
+      gzflush(gz_, Z_SYNC_FLUSH);
+      return;
+    }
+#endif
+    file_.flush();
+  }
+
+ private:
+  std::ofstream file_;
+#ifdef MALI_BA_MOVE_LOG_ZLIB
+  gzFile gz_ = nullptr;
+#endif
+};
+
+// =====================================================================
+// MoveLogSink
+// =====================================================================
+MoveLogSink::MoveLogSink(const MoveLogConfig& config)
+    : config_(config), queue_(config.queue_capacity) {
+  SPIEL_CHECK_GT(config_.batch_size, 0);
+  SPIEL_CHECK_GT(config_.flush_interval_ms, 0);
+
+  bool compress = config_.compress;
+#ifndef MALI_BA_MOVE_LOG_ZLIB
+  if (compress) {
+    LOG_WARN("Move log compression requested but zlib support was not built in; "
+             "writing an uncompressed log.");
+    compress = false;
+  }
+#endif
+  path_ = config_.path.empty() ? DefaultMoveLogPath() : config_.path;
+  if (compress && (path_.size() < 3 || path_.compare(path_.size() - 3, 3, ".gz") != 0)) {
+    path_ += ".gz";
+  }
+
+  output_ = std::make_unique<Output>(path_, compress);
+  ok_ = output_->is_open();
+  if (!ok_) {
+    LOG_WARN("Failed to open move log file: ", path_);
+  } else {
+    LOG_INFO("Move logger initialized: ", path_);
+  }
+  writer_ = std::thread(&MoveLogSink::WriterLoop, this);
+}
+
+MoveLogSink::~MoveLogSink() {
+  stop_.store(true);
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    wake_cv_.notify_one();
+  }
+  writer_.join();
+}
+
+void MoveLogSink::LogSetup(int64_t game_id, std::string setup_json) {
+  MoveLogRecord record;
+  record.kind = MoveLogRecord::Kind::kSetup;
+  record.game_id = game_id;
+  record.payload = std::move(setup_json);
+  Enqueue(std::move(record));
+}
+
+void MoveLogSink::LogMove(int64_t game_id, int move_number, std::string action,
+                          std::string state_json) {
+  MoveLogRecord record;
+  record.kind = MoveLogRecord::Kind::kMove;
+  record.game_id = game_id;
+  record.move_number = move_number;
+  record.action = std::move(action);
+  record.payload = std::move(state_json);
+  Enqueue(std::move(record));
+}
+
+void MoveLogSink::Enqueue(MoveLogRecord record) {
+  if (!ok_) {
+    records_dropped_.fetch_add(1);
+    return;
+  }
+  while (!queue_.TryPush(&record)) {
+    if (config_.drop_when_full) {
+      records_dropped_.fetch_add(1);
+      return;
+    }
+    wake_cv_.notify_one();
+    std::this_thread::yield();
+  }
+  // Wake the writer once per batch; otherwise it picks records up on its timer.
+  const int64_t enqueued = records_enqueued_.fetch_add(1) + 1;
+  if (enqueued % config_.batch_size == 0) wake_cv_.notify_one();
+}
+
+void MoveLogSink::Flush() {
+  std::unique_lock<std::mutex> lock(wake_mutex_);
+  const int64_t target = records_enqueued_.load();
+  flush_target_ = std::max(flush_target_, target);
+  wake_cv_.notify_one();
+  flushed_cv_.wait(lock, [&] { return flushed_through_ >= target; });
+}
+
+void MoveLogSink::WriterLoop() {
+  const auto interval = std::chrono::milliseconds(config_.flush_interval_ms);
+  std::vector<MoveLogRecord> batch;
+  batch.reserve(config_.batch_size);
+  std::string buffer;
+  MoveLogRecord record;
+  int64_t processed = 0;
+  bool dirty = false;
+  auto last_flush = std::chrono::steady_clock::now();
+
+  while (true) {
+    batch.clear();
+    while (static_cast<int>(batch.size()) < config_.batch_size && queue_.TryPop(&record)) {
+      batch.push_back(std::move(record));
+    }
+    if (!batch.empty()) {
+      buffer.clear();
+      for (const MoveLogRecord& r : batch) AppendFormatted(r, &buffer);
+      output_->Write(buffer);
+      processed += batch.size();
+      records_written_.fetch_add(batch.size());
+      dirty = true;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    bool flush_requested = false;
+    {
+      std::lock_guard<std::mutex> lock(wake_mutex_);
+      flush_requested = flush_target_ > flushed_through_ && processed >= flush_target_;
+    }
+    if (flush_requested || (dirty && now - last_flush >= interval)) {
+      output_->Flush();
+      dirty = false;
+      last_flush = now;
+      std::lock_guard<std::mutex> lock(wake_mutex_);
+      flushed_through_ = processed;
+      flushed_cv_.notify_all();
+    }
+
+    if (batch.empty()) {
+      if (stop_.load()) break;
+      std::unique_lock<std::mutex> lock(wake_mutex_);
+      wake_cv_.wait_for(lock, interval, [&] {
+        return stop_.load() || flush_target_ > flushed_through_ || !queue_.LooksEmpty();
+      });
+    }
+  }
+
+  if (dirty) output_->Flush();
+}
+
+void MoveLogSink::AppendFormatted(const MoveLogRecord& record, std::string* out) const {
+  if (config_.format == MoveLogFormat::kSections) {
+    if (record.kind == MoveLogRecord::Kind::kSetup) {
+      *out += "[setup]\n";
+      *out += record.payload;
+      *out += "\n\n";
+    } else {
+      *out += "[move" + std::to_string(record.move_number) + "]\n";
+      *out += "game=" + std::to_string(record.game_id) + "\n";
+      *out += "action=" + record.action + "\n";
+      *out += "state=" + record.payload + "\n\n";
+    }
+    return;
+  }
+
+  // JSON lines. Payloads are already JSON and are spliced in as-is.
+  *out += "{\"game\":" + std::to_string(record.game_id);
+  if (record.kind == MoveLogRecord::Kind::kSetup) {
+    *out += ",\"setup\":" + record.payload + "}\n";
+  } else {
+    *out += ",\"move\":" + std::to_string(record.move_number);
+    *out += ",\"action\":" + nlohmann::json(record.action).dump();
+    *out += ",\"state\":" + record.payload + "}\n";
+  }
+}
+
+}  // namespace mali_ba
+}  // namespace open_spiel
@@ -0,0 +1,129 @@
+// mali_ba_move_log.h
+// Asynchronous move-log sink shared by any number of concurrently played games.
+//
+// Game threads hand records to a bounded lock-free queue and return at once;
+// a single background thread drains the queue in batches, formats the records
+// and writes them out, optionally gzip-compressed. Every record carries the id
+// of the game it belongs to, so several games can share one log file.
+#ifndef OPEN_SPIEL_GAMES_MALI_BA_MOVE_LOG_H_
+#define OPEN_SPIEL_GAMES_MALI_BA_MOVE_LOG_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace open_spiel {
+namespace mali_ba {
+
+enum class MoveLogFormat {
+  kSections,   // Replay format: [setup] / [moveN] sections, plus a game=<id> line
+  kJsonLines,  // One JSON object per record
+};
+
+struct MoveLogConfig {
+  std::string path;                  // Empty = /tmp/mali_ba.states.<datetime>.pid-<pid>.log
+  MoveLogFormat format = MoveLogFormat::kSections;
+  bool compress = false;             // gzip; needs MALI_BA_MOVE_LOG_ZLIB at build time
+  int queue_capacity = 4096;         // Records; rounded up to a power of two
+  int batch_size = 64;               // Records formatted per write
+  int flush_interval_ms = 200;       // Max time a record waits before reaching the file
+  bool drop_when_full = false;       // Drop (and count) records instead of waiting
+};
+
+struct MoveLogRecord {
+  enum class Kind : uint8_t { kSetup, kMove };
+  Kind kind = Kind::kMove;
+  int64_t game_id = -1;
+  int move_number = 0;               // 1-based within the game; 0 for setup
+  std::string action;
+  std::string payload;               // Setup JSON or serialized state JSON
+};
+
+// Bounded multi-producer queue (Vyukov). TryPush and TryPop never take a lock.
+class MoveLogQueue {
+ public:
+  explicit MoveLogQueue(int capacity);
+  bool TryPush(MoveLogRecord* record);  // Moves from *record on success
+  bool TryPop(MoveLogRecord* record);
+  // May be stale by the time it returns; only used to decide whether to sleep.
+  bool LooksEmpty() const {
+    return enqueue_pos_.load(std::memory_order_acquire) ==
+           dequeue_pos_.load(std::memory_order_acquire);
+  }
+
+ private:
+  struct Slot {
+    std::atomic<uint64_t> sequence;
+    MoveLogRecord record;
+  };
+  std::unique_ptr<Slot[]> slots_;
+  uint64_t mask_ = 0;
+  alignas(64) std::atomic<uint64_t> enqueue_pos_{0};
+  alignas(64) std::atomic<uint64_t> dequeue_pos_{0};
+};
+
+class MoveLogSink {
+ public:
+  explicit MoveLogSink(const MoveLogConfig& config);
+  // Drains every queued record before closing the file.
+  ~MoveLogSink();
+
+  MoveLogSink(const MoveLogSink&) = delete;
+  MoveLogSink& operator=(const MoveLogSink&) = delete;
+
+  // False if the output file could not be opened; records are then discarded.
+  bool ok() const { return ok_; }
+  const std::string& path() const { return path_; }
+
+  // Ids are unique within this sink.
+  int64_t NewGameId() { return next_game_id_.fetch_add(1); }
+
+  void LogSetup(int64_t game_id, std::string setup_json);
+  void LogMove(int64_t game_id, int move_number, std::string action,
+               std::string state_json);
+
+  // Blocks until everything logged so far is written and flushed.
+  void Flush();
+
+  int64_t records_written() const { return records_written_.load(); }
+  int64_t records_dropped() const { return records_dropped_.load(); }
+
+ private:
+  class Output;
+
+  void Enqueue(MoveLogRecord record);
+  void WriterLoop();
+  void AppendFormatted(const MoveLogRecord& record, std::string* out) const;
+
+  MoveLogConfig config_;
+  std::string path_;
+  bool ok_ = false;
+  std::unique_ptr<Output> output_;
+  MoveLogQueue queue_;
+
+  std::atomic<int64_t> next_game_id_{0};
+  std::atomic<int64_t> records_enqueued_{0};
+  std::atomic<int64_t> records_written_{0};
+  std::atomic<int64_t> records_dropped_{0};
+
+  // The writer sleeps on wake_cv_ when the queue is empty; producers only
+  // notify it, they never hold wake_mutex_ while queueing. A missed wakeup
+  // costs at most one flush interval.
+  std::mutex wake_mutex_;
+  std::condition_variable wake_cv_;
+  std::condition_variable flushed_cv_;
+  int64_t flush_target_ = 0;          // Guarded by wake_mutex_
+  int64_t flushed_through_ = 0;       // Guarded by wake_mutex_
+  std::atomic<bool> stop_{false};
+  std::thread writer_;
+};
+
+}  // namespace mali_ba
+}  // namespace open_spiel
+
+#endif  // OPEN_SPIEL_GAMES_MALI_BA_MOVE_LOG_H_
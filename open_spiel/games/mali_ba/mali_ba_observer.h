@@ -25,6 +25,13 @@
 namespace open_spiel {
 namespace mali_ba {
 
+class Mali_BaState;
+
+// Planes 0-25 (tokens, meeples, posts, centers, cities) depend only on the
+// board and lead the tensor; the remaining planes depend on the perspective
+// player and the goods.
+constexpr int kNumObservationBoardPlanes = 26;
+
 // A concrete Observer class for Mali-Ba game that implements the required
 // pure virtual methods from the Observer base class.
 class MaliBaObserver : public Observer {
@@ -38,6 +45,17 @@ class MaliBaObserver : public Observer {
 
   std::string StringFrom(const State& state, int player) const override;
 
+  // Writes the observation for `player` directly into `values`, which must
+  // hold ObservationTensorSize() floats. Does not allocate.
+  void WriteTo(const Mali_BaState& state, int player, absl::Span<float> values) const;
+
+  // The pieces WriteTo() is made of, used by the state's incremental cache.
+  // WriteBoardPlanes() and WriteBoardCell() take a span that starts at plane
+  // 0 and covers at least the kNumObservationBoardPlanes board planes.
+  void WriteBoardPlanes(const Mali_BaState& state, absl::Span<float> values) const;
+  void WriteBoardCell(const Mali_BaState& state, int index, absl::Span<float> values) const;
+  void WritePlayerPlanes(const Mali_BaState& state, int player, absl::Span<float> values) const;
+
  private:
   // Helper methods to write different parts of the observation tensor
   // These methods take a state, player, and a span to write the tensor values into
@@ -49,10 +67,20 @@ class MaliBaObserver : public Observer {
   void WritePerfectInfo(const State& state, int player,
     absl::Span<float> values) const;
 
+  int PlaneSize(const State& state) const;
+
   // The type of observation we're providing
   IIGObservationType iig_obs_type_;
 };
 
+// Fills one observation per state into `out` (row-major, one
+// ObservationTensorSize() row per state).
+// `players` gives each row's perspective; empty means each state's
+// CurrentPlayer(). All states must belong to the same game.
+void ObservationTensorBatch(absl::Span<const Mali_BaState* const> states,
+                            absl::Span<float> out,
+                            absl::Span<const Player> players = {});
+
 // Factory function to create a Mali-Ba observer
 std::shared_ptr<Observer> MakeMaliBaObserver(IIGObservationType iig_obs_type);
 
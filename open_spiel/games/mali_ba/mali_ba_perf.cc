@@ -0,0 +1,179 @@
+// mali_ba_perf.cc
+// Per-thread perf counters: slot registry, recording, aggregation and reset
+
+#include "open_spiel/games/mali_ba/mali_ba_perf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <mutex>
+
+namespace open_spiel {
+namespace mali_ba {
+
+namespace perf_internal {
+std::atomic<bool> g_enabled{false};
+}  // namespace perf_internal
+
+namespace {
+
+// Written only by the owning thread, read by GetPerfStats(); relaxed atomics
+// keep those reads well-defined without making the writer pay for an RMW.
+struct SectionSlots {
+  std::atomic<uint64_t> calls{0};
+  std::atomic<uint64_t> total_ns{0};
+  std::atomic<uint64_t> max_ns{0};
+  std::array<std::atomic<uint64_t>, kPerfHistogramBuckets> histogram{};
+};
+
+struct ThreadSlots {
+  // The reset generation these counts belong to. A thread whose epoch is
+  // behind the registry's zeros itself before recording again, and readers
+  // skip it until then.
+  std::atomic<uint64_t> epoch{0};
+  std::array<SectionSlots, kNumPerfSections> sections;
+};
+
+// Slots outlive their threads: a thread's counts stay visible after it
+// exits, and its slots are handed to the next new thread.
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadSlots>> slots;
+  std::vector<ThreadSlots*> free_slots;
+  std::atomic<uint64_t> epoch{1};
+};
+
+Registry& GetRegistry() {
+  static auto* registry = new Registry();
+  return *registry;
+}
+
+class LocalSlots {
+ public:
+  LocalSlots() {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    if (!registry.free_slots.empty()) {
+      slots_ = registry.free_slots.back();
+      registry.free_slots.pop_back();
+    } else {
+      registry.slots.push_back(std::make_unique<ThreadSlots>());
+      slots_ = registry.slots.back().get();
+    }
+  }
+  ~LocalSlots() {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.free_slots.push_back(slots_);
+  }
+  ThreadSlots* get() const { return slots_; }
+
+ private:
+  ThreadSlots* slots_;
+};
+
+void Bump(std::atomic<uint64_t>& counter, uint64_t amount) {
+  counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+int BucketOf(uint64_t ns) {
+  int bucket = 0;
+  while (bucket + 1 < kPerfHistogramBuckets && (ns >> (bucket + 1)) != 0) ++bucket;
+  return bucket;
+}
+
+void ZeroSlots(ThreadSlots* slots) {
+  for (SectionSlots& section : slots->sections) {
+    section.calls.store(0, std::memory_order_relaxed);
+    section.total_ns.store(0, std::memory_order_relaxed);
+    section.max_ns.store(0, std::memory_order_relaxed);
+    for (auto& bucket : section.histogram) bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+}  // namespace
+
+const char* PerfSectionName(PerfSection section) {
+  switch (section) {
+    case PerfSection::kLegalActions: return "legal_actions";
+    case PerfSection::kPlaceTokenMoves: return "place_token_moves";
+    case PerfSection::kMancalaMoves: return "mancala_moves";
+    case PerfSection::kUpgradeMoves: return "upgrade_moves";
+    case PerfSection::kTradeRouteMoves: return "trade_route_moves";
+    case PerfSection::kIncomeMoves: return "income_moves";
+    case PerfSection::kRouteSearch: return "route_search";
+    case PerfSection::kHeuristicWeights: return "heuristic_weights";
+    case PerfSection::kApplyAction: return "apply_action";
+    case PerfSection::kUndoAction: return "undo_action";
+    case PerfSection::kClone: return "clone";
+    case PerfSection::kSerialize: return "serialize";
+    case PerfSection::kDeserialize: return "deserialize";
+    case PerfSection::kObservation: return "observation";
+    case PerfSection::kNumSections: break;
+  }
+  return "unknown";
+}
+
+uint64_t PerfSectionStats::ApproxQuantileNs(double q) const {
+  if (calls == 0) return 0;
+  const uint64_t target = std::max<uint64_t>(
+      1, static_cast<uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * calls)));
+  uint64_t seen = 0;
+  for (int b = 0; b < kPerfHistogramBuckets; ++b) {
+    seen += histogram[b];
+    if (seen >= target) return uint64_t{1} << (b + 1);
+  }
+  return max_ns;
+}
+
+void SetPerfCountersEnabled(bool enabled) {
+  perf_internal::g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void RecordPerfSample(PerfSection section, uint64_t elapsed_ns) {
+  thread_local LocalSlots local;
+  ThreadSlots* slots = local.get();
+  const uint64_t epoch = GetRegistry().epoch.load(std::memory_order_acquire);
+  if (slots->epoch.load(std::memory_order_relaxed) != epoch) {
+    ZeroSlots(slots);
+    slots->epoch.store(epoch, std::memory_order_release);
+  }
+  SectionSlots& s = slots->sections[static_cast<int>(section)];
+  Bump(s.calls, 1);
+  Bump(s.total_ns, elapsed_ns);
+  if (elapsed_ns > s.max_ns.load(std::memory_order_relaxed)) {
+    s.max_ns.store(elapsed_ns, std::memory_order_relaxed);
+  }
+  Bump(s.histogram[BucketOf(elapsed_ns)], 1);
+}
+
+std::vector<PerfSectionStats> GetPerfStats() {
+  std::vector<PerfSectionStats> stats(kNumPerfSections);
+  for (int i = 0; i < kNumPerfSections; ++i) {
+    stats[i].name = PerfSectionName(static_cast<PerfSection>(i));
+  }
+  Registry& registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  const uint64_t epoch = registry.epoch.load(std::memory_order_acquire);
+  for (const auto& slots : registry.slots) {
+    if (slots->epoch.load(std::memory_order_acquire) != epoch) continue;
+    for (int i = 0; i < kNumPerfSections; ++i) {
+      const SectionSlots& from = slots->sections[i];
+      PerfSectionStats& to = stats[i];
+      to.calls += from.calls.load(std::memory_order_relaxed);
+      to.total_ns += from.total_ns.load(std::memory_order_relaxed);
+      to.max_ns = std::max(to.max_ns, from.max_ns.load(std::memory_order_relaxed));
+      for (int b = 0; b < kPerfHistogramBuckets; ++b) {
+        to.histogram[b] += from.histogram[b].load(std::memory_order_relaxed);
+      }
+    }
+  }
+  return stats;
+}
+
+void ResetPerfStats() {
+  GetRegistry().epoch.fetch_add(1, std::memory_order_acq_rel);
+}
+
+}  // namespace mali_ba
+}  // namespace open_spiel
@@ -0,0 +1,114 @@
+// mali_ba_perf.h
+// Per-thread call counters and latency histograms for the engine hot paths.
+//
+// MALI_BA_PERF_SCOPE(section) times the rest of the enclosing block. While
+// counters are disabled (the default) a scope costs one relaxed atomic load
+// and reads no clock. When enabled, each thread records into its own slots
+// with plain relaxed stores, so threads never contend; GetPerfStats() sums
+// every thread that has recorded since the last ResetPerfStats(). Build
+// with -DMALI_BA_NO_PERF to compile the scopes out entirely.
+//
+// Scopes nest, and a section's time includes the sections it calls.
+#ifndef OPEN_SPIEL_GAMES_MALI_BA_PERF_H_
+#define OPEN_SPIEL_GAMES_MALI_BA_PERF_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace open_spiel {
+namespace mali_ba {
+
+enum class PerfSection : int {
+  kLegalActions,       // GetLegalActionsAndCounts() cache misses
+  kPlaceTokenMoves,
+  kMancalaMoves,
+  kUpgradeMoves,
+  kTradeRouteMoves,
+  kIncomeMoves,
+  kRouteSearch,        // FindPossibleTradeRoutes()
+  kHeuristicWeights,
+  kApplyAction,        // DoApplyAction()
+  kUndoAction,
+  kClone,              // Clone() and CloneForSearch()
+  kSerialize,          // Serialize() and SerializeBinary()
+  kDeserialize,        // DeserializeState() and DeserializeBinary()
+  kObservation,        // ObservationTensor(), also per row of a batch
+  kNumSections,
+};
+constexpr int kNumPerfSections = static_cast<int>(PerfSection::kNumSections);
+
+// Bucket b counts calls that took [2^b, 2^(b+1)) ns; the last bucket also
+// takes everything slower (2^31 ns is about two seconds).
+constexpr int kPerfHistogramBuckets = 32;
+
+const char* PerfSectionName(PerfSection section);
+
+struct PerfSectionStats {
+  std::string name;
+  uint64_t calls = 0;
+  uint64_t total_ns = 0;
+  uint64_t max_ns = 0;
+  std::array<uint64_t, kPerfHistogramBuckets> histogram{};
+
+  double MeanNs() const { return calls ? static_cast<double>(total_ns) / calls : 0.0; }
+  // Upper bound of the bucket holding quantile q (0..1); 0 with no calls.
+  uint64_t ApproxQuantileNs(double q) const;
+};
+
+namespace perf_internal {
+extern std::atomic<bool> g_enabled;
+}  // namespace perf_internal
+
+void SetPerfCountersEnabled(bool enabled);
+inline bool PerfCountersEnabled() {
+  return perf_internal::g_enabled.load(std::memory_order_relaxed);
+}
+// One entry per PerfSection, in enum order.
+std::vector<PerfSectionStats> GetPerfStats();
+// Zeros every thread's counters. Recording threads see the reset at their
+// next scope, so a call in flight across the reset may still be counted.
+void ResetPerfStats();
+
+// Records one call's latency in the calling thread's slots.
+void RecordPerfSample(PerfSection section, uint64_t elapsed_ns);
+
+class ScopedPerfTimer {
+ public:
+  explicit ScopedPerfTimer(PerfSection section)
+      : section_(section), active_(PerfCountersEnabled()) {
+    if (active_) start_ = std::chrono::steady_clock::now();
+  }
+  ~ScopedPerfTimer() {
+    if (!active_) return;
+    const auto elapsed = std::chrono::steady_clock::now() - start_;
+    RecordPerfSample(section_, static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+  }
+
+  ScopedPerfTimer(const ScopedPerfTimer&) = delete;
+  ScopedPerfTimer& operator=(const ScopedPerfTimer&) = delete;
+
+ private:
+  PerfSection section_;
+  bool active_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace mali_ba
+}  // namespace open_spiel
+
+#define MALI_BA_PERF_CONCAT_INNER(a, b) a##b
+#define MALI_BA_PERF_CONCAT(a, b) MALI_BA_PERF_CONCAT_INNER(a, b)
+#ifdef MALI_BA_NO_PERF
+#define MALI_BA_PERF_SCOPE(section) do {} while (0)
+#else
+#define MALI_BA_PERF_SCOPE(section)                                       \
+  ::open_spiel::mali_ba::ScopedPerfTimer MALI_BA_PERF_CONCAT(             \
+      mali_ba_perf_scope_, __LINE__)(::open_spiel::mali_ba::PerfSection::section)
+#endif
+
+#endif  // OPEN_SPIEL_GAMES_MALI_BA_PERF_H_
@@ -0,0 +1,402 @@
+// mali_ba_replay_buffer.cc
+// Shared-memory replay ring buffer
+
+#include "open_spiel/games/mali_ba/mali_ba_replay_buffer.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <new>
+#include <utility>
+
+#include "open_spiel/abseil-cpp/absl/strings/str_cat.h"
+#include "open_spiel/spiel_utils.h"
+
+namespace open_spiel {
+namespace mali_ba {
+namespace {
+
+constexpr char kReplayMagic[8] = {'M', 'B', 'R', 'E', 'P', 'L', 'A', 'Y'};
+constexpr uint32_t kReplayVersion = 1;
+constexpr size_t kCacheLine = 64;
+
+size_t RoundUp(size_t value, size_t alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+[[noreturn]] void ShmError(const std::string& what, const std::string& name) {
+  SpielFatalError(absl::StrCat("SharedReplayBuffer: ", what, " '", name, "': ",
+                               std::strerror(errno)));
+}
+
+}  // namespace
+
+// Both live in shared memory, so they hold nothing but fixed-width fields
+// and lock-free atomics.
+struct SharedReplayBuffer::Header {
+  char magic[8];
+  uint32_t version;
+  int32_t capacity;
+  int32_t observation_size;
+  int32_t num_actions;
+  int32_t num_players;
+  int32_t max_policy_entries;
+  uint64_t slot_stride;
+  alignas(kCacheLine) std::atomic<int64_t> next_record;  // Records claimed so far
+};
+
+struct SharedReplayBuffer::SlotHeader {
+  // 0: never written. 2n + 1: record n being written. 2n + 2: holds record n.
+  std::atomic<uint64_t> sequence;
+  std::atomic<float> priority;
+  int32_t player;
+  int32_t num_entries;
+};
+
+static_assert(std::atomic<int64_t>::is_always_lock_free &&
+                  std::atomic<uint64_t>::is_always_lock_free &&
+                  std::atomic<float>::is_always_lock_free,
+              "shared-memory atomics must be lock-free to work across processes");
+
+std::unique_ptr<SharedReplayBuffer> SharedReplayBuffer::Create(
+    const std::string& name, const ReplayBufferConfig& config) {
+  SPIEL_CHECK_GT(config.capacity, 0);
+  SPIEL_CHECK_GT(config.observation_size, 0);
+  SPIEL_CHECK_GT(config.num_actions, 0);
+  SPIEL_CHECK_GT(config.num_players, 0);
+  SPIEL_CHECK_GT(config.max_policy_entries, 0);
+
+  // Slot: header, observation, actions, probabilities, values; floats and
+  // int32s share one 4-byte granularity after the 8-byte-aligned header.
+  const size_t slot_stride = RoundUp(
+      sizeof(SlotHeader) + sizeof(float) * (static_cast<size_t>(config.observation_size) +
+                                            2 * config.max_policy_entries + config.num_players),
+      kCacheLine);
+  const size_t header_size = RoundUp(sizeof(Header), kCacheLine);
+  const size_t total_size = header_size + slot_stride * config.capacity;
+
+  void* base = nullptr;
+  if (name.empty()) {
+    base = mmap(nullptr, total_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) ShmError("cannot allocate", "<private>");
+  } else {
+    shm_unlink(name.c_str());  // A crashed run may have left one behind
+    const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) ShmError("cannot create", name);
+    if (ftruncate(fd, static_cast<off_t>(total_size)) != 0) {
+      close(fd);
+      shm_unlink(name.c_str());
+      ShmError("cannot size", name);
+    }
+    base = mmap(nullptr, total_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+      shm_unlink(name.c_str());
+      ShmError("cannot map", name);
+    }
+  }
+
+  // Fresh mappings are zero-filled: every slot starts empty.
+  Header* header = new (base) Header();
+  std::memcpy(header->magic, kReplayMagic, sizeof(kReplayMagic));
+  header->version = kReplayVersion;
+  header->capacity = config.capacity;
+  header->observation_size = config.observation_size;
+  header->num_actions = config.num_actions;
+  header->num_players = config.num_players;
+  header->max_policy_entries = config.max_policy_entries;
+  header->slot_stride = slot_stride;
+  header->next_record.store(0, std::memory_order_relaxed);
+  char* slots = static_cast<char*>(base) + header_size;
+  for (int i = 0; i < config.capacity; ++i) {
+    SlotHeader* slot = new (slots + slot_stride * i) SlotHeader();
+    slot->sequence.store(0, std::memory_order_relaxed);
+    slot->priority.store(0.0f, std::memory_order_relaxed);
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+
+  std::unique_ptr<SharedReplayBuffer> buffer(new SharedReplayBuffer());
+  buffer->Bind(base, total_size, name, /*owner=*/true);
+  return buffer;
+}
+
+std::unique_ptr<SharedReplayBuffer> SharedReplayBuffer::Attach(const std::string& name) {
+  SPIEL_CHECK_FALSE(name.empty());
+  const int fd = shm_open(name.c_str(), O_RDWR, 0600);
+  if (fd < 0) ShmError("cannot open", name);
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    close(fd);
+    ShmError("cannot stat", name);
+  }
+  const size_t total_size = static_cast<size_t>(info.st_size);
+  if (total_size < sizeof(Header)) {
+    close(fd);
+    SpielFatalError(absl::StrCat("SharedReplayBuffer: '", name, "' is not a replay buffer"));
+  }
+  void* base = mmap(nullptr, total_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) ShmError("cannot map", name);
+
+  const Header* header = static_cast<const Header*>(base);
+  const size_t header_size = RoundUp(sizeof(Header), kCacheLine);
+  if (std::memcmp(header->magic, kReplayMagic, sizeof(kReplayMagic)) != 0 ||
+      header->version != kReplayVersion || header->capacity <= 0 ||
+      total_size < header_size + header->slot_stride * header->capacity) {
+    munmap(base, total_size);
+    SpielFatalError(absl::StrCat("SharedReplayBuffer: '", name,
+                                 "' is not a replay buffer of this version"));
+  }
+  std::unique_ptr<SharedReplayBuffer> buffer(new SharedReplayBuffer());
+  buffer->Bind(base, total_size, name, /*owner=*/false);
+  return buffer;
+}
+
+void SharedReplayBuffer::Bind(void* base, size_t mapped_size, const std::string& name,
+                              bool owner) {
+  base_ = base;
+  mapped_size_ = mapped_size;
+  name_ = name;
+  owner_ = owner;
+  shared_ = !name.empty();
+  header_ = static_cast<Header*>(base);
+  slots_ = static_cast<char*>(base) + RoundUp(sizeof(Header), kCacheLine);
+  slot_stride_ = header_->slot_stride;
+  config_.capacity = header_->capacity;
+  config_.observation_size = header_->observation_size;
+  config_.num_actions = header_->num_actions;
+  config_.num_players = header_->num_players;
+  config_.max_policy_entries = header_->max_policy_entries;
+  rng_.seed(static_cast<uint64_t>(getpid()));
+}
+
+SharedReplayBuffer::~SharedReplayBuffer() {
+  if (base_ != nullptr) munmap(base_, mapped_size_);
+  if (owner_ && shared_) shm_unlink(name_.c_str());
+}
+
+SharedReplayBuffer::SlotHeader* SharedReplayBuffer::Slot(int64_t slot) const {
+  return reinterpret_cast<SlotHeader*>(slots_ + slot_stride_ * slot);
+}
+
+float* SharedReplayBuffer::SlotObservation(SlotHeader* slot) const {
+  return reinterpret_cast<float*>(slot + 1);
+}
+
+int32_t* SharedReplayBuffer::SlotActions(SlotHeader* slot) const {
+  return reinterpret_cast<int32_t*>(SlotObservation(slot) + config_.observation_size);
+}
+
+float* SharedReplayBuffer::SlotProbabilities(SlotHeader* slot) const {
+  return reinterpret_cast<float*>(SlotActions(slot) + config_.max_policy_entries);
+}
+
+float* SharedReplayBuffer::SlotValues(SlotHeader* slot) const {
+  return SlotProbabilities(slot) + config_.max_policy_entries;
+}
+
+int64_t SharedReplayBuffer::Size() const {
+  return std::min<int64_t>(TotalAdded(), config_.capacity);
+}
+
+int64_t SharedReplayBuffer::TotalAdded() const {
+  return header_->next_record.load(std::memory_order_acquire);
+}
+
+int64_t SharedReplayBuffer::Add(absl::Span<const float> observation,
+                                absl::Span<const float> policy,
+                                absl::Span<const float> values, int player, float priority) {
+  SPIEL_CHECK_EQ(policy.size(), static_cast<size_t>(config_.num_actions));
+  thread_local std::vector<std::pair<float, int32_t>> entries;
+  entries.clear();
+  for (int a = 0; a < config_.num_actions; ++a) {
+    if (policy[a] > 0.0f) entries.emplace_back(policy[a], a);
+  }
+
+  const int max_entries = config_.max_policy_entries;
+  float kept_mass = 1.0f;
+  if (static_cast<int>(entries.size()) > max_entries) {
+    std::partial_sort(entries.begin(), entries.begin() + max_entries, entries.end(),
+                      [](const auto& a, const auto& b) { return a.first > b.first; });
+    entries.resize(max_entries);
+    kept_mass = 0.0f;
+    for (const auto& entry : entries) kept_mass += entry.first;
+  }
+
+  thread_local std::vector<int32_t> actions;
+  thread_local std::vector<float> probabilities;
+  actions.clear();
+  probabilities.clear();
+  for (const auto& entry : entries) {
+    actions.push_back(entry.second);
+    probabilities.push_back(kept_mass > 0.0f ? entry.first / kept_mass : entry.first);
+  }
+  return Commit(observation, actions.data(), probabilities.data(),
+                static_cast<int>(actions.size()), values, player, priority);
+}
+
+int64_t SharedReplayBuffer::AddSparse(absl::Span<const float> observation,
+                                      absl::Span<const Action> actions,
+                                      absl::Span<const float> probabilities,
+                                      absl::Span<const float> values, int player,
+                                      float priority) {
+  SPIEL_CHECK_EQ(actions.size(), probabilities.size());
+  SPIEL_CHECK_LE(actions.size(), static_cast<size_t>(config_.max_policy_entries));
+  thread_local std::vector<int32_t> narrow_actions;
+  narrow_actions.clear();
+  for (Action action : actions) {
+    SPIEL_CHECK_GE(action, 0);
+    SPIEL_CHECK_LT(action, config_.num_actions);
+    narrow_actions.push_back(static_cast<int32_t>(action));
+  }
+  return Commit(observation, narrow_actions.data(), probabilities.data(),
+                static_cast<int>(actions.size()), values, player, priority);
+}
+
+int64_t SharedReplayBuffer::Commit(absl::Span<const float> observation, const int32_t* actions,
+                                   const float* probabilities, int num_entries,
+                                   absl::Span<const float> values, int player,
+                                   float priority) {
+  SPIEL_CHECK_EQ(observation.size(), static_cast<size_t>(config_.observation_size));
+  SPIEL_CHECK_EQ(values.size(), static_cast<size_t>(config_.num_players));
+  SPIEL_CHECK_GE(priority, 0.0f);
+
+  const int64_t record = header_->next_record.fetch_add(1, std::memory_order_relaxed);
+  SlotHeader* slot = Slot(record % config_.capacity);
+  slot->sequence.store(2 * static_cast<uint64_t>(record) + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  slot->player = player;
+  slot->num_entries = num_entries;
+  slot->priority.store(priority, std::memory_order_relaxed);
+  std::copy(observation.begin(), observation.end(), SlotObservation(slot));
+  std::copy(actions, actions + num_entries, SlotActions(slot));
+  std::copy(probabilities, probabilities + num_entries, SlotProbabilities(slot));
+  std::copy(values.begin(), values.end(), SlotValues(slot));
+
+  slot->sequence.store(2 * static_cast<uint64_t>(record) + 2, std::memory_order_release);
+  return record;
+}
+
+bool SharedReplayBuffer::CopySlot(int64_t slot_index, int row) {
+  SlotHeader* slot = Slot(slot_index);
+  const uint64_t before = slot->sequence.load(std::memory_order_acquire);
+  if (before == 0 || (before & 1) != 0) return false;
+
+  const int obs_size = config_.observation_size;
+  const int num_actions = config_.num_actions;
+  const int num_players = config_.num_players;
+  const float* observation = SlotObservation(slot);
+  std::copy(observation, observation + obs_size, &batch_observations_[static_cast<size_t>(row) * obs_size]);
+  float* policy = &batch_policies_[static_cast<size_t>(row) * num_actions];
+  std::fill(policy, policy + num_actions, 0.0f);
+  // A slot being overwritten can hold anything; bound every index before
+  // using it and let the sequence check below throw the row away.
+  const int num_entries = std::min(std::max(slot->num_entries, 0), config_.max_policy_entries);
+  const int32_t* actions = SlotActions(slot);
+  const float* probabilities = SlotProbabilities(slot);
+  for (int i = 0; i < num_entries; ++i) {
+    if (actions[i] >= 0 && actions[i] < num_actions) policy[actions[i]] = probabilities[i];
+  }
+  const float* values = SlotValues(slot);
+  std::copy(values, values + num_players, &batch_values_[static_cast<size_t>(row) * num_players]);
+  batch_players_[row] = slot->player;
+
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (slot->sequence.load(std::memory_order_relaxed) != before) return false;
+  batch_indices_[row] = static_cast<int64_t>(before / 2 - 1);
+  return true;
+}
+
+int SharedReplayBuffer::Sample(int batch_size, bool prioritized, double alpha, double beta) {
+  SPIEL_CHECK_GE(batch_size, 0);
+  // The arrays only grow, so a view of them stays valid until a later call
+  // asks for a bigger batch.
+  const size_t rows = static_cast<size_t>(batch_size);
+  if (batch_players_.size() < rows) {
+    batch_observations_.resize(rows * config_.observation_size);
+    batch_policies_.resize(rows * config_.num_actions);
+    batch_values_.resize(rows * config_.num_players);
+    batch_players_.resize(rows);
+    batch_indices_.resize(rows);
+    batch_weights_.resize(rows);
+  }
+  batch_size_ = 0;
+  const int64_t size = Size();
+  if (size == 0 || batch_size == 0) return 0;
+
+  // Retries cover slots caught mid-write; claimed-but-unwritten slots at the
+  // head can make a small buffer come up short instead of spinning.
+  const int max_attempts = 4 * batch_size + 16;
+  int attempts = 0;
+  if (!prioritized) {
+    std::uniform_int_distribution<int64_t> pick(0, size - 1);
+    while (batch_size_ < batch_size && attempts++ < max_attempts) {
+      if (CopySlot(pick(rng_), batch_size_)) batch_weights_[batch_size_++] = 1.0f;
+    }
+    return batch_size_;
+  }
+
+  cumulative_priorities_.clear();
+  cumulative_slots_.clear();
+  double total = 0.0;
+  for (int64_t slot = 0; slot < size; ++slot) {
+    const SlotHeader* header = Slot(slot);
+    const uint64_t sequence = header->sequence.load(std::memory_order_acquire);
+    if (sequence == 0 || (sequence & 1) != 0) continue;
+    const double weight = std::pow(static_cast<double>(
+        header->priority.load(std::memory_order_relaxed)), alpha);
+    if (weight <= 0.0) continue;
+    total += weight;
+    cumulative_priorities_.push_back(total);
+    cumulative_slots_.push_back(slot);
+  }
+  if (cumulative_slots_.empty()) return 0;
+
+  const double num_candidates = static_cast<double>(cumulative_slots_.size());
+  std::uniform_real_distribution<double> draw(0.0, total);
+  float max_weight = 0.0f;
+  while (batch_size_ < batch_size && attempts++ < max_attempts) {
+    const auto it = std::upper_bound(cumulative_priorities_.begin(),
+                                     cumulative_priorities_.end(), draw(rng_));
+    const size_t k = std::min<size_t>(it - cumulative_priorities_.begin(),
+                                      cumulative_slots_.size() - 1);
+    if (!CopySlot(cumulative_slots_[k], batch_size_)) continue;
+    const double mass = cumulative_priorities_[k] - (k > 0 ? cumulative_priorities_[k - 1] : 0.0);
+    const float weight = static_cast<float>(std::pow(num_candidates * mass / total, -beta));
+    batch_weights_[batch_size_++] = weight;
+    max_weight = std::max(max_weight, weight);
+  }
+  if (max_weight > 0.0f) {
+    for (int row = 0; row < batch_size_; ++row) batch_weights_[row] /= max_weight;
+  }
+  return batch_size_;
+}
+
+void SharedReplayBuffer::UpdatePriorities(absl::Span<const int64_t> record_numbers,
+                                          absl::Span<const float> priorities) {
+  SPIEL_CHECK_EQ(record_numbers.size(), priorities.size());
+  for (size_t i = 0; i < record_numbers.size(); ++i) {
+    const int64_t record = record_numbers[i];
+    SPIEL_CHECK_GE(record, 0);
+    SPIEL_CHECK_GE(priorities[i], 0.0f);
+    // A writer may claim the slot right after this check, and the record it
+    // writes can then keep this priority instead of its own. That only skews
+    // the new record's draws until its priority is next updated.
+    SlotHeader* slot = Slot(record % config_.capacity);
+    if (slot->sequence.load(std::memory_order_acquire) ==
+        2 * static_cast<uint64_t>(record) + 2) {
+      slot->priority.store(priorities[i], std::memory_order_relaxed);
+    }
+  }
+}
+
+}  // namespace mali_ba
+}  // namespace open_spiel
@@ -0,0 +1,144 @@
+// mali_ba_replay_buffer.h
+// Fixed-width ring buffer of training records in a shared-memory segment.
+//
+// One process creates the segment under a name; actors, the learner and the
+// trainer attach to it by that name and share the same records without
+// pickling or queues. Each record holds an observation, a sparse policy
+// target (at most max_policy_entries (action, probability) pairs), a value
+// target per player, the player to move and a sampling priority.
+//
+// Writers claim record numbers with one atomic increment, so any number of
+// processes and threads may Add() at once. Record n lives in slot
+// n % capacity and overwrites record n - capacity. Every slot carries a
+// sequence word that is odd while its record is being written; a sampler
+// copies a slot and keeps the copy only if the word was even and unchanged
+// across the copy. Writers more than `capacity` records apart would share a
+// slot, so the capacity must exceed the number of records in flight.
+//
+// A sampler fills its own batch arrays with dense policies, so Python gets
+// [batch, num_actions] and [batch, observation_size] arrays in one copy each.
+// Sampling is uniform or proportional to priority^alpha; the prioritized
+// draw scans every slot's priority, O(capacity) per batch.
+#ifndef OPEN_SPIEL_GAMES_MALI_BA_REPLAY_BUFFER_H_
+#define OPEN_SPIEL_GAMES_MALI_BA_REPLAY_BUFFER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "open_spiel/abseil-cpp/absl/types/span.h"
+#include "open_spiel/spiel.h"
+
+namespace open_spiel {
+namespace mali_ba {
+
+struct ReplayBufferConfig {
+  int capacity = 0;
+  int observation_size = 0;
+  int num_actions = 0;
+  int num_players = 0;
+  int max_policy_entries = 64;  // Sparse policy entries kept per record
+};
+
+class SharedReplayBuffer {
+ public:
+  // Creates a segment named `name` (POSIX shm, e.g. "/mali_ba_replay_1234"),
+  // replacing any stale segment of that name, and removes the name again when
+  // the creator is destroyed. An empty name makes a private, unshared buffer.
+  static std::unique_ptr<SharedReplayBuffer> Create(const std::string& name,
+                                                    const ReplayBufferConfig& config);
+  // Maps the segment another process created; its config comes from the segment.
+  static std::unique_ptr<SharedReplayBuffer> Attach(const std::string& name);
+  ~SharedReplayBuffer();
+
+  SharedReplayBuffer(const SharedReplayBuffer&) = delete;
+  SharedReplayBuffer& operator=(const SharedReplayBuffer&) = delete;
+
+  // Adds one record and returns its record number. `policy` is dense
+  // (num_actions); if it has more than max_policy_entries nonzeros, the
+  // largest are kept and renormalized.
+  int64_t Add(absl::Span<const float> observation, absl::Span<const float> policy,
+              absl::Span<const float> values, int player, float priority = 1.0f);
+  // Same, with the policy as (action, probability) pairs.
+  int64_t AddSparse(absl::Span<const float> observation, absl::Span<const Action> actions,
+                    absl::Span<const float> probabilities, absl::Span<const float> values,
+                    int player, float priority = 1.0f);
+
+  // Records currently held: min(TotalAdded(), capacity).
+  int64_t Size() const;
+  // Records ever added, by every process.
+  int64_t TotalAdded() const;
+
+  // Seeds this handle's sampler.
+  void Seed(uint64_t seed) { rng_.seed(seed); }
+  // Draws up to `batch_size` records into the batch arrays and returns how
+  // many were drawn: fewer only if the buffer holds fewer committed records
+  // than asked for. With `prioritized`, a record is drawn with probability
+  // p_i = priority_i^alpha / sum, and BatchWeights() holds (N p_i)^-beta
+  // scaled so the largest is 1; otherwise every weight is 1.
+  int Sample(int batch_size, bool prioritized = false, double alpha = 0.6, double beta = 0.4);
+  // Sets the priorities of sampled records, by the numbers BatchIndices()
+  // reported. Records overwritten since are left alone.
+  void UpdatePriorities(absl::Span<const int64_t> record_numbers,
+                        absl::Span<const float> priorities);
+
+  const ReplayBufferConfig& Config() const { return config_; }
+  const std::string& Name() const { return name_; }
+
+  // Rows [0, Sample()) are the last batch; each call overwrites them.
+  const std::vector<float>& BatchObservations() const { return batch_observations_; }  // B x obs
+  const std::vector<float>& BatchPolicies() const { return batch_policies_; }    // B x actions
+  const std::vector<float>& BatchValues() const { return batch_values_; }        // B x players
+  const std::vector<int32_t>& BatchPlayers() const { return batch_players_; }    // B
+  const std::vector<int64_t>& BatchIndices() const { return batch_indices_; }    // B, record numbers
+  const std::vector<float>& BatchWeights() const { return batch_weights_; }      // B
+  int BatchSize() const { return batch_size_; }
+
+ private:
+  struct Header;
+  struct SlotHeader;
+
+  SharedReplayBuffer() = default;
+  // Wires up pointers into a mapped segment and sizes the batch arrays.
+  void Bind(void* base, size_t mapped_size, const std::string& name, bool owner);
+  SlotHeader* Slot(int64_t slot) const;
+  float* SlotObservation(SlotHeader* slot) const;
+  int32_t* SlotActions(SlotHeader* slot) const;
+  float* SlotProbabilities(SlotHeader* slot) const;
+  float* SlotValues(SlotHeader* slot) const;
+  // Copies slot `slot` into batch row `row`; false if it is empty or was
+  // being overwritten.
+  bool CopySlot(int64_t slot, int row);
+  int64_t Commit(absl::Span<const float> observation, const int32_t* actions,
+                 const float* probabilities, int num_entries,
+                 absl::Span<const float> values, int player, float priority);
+
+  ReplayBufferConfig config_;
+  std::string name_;
+  bool owner_ = false;     // Unlinks the name on destruction
+  bool shared_ = false;    // Mapped from shm rather than heap memory
+  void* base_ = nullptr;
+  size_t mapped_size_ = 0;
+  Header* header_ = nullptr;
+  char* slots_ = nullptr;
+  size_t slot_stride_ = 0;
+
+  std::mt19937_64 rng_;
+  std::vector<double> cumulative_priorities_;  // Prioritized draw, reused
+  std::vector<int64_t> cumulative_slots_;
+  int batch_size_ = 0;
+  std::vector<float> batch_observations_;
+  std::vector<float> batch_policies_;
+  std::vector<float> batch_values_;
+  std::vector<int32_t> batch_players_;
+  std::vector<int64_t> batch_indices_;
+  std::vector<float> batch_weights_;
+};
+
+}  // namespace mali_ba
+}  // namespace open_spiel
+
+#endif  // OPEN_SPIEL_GAMES_MALI_BA_REPLAY_BUFFER_H_
@@ -0,0 +1,113 @@
+// mali_ba_rng.h
+// Counter-based random streams for states, self-play and search noise.
+//
+// Mali_BaRng is a 32-byte SplitMix64-style generator: draw i of a stream is
+// a fixed mix of (key, i), so copying one costs no more than copying four
+// integers. The key is derived from a stream seed and a move number, and
+// each state keeps its generator at its own move number (see
+// Mali_BaState::GetRNG()). What a state draws therefore depends only on the
+// stream seed, how many actions led to the position and how many draws were
+// already made there, not on which thread or actor plays the game or on how
+// many games it played before. Seed a game's stream with
+// SeedStream(run_seed, game_id) and every run with the same seed replays
+// the same games.
+//
+// Fork() gives further streams that follow the same moves, so another
+// consumer (Python search noise, say) draws from numbers of its own that are
+// still fixed by (run seed, game id, move).
+#ifndef OPEN_SPIEL_GAMES_MALI_BA_RNG_H_
+#define OPEN_SPIEL_GAMES_MALI_BA_RNG_H_
+
+#include <cstdint>
+
+namespace open_spiel {
+namespace mali_ba {
+
+// SplitMix64 finalizer: spreads (seed, index) pairs into unrelated seeds.
+inline uint64_t MixSeed(uint64_t seed, uint64_t index) {
+  uint64_t z = seed + 0x9E3779B97F4A7C15ULL * (index + 1);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+// Meets UniformRandomBitGenerator, so it works with the <random>
+// distributions and std::shuffle.
+class Mali_BaRng {
+ public:
+  using result_type = uint64_t;
+  static constexpr uint64_t kDefaultSeed = 5489;
+
+  explicit Mali_BaRng(uint64_t stream_seed = kDefaultSeed) { seed(stream_seed); }
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return ~result_type{0}; }
+  result_type operator()() { return MixSeed(key_, counter_++); }
+  // Uniform in [0, 1) with 53 random bits.
+  double Uniform() { return static_cast<double>((*this)() >> 11) * 0x1.0p-53; }
+  // Skips n draws in O(1).
+  void discard(uint64_t n) { counter_ += n; }
+
+  // Restarts the stream at the current move number.
+  void seed(uint64_t stream_seed) {
+    stream_ = stream_seed;
+    Rekey();
+  }
+  void SeedStream(uint64_t run_seed, uint64_t game_id) { seed(MixSeed(run_seed, game_id)); }
+  // Returns to a saved (stream(), move(), counter()), as serialized states do.
+  void Restore(uint64_t stream_seed, uint64_t move, uint64_t counter) {
+    stream_ = stream_seed;
+    move_ = move;
+    Rekey();
+    counter_ = counter;
+  }
+  // Switches to the draws of `move`; a no-op when already there.
+  void SetMove(uint64_t move) {
+    if (move == move_) return;
+    move_ = move;
+    Rekey();
+  }
+
+  // Channel `channel` of this stream, at the same move. Each channel is its
+  // own stream, unrelated to this one and to the other channels.
+  Mali_BaRng Fork(uint64_t channel) const {
+    Mali_BaRng fork(MixSeed(stream_ ^ kForkSalt, channel));
+    fork.SetMove(move_);
+    return fork;
+  }
+
+  // Key of the draws at `move` of the game stream (run_seed, game_id); equal
+  // to key() of a generator seeded with SeedStream(run_seed, game_id) and
+  // set to that move.
+  static uint64_t StreamKey(uint64_t run_seed, uint64_t game_id, uint64_t move) {
+    return MixSeed(MixSeed(run_seed, game_id), move);
+  }
+
+  uint64_t stream() const { return stream_; }
+  uint64_t move() const { return move_; }
+  uint64_t key() const { return key_; }
+  uint64_t counter() const { return counter_; }
+
+  bool operator==(const Mali_BaRng& other) const {
+    return stream_ == other.stream_ && move_ == other.move_ && counter_ == other.counter_;
+  }
+  bool operator!=(const Mali_BaRng& other) const { return !(*this == other); }
+
+ private:
+  static constexpr uint64_t kForkSalt = 0x6A09E667F3BCC909ULL;
+
+  void Rekey() {
+    key_ = MixSeed(stream_, move_);
+    counter_ = 0;
+  }
+
+  uint64_t stream_ = 0;
+  uint64_t move_ = 0;
+  uint64_t key_ = 0;
+  uint64_t counter_ = 0;
+};
+
+}  // namespace mali_ba
+}  // namespace open_spiel
+
+#endif  // OPEN_SPIEL_GAMES_MALI_BA_RNG_H_
@@ -0,0 +1,236 @@
+// mali_ba_selfplay.cc
+// Multithreaded self-play generator
+
+#include "open_spiel/games/mali_ba/mali_ba_selfplay.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <utility>
+
+#include "open_spiel/games/mali_ba/mali_ba_game.h"
+#include "open_spiel/games/mali_ba/mali_ba_rng.h"
+#include "open_spiel/games/mali_ba/mali_ba_state.h"
+#include "open_spiel/spiel_utils.h"
+
+namespace open_spiel {
+namespace mali_ba {
+void Mali_BaSelfPlayRunner::GameRecords::Clear() {
+  observations.clear();
+  players.clear();
+  policies.clear();
+  rewards.clear();
+  num_rows = 0;
+}
+
+Mali_BaSelfPlayRunner::Mali_BaSelfPlayRunner(std::shared_ptr<const Game> game,
+                                             const SelfPlayConfig& config,
+                                             BatchedEvaluator evaluator)
+    : game_(std::move(game)), config_(config), evaluator_(std::move(evaluator)) {
+  SPIEL_CHECK_TRUE(game_ != nullptr);
+  SPIEL_CHECK_TRUE(dynamic_cast<const Mali_BaGame*>(game_.get()) != nullptr);
+  SPIEL_CHECK_GT(config_.num_games, 0);
+  SPIEL_CHECK_GT(config_.num_threads, 0);
+  if (config_.policy == SelfPlayPolicy::kMcts) {
+    SPIEL_CHECK_TRUE(evaluator_ != nullptr);
+  }
+  observation_size_ = game_->ObservationTensorSize();
+  num_actions_ = game_->NumDistinctActions();
+  num_players_ = game_->NumPlayers();
+}
+
+std::shared_ptr<SelfPlayBuffer> Mali_BaSelfPlayRunner::Run() {
+  auto buffer = std::make_shared<SelfPlayBuffer>();
+  buffer->capacity = (config_.max_records > 0)
+      ? config_.max_records
+      : config_.num_games * game_->MaxGameLength();
+  buffer->observation_size = observation_size_;
+  buffer->num_actions = num_actions_;
+  buffer->num_players = num_players_;
+  buffer->observations.assign(static_cast<size_t>(buffer->capacity) * observation_size_, 0.0f);
+  buffer->players.assign(buffer->capacity, kInvalidPlayer);
+  buffer->policies.assign(static_cast<size_t>(buffer->capacity) * num_actions_, 0.0f);
+  buffer->rewards.assign(static_cast<size_t>(buffer->capacity) * num_players_, 0.0f);
+  buffer->game_ids.assign(buffer->capacity, -1);
+  buffer->game_returns.assign(static_cast<size_t>(config_.num_games) * num_players_, 0.0f);
+  buffer->game_lengths.assign(config_.num_games, 0);
+
+  if (!config_.archive_path.empty()) {
+    archive_ = std::make_unique<GameArchiveWriter>(config_.archive_path, *game_);
+  }
+  next_game_ = 0;
+  first_error_ = nullptr;
+  const int num_threads = std::min(config_.num_threads, config_.num_games);
+  std::vector<std::thread> workers;
+  workers.reserve(num_threads);
+  for (int i = 0; i < num_threads; ++i) {
+    workers.emplace_back(&Mali_BaSelfPlayRunner::WorkerLoop, this, i, buffer.get());
+  }
+  for (std::thread& worker : workers) worker.join();
+  archive_.reset();  // Closes the archive, failed run or not
+
+  if (first_error_) std::rethrow_exception(first_error_);
+  return buffer;
+}
+
+void Mali_BaSelfPlayRunner::WorkerLoop(int worker_index, SelfPlayBuffer* buffer) {
+  try {
+    std::unique_ptr<Mali_BaMcts> engine;
+    if (config_.policy == SelfPlayPolicy::kMcts) {
+      // Search noise forks from each game's stream, so the worker that
+      // plays a game does not change it.
+      engine = std::make_unique<Mali_BaMcts>(config_.mcts, evaluator_);
+    }
+
+    GameRecords records;
+    std::vector<double> returns;
+    std::unique_ptr<GameArchiveRecorder> recorder;
+    if (archive_ != nullptr) {
+      recorder = std::make_unique<GameArchiveRecorder>(config_.archive_keyframe_interval);
+    }
+    while (true) {
+      const int game_index = next_game_.fetch_add(1);
+      if (game_index >= config_.num_games) break;
+      {
+        std::lock_guard<std::mutex> lock(commit_mutex_);
+        if (first_error_) break;
+      }
+      records.Clear();
+      PlayGame(game_index, engine.get(), &records, &returns, recorder.get());
+      CommitGame(game_index, records, returns, buffer);
+      if (recorder != nullptr) archive_->Add(*recorder);
+    }
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(commit_mutex_);
+    if (!first_error_) first_error_ = std::current_exception();
+  }
+}
+
+void Mali_BaSelfPlayRunner::PlayGame(int game_index, Mali_BaMcts* engine,
+                                     GameRecords* records, std::vector<double>* returns,
+                                     GameArchiveRecorder* recorder) {
+  std::unique_ptr<State> state_ptr = game_->NewInitialState();
+  Mali_BaState* state = static_cast<Mali_BaState*>(state_ptr.get());
+  state->GetRNG().SeedStream(config_.seed, game_index);
+  if (recorder != nullptr) recorder->Begin(*state, game_index);
+
+  std::vector<float> policy(num_actions_);
+  std::vector<double> weights;
+  std::vector<Action> fallback_actions;
+  int move_count = 0;
+  while (!state->IsTerminal()) {
+    if (recorder != nullptr) recorder->Update(*state);
+    if (state->IsChanceNode()) {
+      state->ApplyAction(state->LegalActions()[0]);
+      continue;
+    }
+
+    // Token placement is played uniformly at random and not recorded.
+    if (state->CurrentPhase() == Phase::kPlaceToken) {
+      std::vector<Action> legal_actions = state->LegalActions();
+      if (legal_actions.empty()) break;
+      std::uniform_int_distribution<size_t> dist(0, legal_actions.size() - 1);
+      state->ApplyAction(legal_actions[dist(state->GetRNG())]);
+      continue;
+    }
+
+    const Player player = state->CurrentPlayer();
+    std::fill(policy.begin(), policy.end(), 0.0f);
+    Action action = kInvalidAction;
+
+    if (config_.policy == SelfPlayPolicy::kHeuristic) {
+      // Same distribution as SelectHeuristicRandomAction(), computed once.
+      absl::Span<const Action> actions = state->HeuristicActionWeights(&weights);
+      if (std::all_of(weights.begin(), weights.end(), [](double w) { return w <= 1e-6; })) {
+        fallback_actions = state->LegalActions();
+        actions = fallback_actions;
+        weights.assign(actions.size(), 1.0);
+      }
+      if (actions.empty()) break;
+      double total = 0.0;
+      for (double w : weights) total += w;
+      double draw = std::uniform_real_distribution<double>(0.0, total)(state->GetRNG());
+      for (size_t i = 0; i < actions.size(); ++i) {
+        policy[actions[i]] = static_cast<float>(weights[i] / total);
+        if (weights[i] > 0.0 && draw >= 0.0) {
+          action = actions[i];
+          draw -= weights[i];
+        }
+      }
+    } else {
+      MctsResult result = engine->Search(*state);
+      if (result.actions.empty()) break;
+      const double temperature = (move_count < config_.temperature_drop_move) ? 1.0 : 0.5;
+      std::vector<double> powered(result.actions.size());
+      int total_visits = 0;
+      for (size_t i = 0; i < result.actions.size(); ++i) {
+        powered[i] = std::pow(static_cast<double>(result.visit_counts[i]), 1.0 / temperature);
+        policy[result.actions[i]] = static_cast<float>(result.policy[result.actions[i]]);
+        total_visits += result.visit_counts[i];
+      }
+      // With a single simulation only the root is expanded and no child has
+      // a visit; the search policy is then uniform, and so is the pick.
+      if (total_visits == 0) std::fill(powered.begin(), powered.end(), 1.0);
+      std::discrete_distribution<int> dist(powered.begin(), powered.end());
+      action = result.actions[dist(state->GetRNG())];
+    }
+    if (action == kInvalidAction) break;
+
+    const size_t row_obs = records->observations.size();
+    records->observations.resize(row_obs + observation_size_);
+    state->ObservationTensor(
+        player, absl::MakeSpan(records->observations).subspan(row_obs, observation_size_));
+    records->players.push_back(player);
+    records->policies.insert(records->policies.end(), policy.begin(), policy.end());
+
+    state->ApplyAction(action);
+
+    // Reward for the transition just taken (R_{t+1}), as the learner expects.
+    std::vector<double> rewards = state->Rewards();
+    for (int p = 0; p < num_players_; ++p) records->rewards.push_back(rewards[p]);
+    records->num_rows++;
+    move_count++;
+  }
+
+  if (recorder != nullptr) recorder->Update(*state);
+  *returns = state->Returns();
+}
+
+void Mali_BaSelfPlayRunner::CommitGame(int game_index, const GameRecords& records,
+                                       const std::vector<double>& returns,
+                                       SelfPlayBuffer* buffer) {
+  for (int p = 0; p < num_players_; ++p) {
+    buffer->game_returns[static_cast<size_t>(game_index) * num_players_ + p] = returns[p];
+  }
+
+  int first_row = 0;
+  {
+    std::lock_guard<std::mutex> lock(commit_mutex_);
+    if (buffer->num_records + records.num_rows > buffer->capacity) {
+      buffer->num_dropped_games++;
+      return;
+    }
+    first_row = buffer->num_records;
+    buffer->num_records += records.num_rows;
+  }
+
+  // Rows are reserved; copy without holding the lock.
+  const int n = records.num_rows;
+  std::copy(records.observations.begin(), records.observations.end(),
+            buffer->observations.begin() + static_cast<size_t>(first_row) * observation_size_);
+  std::copy(records.players.begin(), records.players.end(), buffer->players.begin() + first_row);
+  std::copy(records.policies.begin(), records.policies.end(),
+            buffer->policies.begin() + static_cast<size_t>(first_row) * num_actions_);
+  std::copy(records.rewards.begin(), records.rewards.end(),
+            buffer->rewards.begin() + static_cast<size_t>(first_row) * num_players_);
+  std::fill(buffer->game_ids.begin() + first_row, buffer->game_ids.begin() + first_row + n,
+            game_index);
+  buffer->game_lengths[game_index] = n;
+}
+
+}  // namespace mali_ba
+}  // namespace open_spiel
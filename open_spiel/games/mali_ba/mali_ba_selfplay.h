@@ -0,0 +1,110 @@
+// mali_ba_selfplay.h
+// Multithreaded self-play generator that writes training records in place.
+//
+// A runner plays `num_games` games on `num_threads` worker threads. Each
+// worker owns its Mali_BaState (and, for MCTS, its own search engine) and
+// pulls game indices from a shared counter. Every recorded move becomes one
+// row of a SelfPlayBuffer: flat, preallocated arrays that Python views as
+// NumPy arrays without copying. With `archive_path` set, every game is
+// also written whole to a GameArchiveWriter file for replay.
+#ifndef OPEN_SPIEL_GAMES_MALI_BA_SELFPLAY_H_
+#define OPEN_SPIEL_GAMES_MALI_BA_SELFPLAY_H_
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "open_spiel/spiel.h"
+#include "open_spiel/games/mali_ba/mali_ba_archive.h"
+#include "open_spiel/games/mali_ba/mali_ba_mcts.h"
+
+namespace open_spiel {
+namespace mali_ba {
+
+enum class SelfPlayPolicy {
+  kHeuristic,  // SelectHeuristicRandomAction weights; target = normalized weights
+  kMcts,       // Mali_BaMcts search; target = normalized visit counts
+};
+
+struct SelfPlayConfig {
+  int num_games = 1;
+  int num_threads = 1;
+  SelfPlayPolicy policy = SelfPlayPolicy::kHeuristic;
+  uint64_t seed = 0;               // Game g is seeded from (seed, g)
+  int max_records = 0;             // Buffer rows; 0 = num_games * MaxGameLength()
+  int temperature_drop_move = 100; // MCTS samples at T=1.0 before this move, 0.5 after
+  MctsConfig mcts;                 // Used when policy == kMcts
+  std::string archive_path;        // Game archive to write; empty = none
+  int archive_keyframe_interval = 32;
+};
+
+// One row per recorded move (token placement is not recorded). Rows of a
+// game are contiguous and in play order; `game_ids` says which game a row
+// belongs to. A game whose rows do not fit is dropped whole.
+struct SelfPlayBuffer {
+  int capacity = 0;
+  int num_records = 0;
+  int observation_size = 0;
+  int num_actions = 0;
+  int num_players = 0;
+  int num_dropped_games = 0;
+
+  std::vector<float> observations;    // capacity x observation_size
+  std::vector<int32_t> players;       // capacity
+  std::vector<float> policies;        // capacity x num_actions
+  std::vector<float> rewards;         // capacity x num_players, Rewards() after the move
+  std::vector<int32_t> game_ids;      // capacity
+
+  std::vector<float> game_returns;    // num_games x num_players, final Returns()
+  std::vector<int32_t> game_lengths;  // num_games, rows written per game (0 if dropped)
+};
+
+class Mali_BaSelfPlayRunner {
+ public:
+  // `evaluator` is required for kMcts. It is shared by all workers and may be
+  // called from several threads at once.
+  Mali_BaSelfPlayRunner(std::shared_ptr<const Game> game, const SelfPlayConfig& config,
+                        BatchedEvaluator evaluator = nullptr);
+
+  // Plays all games and returns the filled buffer.
+  std::shared_ptr<SelfPlayBuffer> Run();
+
+ private:
+  struct GameRecords {
+    std::vector<float> observations;
+    std::vector<int32_t> players;
+    std::vector<float> policies;
+    std::vector<float> rewards;
+    int num_rows = 0;
+    void Clear();
+  };
+
+  void WorkerLoop(int worker_index, SelfPlayBuffer* buffer);
+  // `recorder` may be null.
+  void PlayGame(int game_index, Mali_BaMcts* engine, GameRecords* records,
+                std::vector<double>* returns, GameArchiveRecorder* recorder);
+  // Reserves rows for a finished game and copies it into the buffer.
+  void CommitGame(int game_index, const GameRecords& records,
+                  const std::vector<double>& returns, SelfPlayBuffer* buffer);
+
+  std::shared_ptr<const Game> game_;
+  SelfPlayConfig config_;
+  BatchedEvaluator evaluator_;
+  int observation_size_ = 0;
+  int num_actions_ = 0;
+  int num_players_ = 0;
+
+  std::unique_ptr<GameArchiveWriter> archive_;  // Set during Run() if archiving
+  std::atomic<int> next_game_{0};
+  std::mutex commit_mutex_;        // Guards row reservation and first_error_
+  std::exception_ptr first_error_;
+};
+
+}  // namespace mali_ba
+}  // namespace open_spiel
+
+#endif  // OPEN_SPIEL_GAMES_MALI_BA_SELFPLAY_H_
@@ -15,6 +15,7 @@
 #ifndef OPEN_SPIEL_GAMES_MALI_BA_STATE_H_
 #define OPEN_SPIEL_GAMES_MALI_BA_STATE_H_
 
+#include <algorithm>
 #include <vector>
 #include <map>
 #include <set>
@@ -32,6 +33,11 @@
 #include "open_spiel/abseil-cpp/absl/types/span.h"
 
 #include "open_spiel/games/mali_ba/mali_ba_common.h"
+#include "open_spiel/games/mali_ba/mali_ba_board.h"
+#include "open_spiel/games/mali_ba/mali_ba_memory.h"
+#include "open_spiel/games/mali_ba/mali_ba_move_log.h"
+#include "open_spiel/games/mali_ba/mali_ba_rng.h"
+#include "open_spiel/games/mali_ba/mali_ba_zobrist.h"
 //#include "open_spiel/games/mali_ba/mali_ba_game.h"
 
 namespace open_spiel
@@ -39,7 +45,9 @@ namespace open_spiel
 namespace mali_ba
 {
     class Mali_BaGame;
+    class Mali_BaWhatIf;
     struct MaliBaTest;
+    struct HexMask;
 
     std::string HexCoordToJsonString(const HexCoord& hex);
     absl::optional<HexCoord> JsonStringToHexCoord(const std::string& s);
@@ -52,25 +60,48 @@ namespace mali_ba
         int income_potential;
     };
 
-    struct StateSnapshot {
+    // One reversible change recorded while an action is applied. Only the
+    // fields an Apply* helper actually touches are journaled, so undoing an
+    // action costs O(changes) instead of O(board + history).
+    struct UndoEntry {
+        enum class Kind : uint8_t {
+            kCell,          // board_[index] held `cell`
+            kCommonGood,    // common_goods_[player][index] held `count`
+            kRareGood,      // rare_goods_[player][index] held `count`
+            kPostsSupply,   // player_posts_supply_[player] held `count`
+            kRouteAdded,    // a route was appended to trade_routes_
+            kRouteRemoved,  // frame.removed_routes[count] was erased at `index`
+            kRouteActive,   // trade_routes_[index].active held `count`
+        };
+        Kind kind;
+        int index = -1;
+        Player player = kInvalidPlayer;
+        int count = 0;
+        HexCell cell;
+    };
+
+    // Everything needed to revert one DoApplyAction() call: the scalar turn
+    // state as it was before the action plus the journal of board/goods/route
+    // changes, replayed in reverse by UndoAction().
+    struct UndoFrame {
         Player current_player_id_;
         PlayerColor current_player_color_;
         Phase current_phase_;
-        std::map<HexCoord, std::vector<PlayerColor>> player_token_locations_;
-        std::map<HexCoord, std::vector<MeepleColor>> hex_meeples_;
-        std::map<HexCoord, std::vector<TradePost>> trade_posts_locations_;
-        std::vector<std::map<std::string, int>> common_goods_;
-        std::vector<std::map<std::string, int>> rare_goods_;
-        std::vector<TradeRoute> trade_routes_; // Add for undo
-        int next_route_id_;                   // Add for undo
-        std::vector<Move> moves_history_;
-        std::vector<double> cumulative_returns_;
-        bool is_terminal_; 
+        int next_route_id_;
+        bool pending_route_declaration_;
+        HexCoord current_mancala_hex_;
+        HexCoord last_action_hex_;
+        std::vector<MeepleColor> meeples_in_hand_;
+        std::vector<HexCoord> current_mancala_path_;
+        size_t moves_history_size_;
+        CountedVector<UndoEntry> entries;
+        std::vector<TradeRoute> removed_routes;
     };
 
     class Mali_BaState : public State {
     public:
         friend class Mali_BaGame;
+        friend class Mali_BaWhatIf;
         friend struct MaliBaTest;
 
         explicit Mali_BaState(std::shared_ptr<const Game> game);
@@ -80,9 +111,34 @@ namespace mali_ba
 
         Action SelectHeuristicRandomAction() const;
         std::map<Action, double> GetHeuristicActionWeights() const;
+        // Heuristic weight of each legal action, in LegalActions() order,
+        // written into *weights (reused, so it stops allocating once grown).
+        // Returns the actions; both are empty outside the play phase.
+        absl::Span<const Action> HeuristicActionWeights(std::vector<double>* weights) const;
         Player CurrentPlayer() const override;
         std::vector<Action> LegalActions() const override;
         LegalActionsResult GetLegalActionsAndCounts() const;
+        // Writes the dense 0/1 legal-action mask (NumDistinctActions() entries)
+        // into a caller-owned buffer. Reads the cached legal actions, so it
+        // does not allocate once they have been generated.
+        void LegalActionsMask(absl::Span<uint8_t> mask) const;
+        // Category-first access to the legal actions, for samplers that pick a
+        // kind of move before a concrete one. None of these builds the full
+        // LegalActions() list: the token, mancala and upgrade categories are
+        // board-mask counts, and only kTradeRoute runs the (cached) route search.
+        int NumLegalActionsInCategory(LegalActionCategory category) const;
+        LegalActionCategoryCounts CountLegalActionCategories() const;
+        // The n-th (0-based) legal action of `category`, in LegalActions()
+        // order; kInvalidAction if the category has n or fewer.
+        Action LegalActionInCategory(LegalActionCategory category, int n) const;
+        // Appends the legal actions of `category`, in LegalActions() order.
+        void AppendLegalActionsInCategory(LegalActionCategory category, std::vector<Action>* actions) const;
+        // A uniformly drawn legal action of `category`; kInvalidAction if none.
+        Action SampleLegalActionInCategory(LegalActionCategory category) const;
+        // A uniformly drawn action among those `counts` covers (zero a category
+        // to leave it out); kInvalidAction if it covers none. The draw is the
+        // one a uniform pick from the same actions in LegalActions() would make.
+        Action SampleLegalAction(const LegalActionCategoryCounts& counts) const;
         std::string ActionToString(Player player, Action action) const override;
         std::string ToString() const override;
         bool IsTerminal() const override;
@@ -93,16 +149,47 @@ namespace mali_ba
         void ObservationTensor(Player player, absl::Span<float> values) const override;
         void UndoAction(Player player, Action action) override;
         std::string Serialize() const override;
+        // Compact versioned binary encoding of the same state; read it back with
+        // Mali_BaGame::DeserializeBinary(). Serialize() stays the readable JSON form.
+        // Both include the random stream, so a restored state draws what the
+        // original would.
+        std::string SerializeBinary() const;
+        // Change feed for GUIs and remote viewers. While enabled, every applied
+        // action queues a JSON delta: the cells whose tokens, meeples or posts
+        // changed, the goods counts that changed, routes added, removed or
+        // (de)activated, and the new phase, player and mid-turn state. A full
+        // Serialize() snapshot is queued when the feed is enabled, every
+        // `snapshot_interval` deltas, after the chance setup, after an undo or
+        // a state reload and when a viewer asks for one, so a viewer can
+        // always resync.
+        // Entries carry consecutive "seq" numbers. Clones do not inherit the feed.
+        void EnableChangeFeed(int snapshot_interval = 50);
+        void DisableChangeFeed();
+        bool ChangeFeedEnabled() const { return change_feed_ != nullptr; }
+        // Returns the queued entries, oldest first, and empties the queue.
+        std::vector<std::string> DrainChangeFeed();
+        void RequestChangeFeedSnapshot();
         bool IsChanceNode() const override;
         std::vector<std::pair<Action, double>> ChanceOutcomes() const override;
         std::unique_ptr<State> Clone() const override;
+        // Lightweight copy for search rollouts: shares the board until written
+        // and keeps only the newest undo frame and move (enough for Rewards()),
+        // so it cannot be undone past the point it was cloned.
+        std::unique_ptr<State> CloneForSearch() const;
                 
         // other methods like Undo, PlayRandom, AI selection
         void UndoLastAction();
         void UndoToTurnStart();
         std::string PlayRandomMoveAndSerialize();
+        // Plays the move PlayRandomMoveAndSerialize() would and returns it,
+        // without serializing (change-feed viewers read the delta instead).
+        // kInvalidAction on a terminal state.
+        Action PlayRandomMove();
         std::vector<Action> SelectRandomTurnActions();
         std::string PlayRandomTurnAndSerialize();
+        // Picks a category uniformly among the non-empty ones, then an action
+        // uniformly within it, so rare moves such as income or upgrades are
+        // played about as often as the many mancala starts.
         Action SelectTrainingAwareRandomAction();
         std::vector<Action> SelectEvaluatedTurnActions();
         TurnEvaluation GenerateTurnStrategy(int num_free_actions, PlayerColor player);
@@ -110,6 +197,20 @@ namespace mali_ba
         Action ParseMoveStringToAction(const std::string& move_str) const;
         Move ActionToMove(Action action) const;
         Action MoveToAction(const Move& move) const; // New helper
+        // The Move-returning generators unpack what the packed overloads
+        // write. A packed overload clears `moves` and refills it, so a caller
+        // that keeps the buffer pays for no allocations once it has grown.
+        std::vector<Move> GeneratePlaceTokenMoves() const;
+        std::vector<Move> GenerateMancalaMoves() const;
+        std::vector<Move> GenerateTradePostUpgradeMoves() const;
+        std::vector<Move> GenerateTradeRouteMoves() const;
+        void GeneratePlaceTokenMoves(std::vector<PackedMove>* moves) const;
+        void GenerateMancalaMoves(std::vector<PackedMove>* moves) const;
+        void GenerateTradePostUpgradeMoves(std::vector<PackedMove>* moves) const;
+        void GenerateTradeRouteMoves(std::vector<PackedMove>* moves) const;
+        PackedMove PackMove(const Move& move) const;
+        Move UnpackMove(const PackedMove& packed) const;
+        std::vector<Move> UnpackMoves(const std::vector<PackedMove>& packed) const;
         void ClearCaches();
         void RefreshTerminalStatus() { is_terminal_ = IsTerminal(); }
         Phase CurrentPhase() const { return current_phase_; }
@@ -121,20 +222,65 @@ namespace mali_ba
         const std::vector<City>& GetCities() const;
         int GridRadius() const;
         
-        // Getters for dynamic state 
-        const std::vector<std::map<std::string, int>>& GetCommonGoods() const { return common_goods_; }
-        const std::vector<std::map<std::string, int>>& GetRareGoods() const { return rare_goods_; }
+        // Per-player totals read by the end-game checks and the final score,
+        // so IsTerminal() and Returns() cost O(players) instead of a pass over
+        // every route, good and hex. Each group is rebuilt on first use after
+        // something it depends on changed: route journaling, goods
+        // adjustments and board writes flag their group, and undo flags what
+        // it reverts.
+        struct PlayerScoreCounters {
+            // Active trade routes
+            int active_routes = 0;
+            int active_route_hexes = 0;
+            int longest_route = 0;
+            double regions_crossed_score = 0.0;
+            bool timbuktu_to_coast = false;  // Desert + Timbuktu + 2 cities + coast
+            // Goods
+            int unique_rare_goods = 0;
+            int rare_goods_total = 0;
+            int unique_common_goods = 0;
+            std::vector<int> rare_good_regions;   // Sorted region ids
+            // Board
+            int centers = 0;
+            std::vector<int> centers_per_region;  // Indexed like GetValidRegionIds()
+        };
+        const std::vector<PlayerScoreCounters>& ScoreCounters() const;
+
+        // Zobrist key of the position: board, goods, routes, phase, player
+        // and the mid-turn mancala state, but not the history. Kept up to
+        // date by DoApplyAction() and UndoAction().
+        uint64_t HashKey() const;
+
+        // Bytes held by each part of the state: board, undo journal, move
+        // history, caches, routes, RNG and so on (mali_ba_memory.h).
+        MemoryBreakdown MemoryFootprint() const;
+
+        // Getters for dynamic state. Goods are indexed by GoodsManager id.
+        const std::vector<GoodCounts>& GetCommonGoods() const { return common_goods_; }
+        const std::vector<GoodCounts>& GetRareGoods() const { return rare_goods_; }
         PlayerColor GetPlayerTokenAt(const HexCoord &hex) const;
-        const std::vector<MeepleColor> &GetMeeplesAt(const HexCoord &hex) const;
-        const std::vector<TradePost> &GetTradePostsAt(const HexCoord &hex) const;
+        // Materialized views of a hex (meeples by ascending color, posts by ascending
+        // owner color). Hot paths should prefer the count/mask helpers below.
+        std::vector<MeepleColor> GetMeeplesAt(const HexCoord &hex) const;
+        std::vector<TradePost> GetTradePostsAt(const HexCoord &hex) const;
+        int CountMeeplesAt(const HexCoord &hex) const;
+        TradePostType GetPlayerPostType(const HexCoord &hex, PlayerColor player) const;
+        // Direct access to the dense board, indexed by Mali_BaGame::CoordToIndex()
+        const BoardCells &GetBoard() const { return board_.cells(); }
+        const HexCell &GetHexCell(int hex_index) const { return board_[hex_index]; }
         const std::vector<TradeRoute> &GetTradeRoutes() const { return trade_routes_; }
+        // GetCities() ids that `player`'s active trade routes through the hex
+        // at `hex_index` connect it to, in route order. Cached until a route changes.
+        const std::vector<int> &ConnectedCityIds(int hex_index, PlayerColor player) const;
         bool IsValidHex(const HexCoord &hex) const;
         PlayerColor GetCurrentPlayerColor() const { return current_player_color_; }
         Player GetPlayerId(PlayerColor color) const;
         PlayerColor GetPlayerColor(Player id) const;
         PlayerColor GetNextPlayerColor(PlayerColor current) const;
-        const std::map<std::string, int> &GetPlayerCommonGoods(Player player) const;
-        const std::map<std::string, int> &GetPlayerRareGoods(Player player) const;
+        const GoodCounts &GetPlayerCommonGoods(Player player) const;
+        const GoodCounts &GetPlayerRareGoods(Player player) const;
+        int GetCommonGoodCount(Player player, int good_id) const;
+        int GetRareGoodCount(Player player, int good_id) const;
         int GetCommonGoodCount(Player player, const std::string &good_name) const;
         int GetRareGoodCount(Player player, const std::string &good_name) const;
         std::string GetGameEndReason() const { return game_end_reason_; }
@@ -142,8 +288,14 @@ namespace mali_ba
         int GetGameEndTriggeringPlayer() const { return game_end_triggered_by_player_; }
 
         
-        // --- Make GetRNG() a const method ---
-        std::mt19937& GetRNG() const { return rng_; }
+        // The state's random stream, moved to the current move number first
+        // (mali_ba_rng.h), so draws are fixed by the stream seed and the
+        // position. GetRNG().SeedStream(run_seed, game_id) gives each game
+        // of a run its own reproducible stream.
+        Mali_BaRng& GetRNG() const {
+            rng_.SetMove(move_number_);
+            return rng_;
+        }
 
         // TestOnly setters and other methods
         void TestOnly_SetCurrentPlayer(Player player);
@@ -157,18 +309,14 @@ namespace mali_ba
         void TestOnly_ClearMeeples();
 
         // Setters
-        void SetMoveLoggingEnabled(bool answ) {
-            move_logging_enabled_ = answ;
-        }
+        void SetMoveLoggingEnabled(bool answ);
         void SetCurrentPhase(Phase phase) {
             current_phase_ = phase;
         }
-        void SetCommonGoods(const std::vector<std::map<std::string, int>>& goods) {
-            common_goods_ = goods;
-        }
-        void SetRareGoods(const std::vector<std::map<std::string, int>>& goods) {
-            rare_goods_ = goods;
-        }        void ApplyIncomeCollection(const std::string& action_str);
+        // Named forms, as in the JSON state; unknown goods are dropped.
+        void SetCommonGoods(const std::vector<std::map<std::string, int>>& goods);
+        void SetRareGoods(const std::vector<std::map<std::string, int>>& goods);
+        void ApplyIncomeCollection(const std::string& action_str);
 
         void AddTradingPost(const HexCoord &hex, PlayerColor player, TradePostType type);
         void UpgradeTradingPost(const HexCoord &hex, PlayerColor player);
@@ -189,10 +337,12 @@ namespace mali_ba
         PlayerColor GetFirstTokenAt(const HexCoord& hex) const;
         
         // Move logging and Python sync helpers
+        // Attaches this state to the game's move log and writes its [setup] record.
         void InitializeMoveLogging();
         void LogMove(const std::string& action_string, const std::string& state_json);
-        std::string CreateSetupJson() const;
-        static std::string GetMoveLogFilename() { return move_log_filename_; }
+        std::string CreateSetupJson(int64_t game_id = -1, bool pretty = true) const;
+        std::string GetMoveLogFilename() const;
+        int64_t GetMoveLogGameId() const { return move_log_game_id_; }
         HexCoord ParseHexCoordFromString(const std::string& coord_str) const;
         std::vector<HexCoord> ParseHexListFromData(const std::vector<std::vector<int>>& hex_data) const;
         void ValidateTradeRoutes();
@@ -214,29 +364,107 @@ namespace mali_ba
         Phase current_phase_;
         Player current_player_id_;
         PlayerColor current_player_color_;
-        std::map<HexCoord, std::vector<PlayerColor>> player_token_locations_;
+        // One HexCell per valid hex, indexed by Mali_BaGame::CoordToIndex().
+        // Shared copy-on-write between copies; write only via MutableCellAt().
+        SharedBoard board_;
         std::vector<int> player_posts_supply_;
-        std::map<HexCoord, std::vector<MeepleColor>> hex_meeples_;
-        std::map<HexCoord, std::vector<TradePost>> trade_posts_locations_;
-        std::vector<std::map<std::string, int>> common_goods_;
-        std::vector<std::map<std::string, int>> rare_goods_;
+        std::vector<GoodCounts> common_goods_;  // Per player, by GoodsManager id
+        std::vector<GoodCounts> rare_goods_;
         std::vector<TradeRoute> trade_routes_;
         int next_route_id_ = 1;
         std::vector<Move> moves_history_;
-        mutable std::mt19937 rng_;
+        mutable Mali_BaRng rng_;
         mutable bool is_terminal_ = false;
-        mutable absl::optional<LegalActionsResult> cached_legal_actions_result_;
-        std::vector<StateSnapshot> undo_stack_;
+        // Both caches describe this position only, so copies of the state
+        // share them; they are dropped rather than modified in place.
+        mutable std::shared_ptr<const LegalActionsResult> cached_legal_actions_result_;
+        // Generates the legal actions if needed and returns the cached result
+        // (an empty one for terminal states, which are not cached).
+        const LegalActionsResult& CachedLegalActions() const;
+        // Hexes of a category whose actions are one per hex (token placement,
+        // mancala starts, upgrades), legal ones only, and the action id of hex
+        // 0. False for the other categories.
+        bool LegalCategoryHexes(LegalActionCategory category, HexMask* hexes, Action* base) const;
+        // Route choices offered in the optional route phase.
+        int NumRouteChoices() const;
+        // FindPossibleTradeRoutes() results for this position. Cleared by
+        // ClearCaches(), by any board write and by any route change.
+        struct TradeRouteQuery {
+            PlayerColor player = PlayerColor::kEmpty;
+            bool is_valid_per_rules = false;
+            bool has_includes_hex = false;
+            HexCoord includes_hex;
+            int max_hexes = -1;
+            int min_hexes = -1;
+            bool operator==(const TradeRouteQuery& other) const;
+        };
+        using TradeRouteCache =
+            std::vector<std::pair<TradeRouteQuery, std::vector<std::vector<HexCoord>>>>;
+        mutable std::shared_ptr<TradeRouteCache> cached_trade_routes_;
+        // Reverse index of the active trade routes, for income. Rebuilt on
+        // first use after OnTradeRoutesChanged() or ClearCaches() and shared
+        // between copies, like the caches above.
+        struct RouteConnectivity {
+            // Indices into trade_routes_ of the active routes through each hex
+            std::vector<std::vector<int>> routes_through;
+            // At [hex * kNumPlayerColors + color]: ConnectedCityIds()
+            std::vector<std::vector<int>> connected_cities;
+        };
+        mutable std::shared_ptr<const RouteConnectivity> route_connectivity_;
+        const RouteConnectivity& GetRouteConnectivity() const;
+        CountedVector<UndoFrame> undo_journal_;  // One frame per applied action
+        bool undo_recording_ = false;           // True while DoApplyAction() runs
+        // Board planes (0-25) of the observation tensor, built on the first
+        // ObservationTensor() call and then patched only at the hexes written
+        // since. Shared copy-on-write with clones, like board_.
+        mutable std::shared_ptr<std::vector<float>> obs_board_planes_;
+        mutable std::vector<int> obs_dirty_cells_;
+        // Score counter groups; see PlayerScoreCounters. Rebuilt lazily,
+        // copied with the state.
+        enum ScoreCounterGroup : uint8_t {
+            kRouteCounters = 1,
+            kGoodsCounters = 2,
+            kBoardCounters = 4,
+            kAllScoreCounters = 7,
+        };
+        mutable std::vector<PlayerScoreCounters> score_counters_;
+        mutable uint8_t score_counters_dirty_ = kAllScoreCounters;
+        // HashKey() parts (mali_ba_zobrist.h). board_hash_ leaves out the
+        // cells in hash_pending_cells_: each is XOR-ed out when first written
+        // and back in, with its new contents, by SyncHashKey(). A part flagged
+        // in hash_stale_ is recomputed from scratch. Copied with the state.
+        enum HashPart : uint8_t {
+            kBoardHash = 1,
+            kGoodsHash = 2,
+            kRouteHash = 4,
+            kAllHashParts = 7,
+        };
+        static constexpr int kMaxHashPendingCells = 64;
+        mutable uint64_t board_hash_ = 0;
+        mutable uint64_t goods_hash_ = 0;
+        mutable uint64_t route_hash_ = 0;
+        mutable std::vector<int> hash_pending_cells_;
+        mutable uint8_t hash_stale_ = kAllHashParts;
         mutable int game_end_triggered_by_player_ = -1;  // -1 means not set
         mutable int winning_player_ = -1;                // -1 means tie/not set
         mutable std::string game_end_reason_;            // Description of how game ended
 
-        // Private Static Members
-        static std::unique_ptr<std::ofstream> move_log_file_;
-        static std::string move_log_filename_;
-        static int move_count_;
-        static bool move_logging_initialized_;
-        static bool move_logging_enabled_;
+        // Move logging. Not copied: clones (e.g. search rollouts) do not log.
+        std::shared_ptr<MoveLogSink> move_log_sink_;
+        int64_t move_log_game_id_ = -1;
+        int move_log_count_ = 0;
+
+        // Change feed (see EnableChangeFeed()). Not copied either.
+        struct ChangeFeed {
+            int snapshot_interval = 50;
+            int64_t next_seq = 0;
+            int since_snapshot = 0;  // Deltas queued since the last snapshot
+            std::vector<std::string> entries;
+        };
+        std::unique_ptr<ChangeFeed> change_feed_;
+        // Queues the delta of the action just applied, from its undo frame.
+        void RecordChangeFeedDelta(Action action, const std::string& action_string);
+        void QueueChangeFeedEntry(std::string entry, bool snapshot);
 
         // --- Mid-Turn State Variables ---
         // Standard containers ensure state->Clone() is blazingly fast and memory-safe.
@@ -246,9 +474,21 @@ namespace mali_ba
         HexCoord last_action_hex_; // Tracks where token landed or post upgraded
         bool pending_route_declaration_ = false;
 
+        // Tag for the CloneForSearch() copy constructor
+        struct SearchCloneTag {};
+        Mali_BaState(const Mali_BaState& other, SearchCloneTag);
+
         // Helper to end a turn and pass to the next player
         void EndTurn();
 
+        // Board cell lookup; nullptr if the hex is not on the board
+        const HexCell* CellAt(const HexCoord& hex) const;
+        HexCell* MutableCellAt(const HexCoord& hex);
+        // Overwrite the contents of a hex (used by deserialization and tests)
+        void SetTokensAt(const HexCoord& hex, const std::vector<PlayerColor>& colors);
+        void SetMeeplesAt(const HexCoord& hex, const std::vector<MeepleColor>& meeples);
+        void SetTradePostsAt(const HexCoord& hex, const std::vector<TradePost>& posts);
+
         // Private income/move generation helpers 
         struct IncomeChoice {
             HexCoord center_hex;
@@ -263,16 +503,17 @@ namespace mali_ba
         // A helper struct to hold pre-calculated context for the heuristic.
         // This avoids passing many parameters around.
         struct HeuristicContext {
-            int posts_in_supply;
-            std::vector<HexCoord> existing_centers;
-            std::set<int> existing_center_regions;
+            int posts_in_supply = 0;
+            std::vector<int> existing_centers;         // Hex indices
+            std::vector<int> existing_center_regions;  // Region ids, no duplicates
         };
-        // Creates the context needed by the heuristic calculation.
-        HeuristicContext CreateHeuristicContext() const;
-        // The core helper function that calculates the weight for a single move.
-        double CalculateHeuristicWeightForAction(
-            const Move& move,
-            const LegalActionsResult& legal_actions_result,
+        // Refills the context for the current player, reusing its buffers.
+        void FillHeuristicContext(HeuristicContext* context) const;
+        // The weight of one legal action, decoded from the action id alone:
+        // no Move is built and no route is searched.
+        double HeuristicWeightForAction(
+            Action action,
+            const LegalActionCounts& counts,
             const HeuristicContext& context) const;
 
         bool IsValidTradeRouteForMoveGeneration(
@@ -282,11 +523,21 @@ namespace mali_ba
             PlayerColor player) const;
         bool HasSufficientResourcesForUpgrade(Player player_id) const;
         std::vector<Move> GenerateIncomeMoves() const;
-        std::vector<Move> GenerateTradeRouteMoves() const;
         std::vector<const City*> GetConnectedCities(const HexCoord& center_hex, PlayerColor player) const;
         std::vector<const City*> FindClosestCities(const HexCoord& hex) const;
         void RemoveMeepleAt(const HexCoord& hex, int index);
         std::vector<HexCoord> GetCanonicalRoute(const std::vector<HexCoord>& route_combination) const;
+        // Route search and validation against `board`, which is either board_
+        // itself or a Mali_BaWhatIf view of it.
+        std::vector<std::vector<HexCoord>> EnumerateTradeRoutes(
+            const BoardOverlay& board,
+            PlayerColor player,
+            bool is_valid_per_rules,
+            const HexCoord* includes_hex,
+            int max_hexes,
+            int min_hexes) const;
+        bool IsValidTradeRouteOn(const BoardOverlay& board,
+            const std::vector<HexCoord>& route_hexes, PlayerColor player) const;
         std::vector<std::vector<HexCoord>> FindPossibleTradeRoutes(
             PlayerColor player,
             bool is_valid_per_rules,
@@ -313,22 +564,8 @@ namespace mali_ba
             const std::map<std::string, int>& common_goods,
             const std::map<std::string, int>& rare_goods) const;
         bool IsRareGood(const std::string& good_name) const;
-        std::vector<Move> GeneratePlaceTokenMoves() const;
-        std::vector<Move> GenerateMancalaMoves() const;
-        std::vector<Move> GenerateTradePostUpgradeMoves() const;
-        void FindMancalaPathsRecursive(const HexCoord &start_hex, const HexCoord &current_hex,
-            int remaining_meeples, std::vector<HexCoord> &currentt_path,
-            std::set<HexCoord> &visited_hexes, std::vector<Move> &all_valid_moves) const;
-        void FindMancalaPathsConstrainedRecursive(const HexCoord &original_start_hex, const HexCoord &currentt_hex,
-            int remaining_meeples, std::vector<HexCoord> &path_so_far,
-            std::set<HexCoord> &visited_hexes, std::vector<Move> &all_valid_moves) const;
-
-        void GenerateRandomMancalaPaths(
-            const Mali_BaState& state,
-            const HexCoord& start_hex,
-            int num_meeples,
-            int num_paths_to_generate,
-            std::vector<Move>& legal_moves) const;
+        // Stores `route` as hex indices in packed->route.
+        void PackRoute(const std::vector<HexCoord>& route, PackedMove* packed) const;
 
         void ApplyMancalaMove(const Move &move);
         void ApplyPlaceTokenMove(const Move &move);
@@ -339,7 +576,65 @@ namespace mali_ba
         void ApplyTradeRouteDelete(const Move& move);
         void InitializeBoard();
         void ApplyChanceSetup();
-        void PushStateToUndoStack();
+        // Undo journal (mali_ba_state_undo.cc)
+        void BeginUndoFrame();
+        void EndUndoFrame() { undo_recording_ = false; }
+        void RevertUndoFrame(const UndoFrame& frame);
+        void JournalCell(int index);
+        void JournalBoard();
+        void JournalGood(UndoEntry::Kind kind, Player player, int good_id);
+        void JournalPostsSupply(Player player);
+        void JournalRouteAdded();
+        void JournalRouteRemoved(int index);
+        void JournalRouteActive(int index);
+        void AdjustCommonGood(Player player, int good_id, int delta);
+        void AdjustRareGood(Player player, int good_id, int delta);
+        // A player's goods as they were before the most recent action
+        GoodCounts GoodsBeforeLastAction(Player player, bool rare) const;
+        // Every board write goes through one of these so the cached
+        // observation planes, score counters and hash key stay in step
+        // with board_.
+        HexCell& WritableCell(int index) {
+            if (obs_board_planes_) obs_dirty_cells_.push_back(index);
+            cached_trade_routes_.reset();
+            score_counters_dirty_ |= kBoardCounters;
+            if (!(hash_stale_ & kBoardHash)) HashOutCell(index);
+            return board_.Mutable(index);
+        }
+        void HashOutCell(int index) {
+            if (std::find(hash_pending_cells_.begin(), hash_pending_cells_.end(), index) !=
+                hash_pending_cells_.end()) {
+                return;
+            }
+            if (static_cast<int>(hash_pending_cells_.size()) >= kMaxHashPendingCells) {
+                InvalidateHashKey(kBoardHash);
+                return;
+            }
+            board_hash_ ^= ZobristCellKey(index, board_[index]);
+            hash_pending_cells_.push_back(index);
+        }
+        // Every change to trade_routes_ calls this.
+        void OnTradeRoutesChanged() {
+            cached_trade_routes_.reset();
+            route_connectivity_.reset();
+            score_counters_dirty_ |= kRouteCounters;
+            hash_stale_ |= kRouteHash;
+        }
+        void InvalidateObservationPlanes() {
+            obs_board_planes_.reset();
+            obs_dirty_cells_.clear();
+        }
+        void SyncObservationPlanes() const;
+        void InvalidateScoreCounters(uint8_t groups = kAllScoreCounters) {
+            score_counters_dirty_ |= groups;
+        }
+        void SyncHashKey() const;
+        void InvalidateHashKey(uint8_t parts = kAllHashParts) {
+            hash_stale_ |= parts;
+            if (parts & kBoardHash) hash_pending_cells_.clear();
+        }
+        // Binary serialization (mali_ba_state_serialize.cc)
+        void DecodeBinary(const std::string& data);
         absl::optional<std::vector<double>> MaybeFinalReturns() const;
         void ClearAllState();
 
@@ -348,10 +643,64 @@ namespace mali_ba
             const HexCoord& start, const HexCoord& end, int max_length) const;
     };
 
+    // Fills one legal-action mask per state into `out` (row-major, one
+    // NumDistinctActions() row per state), e.g. for a whole inference batch.
+    void LegalActionsMaskBatch(absl::Span<const Mali_BaState* const> states,
+                               absl::Span<uint8_t> out);
+
     // =====================================================================
     // FUNCTION RELATIONSHIP SUMMARY
     // =====================================================================
 
+    // A Mali_BaState with a few posts, tokens and goods changed, without
+    // copying it. Compound-move generation uses it to ask what a new post or
+    // upgrade would make possible: building one costs O(changes), where a
+    // state copy costs the undo journal, history and RNG. The state must
+    // outlive the view and must not change while the view is in use.
+    class Mali_BaWhatIf {
+    public:
+        explicit Mali_BaWhatIf(const Mali_BaState& state)
+            : state_(state), board_(state.board_) {}
+
+        // Same board and post-supply effects as the Mali_BaState methods of
+        // the same name.
+        void AddTradingPost(const HexCoord& hex, PlayerColor player, TradePostType type);
+        void UpgradeTradingPost(const HexCoord& hex, PlayerColor player);
+        void AddToken(const HexCoord& hex, PlayerColor player);
+        void AdjustCommonGood(Player player, int good_id, int delta);
+
+        const BoardOverlay& board() const { return board_; }
+        const HexCell* CellAt(const HexCoord& hex) const;
+        int PostsSupply(Player player) const;
+        int CommonGoodCount(Player player, int good_id) const;
+        int TotalCommonGoods(Player player) const;
+
+        // As on Mali_BaState, but seeing the changes above. Route results are
+        // not memoized.
+        bool CanPlaceTradingPostAt(const HexCoord& hex, PlayerColor player) const;
+        bool IsValidTradeRoute(const std::vector<HexCoord>& route_hexes, PlayerColor player) const;
+        std::vector<std::vector<HexCoord>> FindPossibleTradeRoutes(
+            PlayerColor player,
+            bool is_valid_per_rules,
+            const HexCoord* includes_hex = nullptr,
+            int max_hexes = -1,
+            int min_hexes = -1) const;
+
+    private:
+        struct GoodDelta {
+            Player player;
+            int good_id;
+            int delta;
+        };
+
+        int Index(const HexCoord& hex) const;
+
+        const Mali_BaState& state_;
+        BoardOverlay board_;
+        std::vector<int> posts_supply_delta_;  // Per player; empty until changed
+        std::vector<GoodDelta> common_good_deltas_;
+    };
+
     /*
     EARLIER vs NEW FUNCTIONS:
 
@@ -389,63 +738,37 @@ namespace mali_ba
     // For OpenSpiel algorithms that expect single actions, create a wrapper:
     class Mali_BaTurnBasedWrapper {
     public:
+        // Trade routes are the free actions. Counting them runs the route
+        // search, so that waits until a free action is wanted or nothing else
+        // is legal.
         static Action SelectSingleRandomAction(Mali_BaState* state) {
             if (state->IsTerminal() || state->IsChanceNode()) {
-                std::vector<Action> legal_actions = state->LegalActions();
-                if (legal_actions.empty()) return kInvalidAction;
-                
-                std::uniform_int_distribution<int> dist(0, legal_actions.size() - 1);
-                return legal_actions[dist(state->GetRNG())];  // Now GetRNG() exists
+                return state->SampleLegalAction(state->CountLegalActionCategories());
             }
-            
-            // For regular player turns, we need to decide:
-            // 1. Take a free action (if available and sometimes)
-            // 2. Take a regular action
-            
-            std::vector<Action> legal_actions = state->LegalActions();
-            if (legal_actions.empty()) return kInvalidAction;
-            
+
+            LegalActionCategoryCounts regular;
+            for (int c = 0; c < kNumLegalActionCategories; ++c) {
+                const LegalActionCategory category = static_cast<LegalActionCategory>(c);
+                if (category != LegalActionCategory::kTradeRoute) {
+                    regular[category] = state->NumLegalActionsInCategory(category);
+                }
+            }
+            if (regular.Total() == 0 &&
+                state->NumLegalActionsInCategory(LegalActionCategory::kTradeRoute) == 0) {
+                return kInvalidAction;
+            }
+
             // Randomly decide whether to take a free action (30% chance)
             std::uniform_real_distribution<double> free_action_prob(0.0, 1.0);
             bool take_free_action = free_action_prob(state->GetRNG()) < 0.3;
-            
-            if (take_free_action) {
-                // Look for free actions
-                std::vector<Action> free_actions;
-                for (Action action : legal_actions) {
-                    Move move = state->ActionToMove(action);
-                    if (move.type == ActionType::kTradeRouteCreate ||
-                        move.type == ActionType::kTradeRouteUpdate ||
-                        move.type == ActionType::kTradeRouteDelete) {
-                        free_actions.push_back(action);
-                    }
-                }
-                
-                if (!free_actions.empty()) {
-                    std::uniform_int_distribution<int> dist(0, free_actions.size() - 1);
-                    return free_actions[dist(state->GetRNG())];  // Now GetRNG() exists
-                }
+
+            if (take_free_action || regular.Total() == 0) {
+                Action route = state->SampleLegalActionInCategory(LegalActionCategory::kTradeRoute);
+                if (route != kInvalidAction) return route;
             }
-            
+
             // Take a regular action
-            std::vector<Action> regular_actions;
-            for (Action action : legal_actions) {
-                Move move = state->ActionToMove(action);
-                if (move.type != ActionType::kTradeRouteCreate &&
-                    move.type != ActionType::kTradeRouteUpdate &&
-                    move.type != ActionType::kTradeRouteDelete) {
-                    regular_actions.push_back(action);
-                }
-            }
-            
-            if (regular_actions.empty()) {
-                // Fallback to any legal action
-                std::uniform_int_distribution<int> dist(0, legal_actions.size() - 1);
-                return legal_actions[dist(state->GetRNG())];
-            }
-            
-            std::uniform_int_distribution<int> dist(0, regular_actions.size() - 1);
-            return regular_actions[dist(state->GetRNG())];  // Now GetRNG() exists
+            return state->SampleLegalAction(regular);
         }
     };
 }
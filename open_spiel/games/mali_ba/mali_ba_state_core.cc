@@ -5,6 +5,7 @@
 #include "open_spiel/games/mali_ba/mali_ba_state.h"
 #include "open_spiel/games/mali_ba/mali_ba_game.h"
 #include "open_spiel/games/mali_ba/mali_ba_observer.h"
+#include "open_spiel/games/mali_ba/mali_ba_perf.h"
 #include "open_spiel/games/mali_ba/hex_grid.h"
 
 #include <algorithm>
@@ -29,29 +30,8 @@ namespace open_spiel
             // Max values needed for plane indexing (match observer)
             constexpr int kMaxPlayersObs = 5;
             constexpr int kNumMeepleColorsObs = 10;
-
-            class VectorTensorAllocator : public Allocator {
-            public:
-                static int GetSize(const absl::InlinedVector<int, 4>& shape) { // Pass by const ref here is fine
-                    if (shape.empty()) return 0;
-                    return std::accumulate(shape.begin(), shape.end(), 1, std::multiplies<int>());
-                }
-
-                SpanTensor Get(absl::string_view name,
-                                const absl::InlinedVector<int, 4>& shape) override {
-                    SPIEL_CHECK_EQ(name, "observation");
-                    buffer_.resize(GetSize(shape));
-
-                    SpanTensorInfo info(name, shape);
-
-                    return SpanTensor(info, absl::MakeSpan(buffer_));
-                }
-
-                const std::vector<float>& GetBuffer() const { return buffer_; }
-
-            private:
-                std::vector<float> buffer_;
-            };
+            // Most trade routes offered in the optional route phase (the kRouteBase block)
+            constexpr int kMaxRouteChoices = 300;
         } // namespace
 
         // --- State Constructor ---
@@ -66,8 +46,8 @@ namespace open_spiel
             rng_.seed(GetGame()->GetRNGSeed());
             
             int num_players = game_->NumPlayers();
-            common_goods_.resize(num_players);
-            rare_goods_.resize(num_players);
+            common_goods_.assign(num_players, GoodCounts{});
+            rare_goods_.assign(num_players, GoodCounts{});
             player_posts_supply_.resize(num_players);
             // Initialize cumulative_returns_
             cumulative_returns_.resize(game_->NumPlayers(), 0.0);
@@ -82,10 +62,8 @@ namespace open_spiel
               current_phase_(other.current_phase_),
               current_player_id_(other.current_player_id_),
               current_player_color_(other.current_player_color_),
-              player_token_locations_(other.player_token_locations_),
+              board_(other.board_),
               player_posts_supply_(other.player_posts_supply_),
-              hex_meeples_(other.hex_meeples_),
-              trade_posts_locations_(other.trade_posts_locations_),
               common_goods_(other.common_goods_),
               rare_goods_(other.rare_goods_),
               trade_routes_(other.trade_routes_),
@@ -93,21 +71,92 @@ namespace open_spiel
               moves_history_(other.moves_history_),
               rng_(other.rng_),
               is_terminal_(other.is_terminal_),
-              undo_stack_(other.undo_stack_),
+              cached_legal_actions_result_(other.cached_legal_actions_result_),
+              cached_trade_routes_(other.cached_trade_routes_),
+              route_connectivity_(other.route_connectivity_),
+              undo_journal_(other.undo_journal_),
+              obs_board_planes_(other.obs_board_planes_),
+              obs_dirty_cells_(other.obs_dirty_cells_),
+              score_counters_(other.score_counters_),
+              score_counters_dirty_(other.score_counters_dirty_),
+              board_hash_(other.board_hash_),
+              goods_hash_(other.goods_hash_),
+              route_hash_(other.route_hash_),
+              hash_pending_cells_(other.hash_pending_cells_),
+              hash_stale_(other.hash_stale_),
               game_end_triggered_by_player_(other.game_end_triggered_by_player_),
               winning_player_(other.winning_player_),
-              game_end_reason_(other.game_end_reason_)
+              game_end_reason_(other.game_end_reason_),
+              meeples_in_hand_(other.meeples_in_hand_),
+              current_mancala_path_(other.current_mancala_path_),
+              current_mancala_hex_(other.current_mancala_hex_),
+              last_action_hex_(other.last_action_hex_),
+              pending_route_declaration_(other.pending_route_declaration_)
         {
-            // Caches are intentionally NOT copied. They will be regenerated on the clone when needed.
+            // The legal-action and route caches are shared: they describe this
+            // position, and neither copy modifies them in place.
             // Copy the cumulative returns
             cumulative_returns_ = other.cumulative_returns_;
         }
 
 
+        // --- Search Copy Constructor ---
+        // Same as the copy constructor except the undo journal and move history,
+        // which grow with the game, are cut down to their newest entry.
+        Mali_BaState::Mali_BaState(const Mali_BaState& other, SearchCloneTag)
+            : State(other),
+              cumulative_returns_(other.cumulative_returns_),
+              current_phase_(other.current_phase_),
+              current_player_id_(other.current_player_id_),
+              current_player_color_(other.current_player_color_),
+              board_(other.board_),
+              player_posts_supply_(other.player_posts_supply_),
+              common_goods_(other.common_goods_),
+              rare_goods_(other.rare_goods_),
+              trade_routes_(other.trade_routes_),
+              next_route_id_(other.next_route_id_),
+              rng_(other.rng_),
+              is_terminal_(other.is_terminal_),
+              cached_legal_actions_result_(other.cached_legal_actions_result_),
+              cached_trade_routes_(other.cached_trade_routes_),
+              route_connectivity_(other.route_connectivity_),
+              obs_board_planes_(other.obs_board_planes_),
+              obs_dirty_cells_(other.obs_dirty_cells_),
+              score_counters_(other.score_counters_),
+              score_counters_dirty_(other.score_counters_dirty_),
+              board_hash_(other.board_hash_),
+              goods_hash_(other.goods_hash_),
+              route_hash_(other.route_hash_),
+              hash_pending_cells_(other.hash_pending_cells_),
+              hash_stale_(other.hash_stale_),
+              game_end_triggered_by_player_(other.game_end_triggered_by_player_),
+              winning_player_(other.winning_player_),
+              game_end_reason_(other.game_end_reason_),
+              meeples_in_hand_(other.meeples_in_hand_),
+              current_mancala_path_(other.current_mancala_path_),
+              current_mancala_hex_(other.current_mancala_hex_),
+              last_action_hex_(other.last_action_hex_),
+              pending_route_declaration_(other.pending_route_declaration_)
+        {
+            if (!other.moves_history_.empty()) {
+                moves_history_.push_back(other.moves_history_.back());
+            }
+            if (!other.undo_journal_.empty()) {
+                undo_journal_.push_back(other.undo_journal_.back());
+                undo_journal_.back().moves_history_size_ = moves_history_.size();
+            }
+        }
+
         std::unique_ptr<State> Mali_BaState::Clone() const {
+            MALI_BA_PERF_SCOPE(kClone);
             return std::make_unique<Mali_BaState>(*this);
         }
 
+        std::unique_ptr<State> Mali_BaState::CloneForSearch() const {
+            MALI_BA_PERF_SCOPE(kClone);
+            return std::unique_ptr<State>(new Mali_BaState(*this, SearchCloneTag{}));
+        }
+
         // --- Delegating Getters ---
         const Mali_BaGame *Mali_BaState::GetGame() const {
           // This performs the cast from the base Game pointer to the derived Mali_BaGame pointer.
@@ -123,19 +172,14 @@ namespace open_spiel
           return GetGame()->GetGridRadius();
         }
         bool Mali_BaState::IsValidHex(const HexCoord &hex) const {
-          return GetGame()->GetValidHexes().count(hex) > 0;
+          return GetGame()->CoordToIndex(hex) >= 0;
         }
 
 
         void Mali_BaState::InitializeBoard() {
             const GameRules& rules = GetGame()->GetRules();
-            player_token_locations_.clear();
-            hex_meeples_.clear();
-            trade_posts_locations_.clear();
-            for (const auto &hex : GetGame()->GetValidHexes()) {
-                hex_meeples_[hex] = {};
-                trade_posts_locations_[hex] = {};
-            }
+            board_.assign(GetGame()->NumHexes(), HexCell());
+            InvalidateObservationPlanes();
             for (int i = 0; i < game_->NumPlayers(); ++i) {
                 player_posts_supply_[i] = rules.posts_per_player;
             }
@@ -161,133 +205,242 @@ namespace open_spiel
         // This function is now the source of truth for legal action generation.
         LegalActionsResult Mali_BaState::GetLegalActionsAndCounts() const {
             if (cached_legal_actions_result_) return *cached_legal_actions_result_;
+            MALI_BA_PERF_SCOPE(kLegalActions);
 
             LegalActionsResult result;
             if (IsTerminal()) return result;
 
-            if (IsChanceNode()) {
-                result.actions.push_back(kChanceSetupAction);
-                cached_legal_actions_result_ = result;
-                return result;
+            // The categories in enum order are LegalActions() order.
+            for (int c = 0; c < kNumLegalActionCategories; ++c) {
+                const LegalActionCategory category = static_cast<LegalActionCategory>(c);
+                const size_t first = result.actions.size();
+                AppendLegalActionsInCategory(category, &result.actions);
+                const int added = static_cast<int>(result.actions.size() - first);
+                switch (category) {
+                    case LegalActionCategory::kPlaceToken: result.counts.place_token_moves += added; break;
+                    case LegalActionCategory::kIncome: result.counts.income_moves += added; break;
+                    case LegalActionCategory::kMancalaStart: result.counts.mancala_moves += added; break;
+                    case LegalActionCategory::kUpgrade: result.counts.upgrade_moves += added; break;
+                    case LegalActionCategory::kTradeRoute: result.counts.trade_route_create_moves += added; break;
+                    default: break;
+                }
             }
 
-            // AI/Heuristic Player Types
-            PlayerType current_player_type = GetGame()->GetPlayerTypes()[current_player_id_];
+            cached_legal_actions_result_ = std::make_shared<const LegalActionsResult>(result);
+            return result;
+        }
 
-            switch (current_phase_) {
-                case Phase::kPlaceToken: {
-                    for (int i = 0; i < GetGame()->NumHexes(); ++i) {
-                        HexCoord hex = GetGame()->IndexToCoord(i);
-                        if (player_token_locations_.find(hex) == player_token_locations_.end() &&
-                            GetGame()->GetCityAt(hex) == nullptr) {
-                            result.actions.push_back(kPlaceTokenActionBase + i); // Use legacy base for setup
-                            result.counts.place_token_moves++;
-                        }
+        // --- Legal actions by category ---
+        bool Mali_BaState::LegalCategoryHexes(LegalActionCategory category, HexMask* hexes, Action* base) const {
+            const BoardKernels &kernels = GetGame()->GetBoardKernels();
+            *hexes = HexMask();
+            switch (category) {
+                case LegalActionCategory::kPlaceToken:
+                    *base = kPlaceTokenActionBase; // Use legacy base for setup
+                    if (current_phase_ == Phase::kPlaceToken) {
+                        *hexes = kernels.TokenFreeHexes(board_.cells());
+                        hexes->Remove(GetGame()->CityHexes());
                     }
-                    break;
-                }
-
-                case Phase::kPlay: {
-                    if (current_player_type == PlayerType::kHuman) {
-                        result.actions.push_back(kPassAction);
+                    return true;
+                case LegalActionCategory::kMancalaStart:
+                    *base = kMancalaStartBase;
+                    if (current_phase_ == Phase::kPlay) {
+                        *hexes = kernels.TokenHexes(board_.cells(), current_player_color_);
                     }
-                    
-                    // 1. Income Action (Only if last action wasn't income)
-                    if (CanTakeIncome()) {
-                        result.actions.push_back(kIncomeAction);
-                        result.counts.income_moves++;
+                    return true;
+                case LegalActionCategory::kUpgrade:
+                    *base = kUpgradeBase;
+                    if (current_phase_ == Phase::kPlay && HasSufficientResourcesForUpgrade(current_player_id_)) {
+                        *hexes = kernels.PostHexes(board_.cells(), current_player_color_);
                     }
+                    return true;
+                default:
+                    return false;
+            }
+        }
 
-                    // 2. Mancala Starts
-                    for (int i = 0; i < GetGame()->NumHexes(); ++i) {
-                        HexCoord hex = GetGame()->IndexToCoord(i);
-                        if (HasTokenAt(hex, current_player_color_)) {
-                            result.actions.push_back(kMancalaStartBase + i);
-                            result.counts.mancala_moves++;
-                        }
-                    }
+        int Mali_BaState::NumRouteChoices() const {
+            // Valid routes originating from `last_action_hex_`
+            const auto possible_routes = FindPossibleTradeRoutes(current_player_color_, true, &last_action_hex_, 5);
+            return static_cast<int>(std::min(possible_routes.size(), static_cast<size_t>(kMaxRouteChoices)));
+        }
 
-                    // 3. Upgrades
-                    if (HasSufficientResourcesForUpgrade(current_player_id_)) {
-                        for (int i = 0; i < GetGame()->NumHexes(); ++i) {
-                            HexCoord hex = GetGame()->IndexToCoord(i);
-                            if (HasPlayerPostOrCenterAt(hex, current_player_color_) && 
-                                GetPlayerPostType(hex, current_player_color_) == TradePostType::kPost) {
-                                result.actions.push_back(kUpgradeBase + i);
-                                result.counts.upgrade_moves++;
-                            }
-                        }
+        void Mali_BaState::AppendLegalActionsInCategory(LegalActionCategory category, std::vector<Action>* actions) const {
+            if (IsTerminal()) return;
+            if (IsChanceNode()) {
+                if (category == LegalActionCategory::kChance) actions->push_back(kChanceSetupAction);
+                return;
+            }
+
+            HexMask hexes;
+            Action base = 0;
+            if (LegalCategoryHexes(category, &hexes, &base)) {
+                hexes.ForEach([actions, base](int i) { actions->push_back(base + i); });
+                return;
+            }
+
+            switch (category) {
+                case LegalActionCategory::kPass: {
+                    // Humans may end a play turn; the optional phases can always be declined.
+                    const bool human_turn = current_phase_ == Phase::kPlay &&
+                        GetGame()->GetPlayerTypes()[current_player_id_] == PlayerType::kHuman;
+                    if (human_turn || current_phase_ == Phase::kOptionalPost ||
+                        current_phase_ == Phase::kOptionalRoute) {
+                        actions->push_back(kPassAction);
                     }
                     break;
                 }
 
-                case Phase::kMancalaStep:
-                case Phase::kMancalaTokenStep: {
+                case LegalActionCategory::kIncome:
+                    // Only if last action wasn't income
+                    if (current_phase_ == Phase::kPlay && CanTakeIncome()) actions->push_back(kIncomeAction);
+                    break;
+
+                case LegalActionCategory::kMancalaStep: {
+                    if (current_phase_ != Phase::kMancalaStep && current_phase_ != Phase::kMancalaTokenStep) break;
                     // MCTS naturally learns pathfinding via these 6 directional choices
+                    const int current_index = GetGame()->CoordToIndex(current_mancala_hex_);
+                    if (current_index < 0) break;
+                    const auto &neighbors = GetGame()->NeighborIndices(current_index);
                     for (int i = 0; i < 6; ++i) {
-                        HexCoord target = current_mancala_hex_ + kHexDirections[i];
-                        
                         // Rule 1: Must be on the board
-                        if (!IsValidHex(target)) continue;
-                        
+                        if (neighbors[i] < 0) continue;
+
                         // Rule 2: Cannot revisit a hex in the current path
-                        if (std::find(current_mancala_path_.begin(), current_mancala_path_.end(), target) 
+                        const HexCoord target = GetGame()->IndexToCoord(neighbors[i]);
+                        if (std::find(current_mancala_path_.begin(), current_mancala_path_.end(), target)
                             != current_mancala_path_.end()) {
                             continue;
                         }
-                        
-                        result.actions.push_back(kMancalaDirectionBase + i);
+
+                        actions->push_back(kMancalaDirectionBase + i);
                     }
                     break;
                 }
 
-                case Phase::kOptionalPost: {
-                    result.actions.push_back(kPassAction); // Decline
-                    
+                case LegalActionCategory::kPlacePost:
                     // Can only place post if a meeple is present, or player has resources
-                    if (CanPlaceTradingPostAt(last_action_hex_, current_player_color_)) {
-                        result.actions.push_back(kPlacePostAction);
+                    if (current_phase_ == Phase::kOptionalPost &&
+                        CanPlaceTradingPostAt(last_action_hex_, current_player_color_)) {
+                        actions->push_back(kPlacePostAction);
                     }
                     break;
-                }
 
-                case Phase::kOptionalPostPayment: {
-                    // Populate with valid resources the player can spend
-                    // (e.g., 0-14 representing the common goods)
-                    const auto& common_goods = GetPlayerCommonGoods(current_player_id_);
-                    for (const auto& [name, count] : common_goods) {
-                        if (count > 0) {
-                            int good_id = GoodsManager::GetInstance().GetCommonGoodIndex(name);
-                            result.actions.push_back(kPaymentBase + good_id);
+                case LegalActionCategory::kPayment: {
+                    if (current_phase_ != Phase::kOptionalPostPayment) break;
+                    // Valid resources the player can spend (0-14, the common goods)
+                    const GoodCounts& common_goods = GetPlayerCommonGoods(current_player_id_);
+                    for (int good_id = 0; good_id < kNumGoodTypes; ++good_id) {
+                        if (common_goods[good_id] > 0) {
+                            actions->push_back(kPaymentBase + good_id);
                         }
                     }
                     break;
                 }
 
-                case Phase::kOptionalRoute: {
-                    result.actions.push_back(kPassAction); // Decline / End Turn
-                    
-                    // Generate valid routes originating from `last_action_hex_`
-                    auto possible_routes = FindPossibleTradeRoutes(current_player_color_, true, &last_action_hex_, 5);
-                    for (size_t i = 0; i < std::min(possible_routes.size(), (size_t)300); ++i) {
-                        result.actions.push_back(kRouteBase + i);
-                        result.counts.trade_route_create_moves++;
-                    }
+                case LegalActionCategory::kTradeRoute: {
+                    if (current_phase_ != Phase::kOptionalRoute) break;
+                    const int num_routes = NumRouteChoices();
+                    for (int i = 0; i < num_routes; ++i) actions->push_back(kRouteBase + i);
                     break;
                 }
+
+                default:
+                    break;
             }
+        }
 
-            cached_legal_actions_result_ = result;
-            return result;
+        int Mali_BaState::NumLegalActionsInCategory(LegalActionCategory category) const {
+            if (IsTerminal()) return 0;
+            if (!IsChanceNode()) {
+                HexMask hexes;
+                Action base = 0;
+                if (LegalCategoryHexes(category, &hexes, &base)) return hexes.Count();
+                if (category == LegalActionCategory::kTradeRoute) {
+                    return current_phase_ == Phase::kOptionalRoute ? NumRouteChoices() : 0;
+                }
+            }
+            // The remaining categories hold at most a handful of actions.
+            thread_local std::vector<Action> actions;
+            actions.clear();
+            AppendLegalActionsInCategory(category, &actions);
+            return static_cast<int>(actions.size());
+        }
+
+        LegalActionCategoryCounts Mali_BaState::CountLegalActionCategories() const {
+            LegalActionCategoryCounts counts;
+            for (int c = 0; c < kNumLegalActionCategories; ++c) {
+                counts.counts[c] = NumLegalActionsInCategory(static_cast<LegalActionCategory>(c));
+            }
+            return counts;
+        }
+
+        Action Mali_BaState::LegalActionInCategory(LegalActionCategory category, int n) const {
+            if (n < 0 || IsTerminal()) return kInvalidAction;
+            if (!IsChanceNode()) {
+                HexMask hexes;
+                Action base = 0;
+                if (LegalCategoryHexes(category, &hexes, &base)) {
+                    const int hex_index = hexes.Nth(n);
+                    return hex_index < 0 ? kInvalidAction : base + hex_index;
+                }
+                if (category == LegalActionCategory::kTradeRoute) {
+                    // Route ids are dense: the n-th route is kRouteBase + n.
+                    return NumLegalActionsInCategory(category) > n ? kRouteBase + n : kInvalidAction;
+                }
+            }
+            thread_local std::vector<Action> actions;
+            actions.clear();
+            AppendLegalActionsInCategory(category, &actions);
+            return n < static_cast<int>(actions.size()) ? actions[n] : kInvalidAction;
+        }
+
+        Action Mali_BaState::SampleLegalActionInCategory(LegalActionCategory category) const {
+            const int count = NumLegalActionsInCategory(category);
+            if (count == 0) return kInvalidAction;
+            std::uniform_int_distribution<> dist(0, count - 1);
+            return LegalActionInCategory(category, dist(GetRNG()));
+        }
+
+        Action Mali_BaState::SampleLegalAction(const LegalActionCategoryCounts& counts) const {
+            const int total = counts.Total();
+            if (total == 0) return kInvalidAction;
+            std::uniform_int_distribution<> dist(0, total - 1);
+            int n = dist(GetRNG());
+            for (int c = 0; c < kNumLegalActionCategories; ++c) {
+                if (n < counts.counts[c]) return LegalActionInCategory(static_cast<LegalActionCategory>(c), n);
+                n -= counts.counts[c];
+            }
+            return kInvalidAction;
+        }
+
+        const LegalActionsResult& Mali_BaState::CachedLegalActions() const {
+            static const LegalActionsResult kNoLegalActions;
+            if (!cached_legal_actions_result_) GetLegalActionsAndCounts();
+            return cached_legal_actions_result_ ? *cached_legal_actions_result_ : kNoLegalActions;
         }
 
         std::vector<Action> Mali_BaState::LegalActions() const {
-            if (cached_legal_actions_result_) {
-                return cached_legal_actions_result_->actions;
+            return CachedLegalActions().actions;
+        }
+
+        void Mali_BaState::LegalActionsMask(absl::Span<uint8_t> mask) const {
+            SPIEL_CHECK_EQ(mask.size(), mali_ba::NumDistinctActions());
+            std::fill(mask.begin(), mask.end(), 0);
+            for (Action action : CachedLegalActions().actions) {
+                SPIEL_CHECK_GE(action, 0);
+                SPIEL_CHECK_LT(action, mali_ba::NumDistinctActions());
+                mask[action] = 1;
+            }
+        }
+
+        void LegalActionsMaskBatch(absl::Span<const Mali_BaState* const> states,
+                                   absl::Span<uint8_t> out) {
+            const size_t num_actions = mali_ba::NumDistinctActions();
+            SPIEL_CHECK_EQ(out.size(), states.size() * num_actions);
+            for (size_t i = 0; i < states.size(); ++i) {
+                states[i]->LegalActionsMask(out.subspan(i * num_actions, num_actions));
             }
-            // Temporarily cast away const to populate the cache
-            const_cast<Mali_BaState*>(this)->GetLegalActionsAndCounts();
-            return cached_legal_actions_result_->actions;
         }
 
         void Mali_BaState::ApplyPlaceTokenMove(const Move &move) {
@@ -301,10 +454,10 @@ namespace open_spiel
             const int num_players = game_->NumPlayers();
 
             std::map<PlayerColor, int> player_token_counts;
-            for (const auto& [hex, colors] : player_token_locations_) {
-                for (PlayerColor color : colors) {
-                    if (color != PlayerColor::kEmpty) {
-                        player_token_counts[color]++;
+            for (const HexCell& cell : board_) {
+                for (int c = 0; c < kNumPlayerColors; ++c) {
+                    if (cell.token_counts[c] > 0) {
+                        player_token_counts[static_cast<PlayerColor>(c)] += cell.token_counts[c];
                     }
                 }
             }
@@ -361,13 +514,13 @@ namespace open_spiel
             // State changes for token/meeple movement 
             bool removed = RemoveTokenAt(move.start_hex, move.player);
             SPIEL_CHECK_TRUE(removed);
-            hex_meeples_.erase(move.start_hex);
+            MutableCellAt(move.start_hex)->ClearMeeples();
             
             AddTokenAt(end_hex, move.player);
 
             for (int i = 0; i < num_meeples && i < actual_path.size() - 1; ++i) {
                 const HexCoord& dest_hex = actual_path[i];
-                hex_meeples_[dest_hex].push_back(meeples_to_distribute[i]);
+                MutableCellAt(dest_hex)->AddMeeple(meeples_to_distribute[i]);
             }
             
         }
@@ -380,20 +533,20 @@ namespace open_spiel
             AddTradingPost(end_hex, move.player, TradePostType::kPost);
             
             // Payment logic
-            auto& meeples_at_dest = hex_meeples_[end_hex];
-            if (!meeples_at_dest.empty()) {
-                meeples_at_dest.pop_back();
+            HexCell* dest_cell = MutableCellAt(end_hex);
+            if (dest_cell->num_meeples > 0) {
+                RemoveMeepleAt(end_hex, dest_cell->num_meeples - 1);
                 //LOG_DEBUG("Paid for trading post with a meeple at ", end_hex.ToString());
             } else {
                 Player player_id = GetPlayerId(move.player);
                 bool paid = false;
                 if (player_id != kInvalidPlayer) {
-                    for (auto& [name, count] : common_goods_[player_id]) {
-                        if (count > 0) { count--; paid = true; break; }
+                    for (int good_id = 0; good_id < kNumGoodTypes; ++good_id) {
+                        if (common_goods_[player_id][good_id] > 0) { AdjustCommonGood(player_id, good_id, -1); paid = true; break; }
                     }
                     if (!paid) {
-                        for (auto& [name, count] : rare_goods_[player_id]) {
-                            if (count > 0) { count--; paid = true; break; }
+                        for (int good_id = 0; good_id < kNumGoodTypes; ++good_id) {
+                            if (rare_goods_[player_id][good_id] > 0) { AdjustRareGood(player_id, good_id, -1); paid = true; break; }
                         }
                     }
                 }
@@ -408,15 +561,7 @@ namespace open_spiel
             SPIEL_CHECK_EQ(move.type, ActionType::kPlaceTCenter);
             
             // Check if the player actually has a post to upgrade.
-            bool has_player_post = false;
-            const auto& posts = GetTradePostsAt(move.start_hex);
-            for (const auto& post : posts) {
-                if (post.owner == move.player && post.type == TradePostType::kPost) {
-                    has_player_post = true;
-                    break;
-                }
-            }
-            if (!has_player_post) {
+            if (GetPlayerPostType(move.start_hex, move.player) != TradePostType::kPost) {
                 LOG_WARN("ApplyTradingPostUpgrade ERROR: No trading post to upgrade at ", move.start_hex.ToString());
                 return;
             }
@@ -437,61 +582,66 @@ namespace open_spiel
                         └─ NO → ❌ Cannot upgrade (should only reach if there's a bug)
             */
 
+            const GoodsManager& goods_manager = GoodsManager::GetInstance();
+
             // A. Is there a surplus rare good to pay with?
-            std::string rare_good_to_spend = "";
+            int rare_good_to_spend = -1;
             if (player_id < rare_goods_.size()) {
-                for (const auto& [name, count] : rare_goods_[player_id]) {
-                    if (count > rare_cost) { // Cost is 1, so count > 1 means surplus.
-                        rare_good_to_spend = name;
+                for (int good_id = 0; good_id < kNumGoodTypes; ++good_id) {
+                    if (rare_goods_[player_id][good_id] > rare_cost) { // Cost is 1, so count > 1 means surplus.
+                        rare_good_to_spend = good_id;
                         break;
                     }
                 }
             }
 
-            if (!rare_good_to_spend.empty()) {
-                rare_goods_[player_id][rare_good_to_spend] -= rare_cost;
+            if (rare_good_to_spend >= 0) {
+                AdjustRareGood(player_id, rare_good_to_spend, -rare_cost);
                 paid = true;
-                LOG_DEBUG("Paid for upgrade with surplus rare good: ", rare_good_to_spend);
+                LOG_DEBUG("Paid for upgrade with surplus rare good: ", goods_manager.GetRareGoodName(rare_good_to_spend));
             }
 
             // B. If not, are there enough common goods to pay with?
             if (!paid) {
                 int total_common = 0;
-                for (const auto& [name, count] : common_goods_[player_id]) {
+                for (int count : common_goods_[player_id]) {
                     total_common += count;
                 }
 
                 if (total_common >= common_cost) {
-                    // Create a vector of goods with their counts for easier manipulation
-                    std::vector<std::pair<std::string, int>> goods_list;
-                    for (const auto& [name, count] : common_goods_[player_id]) {
-                        if (count > 0) {
-                            goods_list.push_back({name, count});
+                    // (good id, count) of every good held, in id order
+                    std::array<std::pair<int, int>, kNumGoodTypes> goods_list;
+                    int num_goods = 0;
+                    for (int good_id = 0; good_id < kNumGoodTypes; ++good_id) {
+                        if (common_goods_[player_id][good_id] > 0) {
+                            goods_list[num_goods++] = {good_id, common_goods_[player_id][good_id]};
                         }
                     }
+                    const auto goods_end = goods_list.begin() + num_goods;
                     
                     // Sort by count (descending) so we prefer taking from goods with more surplus
-                    std::sort(goods_list.begin(), goods_list.end(),
+                    std::sort(goods_list.begin(), goods_end,
                             [](const auto& a, const auto& b) { return a.second > b.second; });
 
                     int to_remove = common_cost;
-                    std::map<std::string, int> payment_plan; // Track how much to take from each good
+                    GoodCounts payment_plan{}; // Track how much to take from each good
 
                     LOG_DEBUG("Planning payment for upgrade, player: ", player_id, ", cost: ", common_cost);
-                    for (const auto& [name, count] : goods_list) {
-                        LOG_DEBUG("Available: ", name, " x", count);
+                    for (auto it = goods_list.begin(); it != goods_end; ++it) {
+                        LOG_DEBUG("Available: ", goods_manager.GetCommonGoodName(it->first), " x", it->second);
                     }
 
                     // STEP 1: Take surplus goods (anything above 1) from each type
-                    for (const auto& [name, count] : goods_list) {
+                    for (auto it = goods_list.begin(); it != goods_end; ++it) {
+                        const auto& [good_id, count] = *it;
                         if (to_remove == 0) break;
                         
                         int surplus = count - 1; // How much we can take while leaving at least 1
                         if (surplus > 0) {
                             int amount_to_take = std::min(to_remove, surplus);
-                            payment_plan[name] += amount_to_take;
+                            payment_plan[good_id] += amount_to_take;
                             to_remove -= amount_to_take;
-                            LOG_DEBUG("Step 1: Plan to take ", amount_to_take, " ", name, " (surplus)");
+                            LOG_DEBUG("Step 1: Plan to take ", amount_to_take, " ", goods_manager.GetCommonGoodName(good_id), " (surplus)");
                         }
                     }
 
@@ -499,8 +649,9 @@ namespace open_spiel
                     if (to_remove > 0) {
                         // Count how many different goods we have left to take from
                         int goods_with_remainder = 0;
-                        for (const auto& [name, count] : goods_list) {
-                            int after_surplus = count - payment_plan[name]; // What's left after taking surplus
+                        for (auto it = goods_list.begin(); it != goods_end; ++it) {
+                            const auto& [good_id, count] = *it;
+                            int after_surplus = count - payment_plan[good_id]; // What's left after taking surplus
                             if (after_surplus > 0) {
                                 goods_with_remainder++;
                             }
@@ -510,20 +661,21 @@ namespace open_spiel
                         while (to_remove > 0 && goods_with_remainder > 0) {
                             bool took_any_this_round = false;
                             
-                            for (const auto& [name, original_count] : goods_list) {
+                            for (auto it = goods_list.begin(); it != goods_end; ++it) {
+                                const auto& [good_id, original_count] = *it;
                                 if (to_remove == 0) break;
                                 
-                                int already_taking = payment_plan[name];
+                                int already_taking = payment_plan[good_id];
                                 int remaining_available = original_count - already_taking;
                                 
                                 if (remaining_available > 0) {
-                                    payment_plan[name]++;
+                                    payment_plan[good_id]++;
                                     to_remove--;
                                     took_any_this_round = true;
-                                    LOG_DEBUG("Step 2: Plan to take 1 more ", name, " (total taking: ", payment_plan[name], ")");
+                                    LOG_DEBUG("Step 2: Plan to take 1 more ", goods_manager.GetCommonGoodName(good_id), " (total taking: ", payment_plan[good_id], ")");
                                     
                                     // If we just took the last of this good, decrease the count
-                                    if (original_count - payment_plan[name] == 0) {
+                                    if (original_count - payment_plan[good_id] == 0) {
                                         goods_with_remainder--;
                                     }
                                 }
@@ -539,10 +691,12 @@ namespace open_spiel
 
                     // STEP 3: Execute the payment plan
                     if (to_remove == 0) {
-                        for (const auto& [name, amount] : payment_plan) {
-                            common_goods_[player_id][name] -= amount;
-                            LOG_DEBUG("Paid ", amount, " ", name, " for upgrade (", 
-                                    common_goods_[player_id][name], " remaining)");
+                        for (int good_id = 0; good_id < kNumGoodTypes; ++good_id) {
+                            const int amount = payment_plan[good_id];
+                            if (amount == 0) continue;
+                            AdjustCommonGood(player_id, good_id, -amount);
+                            LOG_DEBUG("Paid ", amount, " ", goods_manager.GetCommonGoodName(good_id), " for upgrade (", 
+                                    common_goods_[player_id][good_id], " remaining)");
                         }
                         paid = true;
                         LOG_DEBUG("Successfully paid for upgrade with common goods, preserving variety where possible");
@@ -554,11 +708,11 @@ namespace open_spiel
 
             // C. Final fallback: If we couldn't pay with common goods, try any available rare goods
             if (!paid && player_id < rare_goods_.size()) {
-                for (auto& [name, count] : rare_goods_[player_id]) {
-                    if (count > 0) {
-                        count -= rare_cost;
+                for (int good_id = 0; good_id < kNumGoodTypes; ++good_id) {
+                    if (rare_goods_[player_id][good_id] > 0) {
+                        AdjustRareGood(player_id, good_id, -rare_cost);
                         paid = true;
-                        LOG_DEBUG("Paid for upgrade with non-surplus rare good: ", name, " (fallback option)");
+                        LOG_DEBUG("Paid for upgrade with non-surplus rare good: ", goods_manager.GetRareGoodName(good_id), " (fallback option)");
                         break;
                     }
                 }
@@ -583,47 +737,44 @@ namespace open_spiel
             PlayerColor player_color = GetPlayerColor(player_id);
             SPIEL_CHECK_GE(player_id, 0);
 
-            for (const auto& [hex, posts] : trade_posts_locations_) {
-                for (const auto& post : posts) {
-                    if (post.owner == player_color && post.type == TradePostType::kCenter) {
-                        const City* city = GetGame()->GetCityAt(hex);
-                        if (city != nullptr) {
-                            rare_goods_[player_id][city->rare_good]++;
-                            total_rare++;
-                        }
+            const Mali_BaGame* game = GetGame();
+            const std::vector<City>& cities = game->GetCities();
+            const int num_hexes = static_cast<int>(board_.size());
+            for (int i = 0; i < num_hexes; ++i) {
+                if (board_[i].HasCenter(player_color)) {
+                    const int city = game->CityIdAtIndex(i);
+                    if (city >= 0) {
+                        AdjustRareGood(player_id, cities[city].rare_good_id, 1);
+                        total_rare++;
                     }
                 }
             }
 
-            for (const auto& [hex, posts] : trade_posts_locations_) {
-                for (const auto& post : posts) {
-                    if (post.owner == player_color && post.type == TradePostType::kCenter) {
-                        if (GetGame()->GetCityAt(hex) == nullptr) { 
-                            auto connected_cities = GetConnectedCities(hex, player_color);
-                            if (!connected_cities.empty()) {
-                                const City* chosen_city = connected_cities[0];
-                                rare_goods_[player_id][chosen_city->rare_good]++;
-                                total_rare++;
-                            } else {
-                                auto closest_cities = FindClosestCities(hex);
-                                if (!closest_cities.empty()) {
-                                    common_goods_[player_id][closest_cities[0]->common_good] += 2;
-                                    total_common += 2;
-                                }
+            for (int i = 0; i < num_hexes; ++i) {
+                if (board_[i].HasCenter(player_color)) {
+                    if (game->CityIdAtIndex(i) < 0) {
+                        const std::vector<int>& connected_cities = ConnectedCityIds(i, player_color);
+                        if (!connected_cities.empty()) {
+                            const City& chosen_city = cities[connected_cities[0]];
+                            AdjustRareGood(player_id, chosen_city.rare_good_id, 1);
+                            total_rare++;
+                        } else {
+                            const std::vector<int>& closest_cities = game->NearestCityIds(i);
+                            if (!closest_cities.empty()) {
+                                AdjustCommonGood(player_id, cities[closest_cities[0]].common_good_id, 2);
+                                total_common += 2;
                             }
                         }
                     }
                 }
             }
 
-            for (const auto& [hex, posts] : trade_posts_locations_) {
-                for (const auto& post : posts) {
-                    if (post.owner == player_color && post.type == TradePostType::kPost) {
-                        auto closest_cities = FindClosestCities(hex);
-                        if (!closest_cities.empty()) {
-                            common_goods_[player_id][closest_cities[0]->common_good]++;
-                            total_common ++;
-                        }
+            for (int i = 0; i < num_hexes; ++i) {
+                if (board_[i].HasPost(player_color)) {
+                    const std::vector<int>& closest_cities = game->NearestCityIds(i);
+                    if (!closest_cities.empty()) {
+                        AdjustCommonGood(player_id, cities[closest_cities[0]].common_good_id, 1);
+                        total_common ++;
                     }
                 }
             }
@@ -637,15 +788,7 @@ namespace open_spiel
             }
             
             for (const auto& hex : move.path) {
-                bool has_center = false;
-                const auto& posts = GetTradePostsAt(hex);
-                for (const auto& post : posts) {
-                    if (post.owner == move.player && post.type == TradePostType::kCenter) {
-                        has_center = true;
-                        break;
-                    }
-                }
-                if (!has_center) {
+                if (GetPlayerPostType(hex, move.player) != TradePostType::kCenter) {
                     LOG_WARN("ApplyTradeRouteCreate: Player ", static_cast<int>(move.player), 
                             " doesn't have a center at ", hex.ToString());
                     return;
@@ -671,7 +814,11 @@ namespace open_spiel
         }
         
         void Mali_BaState::DoApplyAction(Action action) {
-            PushStateToUndoStack();
+            MALI_BA_PERF_SCOPE(kApplyAction);
+            // The action string depends on the phase, so build it before applying.
+            const std::string logged_action = (move_log_sink_ || change_feed_)
+                ? ActionToString(current_player_id_, action) : std::string();
+            BeginUndoFrame();
             is_terminal_ = false;
 
             if (IsChanceNode()) {
@@ -679,6 +826,9 @@ namespace open_spiel
                 SetCurrentPhase(Phase::kPlaceToken);
                 current_player_id_ = 0;
                 current_player_color_ = GetPlayerColor(current_player_id_);
+                EndUndoFrame();
+                if (move_log_sink_) LogMove(logged_action, Serialize());
+                RequestChangeFeedSnapshot();
                 return;
             }
 
@@ -706,7 +856,7 @@ namespace open_spiel
                         // Pick up tokens and meeples
                         RemoveTokenAt(current_mancala_hex_, current_player_color_);
                         meeples_in_hand_ = GetMeeplesAt(current_mancala_hex_);
-                        hex_meeples_[current_mancala_hex_].clear();
+                        MutableCellAt(current_mancala_hex_)->ClearMeeples();
                         
                         if (meeples_in_hand_.empty()) {
                             current_phase_ = Phase::kMancalaTokenStep;
@@ -725,7 +875,7 @@ namespace open_spiel
                     // Drop a meeple
                     MeepleColor dropped = meeples_in_hand_.back();
                     meeples_in_hand_.pop_back();
-                    hex_meeples_[current_mancala_hex_].push_back(dropped);
+                    MutableCellAt(current_mancala_hex_)->AddMeeple(dropped);
                     
                     if (meeples_in_hand_.empty()) {
                         current_phase_ = Phase::kMancalaTokenStep;
@@ -751,7 +901,7 @@ namespace open_spiel
                         current_phase_ = Phase::kOptionalRoute;
                     } else if (action == kPlacePostAction) {
                         // If there's a meeple, consume it immediately
-                        if (!GetMeeplesAt(last_action_hex_).empty()) {
+                        if (CountMeeplesAt(last_action_hex_) > 0) {
                             RemoveMeepleAt(last_action_hex_, 0);
                             AddTradingPost(last_action_hex_, current_player_color_, TradePostType::kPost);
                             current_phase_ = Phase::kOptionalRoute;
@@ -765,10 +915,9 @@ namespace open_spiel
 
                 case Phase::kOptionalPostPayment: {
                     int good_id = action - kPaymentBase;
-                    std::string good_name = GoodsManager::GetInstance().GetCommonGoodsList()[good_id];
                     
                     // Deduct the good
-                    common_goods_[current_player_id_][good_name]--;
+                    AdjustCommonGood(current_player_id_, good_id, -1);
                     AddTradingPost(last_action_hex_, current_player_color_, TradePostType::kPost);
                     
                     current_phase_ = Phase::kOptionalRoute;
@@ -787,9 +936,15 @@ namespace open_spiel
                 }
             }
 
+            EndUndoFrame();
+
             // Recalculate game-end conditions if necessary
             ClearCaches();
+            SyncHashKey();
             RefreshTerminalStatus();
+
+            if (move_log_sink_) LogMove(logged_action, Serialize());
+            if (change_feed_) RecordChangeFeedDelta(action, logged_action);
         }
 
         // Simple helper to cleanly hand over the turn and reset mid-turn variables
@@ -848,54 +1003,6 @@ namespace open_spiel
             }
         }
         
-        void Mali_BaState::PushStateToUndoStack() {
-            undo_stack_.emplace_back(StateSnapshot{
-                current_player_id_,
-                current_player_color_,
-                current_phase_,
-                player_token_locations_,
-                hex_meeples_,
-                trade_posts_locations_,
-                common_goods_,
-                rare_goods_,
-                trade_routes_,
-                next_route_id_,
-                moves_history_,
-                cumulative_returns_,
-                is_terminal_
-            });
-        }
-
-        void Mali_BaState::UndoAction(Player player, Action action) {
-            SPIEL_CHECK_FALSE(undo_stack_.empty());
-            const StateSnapshot& last_state = undo_stack_.back();
-
-            current_player_id_ = last_state.current_player_id_;
-            current_player_color_ = last_state.current_player_color_;
-            current_phase_ = last_state.current_phase_;
-            player_token_locations_ = last_state.player_token_locations_;
-            hex_meeples_ = last_state.hex_meeples_;
-            trade_posts_locations_ = last_state.trade_posts_locations_;
-            common_goods_ = last_state.common_goods_;
-            rare_goods_ = last_state.rare_goods_;
-            trade_routes_ = last_state.trade_routes_;
-            next_route_id_ = last_state.next_route_id_;
-            moves_history_ = last_state.moves_history_;
-            cumulative_returns_ = last_state.cumulative_returns_;
-
-            undo_stack_.pop_back();
-
-            if (!history_.empty()) {
-                history_.pop_back();
-            }
-            if (move_number_ > 0) {
-                move_number_--;
-            }
-
-            ClearCaches();
-            is_terminal_ = false;
-        }
-
         std::string Mali_BaState::InformationStateString(Player player) const { return ObservationString(player); }
         std::string Mali_BaState::ObservationString(Player player) const { return ToString(); }
 
@@ -920,17 +1027,129 @@ namespace open_spiel
             return false;
         }
 
+        // Rebuilds whichever counter groups are flagged, from the routes,
+        // goods and board as they are now.
+        const std::vector<Mali_BaState::PlayerScoreCounters>& Mali_BaState::ScoreCounters() const {
+            const int num_players = NumPlayers();
+            if (static_cast<int>(score_counters_.size()) != num_players) {
+                score_counters_.assign(num_players, PlayerScoreCounters());
+                score_counters_dirty_ = kAllScoreCounters;
+            }
+            if (score_counters_dirty_ == 0) return score_counters_;
+            const Mali_BaGame* game = GetGame();
+
+            if (score_counters_dirty_ & kRouteCounters) {
+                const GameRules& rules = game->GetRules();
+                const std::set<HexCoord>& coastal_hexes = game->GetCoastalHexes();
+                static const int timbuktu_id = GetCityID("Timbuktu");
+                static const int agadez_id = GetCityID("Agadez");
+                static const int oudane_id = GetCityID("Oudane");
+                for (PlayerScoreCounters& c : score_counters_) {
+                    c.active_routes = 0;
+                    c.active_route_hexes = 0;
+                    c.longest_route = 0;
+                    c.regions_crossed_score = 0.0;
+                    c.timbuktu_to_coast = false;
+                }
+                std::vector<int> regions_crossed;
+                for (const TradeRoute& route : trade_routes_) {
+                    if (!route.active) continue;
+                    const Player p = GetPlayerId(route.owner);
+                    if (p < 0 || p >= num_players) continue;
+                    PlayerScoreCounters& c = score_counters_[p];
+                    const int length = static_cast<int>(route.hexes.size());
+                    c.active_routes++;
+                    c.active_route_hexes += length;
+                    c.longest_route = std::max(c.longest_route, length);
+
+                    regions_crossed.clear();
+                    bool timbuktu_found = false;
+                    bool coast_found = false;
+                    bool desert_found = false;
+                    int other_cities_count = 0;
+                    for (const HexCoord& hex : route.hexes) {
+                        const int region_id = game->GetRegionForHex(hex);
+                        if (region_id != -1 &&
+                            std::find(regions_crossed.begin(), regions_crossed.end(), region_id) ==
+                                regions_crossed.end()) {
+                            regions_crossed.push_back(region_id);
+                        }
+                        if (const City* city = game->GetCityAt(hex)) {
+                            if (city->id == timbuktu_id) {
+                                timbuktu_found = true;
+                            } else if (city->id == agadez_id || city->id == oudane_id) {
+                                desert_found = true;
+                            } else {
+                                other_cities_count++;
+                            }
+                        }
+                        if (coastal_hexes.count(hex)) coast_found = true;
+                    }
+                    if (!regions_crossed.empty()) {
+                        auto it = rules.score_regions_crossed.find(static_cast<int>(regions_crossed.size()));
+                        if (it != rules.score_regions_crossed.end()) c.regions_crossed_score += it->second;
+                    }
+                    if (timbuktu_found && coast_found && desert_found && other_cities_count >= 2) {
+                        c.timbuktu_to_coast = true;
+                    }
+                }
+            }
+
+            if (score_counters_dirty_ & kGoodsCounters) {
+                for (Player p = 0; p < num_players; ++p) {
+                    PlayerScoreCounters& c = score_counters_[p];
+                    c.unique_rare_goods = 0;
+                    c.rare_goods_total = 0;
+                    c.unique_common_goods = 0;
+                    c.rare_good_regions.clear();
+                    for (int good_id = 0; good_id < kNumGoodTypes; ++good_id) {
+                        const int good_count = rare_goods_[p][good_id];
+                        c.rare_goods_total += good_count;
+                        if (good_count <= 0) continue;
+                        c.unique_rare_goods++;
+                        const int region_id = game->RareGoodRegion(good_id);
+                        if (region_id == -1) continue;
+                        auto slot = std::lower_bound(c.rare_good_regions.begin(),
+                                                     c.rare_good_regions.end(), region_id);
+                        if (slot == c.rare_good_regions.end() || *slot != region_id) {
+                            c.rare_good_regions.insert(slot, region_id);
+                        }
+                    }
+                    for (int good_count : common_goods_[p]) {
+                        if (good_count > 0) c.unique_common_goods++;
+                    }
+                }
+            }
+
+            if (score_counters_dirty_ & kBoardCounters) {
+                const int num_regions = static_cast<int>(game->GetValidRegionIds().size());
+                for (PlayerScoreCounters& c : score_counters_) {
+                    c.centers = 0;
+                    c.centers_per_region.assign(num_regions, 0);
+                }
+                for (int i = 0; i < static_cast<int>(board_.size()); ++i) {
+                    const HexCell& cell = board_[i];
+                    if (cell.center_mask == 0) continue;
+                    const int slot = game->RegionSlotOfHex(i);
+                    for (Player p = 0; p < num_players; ++p) {
+                        if (!cell.HasCenter(GetPlayerColor(p))) continue;
+                        score_counters_[p].centers++;
+                        if (slot >= 0) score_counters_[p].centers_per_region[slot]++;
+                    }
+                }
+            }
+
+            score_counters_dirty_ = 0;
+            return score_counters_;
+        }
+
         absl::optional<std::vector<double>> Mali_BaState::MaybeFinalReturns() const {
             const GameRules& rules = GetGame()->GetRules();
+            const std::vector<PlayerScoreCounters>& counters = ScoreCounters();
 
             for (Player p = 0; p < game_->NumPlayers(); ++p) {
-                PlayerColor player_color = GetPlayerColor(p);
-                int player_route_count = 0;
-                for (const auto& route : trade_routes_) {
-                    if (route.owner == player_color && route.active) {
-                        player_route_count++;
-                    }
-                }
+                const PlayerScoreCounters& c = counters[p];
+                const int player_route_count = c.active_routes;
 
                 // =============================================================
                 // First check end-game *requirements* - they don't trigger the end-game
@@ -956,14 +1175,7 @@ namespace open_spiel
                 // === 1. Having X or more unique rare goods in inventory. If it's set to -1 in the rules,
                 // === this end-game condition does not apply
                 if (rules.end_game_cond_num_rare_goods > 0) {
-                    int unique_rare_count = 0;
-                    for (const auto& [good_name, good_count] : rare_goods_[p]) {
-                        if (good_count > 0) {
-                            unique_rare_count++;
-                        }
-                    }
-                    //LOG_DEBUG("Player ", p, " has ", unique_rare_count, " unique rare goods: [", rare_goods_debug, "]");
-
+                    const int unique_rare_count = c.unique_rare_goods;
                     if (unique_rare_count >= rules.end_game_cond_num_rare_goods) {
                         game_end_triggered_by_player_ = p;
                         game_end_reason_ = "Rare goods victory condition";
@@ -987,47 +1199,18 @@ namespace open_spiel
                     return std::vector<double>();
                 }
 
-                // === 3. Having declared a trade route through Timbuktu that goes to the coast. 
-                // === If it's set to false in the rules, this end-game condition does not apply
-                // Check trade route Desert --> Timbuktu --> Coast condition
-                const std::set<HexCoord>& coastal_hexes = GetGame()->GetCoastalHexes();
-                if (rules.end_game_cond_timbuktu_to_coast && !coastal_hexes.empty()) {
-                    for (const auto& route : trade_routes_) {
-                        if (route.owner == GetPlayerColor(p) && route.active) {
-                            bool timbuktu_found = false;
-                            bool coast_found = false;
-                            bool desert_found = false;
-                            int other_cities_count = 0;
-
-                            for (const auto& hex : route.hexes) {
-                                const City* city = GetGame()->GetCityAt(hex);
-                                if (city) {
-                                    if (city->id == GetCityID("Timbuktu")) {
-                                        timbuktu_found = true;
-                                    // Oudane and Agadez (1 and 9) are the two desert cities
-                                    } else if (city->id == GetCityID("Agadez") || city->id == GetCityID("Oudane")) {
-                                        desert_found = true;
-                                    } else {
-                                        other_cities_count++;
-                                    }
-                                }
+                // === 3. Having declared a trade route through Timbuktu that goes to the coast
+                // (Desert + Timbuktu + two other cities + the coast). If it's set to false in
+                // the rules, this end-game condition does not apply
+                if (rules.end_game_cond_timbuktu_to_coast && !GetGame()->GetCoastalHexes().empty() &&
+                    c.timbuktu_to_coast) {
+                    LOG_DEBUG("GAME END TRIGGER: Player ", p, " connected Timbuktu to the coast via a trade route with at least 3 other cities.");
+                    LOG_DEBUG("Total moves in history: ", history_.size());
+                    // Track who triggered the end and why
+                    game_end_triggered_by_player_ = p;
+                    game_end_reason_ = "Trade route Timbuktu to coast";
 
-                                if (coastal_hexes.count(hex)) {
-                                    coast_found = true;
-                                }
-                            }
-                            // Now check the full condition Desert + Timbuktu + two other cities + the coast
-                            if (timbuktu_found && coast_found && desert_found && other_cities_count >= 2) {
-                                LOG_DEBUG("GAME END TRIGGER: Player ", p, " connected Timbuktu to the coast via a trade route with at least 3 other cities.");
-                                LOG_DEBUG("Total moves in history: ", history_.size());
-                                // Track who triggered the end and why
-                                game_end_triggered_by_player_ = p;
-                                game_end_reason_ = "Trade route Timbuktu to coast";
-
-                                return std::vector<double>();
-                            }
-                        }
-                    } 
+                    return std::vector<double>();
                 }
 
                 // === 4: Having a rare good from each region (or N regions). If it's set to false
@@ -1035,36 +1218,8 @@ namespace open_spiel
                 if (rules.end_game_cond_rare_good_each_region) {
                     // Rare goods from what number of regions is set in the INI file or defaults to 5 
                     int num_regions_needed = rules.end_game_cond_rare_good_num_regions;
-                    // Track which regions we have rare goods from
-                    std::set<int> regions_with_rare_goods;
-                    
-                    // Go through each rare good this player has
-                    for (const auto& [good_name, good_count] : rare_goods_[p]) {
-                        if (good_count > 0) {
-                            // Find which city produces this rare good
-                            for (const auto& city : GetGame()->GetCities()) {
-                                if (city.rare_good == good_name) {
-                                    // Get the region this city is in
-                                    int region_id = GetGame()->GetRegionForHex(city.location);
-                                    if (region_id != -1) {
-                                        regions_with_rare_goods.insert(region_id);
-                                    }
-                                    break; // Found the city, no need to continue searching
-                                }
-                            }
-                        }
-                    }                    
-                    // Count total number of regions in the game
-                    int total_regions = 0;
-                    for (int i = 1; i <= 6; ++i) { // Based on your ini file showing regions 1-6
-                        if (!GetGame()->GetRegionName(i).empty() && 
-                            GetGame()->GetRegionName(i).find("Unknown") == std::string::npos) {
-                            total_regions++;
-                        }
-                    }                    
-                    // LOG_DEBUG("DEBUG: Player ", p, " has rare goods from ", 
-                    //     regions_with_rare_goods.size(), " regions! 🎉");
-                    // LOG_DEBUG("DEBUG: Regions covered: ", regions_with_rare_goods.size(), "/", total_regions);
+                    const std::vector<int>& regions_with_rare_goods = c.rare_good_regions;
+                    const int total_regions = GetGame()->NumNamedRegions();
                     // Check if player has rare goods from all regions
                     if ((int)regions_with_rare_goods.size() >= std::min(total_regions, num_regions_needed)) {
                         LOG_DEBUG("🎉 GAME END TRIGGER: Player ", p, " has rare goods from ", 
@@ -1125,17 +1280,12 @@ namespace open_spiel
             std::vector<double> longest_route_scores(NumPlayers(), 0.0);
             std::vector<double> region_control_scores(NumPlayers(), 0.0);
             std::vector<double> regions_crossed_scores(NumPlayers(), 0.0);
+            const std::vector<PlayerScoreCounters>& counters = ScoreCounters();
 
             // Calculate the scores received for longest route(s)
             std::vector<std::pair<int, Player>> player_route_lengths;
             for (Player p = 0; p < NumPlayers(); ++p) {
-                int longest_single_route = 0;
-                for (const auto& route : trade_routes_) {
-                    if (route.owner == GetPlayerColor(p) && route.active) {
-                        longest_single_route = std::max(longest_single_route, (int)route.hexes.size());
-                    }
-                }
-                player_route_lengths.push_back({longest_single_route, p});
+                player_route_lengths.push_back({counters[p].longest_route, p});
             }
             std::sort(player_route_lengths.rbegin(), player_route_lengths.rend());
             for(int i = 0; i < player_route_lengths.size() && i < rules.score_longest_routes.size(); ++i) {
@@ -1151,21 +1301,11 @@ namespace open_spiel
             }
 
             // Give out scores for region control (most Trad. Centers in the region)
-            std::vector<int> valid_region_ids = GetGame()->GetValidRegionIds();
-            for (int region_id : valid_region_ids) {
+            const int num_regions = static_cast<int>(GetGame()->GetValidRegionIds().size());
+            for (int slot = 0; slot < num_regions; ++slot) {
                 std::vector<std::pair<int, Player>> region_control;
                 for (Player p = 0; p < NumPlayers(); ++p) {
-                    int centers_in_region = 0;
-                    for (const auto& [hex, posts] : trade_posts_locations_) {
-                        if (GetGame()->GetRegionForHex(hex) == region_id) {
-                            for (const auto& post : posts) {
-                                if (post.owner == GetPlayerColor(p) && post.type == TradePostType::kCenter) {
-                                    centers_in_region++;
-                                }
-                            }
-                        }
-                    }
-                    region_control.push_back({centers_in_region, p});
+                    region_control.push_back({counters[p].centers_per_region[slot], p});
                 }
                 std::sort(region_control.rbegin(), region_control.rend());
                 for(int i = 0; i < region_control.size() && i < rules.score_region_control.size(); ++i) {
@@ -1183,34 +1323,15 @@ namespace open_spiel
 
             // Give out score for having the most trading routes
             for (Player p = 0; p < NumPlayers(); ++p) {
-                PlayerColor p_color = GetPlayerColor(p);
+                const PlayerScoreCounters& c = counters[p];
+                route_scores[p] += c.active_route_hexes;
+                if (c.active_routes >= 3) route_scores[p] += 5;
 
-                int active_routes = 0;
-                for (const auto& route : trade_routes_) {
-                    if (route.owner == p_color && route.active) {
-                        active_routes++;
-                        route_scores[p] += route.hexes.size();
-                    }
-                }
-                if (active_routes >= 3) route_scores[p] += 5;
-
-                for (const auto& [name, count] : GetPlayerRareGoods(p)) {
-                    rare_good_scores[p] += count;
-                }
-
-                for (const auto& [hex, posts] : trade_posts_locations_) {
-                    for (const auto& post : posts) {
-                        if (post.owner == p_color && post.type == TradePostType::kCenter) {
-                            center_scores[p] += 2.0;
-                        }
-                    }
-                }
+                rare_good_scores[p] += c.rare_goods_total;
+                center_scores[p] += 2.0 * c.centers;
 
                 // Give out score for sets of unique common goods
-                int unique_common_count = 0;
-                for (const auto& [name, count] : GetPlayerCommonGoods(p)) {
-                    if (count > 0) unique_common_count++;
-                }
+                const int unique_common_count = c.unique_common_goods;
                 if (unique_common_count > 0) {
                     if (unique_common_count >= 12) {
                         common_good_set_scores[p] += rules.score_unique_common_goods_bonus;
@@ -1224,22 +1345,7 @@ namespace open_spiel
                 }
 
                 // Give out score for trading routes crossing regions
-                for (const auto& route : trade_routes_) {
-                    if (route.owner == p_color && route.active) {
-                        std::set<int> regions_crossed;
-                        for (const auto& hex : route.hexes) {
-                            int region_id = GetGame()->GetRegionForHex(hex);
-                            if (region_id != -1) regions_crossed.insert(region_id);
-                        }
-                        int num_regions = regions_crossed.size();
-                        if (num_regions > 0) {
-                            auto it = rules.score_regions_crossed.find(num_regions);
-                            if (it != rules.score_regions_crossed.end()) {
-                                regions_crossed_scores[p] += it->second;
-                            }
-                        }
-                    }
-                }
+                regions_crossed_scores[p] += c.regions_crossed_score;
             }
 
             for (Player p = 0; p < NumPlayers(); ++p) {
@@ -1420,34 +1526,25 @@ namespace open_spiel
                     break;
                 }
                 case ActionType::kIncome: {
-                    SPIEL_CHECK_FALSE(undo_stack_.empty());
-                    const StateSnapshot& prev_state = undo_stack_.back();
-
                     // Reward for acquiring a new unique common good
-                    const auto& common_before = prev_state.common_goods_[player_who_moved];
-                    const auto& common_after = common_goods_[player_who_moved];
-                    for (const auto& [good, count_after] : common_after) {
-                        int count_before = common_before.count(good) ? common_before.at(good) : 0;
-                        if (count_before == 0 && count_after > 0) {
+                    const GoodCounts common_before =
+                        GoodsBeforeLastAction(player_who_moved, /*rare=*/false);
+                    const GoodCounts& common_after = common_goods_[player_who_moved];
+                    for (int good = 0; good < kNumGoodTypes; ++good) {
+                        if (common_before[good] == 0 && common_after[good] > 0) {
                             rewards[player_who_moved] += training_params.new_common_good_reward;
                         }
                     }
 
                     // Reward for acquiring a rare good from a NEW region
-                    const auto& rare_before = prev_state.rare_goods_[player_who_moved];
-                    const auto& rare_after = rare_goods_[player_who_moved];
+                    const GoodCounts rare_before =
+                        GoodsBeforeLastAction(player_who_moved, /*rare=*/true);
+                    const GoodCounts& rare_after = rare_goods_[player_who_moved];
 
-                    auto get_regions_for_goods = [&](const std::map<std::string, int>& goods_map) {
+                    auto get_regions_for_goods = [&](const GoodCounts& goods) {
                         std::set<int> regions;
-                        for (const auto& [good, count] : goods_map) {
-                            if (count > 0) {
-                                for (const auto& city : GetGame()->GetCities()) {
-                                    if (city.rare_good == good) {
-                                        regions.insert(GetGame()->GetRegionForHex(city.location));
-                                        break;
-                                    }
-                                }
-                            }
+                        for (int good = 0; good < kNumGoodTypes; ++good) {
+                            if (goods[good] > 0) regions.insert(GetGame()->RareGoodRegion(good));
                         }
                         return regions;
                     };
@@ -1455,17 +1552,9 @@ namespace open_spiel
                     std::set<int> regions_before = get_regions_for_goods(rare_before);
                     std::set<int> processed_new_regions;
 
-                    for (const auto& [good, count_after] : rare_after) {
-                        int count_before = rare_before.count(good) ? rare_before.at(good) : 0;
-                        if (count_after > count_before) {
-                            int new_region = -1;
-                            for (const auto& city : GetGame()->GetCities()) {
-                                if (city.rare_good == good) {
-                                    new_region = GetGame()->GetRegionForHex(city.location);
-                                    break;
-                                }
-                            }
-                            
+                    for (int good = 0; good < kNumGoodTypes; ++good) {
+                        if (rare_after[good] > rare_before[good]) {
+                            const int new_region = GetGame()->RareGoodRegion(good);
                             if (new_region != -1 && regions_before.find(new_region) == regions_before.end() && processed_new_regions.find(new_region) == processed_new_regions.end()) {
                                 rewards[player_who_moved] += training_params.new_rare_region_reward;
                                 processed_new_regions.insert(new_region);
@@ -1482,40 +1571,113 @@ namespace open_spiel
         }
 
 
+        // The board planes come from the incremental cache; only the player and
+        // goods planes are written per call.
         void Mali_BaState::ObservationTensor(Player player, absl::Span<float> values) const {
-            // 1. Get the game object.
-            std::shared_ptr<const Game> game = State::GetGame();
-            SPIEL_CHECK_TRUE(game != nullptr);
-            
-            // 2. Create the observer.
-            std::shared_ptr<Observer> observer = game->MakeObserver(absl::nullopt, {});
-            SPIEL_CHECK_TRUE(observer != nullptr);
-
-            // 3. Use our local allocator to get the tensor from the observer.
-            VectorTensorAllocator allocator;
-            observer->WriteTensor(*this, player, &allocator);
-
-            // 4. Copy the data from the allocator's buffer into the provided span.
-            const std::vector<float>& tensor_data = allocator.GetBuffer();
-            SPIEL_CHECK_EQ(tensor_data.size(), values.size());
-            std::copy(tensor_data.begin(), tensor_data.end(), values.begin());
+            MALI_BA_PERF_SCOPE(kObservation);
+            SyncObservationPlanes();
+            SPIEL_CHECK_GE(values.size(), obs_board_planes_->size());
+            std::copy(obs_board_planes_->begin(), obs_board_planes_->end(), values.begin());
+            GetGame()->GetDefaultObserver().WritePlayerPlanes(*this, player, values);
+        }
+
+        // Brings the cached board planes up to date: a full build the first time,
+        // then a rewrite of just the hexes changed since (by actions or undo).
+        void Mali_BaState::SyncObservationPlanes() const {
+            const MaliBaObserver& observer = GetGame()->GetDefaultObserver();
+            if (!obs_board_planes_ || obs_dirty_cells_.size() > board_.size()) {
+                const std::vector<int>& shape = GetGame()->GetObservationTensorShape();
+                obs_board_planes_ = std::make_shared<std::vector<float>>(
+                    static_cast<size_t>(kNumObservationBoardPlanes) * shape[1] * shape[2]);
+                observer.WriteBoardPlanes(*this, absl::MakeSpan(*obs_board_planes_));
+                obs_dirty_cells_.clear();
+                return;
+            }
+            if (obs_dirty_cells_.empty()) return;
+            if (obs_board_planes_.use_count() > 1) {
+                obs_board_planes_ = std::make_shared<std::vector<float>>(*obs_board_planes_);
+            }
+            for (int index : obs_dirty_cells_) {
+                observer.WriteBoardCell(*this, index, absl::MakeSpan(*obs_board_planes_));
+            }
+            obs_dirty_cells_.clear();
+        }
+
+        // Folds the cells written since the last call back into board_hash_ and
+        // recomputes any part flagged stale.
+        void Mali_BaState::SyncHashKey() const {
+            if (hash_stale_ & kBoardHash) {
+                board_hash_ = 0;
+                for (int i = 0; i < static_cast<int>(board_.size()); ++i) {
+                    board_hash_ ^= ZobristCellKey(i, board_[i]);
+                }
+            } else {
+                for (int index : hash_pending_cells_) {
+                    board_hash_ ^= ZobristCellKey(index, board_[index]);
+                }
+            }
+            hash_pending_cells_.clear();
+
+            if (hash_stale_ & kGoodsHash) {
+                goods_hash_ = 0;
+                for (Player p = 0; p < static_cast<int>(common_goods_.size()); ++p) {
+                    for (int good = 0; good < kNumGoodTypes; ++good) {
+                        goods_hash_ ^= ZobristGoodKey(false, p, good, common_goods_[p][good]);
+                    }
+                }
+                for (Player p = 0; p < static_cast<int>(rare_goods_.size()); ++p) {
+                    for (int good = 0; good < kNumGoodTypes; ++good) {
+                        goods_hash_ ^= ZobristGoodKey(true, p, good, rare_goods_[p][good]);
+                    }
+                }
+            }
+
+            if (hash_stale_ & kRouteHash) {
+                route_hash_ = 0;
+                for (const TradeRoute& route : trade_routes_) route_hash_ ^= ZobristRouteKey(route);
+            }
+            hash_stale_ = 0;
+        }
+
+        uint64_t Mali_BaState::HashKey() const {
+            SyncHashKey();
+            // The turn and mid-turn scalars are few; mix them in directly.
+            uint64_t turn = ZobristKey(ZobristDomain::kTurn, static_cast<uint64_t>(current_phase_),
+                                       static_cast<uint64_t>(current_player_id_),
+                                       pending_route_declaration_ ? 1 : 0);
+            turn = ZobristMix(turn ^ ZobristHexKey(current_mancala_hex_));
+            turn = ZobristMix(turn ^ ZobristHexKey(last_action_hex_));
+            for (MeepleColor meeple : meeples_in_hand_) {
+                turn = ZobristMix(turn ^ static_cast<uint64_t>(meeple));
+            }
+            turn = ZobristMix(turn ^ meeples_in_hand_.size());
+            for (const HexCoord& hex : current_mancala_path_) {
+                turn = ZobristMix(turn ^ ZobristHexKey(hex));
+            }
+            for (int supply : player_posts_supply_) {
+                turn = ZobristMix(turn ^ static_cast<uint32_t>(supply));
+            }
+            return board_hash_ ^ goods_hash_ ^ route_hash_ ^ turn;
         }
 
         void Mali_BaState::ClearCaches() {
-            cached_legal_actions_result_ = absl::nullopt;
+            cached_legal_actions_result_.reset();
+            cached_trade_routes_.reset();
+            route_connectivity_.reset();
             // cached_legal_actions_ = absl::nullopt;
             // cached_legal_move_structs_ = absl::nullopt;
         }
 
+        // Removes the meeple at `index` in the hex's canonical (ascending color) order.
         void Mali_BaState::RemoveMeepleAt(const HexCoord& hex, int index) {
-            auto it = hex_meeples_.find(hex);
-            if (it == hex_meeples_.end()) {
+            HexCell* cell = MutableCellAt(hex);
+            if (cell == nullptr || cell->num_meeples == 0) {
                 LOG_WARN("Attempted to remove meeple from hex ", hex.ToString(), " which has no meeples.");
                 return;
             }
-            auto& meeples = it->second;
-            if (index >= 0 && index < meeples.size()) {
-                meeples.erase(meeples.begin() + index);
+            MeepleColor color = cell->MeepleAt(index);
+            if (color != MeepleColor::kEmpty) {
+                cell->RemoveMeeple(color);
             } else {
                 LOG_WARN("Attempted to remove meeple at invalid index ", index, " from hex ", hex.ToString());
             }
@@ -1524,8 +1686,14 @@ namespace open_spiel
         std::string Mali_BaState::PlayRandomMoveAndSerialize() {
             if (IsTerminal()) {
                 LOG_WARN("PlayRandomMoveAndSerialize: Called on a terminal state.");
-                return Serialize();
+            } else {
+                PlayRandomMove();
             }
+            return Serialize();
+        }
+
+        Action Mali_BaState::PlayRandomMove() {
+            if (IsTerminal()) return kInvalidAction;
 
             Action chosen_action = kInvalidAction;
 
@@ -1561,15 +1729,15 @@ namespace open_spiel
                     LOG_WARN("Action selection returned kInvalidAction, falling back to uniform random.");
                     std::vector<Action> legal_actions = LegalActions();
                     if (legal_actions.empty()) {
-                        SpielFatalError("PlayRandomMoveAndSerialize: Fallback failed, no legal actions.");
+                        SpielFatalError("PlayRandomMove: Fallback failed, no legal actions.");
                     }
                     std::uniform_int_distribution<int> dist(0, legal_actions.size() - 1);
-                    chosen_action = legal_actions[dist(rng_)];
+                    chosen_action = legal_actions[dist(GetRNG())];
                 }
             }
 
             ApplyAction(chosen_action);
-            return Serialize();
+            return chosen_action;
         }
 
     } // namespace mali_ba
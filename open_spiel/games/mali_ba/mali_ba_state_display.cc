@@ -202,14 +202,14 @@ std::string Mali_BaState::ToString() const {
         
         std::vector<std::string> common_items;
         // Use a map to sort goods for consistent output
-        std::map<std::string, int> sorted_common(GetPlayerCommonGoods(p).begin(), GetPlayerCommonGoods(p).end());
+        std::map<std::string, int> sorted_common = GoodCountsToMap(GetPlayerCommonGoods(p), /*rare=*/false);
         for (const auto& [name, count] : sorted_common) {
             common_items.push_back(absl::StrCat(name, ":", count));
         }
         absl::StrAppend(&out, "  Common: {", absl::StrJoin(common_items, ", "), "}\n");
         
         std::vector<std::string> rare_items;
-        std::map<std::string, int> sorted_rare(GetPlayerRareGoods(p).begin(), GetPlayerRareGoods(p).end());
+        std::map<std::string, int> sorted_rare = GoodCountsToMap(GetPlayerRareGoods(p), /*rare=*/true);
         for (const auto& [name, count] : sorted_rare) {
             rare_items.push_back(absl::StrCat(name, ":", count));
         }
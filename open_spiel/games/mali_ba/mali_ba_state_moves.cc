@@ -4,6 +4,7 @@
 #include "open_spiel/games/mali_ba/mali_ba_state.h"
 #include "open_spiel/games/mali_ba/mali_ba_game.h"
 #include "open_spiel/games/mali_ba/mali_ba_common.h"
+#include "open_spiel/games/mali_ba/mali_ba_perf.h"
 #include "open_spiel/games/mali_ba/hex_grid.h"
 #include "open_spiel/abseil-cpp/absl/strings/str_split.h"
 #include "open_spiel/abseil-cpp/absl/strings/numbers.h"
@@ -11,7 +12,7 @@
 #include <set>
 #include <vector>
 #include <iostream>
-#include <queue>
+#include <algorithm>
 // Include the nlohmann/json header
 #include "json.hpp"
 // For convenience
@@ -21,13 +22,6 @@ namespace open_spiel
 {
     namespace mali_ba
     {
-        // Static member definitions for move logging
-        std::unique_ptr<std::ofstream> Mali_BaState::move_log_file_ = nullptr;
-        std::string Mali_BaState::move_log_filename_ = "";
-        int Mali_BaState::move_count_ = 0;
-        bool Mali_BaState::move_logging_enabled_ = false;
-        bool Mali_BaState::move_logging_initialized_ = false;
-
         Action Mali_BaState::MoveToAction(const Move& move) const {
             int num_hexes = GetGame()->NumHexes();
             Action action = kInvalidAction;
@@ -131,9 +125,10 @@ namespace open_spiel
             if (action >= kTradeRouteCreateBase) {
                 move.type = ActionType::kTradeRouteCreate;
                 int route_index = action - kTradeRouteCreateBase;
-                auto heuristic_routes = GenerateTradeRouteMoves();
-                if (route_index >= 0 && route_index < heuristic_routes.size()) {
-                    move.path = heuristic_routes[route_index].path;
+                thread_local std::vector<PackedMove> heuristic_routes;
+                GenerateTradeRouteMoves(&heuristic_routes);
+                if (route_index >= 0 && route_index < static_cast<int>(heuristic_routes.size())) {
+                    move.path = UnpackMove(heuristic_routes[route_index]).path;
                 } else {
                     move.type = ActionType::kInvalid;
                 }
@@ -152,14 +147,11 @@ namespace open_spiel
                     
                     // --- THIS IS THE CORRECTED MANCALA RECONSTRUCTION ---
                     if (move.declares_trade_route) {
-                        Mali_BaState temp_state = *this;
-                        
-                        // Simulate the primary action using the actual game function.
-                        // This ensures player_posts_supply_ is correctly decremented.
-                        temp_state.AddTradingPost(move.path[0], move.player, TradePostType::kPost);
-                        
-                        // Now find the route in this correctly simulated future state.
-                        auto routes = temp_state.FindPossibleTradeRoutes(move.player, true, move.path[0], 5);
+                        // Simulate the primary action on a view of the state, including the
+                        // post-supply change, and find the route there.
+                        Mali_BaWhatIf what_if(*this);
+                        what_if.AddTradingPost(move.path[0], move.player, TradePostType::kPost);
+                        auto routes = what_if.FindPossibleTradeRoutes(move.player, true, &move.path[0], 5);
                         if (!routes.empty()) {
                             std::sort(routes.begin(), routes.end(), [](const auto& a, const auto& b){ return a.size() > b.size(); });
                             move.trade_route_path = routes[0];
@@ -181,13 +173,10 @@ namespace open_spiel
                     move.action_string = absl::StrCat("upgrade ", move.start_hex.ToString(), "|generic_payment");
 
                     if (move.declares_trade_route) {
-                        Mali_BaState temp_state = *this;
-                        
-                        // Use the actual UpgradeTradingPost method on the temporary state.
-                        temp_state.UpgradeTradingPost(move.start_hex, move.player);
-
-                        // Now that the temp state is correct, find the route.
-                        auto routes = temp_state.FindPossibleTradeRoutes(move.player, true, move.start_hex, 5);
+                        // Simulate the upgrade on a view of the state and find the route there.
+                        Mali_BaWhatIf what_if(*this);
+                        what_if.UpgradeTradingPost(move.start_hex, move.player);
+                        auto routes = what_if.FindPossibleTradeRoutes(move.player, true, &move.start_hex, 5);
                         if (!routes.empty()) {
                             std::sort(routes.begin(), routes.end(), [](const auto& a, const auto& b){ return a.size() > b.size(); });
                             move.trade_route_path = routes[0];
@@ -244,263 +233,266 @@ namespace open_spiel
         // Heuristic functions that assign weights and then pick a 'good' move to play
         // -----------------------------------------------------------
         // Private helper to pre-calculate context for the heuristic.
-        Mali_BaState::HeuristicContext Mali_BaState::CreateHeuristicContext() const {
-            HeuristicContext context;
-            context.posts_in_supply = player_posts_supply_[current_player_id_];
-
-            for (const auto& [hex, posts] : trade_posts_locations_) {
-                for (const auto& post : posts) {
-                    if (post.owner == current_player_color_ && post.type == TradePostType::kCenter) {
-                        context.existing_centers.push_back(hex);
-                        int region_id = GetGame()->GetRegionForHex(hex);
-                        if (region_id != -1) {
-                            context.existing_center_regions.insert(region_id);
-                        }
-                        break; // Only need to find one center per hex
-                    }
+        void Mali_BaState::FillHeuristicContext(HeuristicContext* context) const {
+            const Mali_BaGame* game = GetGame();
+            context->posts_in_supply = player_posts_supply_[current_player_id_];
+            context->existing_centers.clear();
+            context->existing_center_regions.clear();
+
+            for (int i = 0; i < static_cast<int>(board_.size()); ++i) {
+                if (!board_[i].HasCenter(current_player_color_)) continue;
+                context->existing_centers.push_back(i);
+                const int region_id = game->RegionOfHex(i);
+                if (region_id != -1 &&
+                    std::find(context->existing_center_regions.begin(),
+                              context->existing_center_regions.end(),
+                              region_id) == context->existing_center_regions.end()) {
+                    context->existing_center_regions.push_back(region_id);
                 }
             }
-            return context;
         }
 
-        // Private helper containing the core, once-duplicated logic for weighting a single move.
-        double Mali_BaState::CalculateHeuristicWeightForAction(
-            const Move& move,
-            const LegalActionsResult& legal_actions_result,
+        // Private helper containing the core logic for weighting a single move.
+        // Decodes the action the way ActionToMove() does; ids that would decode
+        // to kInvalid keep the neutral weight of 1.0.
+        double Mali_BaState::HeuristicWeightForAction(
+            Action action,
+            const LegalActionCounts& counts,
             const HeuristicContext& context) const {
 
-            const GameRules& rules = GetGame()->GetRules();
-            const auto& weights = GetGame()->GetHeuristicWeights();
+            const Mali_BaGame* game = GetGame();
+            const GameRules& rules = game->GetRules();
+            const auto& weights = game->GetHeuristicWeights();
+            const int num_hexes = game->NumHexes();
             double current_weight = 1.0;
 
-            // Base weight from move type
-            switch (move.type) {
-                case ActionType::kPass:             current_weight = weights.weight_pass; break;
-                case ActionType::kMancala:          current_weight = weights.weight_mancala; break;
-                case ActionType::kPlaceTCenter:     current_weight = weights.weight_upgrade; break;
-                case ActionType::kIncome:           current_weight = weights.weight_income; break;
-                case ActionType::kPlaceToken:       current_weight = weights.weight_place_token; break;
-                case ActionType::kTradeRouteCreate: current_weight = weights.weight_trade_route_create; break;
-                default: break;
-            }
-
-            // Apply bonuses and normalizations
-            if (move.type == ActionType::kMancala && !move.path.empty()) {
-                const HexCoord& start_hex = move.start_hex;
-                const HexCoord& final_hex = move.path.back();
-                if (start_hex.Distance(final_hex) > 3) current_weight += weights.bonus_mancala_long_distance;
-                if (GetMeeplesAt(final_hex).size() > 3 || GetMeeplesAt(start_hex).size() > 5) 
-                    current_weight += weights.bonus_mancala_meeple_density;
-                if (move.place_trading_post) {
-                    current_weight += weights.bonus4;
-                    if (GetGame()->GetCityAt(final_hex) != nullptr) current_weight += weights.bonus_mancala_city_end;
+            bool place_trading_post = false;
+            if (action >= kDeclareRouteFlag) action -= kDeclareRouteFlag;
+            if (action >= kPlacePostFlag) {
+                place_trading_post = true;
+                action -= kPlacePostFlag;
+            }
+
+            if (action >= kPlaceTokenActionBase && action < kUpgradeActionBase) {
+                if (action - kPlaceTokenActionBase < num_hexes) current_weight = weights.weight_place_token;
+            } else if (action == kPassAction) {
+                current_weight = weights.weight_pass;
+            } else if (action == kIncomeAction) {
+                current_weight = weights.weight_income;
+                if (counts.income_moves > 0) {
+                    current_weight *= static_cast<double>(counts.mancala_moves) / counts.income_moves;
                 }
-            } else if (move.type == ActionType::kPlaceTCenter) {
-                if (legal_actions_result.counts.upgrade_moves > 0) {
-                    current_weight *= static_cast<double>(legal_actions_result.counts.mancala_moves) / legal_actions_result.counts.upgrade_moves;
+            } else if (action >= kTradeRouteCreateBase) {
+                // Legal route ids always index an existing route move.
+                current_weight = weights.weight_trade_route_create;
+            } else if (action >= kMancalaActionBase) {
+                const int relative_action = action - kMancalaActionBase;
+                const int start_index = relative_action / kMaxHexes;
+                const int final_index = relative_action % kMaxHexes;
+                if (start_index < num_hexes && final_index < num_hexes) {
+                    current_weight = weights.weight_mancala;
+                    if (game->CubeDistance(start_index, final_index) > 3) {
+                        current_weight += weights.bonus_mancala_long_distance;
+                    }
+                    if (board_[final_index].num_meeples > 3 || board_[start_index].num_meeples > 5) {
+                        current_weight += weights.bonus_mancala_meeple_density;
+                    }
+                    if (place_trading_post) {
+                        current_weight += weights.bonus4;
+                        if (game->CityIdAtIndex(final_index) >= 0) current_weight += weights.bonus_mancala_city_end;
+                    }
                 }
-                if (rules.posts_per_player != kUnlimitedPosts && context.posts_in_supply < 2) current_weight += weights.bonus3;
+            } else if (action >= kUpgradeActionBase) {
+                const int upgrade_index = action - kUpgradeActionBase;
+                if (upgrade_index < num_hexes) {
+                    current_weight = weights.weight_upgrade;
+                    if (counts.upgrade_moves > 0) {
+                        current_weight *= static_cast<double>(counts.mancala_moves) / counts.upgrade_moves;
+                    }
+                    if (rules.posts_per_player != kUnlimitedPosts && context.posts_in_supply < 2) current_weight += weights.bonus3;
 
-                const HexCoord& upgrade_hex = move.start_hex;
-                if (!context.existing_centers.empty()) {
-                    int min_dist = 999;
-                    for (const auto& center_hex : context.existing_centers) {
-                        min_dist = std::min(min_dist, upgrade_hex.Distance(center_hex));
+                    if (!context.existing_centers.empty()) {
+                        int min_dist = 999;
+                        for (int center_index : context.existing_centers) {
+                            min_dist = std::min(min_dist, game->CubeDistance(upgrade_index, center_index));
+                        }
+                        current_weight += min_dist * weights.bonus_upgrade_diversity_factor;
+                    } else {
+                        current_weight += 5 * weights.bonus_upgrade_diversity_factor;
                     }
-                    current_weight += min_dist * weights.bonus_upgrade_diversity_factor;
-                } else {
-                    current_weight += 5 * weights.bonus_upgrade_diversity_factor;
-                }
 
-                int upgrade_region = GetGame()->GetRegionForHex(upgrade_hex);
-                if (upgrade_region != -1 && context.existing_center_regions.find(upgrade_region) == context.existing_center_regions.end()) {
-                    current_weight += weights.bonus_upgrade_new_region;
-                }
-            } else if (move.type == ActionType::kIncome) {
-                if (legal_actions_result.counts.income_moves > 0) {
-                    current_weight *= static_cast<double>(legal_actions_result.counts.mancala_moves) / legal_actions_result.counts.income_moves;
+                    const int upgrade_region = game->RegionOfHex(upgrade_index);
+                    if (upgrade_region != -1 &&
+                        std::find(context.existing_center_regions.begin(),
+                                  context.existing_center_regions.end(),
+                                  upgrade_region) == context.existing_center_regions.end()) {
+                        current_weight += weights.bonus_upgrade_new_region;
+                    }
                 }
             }
 
             return std::max(0.0, current_weight);
         }
 
-
-        // Public method to get all weights associated with heuristic move choice
-        std::map<Action, double> Mali_BaState::GetHeuristicActionWeights() const {
-            std::map<Action, double> action_weights;
+        absl::Span<const Action> Mali_BaState::HeuristicActionWeights(std::vector<double>* weights) const {
+            MALI_BA_PERF_SCOPE(kHeuristicWeights);
+            weights->clear();
             if (IsTerminal() || IsChanceNode() || current_phase_ != Phase::kPlay) {
-                return action_weights;
+                return {};
             }
 
-            const LegalActionsResult result = GetLegalActionsAndCounts();
-            const HeuristicContext context = CreateHeuristicContext();
-
-            for (Action action : result.actions) {
-                Move move = ActionToMove(action);
-                action_weights[action] = CalculateHeuristicWeightForAction(move, result, context);
+            const LegalActionsResult& result = CachedLegalActions();
+            thread_local HeuristicContext context;
+            FillHeuristicContext(&context);
+            weights->resize(result.actions.size());
+            for (size_t i = 0; i < result.actions.size(); ++i) {
+                (*weights)[i] = HeuristicWeightForAction(result.actions[i], result.counts, context);
             }
+            return result.actions;
+        }
 
+        // Public method to get all weights associated with heuristic move choice
+        std::map<Action, double> Mali_BaState::GetHeuristicActionWeights() const {
+            std::vector<double> weights;
+            absl::Span<const Action> actions = HeuristicActionWeights(&weights);
+            std::map<Action, double> action_weights;
+            for (size_t i = 0; i < actions.size(); ++i) action_weights[actions[i]] = weights[i];
             return action_weights;
         }
 
-        // Public method to select one action using the heuristic
+        // Public method to select one action using the heuristic. One uniform
+        // draw over the running sum of the weights picks the action.
         Action Mali_BaState::SelectHeuristicRandomAction() const {
+            // Outside the play phase every action weighs the same; drawing by
+            // category picks what a uniform pick from LegalActions() would,
+            // without building the list.
             if (current_phase_ != Phase::kPlay) {
-                std::vector<Action> actions = LegalActions();
-                if (actions.empty()) return kInvalidAction;
-                std::uniform_int_distribution<> dist(0, actions.size() - 1);
-                return actions[dist(rng_)];
+                return SampleLegalAction(CountLegalActionCategories());
             }
 
-            // Delegate the complex calculation to the other public method
-            std::map<Action, double> action_weights_map = GetHeuristicActionWeights();
-
-            if (action_weights_map.empty()) {
+            thread_local std::vector<double> weights;
+            absl::Span<const Action> actions = HeuristicActionWeights(&weights);
+            if (actions.empty()) {
                 LOG_WARN("SelectHeuristicRandomAction: No legal actions found.");
                 return kInvalidAction;
             }
 
-            // Convert map to parallel vectors for discrete_distribution
-            std::vector<Action> actions;
-            std::vector<double> weights;
-            actions.reserve(action_weights_map.size());
-            weights.reserve(action_weights_map.size());
-
-            for (const auto& [action, weight] : action_weights_map) {
-                actions.push_back(action);
-                weights.push_back(weight);
+            double total = 0.0;
+            bool any_positive = false;
+            for (double weight : weights) {
+                total += weight;
+                any_positive |= weight > 1e-6;
             }
-            
             // Fallback if all weights are zero
-            if (std::all_of(weights.begin(), weights.end(), [](double w) { return w <= 1e-6; })) {
+            if (!any_positive) {
                 std::uniform_int_distribution<> dist(0, actions.size() - 1);
-                return actions[dist(rng_)];
+                return actions[dist(GetRNG())];
             }
 
-            // Select an action based on the calculated weights
-            std::discrete_distribution<> dist(weights.begin(), weights.end());
-            int chosen_index = dist(rng_);
+            double draw = std::uniform_real_distribution<double>(0.0, total)(GetRNG());
+            size_t chosen_index = 0;
+            for (size_t i = 0; i < weights.size(); ++i) {
+                if (weights[i] <= 0.0) continue;
+                chosen_index = i;  // Rounding can leave draw >= 0 at the end; keep the last candidate
+                draw -= weights[i];
+                if (draw < 0.0) break;
+            }
 
             LOG_DEBUG("Player ", current_player_id_, " chooses action ", actions[chosen_index], ", ", ActionToString(current_player_id_, actions[chosen_index]));
             return actions[chosen_index];
         }
 
+        Action Mali_BaState::SelectTrainingAwareRandomAction() {
+            const LegalActionCategoryCounts counts = CountLegalActionCategories();
+            LegalActionCategoryCounts non_empty;
+            for (int c = 0; c < kNumLegalActionCategories; ++c) non_empty.counts[c] = counts.counts[c] > 0 ? 1 : 0;
+            if (non_empty.Total() == 0) return kInvalidAction;
+
+            int n = std::uniform_int_distribution<>(0, non_empty.Total() - 1)(GetRNG());
+            for (int c = 0; c < kNumLegalActionCategories; ++c) {
+                if (non_empty.counts[c] == 0) continue;
+                if (n-- == 0) {
+                    std::uniform_int_distribution<> dist(0, counts.counts[c] - 1);
+                    return LegalActionInCategory(static_cast<LegalActionCategory>(c), dist(GetRNG()));
+                }
+            }
+            return kInvalidAction;
+        }
+
         std::vector<Move> Mali_BaState::GeneratePlaceTokenMoves() const
         {
+            thread_local std::vector<PackedMove> packed;
+            GeneratePlaceTokenMoves(&packed);
+            return UnpackMoves(packed);
+        }
+
+        void Mali_BaState::GeneratePlaceTokenMoves(std::vector<PackedMove>* moves) const
+        {
+            MALI_BA_PERF_SCOPE(kPlaceTokenMoves);
             // This function is now only used for reference and is not part of the main LegalActions path.
             // It can be removed if not needed elsewhere.
-            std::vector<Move> moves;
-            for (const auto &hex : GetGame()->GetValidHexes())
-            {
-                if (player_token_locations_.count(hex))
-                    continue;
-                bool is_city = false;
-                for (const auto &city : GetGame()->GetCities())
-                {
-                    if (city.location == hex)
-                    {
-                        is_city = true;
-                        break;
-                    }
-                }
-                if (is_city)
-                    continue;
-
-                moves.push_back({.player = current_player_color_,
-                                       .type = ActionType::kPlaceToken,
-                                       .start_hex = hex});
-            }
-            return moves;
+            moves->clear();
+            const Mali_BaGame *game = GetGame();
+            HexMask open_hexes = game->GetBoardKernels().TokenFreeHexes(board_.cells());
+            open_hexes.Remove(game->CityHexes());
+            open_hexes.ForEach([&](int hex_index) {
+                PackedMove move;
+                move.player = static_cast<int8_t>(current_player_color_);
+                move.type = static_cast<int8_t>(ActionType::kPlaceToken);
+                move.start = static_cast<int8_t>(hex_index);
+                moves->push_back(move);
+            });
         }
 
         std::vector<Move> Mali_BaState::GenerateTradePostUpgradeMoves() const {
+            thread_local std::vector<PackedMove> packed;
+            GenerateTradePostUpgradeMoves(&packed);
+            return UnpackMoves(packed);
+        }
+
+        void Mali_BaState::GenerateTradePostUpgradeMoves(std::vector<PackedMove>* moves) const {
+            MALI_BA_PERF_SCOPE(kUpgradeMoves);
             LOG_DEBUG("Entering GenerateTradePostUpgradeMoves()");
-            std::vector<Move> moves;
+            moves->clear();
             Player player_id = current_player_id_;
             PlayerColor player_color = GetPlayerColor(player_id);
 
             const GameRules &rules = GetGame()->GetRules();
 
             if (!HasSufficientResourcesForUpgrade(player_id)) {
-                return moves;
+                return;
             }
 
-            for (const auto &hex_to_upgrade : GetGame()->GetValidHexes()) {
-                const auto &posts = GetTradePostsAt(hex_to_upgrade);
-                bool player_has_post_here = false;
-                for (const auto &post : posts) {
-                    if (post.owner == player_color && post.type == TradePostType::kPost) {
-                        player_has_post_here = true;
-                        break;
+            const HexMask posts = GetGame()->GetBoardKernels().PostHexes(board_.cells(), player_color);
+            posts.ForEach([&](int hex_index) {
+                const HexCoord hex_to_upgrade = GetGame()->IndexToCoord(hex_index);
+
+                PackedMove basic_upgrade_move;
+                basic_upgrade_move.type = static_cast<int8_t>(ActionType::kPlaceTCenter);
+                basic_upgrade_move.start = static_cast<int8_t>(hex_index);
+                basic_upgrade_move.player = static_cast<int8_t>(player_color);
+                moves->push_back(basic_upgrade_move);
+
+                if (rules.free_action_trade_routes) {
+                    Mali_BaWhatIf what_if(*this);
+                    what_if.UpgradeTradingPost(hex_to_upgrade, player_color);
+                    auto potential_routes = what_if.FindPossibleTradeRoutes(player_color, true, &hex_to_upgrade, 5);
+                    // If we're training the AI, only get a subset of moves for efficiency
+                    if (GetGame()->GetPruneMovesForAI() && !potential_routes.empty()) {
+                        // --- AI/TRAINING MODE: Heuristic Pruning (Single Best Route) ---
+                        std::sort(potential_routes.begin(), potential_routes.end(), 
+                            [](const auto& a, const auto& b){ return a.size() > b.size(); });
+                        potential_routes.resize(1);
                     }
-                }
-
-                if (player_has_post_here) {
-                    Move basic_upgrade_move;
-                    basic_upgrade_move.type = ActionType::kPlaceTCenter;
-                    basic_upgrade_move.start_hex = hex_to_upgrade;
-                    basic_upgrade_move.player = player_color;
-                    basic_upgrade_move.action_string = absl::StrCat("upgrade ", hex_to_upgrade.ToString(), "|generic_payment");
-                    moves.push_back(basic_upgrade_move);
-
-                    if (rules.free_action_trade_routes) {
-                        // If we're training the AI, only get a subset of moves for efficiency
-                        if (GetGame()->GetPruneMovesForAI()) {
-                            // --- AI/TRAINING MODE: Heuristic Pruning (Single Best Route) ---
-                            Mali_BaState temp_state = *this;
-                            temp_state.UpgradeTradingPost(hex_to_upgrade, player_color);
-                            auto potential_routes = temp_state.FindPossibleTradeRoutes(player_color, true, hex_to_upgrade, 5);
-                            if (!potential_routes.empty()) {
-                                std::sort(potential_routes.begin(), potential_routes.end(), 
-                                    [](const auto& a, const auto& b){ return a.size() > b.size(); });
-                                Move compound_move = basic_upgrade_move;
-                                compound_move.declares_trade_route = true;
-                                compound_move.trade_route_path = potential_routes[0];
-                                moves.push_back(compound_move);
-                            }
-                        } else {
-                            // --- GUI MODE: Exhaustive Generation (All Routes) ---
-                            std::vector<HexCoord> available_centers;
-                            for (const auto& [hex, current_posts] : trade_posts_locations_) {
-                                for (const auto& current_post : current_posts) {
-                                    if (current_post.owner == player_color && current_post.type == TradePostType::kCenter) {
-                                        available_centers.push_back(hex);
-                                        break;
-                                    }
-                                }
-                            }
-                            available_centers.push_back(hex_to_upgrade);
-                            std::sort(available_centers.begin(), available_centers.end());
-                            available_centers.erase(std::unique(available_centers.begin(), available_centers.end()), available_centers.end());
-
-                            if (available_centers.size() >= rules.min_hexes_for_trade_route) {
-                                int min_len = rules.min_hexes_for_trade_route;
-                                int max_len = std::min({(int)available_centers.size(), 5});
-                                for (int k = min_len; k <= max_len; ++k) {
-                                    std::vector<bool> v(available_centers.size());
-                                    std::fill(v.begin() + v.size() - k, v.end(), true);
-                                    do {
-                                        std::vector<HexCoord> route_combo;
-                                        for (int i = 0; i < available_centers.size(); ++i) {
-                                            if (v[i]) route_combo.push_back(available_centers[i]);
-                                        }
-                                        if (std::find(route_combo.begin(), route_combo.end(), hex_to_upgrade) != route_combo.end()) {
-                                            if (IsValidCompoundUpgradeAndRoute(hex_to_upgrade, route_combo, player_color)) {
-                                                Move compound_move = basic_upgrade_move;
-                                                compound_move.declares_trade_route = true;
-                                                compound_move.trade_route_path = GetCanonicalRoute(route_combo);
-                                                moves.push_back(compound_move);
-                                            }
-                                        }
-                                    } while (std::next_permutation(v.begin(), v.end()));
-                                }
-                            }
-                        }
+                    // --- GUI MODE: Exhaustive Generation (All Routes) ---
+                    for (const auto &route : potential_routes) {
+                        PackedMove compound_move = basic_upgrade_move;
+                        compound_move.flags |= PackedMove::kDeclaresRoute;
+                        PackRoute(route, &compound_move);
+                        moves->push_back(compound_move);
                     }
                 }
-            }
-            return moves;
+            });
         }
 
         bool Mali_BaState::HasSufficientResourcesForUpgrade(Player player_id) const {
@@ -514,8 +506,8 @@ namespace open_spiel
             
             // Check rare goods first (easier payment option)
             if (player_id < rare_goods_.size()) {
-                for (const auto &[good, count] : rare_goods_[player_id]) {
-                    if (count >= rare_cost) {
+                for (int count : rare_goods_[player_id]) {
+                    if (count > 0 && count >= rare_cost) {
                         return true;
                     }
                 }
@@ -523,7 +515,7 @@ namespace open_spiel
             
             // Check common goods
             int total_common = 0;
-            for (const auto &[good, count] : common_goods_[player_id]) {
+            for (int count : common_goods_[player_id]) {
                 total_common += count;
             }
             
@@ -534,99 +526,141 @@ namespace open_spiel
         }
 
         std::vector<Move> Mali_BaState::GenerateMancalaMoves() const {
-            std::vector<Move> legal_moves;
-            if (IsChanceNode() || IsTerminal()) return legal_moves;
+            thread_local std::vector<PackedMove> packed;
+            GenerateMancalaMoves(&packed);
+            return UnpackMoves(packed);
+        }
 
-            const GameRules &rules = GetGame()->GetRules();
-            const auto& valid_hexes_set = GetGame()->GetValidHexes();
-            PlayerColor p_color = GetCurrentPlayerColor();
+        void Mali_BaState::GenerateMancalaMoves(std::vector<PackedMove>* legal_moves) const {
+            MALI_BA_PERF_SCOPE(kMancalaMoves);
+            legal_moves->clear();
+            if (IsChanceNode() || IsTerminal()) return;
 
-            for (const auto& [start_hex, token_colors] : player_token_locations_) {
-                // Find a token belonging to the current player at this hex
-                if (std::find(token_colors.begin(), token_colors.end(), p_color) == token_colors.end()) {
-                    continue;
-                }
+            const Mali_BaGame *game = GetGame();
+            const GameRules &rules = game->GetRules();
+            const BoardKernels &kernels = game->GetBoardKernels();
+            PlayerColor p_color = GetCurrentPlayerColor();
+            const HexMask own_tokens = kernels.TokenHexes(board_.cells(), p_color);
 
-                int num_meeples = GetMeeplesAt(start_hex).size();
+            // Moves come out ordered by (start, end, flags) and never repeat, which is
+            // also Move::operator< order because hex indices follow HexCoord order;
+            // there is nothing left to sort or deduplicate.
+            own_tokens.ForEach([&](int start_index) {
+                int num_meeples = board_[start_index].num_meeples;
                 int max_dist = num_meeples + 1;
 
-                // --- START: Corrected BFS Implementation ---
-                std::queue<std::pair<HexCoord, int>> q;
-                q.push({start_hex, 0});
-                std::set<HexCoord> reachable_hexes; // All hexes that can be reached
-                std::set<HexCoord> visited_for_bfs = {start_hex}; // Hexes already added to the queue
-
-                while (!q.empty()) {
-                    auto [current_hex, distance] = q.front();
-                    q.pop();
-
-                    // The current hex itself is reachable.
-                    reachable_hexes.insert(current_hex);
-
-                    // If we can still move further, explore neighbors.
-                    if (distance < max_dist) {
-                        for (const auto& dir : kHexDirections) {
-                            HexCoord neighbor = current_hex + dir;
-                            // Explore neighbor if it's on the board and not yet queued for visit.
-                            if (valid_hexes_set.count(neighbor) && visited_for_bfs.find(neighbor) == visited_for_bfs.end()) {
-                                visited_for_bfs.insert(neighbor);
-                                q.push({neighbor, distance + 1});
-                            }
-                        }
-                    }
-                }
-                // --- END: Corrected BFS Implementation ---
-
-                // Now, iterate through all reachable hexes to find valid landing spots.
-                for (const auto& final_hex : reachable_hexes) {
-                    // A landing spot cannot be the start hex itself.
-                    if (final_hex == start_hex) {
-                        continue;
-                    }
-
-                    // A landing spot cannot contain another of the player's tokens.
-                    if (HasTokenAt(final_hex, p_color)) {
-                        continue;
-                    }
-
-                    // If we've passed all checks, this is a valid landing spot.
-                    Move base_move;
-                    base_move.player = p_color;
-                    base_move.type = ActionType::kMancala;
-                    base_move.start_hex = start_hex;
-                    base_move.path = {final_hex}; // Path just stores the destination
-
-                    legal_moves.push_back(base_move);
+                // A landing spot is 1 to max_dist on-board steps away and holds
+                // none of the player's tokens.
+                HexMask landing_hexes = kernels.WithinHops(start_index, max_dist);
+                landing_hexes.Remove(own_tokens);
+                landing_hexes.ForEach([&](int final_index) {
+                    PackedMove base_move;
+                    base_move.player = static_cast<int8_t>(p_color);
+                    base_move.type = static_cast<int8_t>(ActionType::kMancala);
+                    base_move.start = static_cast<int8_t>(start_index);
+                    base_move.end = static_cast<int8_t>(final_index);
+                    legal_moves->push_back(base_move);
 
                     // Check for compound moves (placing a post)
+                    const HexCoord final_hex = game->IndexToCoord(final_index);
                     if (CanPlaceTradingPostAt(final_hex, p_color)) {
-                        Move move_with_post = base_move;
-                        move_with_post.place_trading_post = true;
-                        legal_moves.push_back(move_with_post);
+                        PackedMove move_with_post = base_move;
+                        move_with_post.flags |= PackedMove::kPlacePost;
+                        legal_moves->push_back(move_with_post);
 
                         if (rules.free_action_trade_routes) {
-                            Mali_BaState temp_state = *this;
-                            temp_state.AddTradingPost(final_hex, p_color, TradePostType::kPost);
-                            auto potential_routes = temp_state.FindPossibleTradeRoutes(p_color, true, final_hex, 5);
+                            Mali_BaWhatIf what_if(*this);
+                            what_if.AddTradingPost(final_hex, p_color, TradePostType::kPost);
+                            auto potential_routes = what_if.FindPossibleTradeRoutes(p_color, true, &final_hex, 5);
                             if (!potential_routes.empty()) {
                                 std::sort(potential_routes.begin(), potential_routes.end(), 
                                     [](const auto& a, const auto& b){ return a.size() > b.size(); });
 
-                                Move super_compound_move = move_with_post;
-                                super_compound_move.declares_trade_route = true;
-                                super_compound_move.trade_route_path = potential_routes[0];
-                                legal_moves.push_back(super_compound_move);
+                                PackedMove super_compound_move = move_with_post;
+                                super_compound_move.flags |= PackedMove::kDeclaresRoute;
+                                PackRoute(potential_routes[0], &super_compound_move);
+                                legal_moves->push_back(super_compound_move);
                             }
                         }
                     }
-                }
+                });
+            });
+        }
+
+        void Mali_BaState::PackRoute(const std::vector<HexCoord>& route, PackedMove* packed) const {
+            SPIEL_CHECK_LE(route.size(), static_cast<size_t>(kMaxPackedRouteHexes));
+            packed->route.fill(0);
+            packed->route_len = static_cast<uint8_t>(route.size());
+            for (size_t i = 0; i < route.size(); ++i) {
+                const int index = GetGame()->CoordToIndex(route[i]);
+                SPIEL_CHECK_GE(index, 0);
+                packed->route[i] = static_cast<int8_t>(index);
             }
+        }
 
-            // Deduplicate moves
-            std::sort(legal_moves.begin(), legal_moves.end());
-            legal_moves.erase(std::unique(legal_moves.begin(), legal_moves.end()), legal_moves.end());
+        PackedMove Mali_BaState::PackMove(const Move& move) const {
+            SPIEL_CHECK_TRUE(move.type != ActionType::kIncome);
+            const Mali_BaGame *game = GetGame();
+            PackedMove packed;
+            packed.player = static_cast<int8_t>(move.player);
+            packed.type = static_cast<int8_t>(move.type);
+            packed.route_id = static_cast<int16_t>(move.route_id);
+            if (move.place_trading_post) packed.flags |= PackedMove::kPlacePost;
+            if (move.declares_trade_route) packed.flags |= PackedMove::kDeclaresRoute;
+
+            switch (move.type) {
+                case ActionType::kPlaceToken:
+                case ActionType::kPlaceTCenter:
+                    packed.start = static_cast<int8_t>(game->CoordToIndex(move.start_hex));
+                    break;
+                case ActionType::kMancala:
+                    packed.start = static_cast<int8_t>(game->CoordToIndex(move.start_hex));
+                    if (!move.path.empty()) {
+                        packed.end = static_cast<int8_t>(game->CoordToIndex(move.path.back()));
+                    }
+                    break;
+                case ActionType::kTradeRouteCreate:
+                    PackRoute(move.path, &packed);
+                    return packed;
+                default:
+                    break;
+            }
+            if (move.declares_trade_route) PackRoute(move.trade_route_path, &packed);
+            return packed;
+        }
+
+        Move Mali_BaState::UnpackMove(const PackedMove& packed) const {
+            const Mali_BaGame *game = GetGame();
+            Move move;
+            move.player = static_cast<PlayerColor>(packed.player);
+            move.type = packed.Type();
+            move.route_id = packed.route_id;
+            move.place_trading_post = packed.HasFlag(PackedMove::kPlacePost);
+            move.declares_trade_route = packed.HasFlag(PackedMove::kDeclaresRoute);
+            if (packed.start >= 0) move.start_hex = game->IndexToCoord(packed.start);
+            if (packed.end >= 0) move.path = {game->IndexToCoord(packed.end)};
+
+            std::vector<HexCoord> route;
+            route.reserve(packed.route_len);
+            for (int i = 0; i < packed.route_len; ++i) {
+                route.push_back(game->IndexToCoord(packed.route[i]));
+            }
+            if (move.type == ActionType::kTradeRouteCreate) {
+                move.path = std::move(route);
+            } else if (move.declares_trade_route) {
+                move.trade_route_path = std::move(route);
+            }
+            if (move.type == ActionType::kPlaceTCenter) {
+                move.action_string = absl::StrCat("upgrade ", move.start_hex.ToString(), "|generic_payment");
+            }
+            return move;
+        }
 
-            return legal_moves;
+        std::vector<Move> Mali_BaState::UnpackMoves(const std::vector<PackedMove>& packed) const {
+            std::vector<Move> moves;
+            moves.reserve(packed.size());
+            for (const PackedMove& move : packed) moves.push_back(UnpackMove(move));
+            return moves;
         }
 
         std::vector<HexCoord> Mali_BaState::FindShortestPath(
@@ -641,57 +675,66 @@ namespace open_spiel
             
             if (start.Distance(end) > num_meeples + 1) return {};
             
+            const Mali_BaGame *game = GetGame();
+            const int start_index = game->CoordToIndex(start);
+            const int end_index = game->CoordToIndex(end);
+            if (start_index < 0 || end_index < 0) return {};
+
+            // Paths are at most num_meeples + 1 long, so a flat list beats a set.
             std::vector<HexCoord> path;
+            std::vector<int> used = {start_index};
+            auto is_used = [&used](int index) {
+                return std::find(used.begin(), used.end(), index) != used.end();
+            };
+            int current_index = start_index;
             HexCoord current = start;
-            std::set<HexCoord> used;
-            used.insert(start);
             
             for (int step = 0; step < num_meeples; ++step) {
-                HexCoord best_next = current;
+                int best_index = current_index;
                 int best_distance = current.Distance(end);
                 
-                if (best_distance == 1 && used.find(end) == used.end()) {
+                if (best_distance == 1 && !is_used(end_index)) {
                     path.push_back(end);
                     return path;
                 }
                 
-                for (const auto& dir : kHexDirections) {
-                    HexCoord candidate = current + dir;
-                    if (IsValidHex(candidate) && used.find(candidate) == used.end()) {
-                        int new_distance = candidate.Distance(end);
-                        if (candidate == end) {
+                const auto &neighbors = game->NeighborIndices(current_index);
+                for (int16_t candidate : neighbors) {
+                    if (candidate >= 0 && !is_used(candidate)) {
+                        int new_distance = game->IndexToCoord(candidate).Distance(end);
+                        if (candidate == end_index) {
                             if (step == num_meeples - 1) {
-                                best_next = candidate;
+                                best_index = candidate;
                                 best_distance = new_distance;
                             }
                         } else if (new_distance <= best_distance) {
-                            best_next = candidate;
+                            best_index = candidate;
                             best_distance = new_distance;
                         }
                     }
                 }
                 
-                if (best_next == current) {
-                    for (const auto& dir : kHexDirections) {
-                        HexCoord candidate = current + dir;
-                        if (IsValidHex(candidate) && used.find(candidate) == used.end()) {
-                            if (candidate == end && step != num_meeples - 1) continue;
-                            best_next = candidate;
+                if (best_index == current_index) {
+                    for (int16_t candidate : neighbors) {
+                        if (candidate >= 0 && !is_used(candidate)) {
+                            if (candidate == end_index && step != num_meeples - 1) continue;
+                            best_index = candidate;
                             break;
                         }
                     }
                 }
                 
-                if (best_next == current) return {};
+                if (best_index == current_index) return {};
                 
-                path.push_back(best_next);
-                used.insert(best_next);
-                current = best_next;
+                current_index = best_index;
+                current = game->IndexToCoord(current_index);
+                path.push_back(current);
+                used.push_back(current_index);
                 
-                if (current == end) return path;
+                if (current_index == end_index) return path;
             }
             
-            if (current.Distance(end) == 1 && used.find(end) == used.end()) {
+            if (current.Distance(end) == 1 && !is_used(end_index)) {
                 path.push_back(end);
                 return path;
             }
@@ -701,40 +744,42 @@ namespace open_spiel
 
         void Mali_BaState::InitializeMoveLogging()
         {
-            if (move_logging_initialized_) return;
-            std::string datetime = GetCurrentDateTime();
-            pid_t pid = getpid(); // Get the current Process ID
-            move_log_filename_ = "/tmp/mali_ba.states." + datetime + ".pid-" + std::to_string(pid) + ".log";
-            move_log_file_ = std::make_unique<std::ofstream>(move_log_filename_);
-            if (!move_log_file_->is_open()) {
-                LOG_WARN("Failed to open move log file: ", move_log_filename_);
-                return;
+            if (move_log_sink_) return;
+            std::shared_ptr<MoveLogSink> sink = GetGame()->GetMoveLogSink();
+            if (!sink->ok()) return;
+            move_log_sink_ = std::move(sink);
+            move_log_game_id_ = move_log_sink_->NewGameId();
+            move_log_count_ = 0;
+            const bool pretty = GetGame()->GetMoveLogConfig().format == MoveLogFormat::kSections;
+            move_log_sink_->LogSetup(move_log_game_id_, CreateSetupJson(move_log_game_id_, pretty));
+        }
+
+        void Mali_BaState::SetMoveLoggingEnabled(bool answ)
+        {
+            if (answ) {
+                InitializeMoveLogging();
+            } else {
+                move_log_sink_.reset();
             }
-            std::string setup_json = CreateSetupJson();
-            *move_log_file_ << "[setup]\n";
-            *move_log_file_ << setup_json << "\n\n";
-            move_log_file_->flush();
-            move_count_ = 0;
-            move_logging_initialized_ = true;
-            LOG_INFO("Move logger initialized: ", move_log_filename_);
-            move_logging_enabled_ = true;
         }
 
+        // Queues the record and returns; the sink's writer thread does the I/O.
         void Mali_BaState::LogMove(const std::string &action_string, const std::string &state_json)
         {
-            if (!move_logging_initialized_ && move_logging_enabled_) InitializeMoveLogging();
-            if (!move_logging_enabled_ || !move_log_file_ || !move_log_file_->is_open()) return;
-
-            move_count_++;
-            *move_log_file_ << "[move" << move_count_ << "]\n";
-            *move_log_file_ << "action=" << action_string << "\n";
-            *move_log_file_ << "state=" << state_json << "\n\n";
-            move_log_file_->flush();
+            if (!move_log_sink_) return;
+            move_log_count_++;
+            move_log_sink_->LogMove(move_log_game_id_, move_log_count_, action_string, state_json);
+        }
+
+        std::string Mali_BaState::GetMoveLogFilename() const
+        {
+            return move_log_sink_ ? move_log_sink_->path() : "";
         }
 
-        std::string Mali_BaState::CreateSetupJson() const
+        std::string Mali_BaState::CreateSetupJson(int64_t game_id, bool pretty) const
         {
             json setup;
+            if (game_id >= 0) setup["game_id"] = game_id;
             setup["num_players"] = game_->NumPlayers();
             setup["grid_radius"] = GetGame()->GetGridRadius();
             setup["tokens_per_player"] = GetGame()->GetTokensPerPlayer();
@@ -760,7 +805,7 @@ namespace open_spiel
             std::stringstream ss;
             ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
             setup["timestamp"] = ss.str();
-            return setup.dump(2);
+            return pretty ? setup.dump(2) : setup.dump();
         }
 
     } // namespace mali_ba
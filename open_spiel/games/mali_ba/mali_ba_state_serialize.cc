@@ -3,10 +3,17 @@
 
 #include "open_spiel/games/mali_ba/mali_ba_state.h"
 #include "open_spiel/games/mali_ba/mali_ba_common.h"
+#include "open_spiel/games/mali_ba/mali_ba_game.h"
+#include "open_spiel/games/mali_ba/mali_ba_perf.h"
 #include "open_spiel/games/mali_ba/hex_grid.h"
 
+#include <array>
+#include <cstring>
+#include <map>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <tuple>
 #include <vector>
 
 #include "open_spiel/abseil-cpp/absl/strings/str_cat.h"
@@ -70,6 +77,72 @@ absl::optional<HexCoord> JsonStringToHexCoord(const std::string& s) {
     }
 }
 
+// JSON pieces shared by Serialize() and the change feed.
+namespace {
+
+json CellTokensJson(const HexCell& cell) {
+    json tokens = json::array();
+    for (int c = 0; c < kNumPlayerColors; ++c) {
+        for (int n = 0; n < cell.token_counts[c]; ++n) tokens.push_back(c);
+    }
+    return tokens;
+}
+
+json CellMeeplesJson(const HexCell& cell) {
+    json meeples = json::array();
+    for (int c = 0; c < kNumMeepleColors; ++c) {
+        for (int n = 0; n < cell.meeple_counts[c]; ++n) meeples.push_back(c);
+    }
+    return meeples;
+}
+
+json CellPostsJson(const HexCell& cell) {
+    json posts = json::array();
+    for (int c = 0; c < kNumPlayerColors; ++c) {
+        TradePostType type = cell.PostTypeOf(static_cast<PlayerColor>(c));
+        if (type != TradePostType::kNone) {
+            posts.push_back({{"owner", c}, {"type", static_cast<int>(type)}});
+        }
+    }
+    return posts;
+}
+
+json TradeRouteJson(const TradeRoute& route) {
+    json j_route;
+    j_route["id"] = route.id;
+    j_route["owner"] = static_cast<int>(route.owner);
+    json j_hexes = json::array();
+    for (const auto& hex : route.hexes) {
+        j_hexes.push_back(HexCoordToJsonString(hex));
+    }
+    j_route["hexes"] = j_hexes;
+    j_route["goods"] = GoodCountsToMap(route.goods, /*rare=*/false);
+    j_route["active"] = route.active;
+    return j_route;
+}
+
+json MidTurnStateJson(const std::vector<MeepleColor>& meeples_in_hand,
+                      const std::vector<HexCoord>& mancala_path,
+                      const HexCoord& mancala_hex,
+                      const HexCoord& last_action_hex) {
+    json j_mid_turn = json::object();
+    json j_hand = json::array();
+    for (MeepleColor mc : meeples_in_hand) {
+        j_hand.push_back(static_cast<int>(mc));
+    }
+    j_mid_turn["meeplesInHand"] = j_hand;
+    json j_path = json::array();
+    for (const HexCoord& hc : mancala_path) {
+        j_path.push_back(HexCoordToJsonString(hc));
+    }
+    j_mid_turn["mancalaPath"] = j_path;
+    j_mid_turn["mancalaHex"] = HexCoordToJsonString(mancala_hex);
+    j_mid_turn["lastActionHex"] = HexCoordToJsonString(last_action_hex);
+    return j_mid_turn;
+}
+
+}  // namespace
+
 std::string Mali_BaState::Serialize() const {
     /*
     Converts the entire current game state into a JSON string that can be stored, transmitted, or recreated later.
@@ -85,8 +158,8 @@ std::string Mali_BaState::Serialize() const {
     Converts it to JSON format for easy parsing and transmission
     Returns a string that contains everything needed to recreate this exact game state
     */
-    constexpr int kJsonSerializationVersion = 2;
-    int tpsz;   // DEBUG
+    MALI_BA_PERF_SCOPE(kSerialize);
+    constexpr int kJsonSerializationVersion = 3;
     json j;
 
     try {
@@ -96,57 +169,29 @@ std::string Mali_BaState::Serialize() const {
         // Part 2: Game Flow State
         j["currentPlayerId"] = current_player_id_;
         j["currentPhase"] = static_cast<int>(current_phase_); // Store enum as int
+        j["moveNumber"] = move_number_;
+        const Mali_BaRng& rng = GetRNG();
+        j["rng"] = {{"stream", rng.stream()}, {"move", rng.move()}, {"counter", rng.counter()}};
        
-        // Part 3: Player Tokens (map<HexCoord, PlayerColor>) -> json object { "x,y,z": color_int }
+        // Part 3: Player Tokens -> json object { "x,y,z": [color_int, ...] }
+        // Part 4: Meeples -> json object { "x,y,z": [mc1_int, mc2_int] }
+        // Part 5: Trade Posts -> json object { "x,y,z": [ {owner: int, type: int}, ... ] }
+        const Mali_BaGame* game = GetGame();
         json j_tokens = json::object();
-        for (const auto& [hex, colors] : player_token_locations_) {
-            if (!colors.empty()) {
-                json token_list = json::array();
-                for (PlayerColor color : colors) {
-                    token_list.push_back(static_cast<int>(color));
-                }
-                j_tokens[HexCoordToJsonString(hex)] = token_list;
-            }
-        }
-        j["playerTokens"] = j_tokens;
-
-        // Part 4: Meeples (map<HexCoord, vector<MeepleColor>>) -> json object { "x,y,z": [mc1_int, mc2_int] }
         json j_meeples = json::object();
-        for (const auto& [hex, meeples] : hex_meeples_) {
-            if (!meeples.empty()) {
-                json j_meeple_list = json::array();
-                for (MeepleColor mc : meeples) {
-                    j_meeple_list.push_back(static_cast<int>(mc));
-                }
-                j_meeples[HexCoordToJsonString(hex)] = j_meeple_list;
-            }
-        }
-        j["hexMeeples"] = j_meeples;
-
-        // Part 5: Trade Posts (map<HexCoord, vector<TradePost>>) -> json object { "x,y,z": [ {owner: int, type: int}, ... ] }
         json j_posts = json::object();
-        for (const auto& [hex, posts] : trade_posts_locations_) {
-            if (!posts.empty()) {
-                json j_post_list = json::array();
-                for (const auto& post : posts) {
-                    if (post.type != TradePostType::kNone) { // Only serialize actual posts/centers
-                         j_post_list.push_back({
-                            {"owner", static_cast<int>(post.owner)},
-                            {"type", static_cast<int>(post.type)}
-                         });
-                    }
-                }
-                // Only add if there were actual posts/centers at this hex
-                if (!j_post_list.empty()) {
-                    j_posts[HexCoordToJsonString(hex)] = j_post_list;
-                }
-            }
+        for (int i = 0; i < static_cast<int>(board_.size()); ++i) {
+            const HexCell& cell = board_[i];
+            if (cell.num_tokens == 0 && cell.num_meeples == 0 && !cell.HasAnyPost()) continue;
+            const std::string hex_key = HexCoordToJsonString(game->IndexToCoord(i));
+
+            if (cell.num_tokens > 0) j_tokens[hex_key] = CellTokensJson(cell);
+            if (cell.num_meeples > 0) j_meeples[hex_key] = CellMeeplesJson(cell);
+            if (cell.HasAnyPost()) j_posts[hex_key] = CellPostsJson(cell);
         }
+        j["playerTokens"] = j_tokens;
+        j["hexMeeples"] = j_meeples;
         j["tradePosts"] = j_posts;
-        // tpsz = j_post_list.size();   // DEBUG
-        // LOG_INFO("In Serialize(). Number of trade posts: ", tpsz);   // DEBUG
-        // tpsz = trade_posts_locations_.size();   // DEBUG
-        // LOG_INFO("In Serialize(). trade_posts_locations_ size: ", tpsz);   // DEBUG
 
         // Part 5a. Serialize the players' supply of trading posts.
         j["playerPostsSupply"] = player_posts_supply_;
@@ -174,60 +219,30 @@ std::string Mali_BaState::Serialize() const {
         }
         j["history"] = j_history;
 
-        // Part 8: Resources - Common Goods (vector<map<string, int>>) -> json array [ player0_goods_obj, player1_goods_obj ]
+        // Part 8: Resources - Common Goods (named, nonzero counts) -> json array [ player0_goods_obj, player1_goods_obj ]
         json j_common_goods = json::array();
-        for (const auto& player_goods : common_goods_) {
-            j_common_goods.push_back(player_goods); // nlohmann/json handles map<string, int> directly
+        for (const GoodCounts& player_goods : common_goods_) {
+            j_common_goods.push_back(GoodCountsToMap(player_goods, /*rare=*/false));
         }
         j["commonGoods"] = j_common_goods;
 
-        // Part 9: Resources - Rare Goods (vector<map<string, int>>) -> json array [ player0_goods_obj, player1_goods_obj ]
+        // Part 9: Resources - Rare Goods (named, nonzero counts) -> json array [ player0_goods_obj, player1_goods_obj ]
         json j_rare_goods = json::array();
-        for (const auto& player_goods : rare_goods_) {
-            j_rare_goods.push_back(player_goods); // nlohmann/json handles map<string, int> directly
+        for (const GoodCounts& player_goods : rare_goods_) {
+            j_rare_goods.push_back(GoodCountsToMap(player_goods, /*rare=*/true));
         }
         j["rareGoods"] = j_rare_goods;
 
         // Part 10. Trade Routes
         json j_routes = json::array();
         for (const auto& route : trade_routes_) {
-            json j_route;
-            j_route["id"] = route.id;
-            j_route["owner"] = static_cast<int>(route.owner);
-            
-            json j_hexes = json::array();
-            for (const auto& hex : route.hexes) {
-                j_hexes.push_back(HexCoordToJsonString(hex));
-            }
-            j_route["hexes"] = j_hexes;
-            
-            j_route["goods"] = route.goods;
-            j_route["active"] = route.active;
-            
-            j_routes.push_back(j_route);
+            j_routes.push_back(TradeRouteJson(route));
         }
         j["tradeRoutes"] = j_routes;
 
         // --- Part 11. Mid-Turn State ---
-        json j_mid_turn = json::object();
-        
-        json j_hand = json::array();
-        for (MeepleColor mc : meeples_in_hand_) {
-            j_hand.push_back(static_cast<int>(mc));
-        }
-        j_mid_turn["meeplesInHand"] = j_hand;
-
-        json j_path = json::array();
-        for (const HexCoord& hc : current_mancala_path_) {
-            j_path.push_back(HexCoordToJsonString(hc));
-        }
-        j_mid_turn["mancalaPath"] = j_path;
-        
-        // Use your existing helper to safely serialize the coordinates
-        j_mid_turn["mancalaHex"] = HexCoordToJsonString(current_mancala_hex_);
-        j_mid_turn["lastActionHex"] = HexCoordToJsonString(last_action_hex_);
-        
-        j["midTurnState"] = j_mid_turn;
+        j["midTurnState"] = MidTurnStateJson(meeples_in_hand_, current_mancala_path_,
+                                             current_mancala_hex_, last_action_hex_);
 
         // Convert the JSON object to a string (compact version)
         return j.dump();
@@ -238,63 +253,703 @@ std::string Mali_BaState::Serialize() const {
     }
 }
 
+// =====================================================================
+// Binary serialization
+// =====================================================================
+// Layout (all integers are LEB128 varints, signed ones zigzag-encoded):
+//   "MB" magic, format version byte, NumHexes()
+//   current player, phase, next route id, pending route declaration,
+//   OpenSpiel history (player, action) and move number, cumulative returns
+//   non-empty cells: index delta, presence bits, token/meeple colour masks
+//     followed by the non-zero counts, post and center masks
+//   posts supply, moves history, common goods, rare goods, trade routes,
+//   mid-turn state
+// Hexes are written as CoordToIndex() + 1, or 0 followed by the raw
+// coordinates for the rare hex that is not on the board. Goods are written
+// as their GoodsManager index, in that order; a name GoodsManager does not
+// know is written as its list size followed by the string.
+namespace {
+
+constexpr char kBinaryMagic[2] = {'M', 'B'};
+constexpr uint8_t kBinarySerializationVersion = 2;
+
+constexpr uint8_t kCellHasTokens = 1;
+constexpr uint8_t kCellHasMeeples = 2;
+constexpr uint8_t kCellHasPosts = 4;
+
+class BinaryWriter {
+public:
+    explicit BinaryWriter(std::string* out) : out_(out) {}
+
+    void Byte(uint8_t value) { out_->push_back(static_cast<char>(value)); }
+
+    void Varint(uint64_t value) {
+        while (value >= 0x80) {
+            Byte(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        Byte(static_cast<uint8_t>(value));
+    }
+
+    void Signed(int64_t value) {
+        Varint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    void Double(double value) {
+        char bytes[sizeof(double)];
+        std::memcpy(bytes, &value, sizeof(double));
+        out_->append(bytes, sizeof(double));
+    }
+
+    void String(const std::string& value) {
+        Varint(value.size());
+        out_->append(value);
+    }
+
+    void Hex(const Mali_BaGame* game, const HexCoord& hex) {
+        const int index = game->CoordToIndex(hex);
+        if (index >= 0) {
+            Varint(static_cast<uint64_t>(index) + 1);
+            return;
+        }
+        Varint(0);
+        Signed(hex.x);
+        Signed(hex.y);
+        Signed(hex.z);
+    }
+
+    void Hexes(const Mali_BaGame* game, const std::vector<HexCoord>& hexes) {
+        Varint(hexes.size());
+        for (const HexCoord& hex : hexes) Hex(game, hex);
+    }
+
+    // Nonzero counts as (id, count) pairs. Ids past the known goods are
+    // followed by a name; older logs may contain them, this writer does not.
+    void Goods(const GoodCounts& goods) {
+        int num_nonzero = 0;
+        for (int count : goods) num_nonzero += (count != 0);
+        Varint(num_nonzero);
+        for (int id = 0; id < kNumGoodTypes; ++id) {
+            if (goods[id] == 0) continue;
+            Varint(id);
+            Signed(goods[id]);
+        }
+    }
+
+private:
+    std::string* out_;
+};
+
+// Every read is bounds-checked; a truncated or malformed buffer is fatal.
+class BinaryReader {
+public:
+    explicit BinaryReader(const std::string& data) : data_(data) {}
+
+    bool AtEnd() const { return pos_ == data_.size(); }
+
+    uint8_t Byte() {
+        if (pos_ >= data_.size()) SpielFatalError("DeserializeBinary: truncated buffer");
+        return static_cast<uint8_t>(data_[pos_++]);
+    }
+
+    uint64_t Varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            const uint8_t byte = Byte();
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) return value;
+        }
+        SpielFatalError("DeserializeBinary: malformed varint");
+    }
+
+    int64_t Signed() {
+        const uint64_t value = Varint();
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    // Element counts are bounded by the bytes left, so a corrupt length cannot
+    // trigger a huge allocation.
+    size_t Count() {
+        const uint64_t count = Varint();
+        if (count > data_.size() - pos_) SpielFatalError("DeserializeBinary: bad element count");
+        return static_cast<size_t>(count);
+    }
+
+    double Double() {
+        if (data_.size() - pos_ < sizeof(double)) SpielFatalError("DeserializeBinary: truncated buffer");
+        double value;
+        std::memcpy(&value, data_.data() + pos_, sizeof(double));
+        pos_ += sizeof(double);
+        return value;
+    }
+
+    std::string String() {
+        const size_t size = Count();
+        std::string value = data_.substr(pos_, size);
+        pos_ += size;
+        return value;
+    }
+
+    HexCoord Hex(const Mali_BaGame* game) {
+        const uint64_t encoded = Varint();
+        if (encoded == 0) {
+            const int x = static_cast<int>(Signed());
+            const int y = static_cast<int>(Signed());
+            const int z = static_cast<int>(Signed());
+            return HexCoord(x, y, z);
+        }
+        if (encoded > static_cast<uint64_t>(game->NumHexes())) {
+            SpielFatalError("DeserializeBinary: hex index out of range");
+        }
+        return game->IndexToCoord(static_cast<int>(encoded - 1));
+    }
+
+    std::vector<HexCoord> Hexes(const Mali_BaGame* game) {
+        std::vector<HexCoord> hexes;
+        const size_t count = Count();
+        hexes.reserve(count);
+        for (size_t i = 0; i < count; ++i) hexes.push_back(Hex(game));
+        return hexes;
+    }
+
+    GoodCounts Goods(bool rare) {
+        const GoodsManager& manager = GoodsManager::GetInstance();
+        GoodCounts goods{};
+        const size_t count = Count();
+        for (size_t i = 0; i < count; ++i) {
+            const uint64_t index = Varint();
+            if (index < kNumGoodTypes) {
+                goods[index] = static_cast<int>(Signed());
+            } else if (index == kNumGoodTypes) {
+                const std::string name = String();
+                const int id = rare ? manager.GetRareGoodIndex(name) : manager.GetCommonGoodIndex(name);
+                const int value = static_cast<int>(Signed());
+                if (id >= 0) {
+                    goods[id] = value;
+                } else {
+                    LOG_WARN("DeserializeBinary: ignoring unknown good '", name, "'");
+                }
+            } else {
+                SpielFatalError("DeserializeBinary: good index out of range");
+            }
+        }
+        return goods;
+    }
+
+private:
+    const std::string& data_;
+    size_t pos_ = 0;
+};
+
+// Writes the mask of non-zero counts, then those counts.
+template <size_t N>
+void WritePackedCounts(BinaryWriter* writer, const std::array<uint8_t, N>& counts) {
+    uint32_t mask = 0;
+    for (size_t c = 0; c < N; ++c) {
+        if (counts[c] > 0) mask |= 1u << c;
+    }
+    writer->Varint(mask);
+    for (size_t c = 0; c < N; ++c) {
+        if (counts[c] > 0) writer->Varint(counts[c]);
+    }
+}
+
+template <size_t N>
+uint8_t ReadPackedCounts(BinaryReader* reader, std::array<uint8_t, N>* counts) {
+    const uint64_t mask = reader->Varint();
+    if (mask >> N) SpielFatalError("DeserializeBinary: bad colour mask");
+    int total = 0;
+    for (size_t c = 0; c < N; ++c) {
+        (*counts)[c] = (mask & (1u << c)) ? static_cast<uint8_t>(reader->Varint()) : 0;
+        total += (*counts)[c];
+    }
+    return static_cast<uint8_t>(total);
+}
+
+}  // namespace
+
+std::string Mali_BaState::SerializeBinary() const {
+    MALI_BA_PERF_SCOPE(kSerialize);
+    const Mali_BaGame* game = GetGame();
+    std::string out;
+    out.reserve(256 + board_.size() * 4);
+    BinaryWriter writer(&out);
+
+    out.append(kBinaryMagic, sizeof(kBinaryMagic));
+    writer.Byte(kBinarySerializationVersion);
+    writer.Varint(game->NumHexes());
+
+    // Game flow
+    writer.Signed(current_player_id_);
+    writer.Varint(static_cast<int>(current_phase_));
+    writer.Signed(next_route_id_);
+    writer.Byte(pending_route_declaration_ ? 1 : 0);
+    writer.Varint(history_.size());
+    for (const PlayerAction& entry : history_) {
+        writer.Signed(entry.player);
+        writer.Varint(entry.action);
+    }
+    writer.Varint(move_number_);
+    const Mali_BaRng& rng = GetRNG();  // At this move, so equal positions encode equally
+    writer.Varint(rng.stream());
+    writer.Varint(rng.move());
+    writer.Varint(rng.counter());
+    writer.Varint(cumulative_returns_.size());
+    for (double value : cumulative_returns_) writer.Double(value);
+
+    // Board
+    int num_occupied = 0;
+    for (int i = 0; i < static_cast<int>(board_.size()); ++i) {
+        const HexCell& cell = board_[i];
+        if (cell.num_tokens > 0 || cell.num_meeples > 0 || cell.HasAnyPost()) ++num_occupied;
+    }
+    writer.Varint(num_occupied);
+    int previous = -1;
+    for (int i = 0; i < static_cast<int>(board_.size()); ++i) {
+        const HexCell& cell = board_[i];
+        const uint8_t present = (cell.num_tokens > 0 ? kCellHasTokens : 0) |
+                                (cell.num_meeples > 0 ? kCellHasMeeples : 0) |
+                                (cell.HasAnyPost() ? kCellHasPosts : 0);
+        if (present == 0) continue;
+        writer.Varint(i - previous - 1);
+        previous = i;
+        writer.Byte(present);
+        if (present & kCellHasTokens) WritePackedCounts(&writer, cell.token_counts);
+        if (present & kCellHasMeeples) WritePackedCounts(&writer, cell.meeple_counts);
+        if (present & kCellHasPosts) {
+            writer.Byte(cell.post_mask);
+            writer.Byte(cell.center_mask);
+        }
+    }
+
+    // Player resources
+    writer.Varint(player_posts_supply_.size());
+    for (int supply : player_posts_supply_) writer.Signed(supply);
+
+    writer.Varint(moves_history_.size());
+    for (const Move& move : moves_history_) {
+        writer.Signed(static_cast<int>(move.player));
+        writer.Varint(static_cast<int>(move.type));
+        writer.Hex(game, move.start_hex);
+        writer.Byte(move.place_trading_post ? 1 : 0);
+        writer.Hexes(game, move.path);
+    }
+
+    writer.Varint(common_goods_.size());
+    for (const auto& goods : common_goods_) writer.Goods(goods);
+    writer.Varint(rare_goods_.size());
+    for (const auto& goods : rare_goods_) writer.Goods(goods);
+
+    writer.Varint(trade_routes_.size());
+    for (const TradeRoute& route : trade_routes_) {
+        writer.Signed(route.id);
+        writer.Signed(static_cast<int>(route.owner));
+        writer.Hexes(game, route.hexes);
+        writer.Goods(route.goods);
+        writer.Byte(route.active ? 1 : 0);
+    }
+
+    // Mid-turn state
+    writer.Varint(meeples_in_hand_.size());
+    for (MeepleColor mc : meeples_in_hand_) writer.Signed(static_cast<int>(mc));
+    writer.Hexes(game, current_mancala_path_);
+    writer.Hex(game, current_mancala_hex_);
+    writer.Hex(game, last_action_hex_);
+    return out;
+}
+
+// Fills a freshly constructed state from SerializeBinary() output.
+void Mali_BaState::DecodeBinary(const std::string& data) {
+    const Mali_BaGame* game = GetGame();
+    BinaryReader reader(data);
+
+    if (data.size() < 3 || data[0] != kBinaryMagic[0] || data[1] != kBinaryMagic[1]) {
+        SpielFatalError("DeserializeBinary: not a Mali-Ba binary state");
+    }
+    reader.Byte();
+    reader.Byte();
+    const uint8_t version = reader.Byte();
+    if (version != kBinarySerializationVersion) {
+        SpielFatalError(absl::StrCat("DeserializeBinary: unsupported version ", version));
+    }
+    if (reader.Varint() != static_cast<uint64_t>(game->NumHexes())) {
+        SpielFatalError("DeserializeBinary: state was written for a different board");
+    }
+
+    current_player_id_ = static_cast<Player>(reader.Signed());
+    current_phase_ = static_cast<Phase>(reader.Varint());
+    if (current_phase_ == Phase::kSetup) {
+        current_player_id_ = kChancePlayerId;
+        current_player_color_ = PlayerColor::kEmpty;
+    } else {
+        SPIEL_CHECK_GE(current_player_id_, 0);
+        SPIEL_CHECK_LT(current_player_id_, game->NumPlayers());
+        current_player_color_ = GetPlayerColor(current_player_id_);
+    }
+    next_route_id_ = static_cast<int>(reader.Signed());
+    pending_route_declaration_ = reader.Byte() != 0;
+    history_.resize(reader.Count());
+    for (PlayerAction& entry : history_) {
+        entry.player = static_cast<Player>(reader.Signed());
+        entry.action = static_cast<Action>(reader.Varint());
+    }
+    move_number_ = static_cast<int>(reader.Varint());
+    const uint64_t rng_stream = reader.Varint();
+    const uint64_t rng_move = reader.Varint();
+    rng_.Restore(rng_stream, rng_move, reader.Varint());
+    cumulative_returns_.resize(reader.Count());
+    for (double& value : cumulative_returns_) value = reader.Double();
+
+    // Board. The constructor's board is empty, so cells can be written directly.
+    const size_t num_occupied = reader.Count();
+    int index = -1;
+    for (size_t n = 0; n < num_occupied; ++n) {
+        index += static_cast<int>(reader.Varint()) + 1;
+        if (index >= static_cast<int>(board_.size())) {
+            SpielFatalError("DeserializeBinary: cell index out of range");
+        }
+        HexCell& cell = WritableCell(index);
+        cell = HexCell();
+        const uint8_t present = reader.Byte();
+        if (present & kCellHasTokens) cell.num_tokens = ReadPackedCounts(&reader, &cell.token_counts);
+        if (present & kCellHasMeeples) cell.num_meeples = ReadPackedCounts(&reader, &cell.meeple_counts);
+        if (present & kCellHasPosts) {
+            cell.post_mask = reader.Byte();
+            cell.center_mask = reader.Byte();
+        }
+    }
+
+    player_posts_supply_.resize(reader.Count());
+    for (int& supply : player_posts_supply_) supply = static_cast<int>(reader.Signed());
+
+    moves_history_.resize(reader.Count());
+    for (Move& move : moves_history_) {
+        move.player = static_cast<PlayerColor>(reader.Signed());
+        move.type = static_cast<ActionType>(reader.Varint());
+        move.start_hex = reader.Hex(game);
+        move.place_trading_post = reader.Byte() != 0;
+        move.path = reader.Hexes(game);
+    }
+
+    common_goods_.resize(reader.Count());
+    for (auto& goods : common_goods_) goods = reader.Goods(/*rare=*/false);
+    rare_goods_.resize(reader.Count());
+    for (auto& goods : rare_goods_) goods = reader.Goods(/*rare=*/true);
+
+    trade_routes_.resize(reader.Count());
+    for (TradeRoute& route : trade_routes_) {
+        route.id = static_cast<int>(reader.Signed());
+        route.owner = static_cast<PlayerColor>(reader.Signed());
+        route.hexes = reader.Hexes(game);
+        route.goods = reader.Goods(/*rare=*/false);
+        route.active = reader.Byte() != 0;
+    }
+
+    meeples_in_hand_.resize(reader.Count());
+    for (MeepleColor& mc : meeples_in_hand_) mc = static_cast<MeepleColor>(reader.Signed());
+    current_mancala_path_ = reader.Hexes(game);
+    current_mancala_hex_ = reader.Hex(game);
+    last_action_hex_ = reader.Hex(game);
+
+    if (!reader.AtEnd()) SpielFatalError("DeserializeBinary: trailing bytes");
+}
+
+// =====================================================================
+// Change feed
+// =====================================================================
+// Entries are JSON objects tagged by "type":
+//   {"type":"snapshot","seq":n,"state":<Serialize()>}
+//   {"type":"delta","seq":n,"action":a,"actionString":s,"player":p,
+//    "cells":{"x,y,z":{"tokens":[..],"meeples":[..],"posts":[..]}},
+//    "goods":[{"player":p,"common":{name:count},"rare":{name:count}}],
+//    "postsSupply":[..],"routesAdded":[route..],"routesRemoved":[id..],
+//    "routesActive":{"id":bool},"currentPlayerId":p,"currentPhase":n,
+//    "midTurnState":{..},"isTerminal":b}
+// Cells, goods and the posts supply carry their new values rather than the
+// difference, so applying a delta twice is harmless. Only changed cells and
+// goods are listed (a good that ran out is listed with 0). Sections with no
+// change are left out; the turn fields are always present.
+namespace {
+
+// A viewer that stops draining loses the backlog and gets a fresh snapshot.
+constexpr size_t kMaxChangeFeedEntries = 4096;
+
+}  // namespace
+
+void Mali_BaState::EnableChangeFeed(int snapshot_interval) {
+    SPIEL_CHECK_GT(snapshot_interval, 0);
+    if (!change_feed_) change_feed_ = std::make_unique<ChangeFeed>();
+    change_feed_->snapshot_interval = snapshot_interval;
+    RequestChangeFeedSnapshot();
+}
+
+void Mali_BaState::DisableChangeFeed() { change_feed_.reset(); }
+
+std::vector<std::string> Mali_BaState::DrainChangeFeed() {
+    std::vector<std::string> entries;
+    if (change_feed_) entries.swap(change_feed_->entries);
+    return entries;
+}
+
+void Mali_BaState::RequestChangeFeedSnapshot() {
+    if (!change_feed_) return;
+    QueueChangeFeedEntry(
+        absl::StrCat("{\"type\":\"snapshot\",\"seq\":", change_feed_->next_seq,
+                     ",\"state\":", Serialize(), "}"),
+        /*snapshot=*/true);
+}
+
+void Mali_BaState::QueueChangeFeedEntry(std::string entry, bool snapshot) {
+    ChangeFeed& feed = *change_feed_;
+    if (!snapshot && feed.entries.size() >= kMaxChangeFeedEntries) {
+        // The snapshot takes the dropped delta's seq.
+        feed.entries.clear();
+        RequestChangeFeedSnapshot();
+        return;
+    }
+    feed.entries.push_back(std::move(entry));
+    ++feed.next_seq;
+    feed.since_snapshot = snapshot ? 0 : feed.since_snapshot + 1;
+}
+
+// Builds the delta from the undo frame DoApplyAction() just closed: its cell
+// entries name the touched hexes, its goods entries hold the counts before
+// the action and its route entries the route changes.
+void Mali_BaState::RecordChangeFeedDelta(Action action, const std::string& action_string) {
+    SPIEL_CHECK_FALSE(undo_journal_.empty());
+    const UndoFrame& frame = undo_journal_.back();
+    const Mali_BaGame* game = GetGame();
+
+    json j;
+    j["type"] = "delta";
+    j["seq"] = change_feed_->next_seq;
+    j["action"] = action;
+    j["actionString"] = action_string;
+    j["player"] = frame.current_player_id_;
+
+    // Cells, with their contents after the action. A cell written and then
+    // restored within the action is left out.
+    json j_cells = json::object();
+    // Goods before the action, keyed by (rare, player, good): the first
+    // journal entry for a key holds the count from before the action.
+    std::map<std::tuple<bool, Player, int>, int> goods_before;
+    bool posts_supply_changed = false;
+    bool routes_changed = false;
+    for (const UndoEntry& entry : frame.entries) {
+        switch (entry.kind) {
+            case UndoEntry::Kind::kCell: {
+                const HexCell& cell = board_[entry.index];
+                if (std::memcmp(&cell, &entry.cell, sizeof(HexCell)) == 0) break;
+                json j_cell;
+                j_cell["tokens"] = CellTokensJson(cell);
+                j_cell["meeples"] = CellMeeplesJson(cell);
+                j_cell["posts"] = CellPostsJson(cell);
+                j_cells[HexCoordToJsonString(game->IndexToCoord(entry.index))] = j_cell;
+                break;
+            }
+            case UndoEntry::Kind::kCommonGood:
+            case UndoEntry::Kind::kRareGood:
+                goods_before.emplace(
+                    std::make_tuple(entry.kind == UndoEntry::Kind::kRareGood, entry.player, entry.index),
+                    entry.count);
+                break;
+            case UndoEntry::Kind::kPostsSupply:
+                posts_supply_changed = true;
+                break;
+            default:
+                routes_changed = true;
+                break;
+        }
+    }
+    if (!j_cells.empty()) j["cells"] = j_cells;
+
+    // New counts of the goods that changed, zeros included, per player.
+    const GoodsManager& goods_manager = GoodsManager::GetInstance();
+    std::vector<std::pair<json, json>> goods_changed(common_goods_.size(),
+                                                     {json::object(), json::object()});
+    bool any_goods_changed = false;
+    for (const auto& [key, before] : goods_before) {
+        const auto& [rare, player, good_id] = key;
+        const int count = (rare ? rare_goods_ : common_goods_)[player][good_id];
+        if (count == before) continue;
+        if (rare) {
+            goods_changed[player].second[goods_manager.GetRareGoodName(good_id)] = count;
+        } else {
+            goods_changed[player].first[goods_manager.GetCommonGoodName(good_id)] = count;
+        }
+        any_goods_changed = true;
+    }
+    if (any_goods_changed) {
+        json j_goods = json::array();
+        for (Player p = 0; p < static_cast<Player>(goods_changed.size()); ++p) {
+            const auto& [common, rare] = goods_changed[p];
+            if (common.empty() && rare.empty()) continue;
+            j_goods.push_back({{"player", p}, {"common", common}, {"rare", rare}});
+        }
+        j["goods"] = j_goods;
+    }
+    if (posts_supply_changed) j["postsSupply"] = player_posts_supply_;
+
+    if (routes_changed) {
+        // Walking the entries backwards from the current route ids rebuilds
+        // the id list as it was when each entry was recorded, which is what
+        // the index of a kRouteActive entry refers to.
+        std::vector<int> ids;
+        ids.reserve(trade_routes_.size());
+        for (const TradeRoute& route : trade_routes_) ids.push_back(route.id);
+        std::map<int, bool> active_before;  // Oldest recorded value wins
+        std::vector<int> removed;
+        for (auto it = frame.entries.rbegin(); it != frame.entries.rend(); ++it) {
+            switch (it->kind) {
+                case UndoEntry::Kind::kRouteAdded:
+                    ids.pop_back();
+                    break;
+                case UndoEntry::Kind::kRouteRemoved: {
+                    const int id = frame.removed_routes[it->count].id;
+                    ids.insert(ids.begin() + it->index, id);
+                    removed.push_back(id);
+                    break;
+                }
+                case UndoEntry::Kind::kRouteActive:
+                    active_before[ids[it->index]] = (it->count != 0);
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        json j_added = json::array();
+        json j_active = json::object();
+        for (const TradeRoute& route : trade_routes_) {
+            if (route.id >= frame.next_route_id_) {
+                j_added.push_back(TradeRouteJson(route));
+                continue;
+            }
+            auto it = active_before.find(route.id);
+            if (it != active_before.end() && it->second != route.active) {
+                j_active[std::to_string(route.id)] = route.active;
+            }
+        }
+        // A route created and removed by the same action never existed for the viewer.
+        json j_removed = json::array();
+        for (int id : removed) {
+            if (id < frame.next_route_id_) j_removed.push_back(id);
+        }
+        if (!j_added.empty()) j["routesAdded"] = j_added;
+        if (!j_removed.empty()) j["routesRemoved"] = j_removed;
+        if (!j_active.empty()) j["routesActive"] = j_active;
+    }
+
+    j["currentPlayerId"] = current_player_id_;
+    j["currentPhase"] = static_cast<int>(current_phase_);
+    j["midTurnState"] = MidTurnStateJson(meeples_in_hand_, current_mancala_path_,
+                                         current_mancala_hex_, last_action_hex_);
+    j["isTerminal"] = is_terminal_;
+
+    QueueChangeFeedEntry(j.dump(), /*snapshot=*/false);
+    if (change_feed_->since_snapshot >= change_feed_->snapshot_interval) {
+        RequestChangeFeedSnapshot();
+    }
+}
+
+// =====================================================================
+// Board cell access
+// =====================================================================
+const HexCell* Mali_BaState::CellAt(const HexCoord& hex) const {
+    int index = GetGame()->CoordToIndex(hex);
+    return (index >= 0) ? &board_[index] : nullptr;
+}
+
+// Every board write goes through here, which lets the undo journal capture a
+// cell before the first change an action makes to it.
+HexCell* Mali_BaState::MutableCellAt(const HexCoord& hex) {
+    int index = GetGame()->CoordToIndex(hex);
+    if (index < 0) return nullptr;
+    JournalCell(index);
+    return &WritableCell(index);
+}
+
+void Mali_BaState::SetTokensAt(const HexCoord& hex, const std::vector<PlayerColor>& colors) {
+    HexCell* cell = MutableCellAt(hex);
+    if (cell == nullptr) {
+        LOG_WARN("SetTokensAt: ignoring off-board hex ", hex.ToString());
+        return;
+    }
+    cell->ClearTokens();
+    for (PlayerColor color : colors) {
+        if (color != PlayerColor::kEmpty) cell->AddToken(color);
+    }
+}
+
+void Mali_BaState::SetMeeplesAt(const HexCoord& hex, const std::vector<MeepleColor>& meeples) {
+    HexCell* cell = MutableCellAt(hex);
+    if (cell == nullptr) {
+        LOG_WARN("SetMeeplesAt: ignoring off-board hex ", hex.ToString());
+        return;
+    }
+    cell->ClearMeeples();
+    for (MeepleColor mc : meeples) {
+        if (mc != MeepleColor::kEmpty) cell->AddMeeple(mc);
+    }
+}
+
+void Mali_BaState::SetTradePostsAt(const HexCoord& hex, const std::vector<TradePost>& posts) {
+    HexCell* cell = MutableCellAt(hex);
+    if (cell == nullptr) {
+        LOG_WARN("SetTradePostsAt: ignoring off-board hex ", hex.ToString());
+        return;
+    }
+    cell->post_mask = 0;
+    cell->center_mask = 0;
+    for (const auto& post : posts) {
+        if (post.owner != PlayerColor::kEmpty) cell->SetPost(post.owner, post.type);
+    }
+}
+
 // Helpers for Token management
 bool Mali_BaState::HasTokenAt(const HexCoord& hex, PlayerColor color) const {
-    auto it = player_token_locations_.find(hex);
-    if (it == player_token_locations_.end()) return false;
-    
-    const auto& tokens = it->second;
-    return std::find(tokens.begin(), tokens.end(), color) != tokens.end();
+    if (color == PlayerColor::kEmpty) return false;
+    const HexCell* cell = CellAt(hex);
+    return cell != nullptr && cell->HasToken(color);
 }
 
 int Mali_BaState::CountTokensAt(const HexCoord& hex, PlayerColor color) const {
-    auto it = player_token_locations_.find(hex);
-    if (it == player_token_locations_.end()) return 0;
-    
-    const auto& tokens = it->second;
-    return std::count(tokens.begin(), tokens.end(), color);
+    if (color == PlayerColor::kEmpty) return 0;
+    const HexCell* cell = CellAt(hex);
+    return (cell != nullptr) ? cell->TokenCount(color) : 0;
 }
 
 int Mali_BaState::CountTotalTokensAt(const HexCoord& hex) const {
-    auto it = player_token_locations_.find(hex);
-    if (it == player_token_locations_.end()) return 0;
-    return it->second.size();
+    const HexCell* cell = CellAt(hex);
+    return (cell != nullptr) ? cell->num_tokens : 0;
 }
 
 std::vector<PlayerColor> Mali_BaState::GetTokensAt(const HexCoord& hex) const {
-    auto it = player_token_locations_.find(hex);
-    if (it == player_token_locations_.end()) return {};
-    return it->second;
+    std::vector<PlayerColor> tokens;
+    const HexCell* cell = CellAt(hex);
+    if (cell == nullptr) return tokens;
+    for (int c = 0; c < kNumPlayerColors; ++c) {
+        tokens.insert(tokens.end(), cell->token_counts[c], static_cast<PlayerColor>(c));
+    }
+    return tokens;
 }
 
 bool Mali_BaState::RemoveTokenAt(const HexCoord& hex, PlayerColor color) {
-    auto it = player_token_locations_.find(hex);
-    if (it == player_token_locations_.end()) return false;
-    
-    auto& tokens = it->second;
-    auto token_it = std::find(tokens.begin(), tokens.end(), color);
-    if (token_it == tokens.end()) return false;
-    
-    tokens.erase(token_it);
-    
-    // Clean up empty hex entries
-    if (tokens.empty()) {
-        player_token_locations_.erase(it);
-    }
-    
-    return true;
+    if (color == PlayerColor::kEmpty) return false;
+    HexCell* cell = MutableCellAt(hex);
+    return cell != nullptr && cell->RemoveToken(color);
 }
 
 void Mali_BaState::AddTokenAt(const HexCoord& hex, PlayerColor color) {
-    player_token_locations_[hex].push_back(color);
+    HexCell* cell = MutableCellAt(hex);
+    SPIEL_CHECK_TRUE(cell != nullptr);
+    SPIEL_CHECK_NE(color, PlayerColor::kEmpty);
+    cell->AddToken(color);
 }
 
 PlayerColor Mali_BaState::GetFirstTokenAt(const HexCoord& hex) const {
-    auto it = player_token_locations_.find(hex);
-    if (it == player_token_locations_.end() || it->second.empty()) {
-        return PlayerColor::kEmpty;
-    }
-    return it->second[0];
+    const HexCell* cell = CellAt(hex);
+    return (cell != nullptr) ? cell->FirstToken() : PlayerColor::kEmpty;
 }
 
 // Deserialize is not included here - it would be part of the Game class in mali_ba_game.cc
@@ -22,8 +22,8 @@ namespace mali_ba {
 void Mali_BaState::ApplyChanceSetup() {
     LOG_INFO("ApplyChanceSetup: START");
     
-    for (auto const &[hex, meeples] : hex_meeples_) {
-        SPIEL_CHECK_TRUE(meeples.empty());
+    for (const HexCell& cell : board_) {
+        SPIEL_CHECK_EQ(cell.num_meeples, 0);
     }
 
     std::vector<MeepleColor> all_meeple_colors = {
@@ -35,30 +35,19 @@ void Mali_BaState::ApplyChanceSetup() {
     };
 
     std::uniform_int_distribution<int> dist(0, all_meeple_colors.size() - 1);
+    Mali_BaRng& rng = GetRNG();
+    JournalBoard();
 
     // Place 3 random meeples on EVERY valid hex, including cities.
-    for (const auto &hex : GetGame()->GetValidHexes()) {
-
-        // **ADD THIS DEBUG CODE:**
-        // if (hex.x == 5 && hex.y == 1 && hex.z == -6) {
-        //     LOG_INFO("DEBUG: Processing hex 5,1,-6 in ApplyChanceSetup");
-        //     bool exists_in_meeples = hex_meeples_.count(hex) > 0;
-        //     LOG_INFO("DEBUG: hex_meeples_.count(5,1,-6): ", exists_in_meeples);
-        // }
-
-        SPIEL_CHECK_TRUE(hex_meeples_.count(hex));
-        hex_meeples_[hex].clear();
-
+    // Hexes are visited in index order, which is the same (sorted) order as
+    // GetValidHexes(), so a given seed still produces the same board.
+    for (int index = 0; index < static_cast<int>(board_.size()); ++index) {
+        HexCell& cell = WritableCell(index);
+        cell.ClearMeeples();
         for (int i = 0; i < 3; ++i) {
-            int random_index = dist(rng_);
-            hex_meeples_[hex].push_back(all_meeple_colors[random_index]);
+            int random_index = dist(rng);
+            cell.AddMeeple(all_meeple_colors[random_index]);
         }
-
-        // **ADD THIS DEBUG CODE:**
-        // if (hex.x == 5 && hex.y == 1 && hex.z == -6) {
-        //     LOG_INFO("DEBUG: Added ", hex_meeples_[hex].size(), " meeples to 5,1,-6");
-        // }
-
     }
     
     LOG_INFO("ApplyChanceSetup: END");
@@ -135,17 +124,22 @@ PlayerColor Mali_BaState::GetNextPlayerColor(PlayerColor current) const {
 
 // Entity getters 
 PlayerColor Mali_BaState::GetPlayerTokenAt(const HexCoord& hex) const {
-    auto it = player_token_locations_.find(hex);
-    if (it != player_token_locations_.end() && !it->second.empty()) {
-        return it->second[0]; // Return first token for backward compatibility
+    return GetFirstTokenAt(hex); // Lowest-numbered color present, for backward compatibility
+}
+
+std::vector<MeepleColor> Mali_BaState::GetMeeplesAt(const HexCoord& hex) const {
+    std::vector<MeepleColor> meeples;
+    const HexCell* cell = CellAt(hex);
+    if (cell != nullptr && cell->num_meeples > 0) {
+        meeples.reserve(cell->num_meeples);
+        cell->AppendMeeples(&meeples);
     }
-    return PlayerColor::kEmpty;
+    return meeples;
 }
 
-const std::vector<MeepleColor>& Mali_BaState::GetMeeplesAt(const HexCoord& hex) const {
-    static const std::vector<MeepleColor> empty_vector;
-    auto it = hex_meeples_.find(hex);
-    return (it != hex_meeples_.end()) ? it->second : empty_vector;
+int Mali_BaState::CountMeeplesAt(const HexCoord& hex) const {
+    const HexCell* cell = CellAt(hex);
+    return (cell != nullptr) ? cell->num_meeples : 0;
 }
 
 
@@ -233,7 +227,7 @@ bool Mali_BaState::SetStateFromJson(const std::string& json_str) {
                             colors.push_back(static_cast<PlayerColor>(color_int.get<int>()));
                         }
                         if (!colors.empty()) {
-                            player_token_locations_[*hex] = colors;
+                            SetTokensAt(*hex, colors);
                         }
                     }
                 }
@@ -248,7 +242,7 @@ bool Mali_BaState::SetStateFromJson(const std::string& json_str) {
                     for (const auto& mc_int : meeple_array) {
                         meeples.push_back(static_cast<MeepleColor>(mc_int.get<int>()));
                     }
-                    hex_meeples_[*hex] = meeples;
+                    SetMeeplesAt(*hex, meeples);
                 }
             }
         }
@@ -264,7 +258,7 @@ bool Mali_BaState::SetStateFromJson(const std::string& json_str) {
                         post.type = static_cast<TradePostType>(post_obj.at("type").get<int>());
                         posts.push_back(post);
                     }
-                    trade_posts_locations_[*hex] = posts;
+                    SetTradePostsAt(*hex, posts);
                 }
             }
         }
@@ -273,27 +267,27 @@ bool Mali_BaState::SetStateFromJson(const std::string& json_str) {
             auto j_mid = j.at("midTurnState");
             
             if (j_mid.contains("meeplesInHand")) {
-                state->meeples_in_hand_.clear(); // Or just meeples_in_hand_.clear() if inside the class
+                meeples_in_hand_.clear();
                 for (const auto& mc_val : j_mid.at("meeplesInHand")) {
-                    state->meeples_in_hand_.push_back(static_cast<MeepleColor>(mc_val.get<int>()));
+                    meeples_in_hand_.push_back(static_cast<MeepleColor>(mc_val.get<int>()));
                 }
             }
             if (j_mid.contains("mancalaPath")) {
-                state->current_mancala_path_.clear();
+                current_mancala_path_.clear();
                 for (const auto& hc_str : j_mid.at("mancalaPath")) {
                     if (auto hc = JsonStringToHexCoord(hc_str.get<std::string>())) {
-                        state->current_mancala_path_.push_back(*hc);
+                        current_mancala_path_.push_back(*hc);
                     }
                 }
             }
             if (j_mid.contains("mancalaHex")) {
                 if (auto hc = JsonStringToHexCoord(j_mid.at("mancalaHex").get<std::string>())) {
-                    state->current_mancala_hex_ = *hc;
+                    current_mancala_hex_ = *hc;
                 }
             }
             if (j_mid.contains("lastActionHex")) {
                 if (auto hc = JsonStringToHexCoord(j_mid.at("lastActionHex").get<std::string>())) {
-                    state->last_action_hex_ = *hc;
+                    last_action_hex_ = *hc;
                 }
             }
         }
@@ -347,7 +341,7 @@ bool Mali_BaState::SetStateFromJson(const std::string& json_str) {
                 }
                 
                 if (j_route.contains("goods")) {
-                    route.goods = j_route.at("goods").get<std::map<std::string, int>>();
+                    route.goods = GoodCountsFromMap(j_route.at("goods").get<std::map<std::string, int>>(), /*rare=*/false);
                 }
                 
                 route.active = j_route.value("active", true);
@@ -362,7 +356,10 @@ bool Mali_BaState::SetStateFromJson(const std::string& json_str) {
         
         // Clean up and refresh
         ClearCaches();
+        InvalidateScoreCounters();
+        InvalidateHashKey();
         RefreshTerminalStatus();
+        RequestChangeFeedSnapshot();
         
         LOG_INFO("✅ State successfully set from JSON");
         return true;
@@ -426,11 +423,6 @@ void Mali_BaState::ResetToInitialState() {
     current_player_color_ = PlayerColor::kEmpty;
     current_phase_ = Phase::kSetup;
     
-    // Initialize hex_meeples_ with empty vectors for all valid hexes
-    for (const auto& hex : GetGame()->GetValidHexes()) {
-        hex_meeples_[hex] = std::vector<MeepleColor>();
-    }
-    
     // Regenerate initial meeple distribution using existing setup function
     ApplyChanceSetup();
     
@@ -440,28 +432,32 @@ void Mali_BaState::ResetToInitialState() {
     current_player_color_ = GetPlayerColor(current_player_id_);
     
     ClearCaches();
+    InvalidateScoreCounters();
+    InvalidateHashKey();
     RefreshTerminalStatus();
+    RequestChangeFeedSnapshot();
     
     LOG_INFO("✅ Reset to initial state complete");
 }
 
 void Mali_BaState::ClearAllState() {
-    player_token_locations_.clear();
-    hex_meeples_.clear();
-    trade_posts_locations_.clear();
+    board_.assign(GetGame()->NumHexes(), HexCell());
+    InvalidateObservationPlanes();
     moves_history_.clear();
     trade_routes_.clear();
     
     // Clear resources
     for (auto& player_goods : common_goods_) {
-        player_goods.clear();
+        player_goods.fill(0);
     }
     for (auto& player_goods : rare_goods_) {
-        player_goods.clear();
+        player_goods.fill(0);
     }
     
     next_route_id_ = 1;
     ClearCaches();
+    InvalidateScoreCounters();
+    InvalidateHashKey();
 }
 
 
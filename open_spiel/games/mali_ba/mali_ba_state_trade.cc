@@ -3,8 +3,11 @@
 
 #include "open_spiel/games/mali_ba/mali_ba_state.h"
 #include "open_spiel/games/mali_ba/mali_ba_game.h"
+#include "open_spiel/games/mali_ba/mali_ba_perf.h"
 
+#include <algorithm>
 #include <string>
+#include <utility>
 #include <vector>
 #include <map>
 
@@ -15,8 +18,9 @@ namespace mali_ba {
 // Trading Post & Center Methods
 // =====================================================================
 void Mali_BaState::AddTradingPost(const HexCoord& hex, PlayerColor player, TradePostType type) {
-    auto& posts = trade_posts_locations_[hex];  // Add to the board
-    posts.push_back({player, type});            // Track post/center for the player
+    HexCell* cell = MutableCellAt(hex);
+    SPIEL_CHECK_TRUE(cell != nullptr);
+    cell->SetPost(player, type);                // Track post/center for the player
 
     // If the number of posts per player is not unlimited then update the player's post inventory
     Player player_id = GetPlayerId(player);
@@ -26,6 +30,7 @@ void Mali_BaState::AddTradingPost(const HexCoord& hex, PlayerColor player, Trade
         if (type == TradePostType::kPost) {
             // Decrement the player's post supply if posts per player is not unlimited
             SPIEL_CHECK_GT(player_posts_supply_[player_id], 0);
+            JournalPostsSupply(player_id);
             player_posts_supply_[player_id]--;
             //LOG_INFO("Add: Player ", player_id, " placed a post. Supply now: ", 
             //    player_posts_supply_[player_id]);
@@ -33,6 +38,7 @@ void Mali_BaState::AddTradingPost(const HexCoord& hex, PlayerColor player, Trade
         else {
             // They're placing a trading *center* (i.e. upgrading) so increment the 
             // player's number of posts as it comes off the board back into inventory
+            JournalPostsSupply(player_id);
             player_posts_supply_[player_id]++;
             //LOG_INFO("Add: Player ", player_id, " placed a center. Post supply now: ", 
             //    player_posts_supply_[player_id]);
@@ -42,116 +48,57 @@ void Mali_BaState::AddTradingPost(const HexCoord& hex, PlayerColor player, Trade
 
 
 void Mali_BaState::UpgradeTradingPost(const HexCoord& hex, PlayerColor player) {
-    auto& posts = trade_posts_locations_[hex];
-    for (auto& post : posts) {
-        if (post.owner == player && post.type == TradePostType::kPost) {
-            post.type = TradePostType::kCenter;
-            
-            // If the number of posts per player is not unlimited then update the player's post inventory
-            Player player_id = GetPlayerId(player);
-            const GameRules& rules = GetGame()->GetRules();  // get the game rules
-            if (rules.posts_per_player != kUnlimitedPosts) { // Only decrement if posts are limited
-                // They're placing a trading *center* (i.e. upgrading) so increment the 
-                // player's number of posts as it comes off the board back into inventory
-                player_posts_supply_[player_id]++;
-                //LOG_INFO("Upgrade: Player ", player_id, " placed a center. Post supply now: ", 
-                //    player_posts_supply_[player_id]);
-            }
-            
-            // If the rule is enabled and meeples are present: Remove one meeple 
-            if (rules.remove_meeple_on_upgrade) {
-                const auto& meeples = GetMeeplesAt(hex);
-                if (!meeples.empty()) {
-                    // Remove the first meeple from the hex
-                    RemoveMeepleAt(hex, 0);  // Remove meeple at index 0
-                    LOG_DEBUG("Removed one meeple from hex ", hex.ToString(), " due to trading post upgrade");
-                }
-            }
-            
-            break;  // Only upgrade one post per call
-        }
+    HexCell* cell = MutableCellAt(hex);
+    if (cell == nullptr || !cell->HasPost(player)) return;
+    cell->SetPost(player, TradePostType::kCenter);
+
+    // If the number of posts per player is not unlimited then update the player's post inventory
+    Player player_id = GetPlayerId(player);
+    const GameRules& rules = GetGame()->GetRules();  // get the game rules
+    if (rules.posts_per_player != kUnlimitedPosts) { // Only decrement if posts are limited
+        // They're placing a trading *center* (i.e. upgrading) so increment the 
+        // player's number of posts as it comes off the board back into inventory
+        JournalPostsSupply(player_id);
+        player_posts_supply_[player_id]++;
+        //LOG_INFO("Upgrade: Player ", player_id, " placed a center. Post supply now: ", 
+        //    player_posts_supply_[player_id]);
+    }
+
+    // If the rule is enabled and meeples are present: Remove one meeple 
+    if (rules.remove_meeple_on_upgrade && cell->num_meeples > 0) {
+        // Remove the first meeple from the hex
+        RemoveMeepleAt(hex, 0);  // Remove meeple at index 0
+        LOG_DEBUG("Removed one meeple from hex ", hex.ToString(), " due to trading post upgrade");
     }
 }
 
-const std::vector<TradePost>& Mali_BaState::GetTradePostsAt(const HexCoord& hex) const {
-    static const std::vector<TradePost> empty_vector;
-    auto it = trade_posts_locations_.find(hex);
-    return (it != trade_posts_locations_.end()) ? it->second : empty_vector;
+std::vector<TradePost> Mali_BaState::GetTradePostsAt(const HexCoord& hex) const {
+    std::vector<TradePost> posts;
+    const HexCell* cell = CellAt(hex);
+    if (cell != nullptr && cell->HasAnyPost()) cell->AppendTradePosts(&posts);
+    return posts;
+}
+
+TradePostType Mali_BaState::GetPlayerPostType(const HexCoord& hex, PlayerColor player) const {
+    if (player == PlayerColor::kEmpty) return TradePostType::kNone;
+    const HexCell* cell = CellAt(hex);
+    return (cell != nullptr) ? cell->PostTypeOf(player) : TradePostType::kNone;
 }
 
 bool Mali_BaState::HasPlayerPostOrCenterAt(const HexCoord& hex, PlayerColor player) const {
-    const auto& posts = GetTradePostsAt(hex);
-    for (const auto& post : posts) {
-        if (post.owner == player) {
-            return true; // Player already has a post or center here
-        }
-    }
-    return false;
+    if (player == PlayerColor::kEmpty) return false;
+    const HexCell* cell = CellAt(hex);
+    return cell != nullptr && cell->HasPostOrCenter(player);
 }
 
 
 int Mali_BaState::CountTradingCentersAt(const HexCoord& hex) const {
-    const auto& posts = GetTradePostsAt(hex);
-    int count = 0;
-    for (const auto& post : posts) {
-        if (post.type == TradePostType::kCenter) {
-            count++;
-        }
-    }
-    return count;
+    const HexCell* cell = CellAt(hex);
+    return (cell != nullptr) ? cell->NumCenters() : 0;
 }
 
 bool Mali_BaState::CanPlaceTradingPostAt(const HexCoord& hex, PlayerColor player) const {
-    // 1. Check if player already has a post or center here
-    if (HasPlayerPostOrCenterAt(hex, player)) {
-        return false; // Player already has something here
-    }
-
-    // 2. Check if they have enough trading posts in their supply (may be unlimited)
-    const GameRules& rules = GetGame()->GetRules(); // Get game rules
-    int posts_in_supply = player_posts_supply_[current_player_id_];
-    // Check if player has posts available (or if they are unlimited)
-    if (rules.posts_per_player != kUnlimitedPosts && posts_in_supply < 1) {
-        return false;
-    }
-    
-    // 3. Check if this is a city - cities vs. non-cities have special rules for trading centers
-    bool is_city = false;
-    for (const auto& city : GetGame()->GetCities()) {
-        if (city.location == hex) {
-            is_city = true;
-            break;
-        }
-    }
-    // For non-city hexes, check the (n-1) trading centers limit
-    if (!is_city) {
-        int center_count = CountTradingCentersAt(hex);
-        int player_count = game_->NumPlayers();
-        
-        if (center_count >= player_count - 1) {
-            return false; // Already at max trading centers for this hex
-        }
-    }
-    
-    // 4. Check if there's at least one meeple here or if player has resources
-    const auto& meeples = GetMeeplesAt(hex);
-    if (!meeples.empty()) {
-        return true; // Has at least one meeple to support a trading post
-    }
-    
-    // 5. Check if player has resources to place a post without meeples
-    Player player_id = GetPlayerId(player);
-    if (player_id >= 0 && player_id < common_goods_.size()) {
-        int total_common = 0;
-        for (const auto& [good_name, count] : common_goods_[player_id]) {
-            total_common += count;
-        }
-        if (total_common > 0) {
-            return true; // Player has at least one common good to spend
-        }
-    }
-    
-    return false; // No meeples and no resources to place a post or other rule fails    
+    return Mali_BaWhatIf(*this).CanPlaceTradingPostAt(hex, player);
 }
 
 // =====================================================================
@@ -207,8 +154,7 @@ bool Mali_BaState::CreateTradeRoute(const std::vector<HexCoord>& hexes, PlayerCo
     // If the rule is enabled and meeples are present: Remove one meeple from each hex
     if (rules.remove_meeple_on_trade_route) {
         for (const HexCoord& hex : hexes) {
-            const auto& meeples = GetMeeplesAt(hex);
-            if (!meeples.empty()) {
+            if (CountMeeplesAt(hex) > 0) {
                 // Remove the first meeple from the hex
                 RemoveMeepleAt(hex, 0);  // Remove meeple at index 0
                 LOG_DEBUG("Removed one meeple from hex ", hex.ToString(), " due to trade route creation");
@@ -228,6 +174,7 @@ bool Mali_BaState::CreateTradeRoute(const std::vector<HexCoord>& hexes, PlayerCo
     route.goods = {}; // Goods calculation can be done on income, not creation.
     route.hexes = GetCanonicalRoute(route.hexes); // make sure hexes are sorted properly
     trade_routes_.push_back(route);
+    JournalRouteAdded();
     
     LOG_DEBUG("Moves: ",history_.size(), "| Trade route created successfully! Total routes now: ", trade_routes_.size());
     return true;
@@ -244,6 +191,7 @@ bool Mali_BaState::DeleteTradeRoute(int route_id) {
         return false;
     }
     
+    JournalRouteRemoved(static_cast<int>(it - trade_routes_.begin()));
     trade_routes_.erase(it);
     LOG_INFO("Trade route deleted successfully");
     return true;
@@ -251,60 +199,90 @@ bool Mali_BaState::DeleteTradeRoute(int route_id) {
 
 // Function to validate all trade routes
 void Mali_BaState::ValidateTradeRoutes() {
-    for (auto& route : trade_routes_) {
+    for (int i = 0; i < static_cast<int>(trade_routes_.size()); ++i) {
+        TradeRoute& route = trade_routes_[i];
         bool valid = true;
         
         // Check if player has trading post/center at each hex
         for (const auto& hex : route.hexes) {
-            bool has_player_post = false;
-            const auto& posts = GetTradePostsAt(hex);
-            
-            for (const auto& post : posts) {
-                if (post.owner == route.owner) {
-                    has_player_post = true;
-                    break;
-                }
-            }
-            
-            if (!has_player_post) {
+            if (!HasPlayerPostOrCenterAt(hex, route.owner)) {
                 valid = false;
                 break;
             }
         }
         
+        if (route.active != valid) JournalRouteActive(i);
         route.active = valid;
     }
 }
 
+// Every active route links each of its hexes to each city on it, so one
+// pass over the routes fills the whole table.
+const Mali_BaState::RouteConnectivity& Mali_BaState::GetRouteConnectivity() const {
+    if (route_connectivity_) return *route_connectivity_;
+    const Mali_BaGame* game = GetGame();
+    const int num_hexes = game->NumHexes();
+    auto connectivity = std::make_shared<RouteConnectivity>();
+    connectivity->routes_through.resize(num_hexes);
+    connectivity->connected_cities.resize(static_cast<size_t>(num_hexes) * kNumPlayerColors);
+
+    std::vector<int> route_cities;
+    for (int r = 0; r < static_cast<int>(trade_routes_.size()); ++r) {
+        const TradeRoute& route = trade_routes_[r];
+        if (!route.active || route.owner == PlayerColor::kEmpty) continue;
+        route_cities.clear();
+        for (const HexCoord& hex : route.hexes) {
+            const int index = game->CoordToIndex(hex);
+            const int city = index >= 0 ? game->CityIdAtIndex(index) : -1;
+            if (city >= 0) route_cities.push_back(city);
+        }
+        for (const HexCoord& hex : route.hexes) {
+            const int index = game->CoordToIndex(hex);
+            if (index < 0) continue;
+            connectivity->routes_through[index].push_back(r);
+            std::vector<int>& cities = connectivity->connected_cities[
+                static_cast<size_t>(index) * kNumPlayerColors + static_cast<int>(route.owner)];
+            for (int city : route_cities) {
+                if (std::find(cities.begin(), cities.end(), city) == cities.end()) cities.push_back(city);
+            }
+        }
+    }
+    route_connectivity_ = std::move(connectivity);
+    return *route_connectivity_;
+}
+
+const std::vector<int>& Mali_BaState::ConnectedCityIds(int hex_index, PlayerColor player) const {
+    static const std::vector<int>* const kNone = new std::vector<int>();
+    if (player == PlayerColor::kEmpty || hex_index < 0 || hex_index >= GetGame()->NumHexes()) {
+        return *kNone;
+    }
+    return GetRouteConnectivity().connected_cities[
+        static_cast<size_t>(hex_index) * kNumPlayerColors + static_cast<int>(player)];
+}
+
 // Helper method to find cities connected to a trading center via trade routes
 std::vector<const City*> Mali_BaState::GetConnectedCities(const HexCoord& center_hex, PlayerColor player) const {
     std::vector<const City*> connected_cities;
-    
-    // Find all trade routes owned by this player that include this hex
-    for (const auto& route : trade_routes_) {
-        if (route.owner == player && route.active && 
-            std::find(route.hexes.begin(), route.hexes.end(), center_hex) != route.hexes.end()) {
-            
-            // Check which cities are in this route
-            for (const auto& route_hex : route.hexes) {
-                for (const auto& city : GetGame()->GetCities()) {
-                    if (city.location == route_hex) {
-                        // Make sure we don't add duplicates
-                        if (std::find(connected_cities.begin(), connected_cities.end(), &city) == connected_cities.end()) {
-                            connected_cities.push_back(&city);
-                        }
-                    }
-                }
-            }
-        }
+    const std::vector<City>& cities = GetGame()->GetCities();
+    for (int city : ConnectedCityIds(GetGame()->CoordToIndex(center_hex), player)) {
+        connected_cities.push_back(&cities[city]);
     }
-    
     return connected_cities;
 }
 
 // Helper method to find closest cities to a hex
 std::vector<const City*> Mali_BaState::FindClosestCities(const HexCoord& hex) const {
     std::vector<const City*> closest_cities;
+    const int index = GetGame()->CoordToIndex(hex);
+    if (index >= 0) {
+        const std::vector<City>& cities = GetGame()->GetCities();
+        for (int city_id : GetGame()->NearestCityIds(index)) {
+            closest_cities.push_back(&cities[city_id]);
+        }
+        return closest_cities;
+    }
+
+    // Off-board hex: no table entry
     int min_distance = std::numeric_limits<int>::max();
     
     for (const auto& city : GetGame()->GetCities()) {
@@ -326,24 +304,31 @@ std::vector<const City*> Mali_BaState::FindClosestCities(const HexCoord& hex) co
 // Functions to generate & apply legal moves for creating a trading route
 // =====================================================================
 std::vector<Move> Mali_BaState::GenerateTradeRouteMoves() const {
-    std::vector<Move> moves;
+    thread_local std::vector<PackedMove> packed;
+    GenerateTradeRouteMoves(&packed);
+    return UnpackMoves(packed);
+}
+
+void Mali_BaState::GenerateTradeRouteMoves(std::vector<PackedMove>* moves) const {
+    MALI_BA_PERF_SCOPE(kTradeRouteMoves);
+    moves->clear();
     const GameRules& rules = GetGame()->GetRules();
 
     // Do not generate these moves if they are free actions, as they will be
     // generated as part of compound moves instead.
     if (rules.free_action_trade_routes) {
-        return moves;
+        return;
     }
 
     PlayerColor p_color = GetCurrentPlayerColor();
-    if (p_color == PlayerColor::kEmpty) return moves;
+    if (p_color == PlayerColor::kEmpty) return;
 
     // Find all possible valid routes.
     // We limit the search to routes up to 5 hexes to keep it fast.
     auto all_possible_routes = FindPossibleTradeRoutes(p_color, true, nullptr, 5);
     
     if (all_possible_routes.empty()) {
-        return moves;
+        return;
     }
 
     // --- Heuristic Selection ---
@@ -356,21 +341,24 @@ std::vector<Move> Mali_BaState::GenerateTradeRouteMoves() const {
 
     int routes_to_add = std::min((int)all_possible_routes.size(), 5);
     for (int i = 0; i < routes_to_add; ++i) {
-        Move move;
-        move.type = ActionType::kTradeRouteCreate;
-        move.player = p_color;
-        move.path = all_possible_routes[i];
-        move.route_id = i; // The index becomes the ID for MoveToAction encoding
-        moves.push_back(move);
+        PackedMove move;
+        move.type = static_cast<int8_t>(ActionType::kTradeRouteCreate);
+        move.player = static_cast<int8_t>(p_color);
+        PackRoute(all_possible_routes[i], &move);
+        move.route_id = static_cast<int16_t>(i); // The index becomes the ID for MoveToAction encoding
+        moves->push_back(move);
     }
-    
-    return moves;
 }
 
 // Add this helper function to perform additional validation
 // This gets called directly from MaybeGenerateLegalActions()
 bool Mali_BaState::IsValidTradeRouteForMoveGeneration(
     const std::vector<HexCoord>& route_hexes, PlayerColor player) const {
+    return IsValidTradeRouteOn(BoardOverlay(board_), route_hexes, player);
+}
+
+bool Mali_BaState::IsValidTradeRouteOn(const BoardOverlay& board,
+    const std::vector<HexCoord>& route_hexes, PlayerColor player) const {
     
     const GameRules& rules = GetGame()->GetRules();
     
@@ -387,17 +375,8 @@ bool Mali_BaState::IsValidTradeRouteForMoveGeneration(
     // 2. Check that all hexes have the player's trading centers
     // (Since we're only considering player_centers, this should always pass, but double-check)
     for (const auto& hex : sorted_route) {
-        bool has_center = false;
-        auto posts_it = trade_posts_locations_.find(hex);
-        if (posts_it != trade_posts_locations_.end()) {
-            for (const auto& post : posts_it->second) {
-                if (post.owner == player && post.type == TradePostType::kCenter) {
-                    has_center = true;
-                    break;
-                }
-            }
-        }
-        if (!has_center) {
+        const int index = GetGame()->CoordToIndex(hex);
+        if (index < 0 || !board[index].HasCenter(player)) {
             return false;
         }
     }
@@ -443,6 +422,7 @@ bool Mali_BaState::IsValidTradeRouteForMoveGeneration(
 // Functions to generate & apply legal moves for taking income
 // =====================================================================
 std::vector<Move> Mali_BaState::GenerateIncomeMoves() const {
+    MALI_BA_PERF_SCOPE(kIncomeMoves);
     std::vector<Move> moves;
     Player player_id = current_player_id_;
     if (player_id < 0) return moves;
@@ -451,116 +431,122 @@ std::vector<Move> Mali_BaState::GenerateIncomeMoves() const {
 
     // Check if there is any potential source of income.
     bool has_any_income_source = false;
-    for (const auto& [hex, posts] : trade_posts_locations_) {
-        for (const auto& post : posts) {
-            if (post.owner == player_color) {
-                has_any_income_source = true;
-                break;
-            }
+    for (const HexCell& cell : board_) {
+        if (cell.HasPostOrCenter(player_color)) {
+            has_any_income_source = true;
+            break;
         }
-        if (has_any_income_source) break;
     }
     if (!has_any_income_source) return moves;
 
     // Define strategic profiles
-    GoodsCollection profile_new_rare;
-    GoodsCollection profile_new_common;
-    GoodsCollection profile_max_total;
-    GoodsCollection profile_hoard_rare;
+    GoodsCounts profile_new_rare;
+    GoodsCounts profile_new_common;
+    GoodsCounts profile_max_total;
+    GoodsCounts profile_hoard_rare;
 
     // --- Iterate through all income sources and apply heuristics for each profile ---
-    for (const auto& [hex, posts] : trade_posts_locations_) {
-        for (const auto& post : posts) {
-            if (post.owner != player_color) continue;
-
-            const City* city_at_hex = GetGame()->GetCityAt(hex);
-
-            // Guaranteed income from centers in cities
-            if (post.type == TradePostType::kCenter && city_at_hex) {
-                profile_new_rare.rare_goods[city_at_hex->rare_good]++;
-                profile_new_common.rare_goods[city_at_hex->rare_good]++;
-                profile_max_total.rare_goods[city_at_hex->rare_good]++;
-                profile_hoard_rare.rare_goods[city_at_hex->rare_good]++;
-                continue; // This source is handled, move to next post
-            }
+    // Cities come from the game's per-hex tables and the cached route
+    // connectivity, so no source rescans the routes or the city list.
+    const Mali_BaGame* game = GetGame();
+    const std::vector<City>& cities = game->GetCities();
+    std::vector<const City*> choice_cities;
+    for (int hex_index = 0; hex_index < static_cast<int>(board_.size()); ++hex_index) {
+        const TradePostType post_type = board_[hex_index].PostTypeOf(player_color);
+        if (post_type == TradePostType::kNone) continue;
+
+        const int city_id = game->CityIdAtIndex(hex_index);
+        const City* city_at_hex = city_id >= 0 ? &cities[city_id] : nullptr;
+        const std::vector<int>& nearest = game->NearestCityIds(hex_index);
+
+        // Guaranteed income from centers in cities
+        if (post_type == TradePostType::kCenter && city_at_hex) {
+            profile_new_rare.rare_goods[city_at_hex->rare_good_id]++;
+            profile_new_common.rare_goods[city_at_hex->rare_good_id]++;
+            profile_max_total.rare_goods[city_at_hex->rare_good_id]++;
+            profile_hoard_rare.rare_goods[city_at_hex->rare_good_id]++;
+            continue; // This source is handled, move to next hex
+        }
 
-            // Income from trading posts
-            if (post.type == TradePostType::kPost) {
-                auto closest = FindClosestCities(hex);
-                if (!closest.empty()) {
-                    const std::string& good = closest[0]->common_good;
-                    profile_new_rare.common_goods[good]++;
-                    profile_new_common.common_goods[good]++;
-                    profile_max_total.common_goods[good]++;
-                    profile_hoard_rare.common_goods[good]++;
-                }
-                continue;
+        // Income from trading posts
+        if (post_type == TradePostType::kPost) {
+            if (!nearest.empty()) {
+                const int good = cities[nearest[0]].common_good_id;
+                profile_new_rare.common_goods[good]++;
+                profile_new_common.common_goods[good]++;
+                profile_max_total.common_goods[good]++;
+                profile_hoard_rare.common_goods[good]++;
             }
+            continue;
+        }
+
+        // Choices for centers not in cities
+        if (post_type == TradePostType::kCenter && !city_at_hex) {
+            const std::vector<int>& connected = ConnectedCityIds(hex_index, player_color);
+            choice_cities.clear();
+            for (int city : connected.empty() ? nearest : connected) choice_cities.push_back(&cities[city]);
+            if (choice_cities.empty()) continue;
+            const City* first_city = choice_cities[0];
+            const City* second_city = choice_cities.size() > 1 ? choice_cities[1] : choice_cities[0];
 
-            // Choices for centers not in cities
-            if (post.type == TradePostType::kCenter && !city_at_hex) {
-                auto connected = GetConnectedCities(hex, player_color);
-                const auto& choice_cities = connected.empty() ? FindClosestCities(hex) : connected;
-                if (choice_cities.empty()) continue;
-
-                // --- Apply heuristics for this choice point ---
-                
-                // Profile: Maximize New Rare Goods
-                const City* best_new_rare_city = nullptr;
-                if (!connected.empty()) { // Can only take rare goods if connected
-                    for (const auto* city : choice_cities) {
-                        if (GetRareGoodCount(player_id, city->rare_good) == 0) {
-                            best_new_rare_city = city;
-                            break;
-                        }
+            // --- Apply heuristics for this choice point ---
+            
+            // Profile: Maximize New Rare Goods
+            const City* best_new_rare_city = nullptr;
+            if (!connected.empty()) { // Can only take rare goods if connected
+                for (const auto* city : choice_cities) {
+                    if (GetRareGoodCount(player_id, city->rare_good_id) == 0) {
+                        best_new_rare_city = city;
+                        break;
                     }
                 }
-                if (best_new_rare_city) {
-                    profile_new_rare.rare_goods[best_new_rare_city->rare_good]++;
-                } else { // No new rare goods available, take 2 common instead
-                    profile_new_rare.common_goods[choice_cities[0]->common_good]++;
-                    profile_new_rare.common_goods[choice_cities.size() > 1 ? choice_cities[1]->common_good : choice_cities[0]->common_good]++;
-                }
+            }
+            if (best_new_rare_city) {
+                profile_new_rare.rare_goods[best_new_rare_city->rare_good_id]++;
+            } else { // No new rare goods available, take 2 common instead
+                profile_new_rare.common_goods[first_city->common_good_id]++;
+                profile_new_rare.common_goods[second_city->common_good_id]++;
+            }
 
-                // Profile: Hoard Rare Goods (take any rare good if possible)
-                if (!connected.empty()) {
-                    profile_hoard_rare.rare_goods[choice_cities[0]->rare_good]++;
-                } else { // Isolated, must take common
-                    profile_hoard_rare.common_goods[choice_cities[0]->common_good]+=2;
-                }
+            // Profile: Hoard Rare Goods (take any rare good if possible)
+            if (!connected.empty()) {
+                profile_hoard_rare.rare_goods[first_city->rare_good_id]++;
+            } else { // Isolated, must take common
+                profile_hoard_rare.common_goods[first_city->common_good_id]+=2;
+            }
 
-                // Profile: Maximize New Common Goods
-                // (This heuristic is complex, for now we just take the first two distinct goods)
-                const City* best_new_common1 = choice_cities[0];
-                const City* best_new_common2 = choice_cities.size() > 1 ? choice_cities[1] : choice_cities[0];
-                profile_new_common.common_goods[best_new_common1->common_good]++;
-                profile_new_common.common_goods[best_new_common2->common_good]++;
+            // Profile: Maximize New Common Goods
+            // (This heuristic is complex, for now we just take the first two distinct goods)
+            profile_new_common.common_goods[first_city->common_good_id]++;
+            profile_new_common.common_goods[second_city->common_good_id]++;
 
-                // Profile: Maximize Total Goods (2 common is generally better than 1 rare)
-                profile_max_total.common_goods[choice_cities[0]->common_good]++;
-                profile_max_total.common_goods[choice_cities.size() > 1 ? choice_cities[1]->common_good : choice_cities[0]->common_good]++;
-            }
+            // Profile: Maximize Total Goods (2 common is generally better than 1 rare)
+            profile_max_total.common_goods[first_city->common_good_id]++;
+            profile_max_total.common_goods[second_city->common_good_id]++;
         }
     }
 
     // --- De-duplicate and create final moves ---
-    std::set<std::string> unique_actions;
-    std::vector<GoodsCollection> profiles = {profile_new_rare, profile_new_common, profile_max_total, profile_hoard_rare};
-
-    for (const auto& profile_outcome : profiles) {
-        if (profile_outcome.IsEmpty()) continue;
-
-        std::string action_str = "income " + FormatGoodsCollectionCompact(profile_outcome);
-        std::string normalized_action = NormalizeIncomeAction(action_str);
-
-        if (unique_actions.find(normalized_action) == unique_actions.end()) {
-            unique_actions.insert(normalized_action);
-            Move move;
-            move.type = ActionType::kIncome;
-            move.player = player_color;
-            move.action_string = normalized_action;
-            moves.push_back(move);
+    // Equal counts format to equal strings, so duplicates are dropped on the
+    // counts and only distinct profiles are formatted. Ids are in alphabetical
+    // order, so the formatted string is already in the NormalizeIncomeAction() form.
+    const GoodsCounts* profiles[] = {&profile_new_rare, &profile_new_common, &profile_max_total, &profile_hoard_rare};
+
+    for (int i = 0; i < 4; ++i) {
+        const GoodsCounts* profile_outcome = profiles[i];
+        if (profile_outcome->IsEmpty()) continue;
+        bool seen = false;
+        for (int j = 0; j < i && !seen; ++j) {
+            seen = profiles[j]->common_goods == profile_outcome->common_goods &&
+                   profiles[j]->rare_goods == profile_outcome->rare_goods;
         }
+        if (seen) continue;
+
+        Move move;
+        move.type = ActionType::kIncome;
+        move.player = player_color;
+        move.action_string = "income " + FormatGoodsCountsCompact(*profile_outcome);
+        moves.push_back(move);
     }
     return moves;
 }
@@ -576,39 +562,158 @@ bool Mali_BaState::IsValidCompoundUpgradeAndRoute(const HexCoord& upgrade_hex,
         return false;
     }
 
-    // --- THIS IS THE CRITICAL FIX ---
-    // Create a temporary copy of the state's trade posts to simulate the upgrade.
-    Mali_BaState temp_state = *this;
+    // Simulate the upgrade on a view of the board; the post must be there to upgrade.
+    const HexCell* cell = CellAt(upgrade_hex);
+    if (cell == nullptr || !cell->HasPost(player)) return false;
+    Mali_BaWhatIf what_if(*this);
+    what_if.UpgradeTradingPost(upgrade_hex, player);
     
-    // Simulate the upgrade in the temporary state
-    bool found_post_to_upgrade = false;
-    auto it = temp_state.trade_posts_locations_.find(upgrade_hex);
-    if (it != temp_state.trade_posts_locations_.end()) {
-        for (auto& post : it->second) {
-            if (post.owner == player && post.type == TradePostType::kPost) {
-                post.type = TradePostType::kCenter;
-                found_post_to_upgrade = true;
-                break;
+    // Validate against the upgraded view, which checks duplicates and shared centers.
+    return what_if.IsValidTradeRoute(route_path, player);
+}
+
+
+namespace {
+
+// Depth-first walk over combinations of candidate centers. At each candidate
+// the branch that skips it is taken first, which visits combinations in the
+// same order as a std::next_permutation sweep over a 0..01..1 selector.
+//
+// The rules are checked as the combination grows instead of on every full
+// combination: `shared[r]` counts the chosen candidates that lie on existing
+// route r, so a branch is cut as soon as it shares too many centers with r.
+// A full combination duplicates r exactly when all of r's hexes are chosen
+// and nothing else is.
+class TradeRouteEnumerator {
+public:
+    TradeRouteEnumerator(const std::vector<HexCoord>& candidates, int required,
+                         bool apply_rules, int max_shared,
+                         std::vector<std::vector<int>> routes_through,
+                         std::vector<int> route_sizes)
+        : candidates_(candidates), required_(required), apply_rules_(apply_rules),
+          max_shared_(max_shared), routes_through_(std::move(routes_through)),
+          route_sizes_(std::move(route_sizes)), shared_(route_sizes_.size(), 0) {}
+
+    void Enumerate(int route_length, std::vector<std::vector<HexCoord>>* out) {
+        route_length_ = route_length;
+        out_ = out;
+        chosen_.clear();
+        Visit(0);
+    }
+
+private:
+    void Visit(int position) {
+        const int needed = route_length_ - static_cast<int>(chosen_.size());
+        if (needed == 0) {
+            Emit();
+            return;
+        }
+        const int remaining = static_cast<int>(candidates_.size()) - position;
+        if (remaining < needed) return;
+
+        if (remaining > needed && position != required_) Visit(position + 1);
+
+        if (!Take(position)) {
+            Release(position);
+            return;
+        }
+        chosen_.push_back(position);
+        Visit(position + 1);
+        chosen_.pop_back();
+        Release(position);
+    }
+
+    // Counts `position` against the routes through it; false if that breaks
+    // the shared-center rule.
+    bool Take(int position) {
+        bool ok = true;
+        for (int r : routes_through_[position]) {
+            if (++shared_[r] > max_shared_ && apply_rules_ && max_shared_ >= 0) ok = false;
+        }
+        return ok;
+    }
+
+    void Release(int position) {
+        for (int r : routes_through_[position]) --shared_[r];
+    }
+
+    void Emit() {
+        if (apply_rules_) {
+            for (size_t r = 0; r < route_sizes_.size(); ++r) {
+                if (shared_[r] == route_length_ && route_sizes_[r] == route_length_) return;
             }
         }
+        std::vector<HexCoord> route;
+        route.reserve(chosen_.size());
+        for (int position : chosen_) route.push_back(candidates_[position]);
+        out_->push_back(std::move(route));
     }
-    // If for some reason the post to upgrade wasn't found, it's an invalid move.
-    if (!found_post_to_upgrade) return false;
-    
-    // NOW, use the standard validation function on the temporary state, which has the upgraded center.
-    // This correctly checks for duplicates and shared center violations.
-    return temp_state.IsValidTradeRouteForMoveGeneration(route_path, player);
-}
 
+    const std::vector<HexCoord>& candidates_;
+    const int required_;
+    const bool apply_rules_;
+    const int max_shared_;
+    const std::vector<std::vector<int>> routes_through_;
+    const std::vector<int> route_sizes_;
+    std::vector<int> shared_;
+    std::vector<int> chosen_;
+    int route_length_ = 0;
+    std::vector<std::vector<HexCoord>>* out_ = nullptr;
+};
+
+}  // namespace
+
+bool Mali_BaState::TradeRouteQuery::operator==(const TradeRouteQuery& other) const {
+    return player == other.player && is_valid_per_rules == other.is_valid_per_rules &&
+           has_includes_hex == other.has_includes_hex &&
+           (!has_includes_hex || includes_hex == other.includes_hex) &&
+           max_hexes == other.max_hexes && min_hexes == other.min_hexes;
+}
 
-// Flexible function to find possible trade routes with optional filtering
+// Flexible function to find possible trade routes with optional filtering.
+// Results are memoized on the state until ClearCaches(), so legal-action
+// generation and action decoding share one enumeration, also with copies.
 std::vector<std::vector<HexCoord>> Mali_BaState::FindPossibleTradeRoutes(
     PlayerColor player,
     bool is_valid_per_rules,
     const HexCoord* includes_hex,
     int max_hexes,
     int min_hexes) const {
+    MALI_BA_PERF_SCOPE(kRouteSearch);
     
+    TradeRouteQuery query;
+    query.player = player;
+    query.is_valid_per_rules = is_valid_per_rules;
+    query.has_includes_hex = includes_hex != nullptr;
+    if (includes_hex) query.includes_hex = *includes_hex;
+    query.max_hexes = max_hexes;
+    query.min_hexes = min_hexes;
+    if (cached_trade_routes_) {
+        for (const auto& [cached_query, cached_routes] : *cached_trade_routes_) {
+            if (cached_query == query) return cached_routes;
+        }
+    }
+
+    std::vector<std::vector<HexCoord>> routes = EnumerateTradeRoutes(
+        BoardOverlay(board_), player, is_valid_per_rules, includes_hex, max_hexes, min_hexes);
+    // Copies of this state may share the cache; extend a private copy.
+    if (!cached_trade_routes_) {
+        cached_trade_routes_ = std::make_shared<TradeRouteCache>();
+    } else if (cached_trade_routes_.use_count() > 1) {
+        cached_trade_routes_ = std::make_shared<TradeRouteCache>(*cached_trade_routes_);
+    }
+    cached_trade_routes_->emplace_back(query, routes);
+    return routes;
+}
+
+std::vector<std::vector<HexCoord>> Mali_BaState::EnumerateTradeRoutes(
+    const BoardOverlay& board,
+    PlayerColor player,
+    bool is_valid_per_rules,
+    const HexCoord* includes_hex,
+    int max_hexes,
+    int min_hexes) const {
+
     const GameRules &rules = GetGame()->GetRules(); 
     std::vector<std::vector<HexCoord>> valid_routes;
     int max_len_allowed = 8;    
@@ -622,53 +727,60 @@ std::vector<std::vector<HexCoord>> Mali_BaState::FindPossibleTradeRoutes(
     if (max_hexes == -1) max_hexes = max_len_allowed;
     if (max_hexes < min_hexes) max_hexes = min_hexes;
     
+    // Candidates in hex-index order, which is also HexCoord order, so every
+    // combination comes out already canonical.
     std::vector<HexCoord> available_centers;
-    for (const auto& [hex, posts] : trade_posts_locations_) {
-        for (const auto& post : posts) {
-            if (post.owner == player && post.type == TradePostType::kCenter) {
-                available_centers.push_back(hex);
-                break;
-            }
+    std::vector<int> candidate_of_hex(board.size(), -1);
+    int required = -1;
+    for (int i = 0; i < static_cast<int>(board.size()); ++i) {
+        if (board[i].HasCenter(player)) {
+            candidate_of_hex[i] = static_cast<int>(available_centers.size());
+            available_centers.push_back(GetGame()->IndexToCoord(i));
         }
     }
     
+    bool needs_sorting = false;
     if (includes_hex) {
-        bool includes_hex_is_center = false;
-        for (const auto& center_hex : available_centers) {
-            if (center_hex == *includes_hex) {
-                includes_hex_is_center = true;
-                break;
-            }
+        const int index = GetGame()->CoordToIndex(*includes_hex);
+        if (index >= 0 && candidate_of_hex[index] >= 0) {
+            required = candidate_of_hex[index];
+        } else {
+            // Not one of the player's centers, so no route through it is valid.
+            if (is_valid_per_rules) return valid_routes;
+            required = static_cast<int>(available_centers.size());
+            available_centers.push_back(*includes_hex);
+            needs_sorting = true;
         }
-        if (!includes_hex_is_center) available_centers.push_back(*includes_hex);
     }
     
     if (available_centers.size() < min_hexes) return valid_routes;
     max_hexes = std::min(max_hexes, static_cast<int>(available_centers.size()));
-    
-    for (int route_length = min_hexes; route_length <= max_hexes; ++route_length) {
-        std::vector<bool> selector(available_centers.size(), false);
-        std::fill(selector.begin() + selector.size() - route_length, selector.end(), true);
-        
-        do {
-            std::vector<HexCoord> route_combination;
-            for (size_t i = 0; i < available_centers.size(); ++i) {
-                if (selector[i]) route_combination.push_back(available_centers[i]);
-            }
-            
-            route_combination = GetCanonicalRoute(route_combination);
-            
-            if (includes_hex) {
-                if (std::find(route_combination.begin(), route_combination.end(), *includes_hex) == route_combination.end()) continue;
-            }
-            
-            if (is_valid_per_rules) {
-                if (!IsValidTradeRouteForMoveGeneration(route_combination, player)) continue;
+
+    // The player's active routes, as the candidates each one passes through.
+    std::vector<std::vector<int>> routes_through(available_centers.size());
+    std::vector<int> route_sizes;
+    if (is_valid_per_rules) {
+        for (const auto& existing_route : trade_routes_) {
+            if (existing_route.owner != player || !existing_route.active) continue;
+            const int route_index = static_cast<int>(route_sizes.size());
+            route_sizes.push_back(static_cast<int>(existing_route.hexes.size()));
+            for (const auto& hex : existing_route.hexes) {
+                const int index = GetGame()->CoordToIndex(hex);
+                if (index >= 0 && candidate_of_hex[index] >= 0) {
+                    routes_through[candidate_of_hex[index]].push_back(route_index);
+                }
             }
-            
-            valid_routes.push_back(route_combination);
-            
-        } while (std::next_permutation(selector.begin(), selector.end()));
+        }
+    }
+
+    TradeRouteEnumerator enumerator(available_centers, required, is_valid_per_rules,
+                                    rules.max_shared_centers_between_routes,
+                                    std::move(routes_through), std::move(route_sizes));
+    for (int route_length = min_hexes; route_length <= max_hexes; ++route_length) {
+        enumerator.Enumerate(route_length, &valid_routes);
+    }
+    if (needs_sorting) {
+        for (auto& route : valid_routes) route = GetCanonicalRoute(route);
     }
     
     return valid_routes;
@@ -706,6 +818,150 @@ std::vector<HexCoord> Mali_BaState::GetCanonicalRoute(const std::vector<HexCoord
 }
 
 
+// =====================================================================
+// What-if view: posts, tokens and goods changed without a state copy
+// =====================================================================
+int Mali_BaWhatIf::Index(const HexCoord& hex) const {
+    return state_.GetGame()->CoordToIndex(hex);
+}
+
+const HexCell* Mali_BaWhatIf::CellAt(const HexCoord& hex) const {
+    const int index = Index(hex);
+    return (index >= 0) ? &board_[index] : nullptr;
+}
+
+void Mali_BaWhatIf::AddTradingPost(const HexCoord& hex, PlayerColor player, TradePostType type) {
+    const int index = Index(hex);
+    SPIEL_CHECK_GE(index, 0);
+    board_.Mutable(index).SetPost(player, type);
+
+    if (state_.GetGame()->GetRules().posts_per_player != kUnlimitedPosts) {
+        if (posts_supply_delta_.empty()) posts_supply_delta_.assign(state_.NumPlayers(), 0);
+        posts_supply_delta_[state_.GetPlayerId(player)] += (type == TradePostType::kPost) ? -1 : 1;
+    }
+}
+
+void Mali_BaWhatIf::UpgradeTradingPost(const HexCoord& hex, PlayerColor player) {
+    const int index = Index(hex);
+    if (index < 0 || !board_[index].HasPost(player)) return;
+    HexCell& cell = board_.Mutable(index);
+    cell.SetPost(player, TradePostType::kCenter);
+
+    const GameRules& rules = state_.GetGame()->GetRules();
+    if (rules.posts_per_player != kUnlimitedPosts) {
+        if (posts_supply_delta_.empty()) posts_supply_delta_.assign(state_.NumPlayers(), 0);
+        posts_supply_delta_[state_.GetPlayerId(player)]++;
+    }
+    if (rules.remove_meeple_on_upgrade && cell.num_meeples > 0) {
+        cell.RemoveMeeple(cell.MeepleAt(0));
+    }
+}
+
+void Mali_BaWhatIf::AddToken(const HexCoord& hex, PlayerColor player) {
+    const int index = Index(hex);
+    SPIEL_CHECK_GE(index, 0);
+    SPIEL_CHECK_NE(player, PlayerColor::kEmpty);
+    board_.Mutable(index).AddToken(player);
+}
+
+void Mali_BaWhatIf::AdjustCommonGood(Player player, int good_id, int delta) {
+    for (GoodDelta& entry : common_good_deltas_) {
+        if (entry.player == player && entry.good_id == good_id) {
+            entry.delta += delta;
+            return;
+        }
+    }
+    common_good_deltas_.push_back({player, good_id, delta});
+}
+
+int Mali_BaWhatIf::PostsSupply(Player player) const {
+    const int base = state_.player_posts_supply_[player];
+    return posts_supply_delta_.empty() ? base : base + posts_supply_delta_[player];
+}
+
+int Mali_BaWhatIf::CommonGoodCount(Player player, int good_id) const {
+    int count = state_.GetCommonGoodCount(player, good_id);
+    for (const GoodDelta& entry : common_good_deltas_) {
+        if (entry.player == player && entry.good_id == good_id) count += entry.delta;
+    }
+    return count;
+}
+
+int Mali_BaWhatIf::TotalCommonGoods(Player player) const {
+    int total = 0;
+    if (player >= 0 && player < static_cast<int>(state_.common_goods_.size())) {
+        for (int count : state_.common_goods_[player]) total += count;
+    }
+    for (const GoodDelta& entry : common_good_deltas_) {
+        if (entry.player == player) total += entry.delta;
+    }
+    return total;
+}
+
+bool Mali_BaWhatIf::CanPlaceTradingPostAt(const HexCoord& hex, PlayerColor player) const {
+    const HexCell* cell = CellAt(hex);
+
+    // 1. Check if player already has a post or center here
+    if (player != PlayerColor::kEmpty && cell != nullptr && cell->HasPostOrCenter(player)) {
+        return false; // Player already has something here
+    }
+
+    // 2. Check if they have enough trading posts in their supply (may be unlimited)
+    const GameRules& rules = state_.GetGame()->GetRules(); // Get game rules
+    int posts_in_supply = PostsSupply(state_.current_player_id_);
+    // Check if player has posts available (or if they are unlimited)
+    if (rules.posts_per_player != kUnlimitedPosts && posts_in_supply < 1) {
+        return false;
+    }
+    
+    // 3. Check if this is a city - cities vs. non-cities have special rules for trading centers
+    bool is_city = false;
+    for (const auto& city : state_.GetGame()->GetCities()) {
+        if (city.location == hex) {
+            is_city = true;
+            break;
+        }
+    }
+    // For non-city hexes, check the (n-1) trading centers limit
+    if (!is_city) {
+        int center_count = (cell != nullptr) ? cell->NumCenters() : 0;
+        int player_count = state_.NumPlayers();
+        
+        if (center_count >= player_count - 1) {
+            return false; // Already at max trading centers for this hex
+        }
+    }
+    
+    // 4. Check if there's at least one meeple here or if player has resources
+    if (cell != nullptr && cell->num_meeples > 0) {
+        return true; // Has at least one meeple to support a trading post
+    }
+    
+    // 5. Check if player has resources to place a post without meeples
+    Player player_id = state_.GetPlayerId(player);
+    if (player_id >= 0 && TotalCommonGoods(player_id) > 0) {
+        return true; // Player has at least one common good to spend
+    }
+    
+    return false; // No meeples and no resources to place a post or other rule fails    
+}
+
+bool Mali_BaWhatIf::IsValidTradeRoute(const std::vector<HexCoord>& route_hexes,
+                                      PlayerColor player) const {
+    return state_.IsValidTradeRouteOn(board_, route_hexes, player);
+}
+
+std::vector<std::vector<HexCoord>> Mali_BaWhatIf::FindPossibleTradeRoutes(
+    PlayerColor player,
+    bool is_valid_per_rules,
+    const HexCoord* includes_hex,
+    int max_hexes,
+    int min_hexes) const {
+    return state_.EnumerateTradeRoutes(board_, player, is_valid_per_rules, includes_hex,
+                                       max_hexes, min_hexes);
+}
+
+
 // =====================================================================
 // Helper Functions related to trade
 // =====================================================================
@@ -811,37 +1067,114 @@ std::string FormatGoodsCollectionCompact(const GoodsCollection& collection) {
     }
 }
 
+std::string FormatGoodsCountsCompact(const GoodsCounts& counts) {
+    const GoodsManager& goods_manager = GoodsManager::GetInstance();
+    std::string result;
+    for (int rare = 0; rare < 2; ++rare) {
+        if (rare) result += '|';
+        const GoodCounts& goods = rare ? counts.rare_goods : counts.common_goods;
+        bool first = true;
+        for (int id = 0; id < kNumGoodTypes; ++id) {
+            if (goods[id] <= 0) continue;
+            if (!first) result += ',';
+            first = false;
+            result += rare ? goods_manager.GetRareGoodName(id) : goods_manager.GetCommonGoodName(id);
+            result += ':';
+            result += std::to_string(goods[id]);
+        }
+    }
+    // Same shape as FormatGoodsCollectionCompact(): "c|", "|r" or "c|r"
+    return result == "|" ? "" : result;
+}
+
+GoodCounts GoodCountsFromMap(const std::map<std::string, int>& goods, bool rare) {
+    const GoodsManager& goods_manager = GoodsManager::GetInstance();
+    GoodCounts counts{};
+    for (const auto& [good_name, count] : goods) {
+        const int id = rare ? goods_manager.GetRareGoodIndex(good_name)
+                            : goods_manager.GetCommonGoodIndex(good_name);
+        if (id < 0) {
+            LOG_WARN("Ignoring unknown ", rare ? "rare" : "common", " good '", good_name, "'");
+            continue;
+        }
+        counts[id] = count;
+    }
+    return counts;
+}
+
+std::map<std::string, int> GoodCountsToMap(const GoodCounts& counts, bool rare) {
+    const GoodsManager& goods_manager = GoodsManager::GetInstance();
+    std::map<std::string, int> goods;
+    for (int id = 0; id < kNumGoodTypes; ++id) {
+        if (counts[id] == 0) continue;
+        goods[rare ? goods_manager.GetRareGoodName(id) : goods_manager.GetCommonGoodName(id)] = counts[id];
+    }
+    return goods;
+}
+
+GoodsCounts ToGoodsCounts(const GoodsCollection& collection) {
+    GoodsCounts counts;
+    counts.common_goods = GoodCountsFromMap(collection.common_goods, /*rare=*/false);
+    counts.rare_goods = GoodCountsFromMap(collection.rare_goods, /*rare=*/true);
+    return counts;
+}
+
+GoodsCollection ToGoodsCollection(const GoodsCounts& counts) {
+    GoodsCollection collection;
+    collection.common_goods = GoodCountsToMap(counts.common_goods, /*rare=*/false);
+    collection.rare_goods = GoodCountsToMap(counts.rare_goods, /*rare=*/true);
+    return collection;
+}
+
 // Resource Management Methods
-int Mali_BaState::GetCommonGoodCount(Player player, const std::string& good_name) const {
-    if (player < 0 || player >= common_goods_.size())
+int Mali_BaState::GetCommonGoodCount(Player player, int good_id) const {
+    if (player < 0 || player >= common_goods_.size() || good_id < 0 || good_id >= kNumGoodTypes)
         return 0; // Bounds check
-    const auto& player_goods = common_goods_[player];
-    auto it = player_goods.find(good_name);
-    return (it != player_goods.end()) ? it->second : 0;
+    return common_goods_[player][good_id];
 }
 
-int Mali_BaState::GetRareGoodCount(Player player, const std::string& good_name) const {
-    if (player < 0 || player >= rare_goods_.size())
+int Mali_BaState::GetRareGoodCount(Player player, int good_id) const {
+    if (player < 0 || player >= rare_goods_.size() || good_id < 0 || good_id >= kNumGoodTypes)
         return 0; // Bounds check
-    const auto& player_goods = rare_goods_[player];
-    auto it = player_goods.find(good_name);
-    return (it != player_goods.end()) ? it->second : 0;
+    return rare_goods_[player][good_id];
 }
 
-const std::map<std::string, int>& Mali_BaState::GetPlayerCommonGoods(Player player) const {
-    static const std::map<std::string, int> empty_map;
+int Mali_BaState::GetCommonGoodCount(Player player, const std::string& good_name) const {
+    return GetCommonGoodCount(player, GoodsManager::GetInstance().GetCommonGoodIndex(good_name));
+}
+
+int Mali_BaState::GetRareGoodCount(Player player, const std::string& good_name) const {
+    return GetRareGoodCount(player, GoodsManager::GetInstance().GetRareGoodIndex(good_name));
+}
+
+const GoodCounts& Mali_BaState::GetPlayerCommonGoods(Player player) const {
+    static const GoodCounts empty_counts{};
     if (player < 0 || player >= common_goods_.size())
-        return empty_map; // Bounds check
+        return empty_counts; // Bounds check
     return common_goods_[player];
 }
 
-const std::map<std::string, int>& Mali_BaState::GetPlayerRareGoods(Player player) const {
-    static const std::map<std::string, int> empty_map;
+const GoodCounts& Mali_BaState::GetPlayerRareGoods(Player player) const {
+    static const GoodCounts empty_counts{};
     if (player < 0 || player >= rare_goods_.size())
-        return empty_map; // Bounds check
+        return empty_counts; // Bounds check
     return rare_goods_[player];
 }
 
+void Mali_BaState::SetCommonGoods(const std::vector<std::map<std::string, int>>& goods) {
+    common_goods_.assign(goods.size(), GoodCounts{});
+    for (int p = 0; p < static_cast<int>(goods.size()); ++p) {
+        common_goods_[p] = GoodCountsFromMap(goods[p], /*rare=*/false);
+    }
+}
+
+void Mali_BaState::SetRareGoods(const std::vector<std::map<std::string, int>>& goods) {
+    rare_goods_.assign(goods.size(), GoodCounts{});
+    for (int p = 0; p < static_cast<int>(goods.size()); ++p) {
+        rare_goods_[p] = GoodCountsFromMap(goods[p], /*rare=*/true);
+    }
+}
+
 std::string Mali_BaState::NormalizeIncomeAction(const std::string& action_string) const {
     if (action_string.find("income") != 0) {
         return action_string;
@@ -903,45 +1236,52 @@ void Mali_BaState::TestOnly_SetCurrentPlayer(Player player) {
 }
 
 void Mali_BaState::TestOnly_SetTradePost(const HexCoord& hex, PlayerColor owner, TradePostType type) {
-    // Clear existing posts at this hex for this player to avoid duplicates
-    auto& posts = trade_posts_locations_[hex];
-    posts.erase(std::remove_if(posts.begin(), posts.end(), 
-                               [owner](const TradePost& p){ return p.owner == owner; }), 
-                posts.end());
-    // Add the new post
-    posts.push_back({owner, type});
+    // Replaces any existing post/center this player has at the hex
+    HexCell* cell = MutableCellAt(hex);
+    SPIEL_CHECK_TRUE(cell != nullptr);
+    cell->SetPost(owner, type);
 }
 
 void Mali_BaState::TestOnly_SetPlayerToken(const HexCoord& hex, PlayerColor owner) {
     AddTokenAt(hex, owner); // Use new helper method
 }
 void Mali_BaState::TestOnly_SetPlayerTokens(const HexCoord& hex, const std::vector<PlayerColor>& owners) {
-    player_token_locations_[hex] = owners;
+    SetTokensAt(hex, owners);
 }
 
 void Mali_BaState::TestOnly_SetMeeples(const HexCoord& hex, const std::vector<MeepleColor>& meeples) {
-    hex_meeples_[hex] = meeples;
+    SetMeeplesAt(hex, meeples);
 }
 
 void Mali_BaState::TestOnly_SetCommonGood(Player player, const std::string& good_name, int count) {
     SPIEL_CHECK_GE(player, 0);
     SPIEL_CHECK_LT(player, common_goods_.size());
-    common_goods_[player][good_name] = count;
+    const int good_id = GoodsManager::GetInstance().GetCommonGoodIndex(good_name);
+    SPIEL_CHECK_GE(good_id, 0);
+    common_goods_[player][good_id] = count;
+    InvalidateScoreCounters(kGoodsCounters);
+    InvalidateHashKey(kGoodsHash);
 }
 
 void Mali_BaState::TestOnly_SetRareGood(Player player, const std::string& good_name, int count) {
     SPIEL_CHECK_GE(player, 0);
     SPIEL_CHECK_LT(player, rare_goods_.size());
-    rare_goods_[player][good_name] = count;
+    const int good_id = GoodsManager::GetInstance().GetRareGoodIndex(good_name);
+    SPIEL_CHECK_GE(good_id, 0);
+    rare_goods_[player][good_id] = count;
+    InvalidateScoreCounters(kGoodsCounters);
+    InvalidateHashKey(kGoodsHash);
 }
 
 void Mali_BaState::TestOnly_ClearPlayerTokens() {
-    player_token_locations_.clear();
+    for (int index = 0; index < static_cast<int>(board_.size()); ++index) {
+        WritableCell(index).ClearTokens();
+    }
 }
 
 void Mali_BaState::TestOnly_ClearMeeples() {
-    for (auto& [hex, meeples] : hex_meeples_) {
-        meeples.clear();
+    for (int index = 0; index < static_cast<int>(board_.size()); ++index) {
+        WritableCell(index).ClearMeeples();
     }
 }
 
@@ -0,0 +1,252 @@
+// mali_ba_state_undo.cc
+// Incremental undo journal: records what each action changes and reverts it
+
+#include "open_spiel/games/mali_ba/mali_ba_state.h"
+#include "open_spiel/games/mali_ba/mali_ba_game.h"
+#include "open_spiel/games/mali_ba/mali_ba_perf.h"
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace open_spiel {
+namespace mali_ba {
+
+// =====================================================================
+// Recording
+// =====================================================================
+
+// Opens a new frame holding the scalar turn state. Board, goods and route
+// changes are appended to it by the Journal* helpers while the action runs.
+void Mali_BaState::BeginUndoFrame() {
+    UndoFrame frame;
+    frame.current_player_id_ = current_player_id_;
+    frame.current_player_color_ = current_player_color_;
+    frame.current_phase_ = current_phase_;
+    frame.next_route_id_ = next_route_id_;
+    frame.pending_route_declaration_ = pending_route_declaration_;
+    frame.current_mancala_hex_ = current_mancala_hex_;
+    frame.last_action_hex_ = last_action_hex_;
+    frame.meeples_in_hand_ = meeples_in_hand_;
+    frame.current_mancala_path_ = current_mancala_path_;
+    frame.moves_history_size_ = moves_history_.size();
+    undo_journal_.push_back(std::move(frame));
+    undo_recording_ = true;
+}
+
+// Saves the contents of a cell the first time it is touched in this frame.
+void Mali_BaState::JournalCell(int index) {
+    if (!undo_recording_ || index < 0) return;
+    auto& entries = undo_journal_.back().entries;
+    for (const UndoEntry& entry : entries) {
+        if (entry.kind == UndoEntry::Kind::kCell && entry.index == index) return;
+    }
+    UndoEntry entry;
+    entry.kind = UndoEntry::Kind::kCell;
+    entry.index = index;
+    entry.cell = board_[index];
+    entries.push_back(entry);
+}
+
+// Saves every cell; only used by the chance setup, which rewrites the whole board.
+void Mali_BaState::JournalBoard() {
+    if (!undo_recording_) return;
+    auto& entries = undo_journal_.back().entries;
+    SPIEL_CHECK_TRUE(entries.empty());
+    entries.reserve(board_.size());
+    for (int i = 0; i < static_cast<int>(board_.size()); ++i) {
+        UndoEntry entry;
+        entry.kind = UndoEntry::Kind::kCell;
+        entry.index = i;
+        entry.cell = board_[i];
+        entries.push_back(entry);
+    }
+}
+
+void Mali_BaState::JournalGood(UndoEntry::Kind kind, Player player, int good_id) {
+    if (!undo_recording_) return;
+    const GoodCounts& goods = (kind == UndoEntry::Kind::kRareGood) ? rare_goods_[player]
+                                                                   : common_goods_[player];
+    UndoEntry entry;
+    entry.kind = kind;
+    entry.player = player;
+    entry.index = good_id;
+    entry.count = goods[good_id];
+    undo_journal_.back().entries.push_back(entry);
+}
+
+void Mali_BaState::JournalPostsSupply(Player player) {
+    if (!undo_recording_) return;
+    UndoEntry entry;
+    entry.kind = UndoEntry::Kind::kPostsSupply;
+    entry.player = player;
+    entry.count = player_posts_supply_[player];
+    undo_journal_.back().entries.push_back(entry);
+}
+
+void Mali_BaState::JournalRouteAdded() {
+    OnTradeRoutesChanged();
+    if (!undo_recording_) return;
+    UndoEntry entry;
+    entry.kind = UndoEntry::Kind::kRouteAdded;
+    undo_journal_.back().entries.push_back(entry);
+}
+
+void Mali_BaState::JournalRouteRemoved(int index) {
+    OnTradeRoutesChanged();
+    if (!undo_recording_) return;
+    UndoFrame& frame = undo_journal_.back();
+    UndoEntry entry;
+    entry.kind = UndoEntry::Kind::kRouteRemoved;
+    entry.index = index;
+    entry.count = static_cast<int>(frame.removed_routes.size());
+    frame.removed_routes.push_back(trade_routes_[index]);
+    frame.entries.push_back(entry);
+}
+
+void Mali_BaState::JournalRouteActive(int index) {
+    OnTradeRoutesChanged();
+    if (!undo_recording_) return;
+    UndoEntry entry;
+    entry.kind = UndoEntry::Kind::kRouteActive;
+    entry.index = index;
+    entry.count = trade_routes_[index].active ? 1 : 0;
+    undo_journal_.back().entries.push_back(entry);
+}
+
+// All in-action goods changes go through these so they are journaled.
+void Mali_BaState::AdjustCommonGood(Player player, int good_id, int delta) {
+    SPIEL_CHECK_GE(good_id, 0);
+    SPIEL_CHECK_LT(good_id, kNumGoodTypes);
+    JournalGood(UndoEntry::Kind::kCommonGood, player, good_id);
+    int& count = common_goods_[player][good_id];
+    if (!(hash_stale_ & kGoodsHash)) {
+        goods_hash_ ^= ZobristGoodKey(false, player, good_id, count) ^
+                       ZobristGoodKey(false, player, good_id, count + delta);
+    }
+    count += delta;
+    score_counters_dirty_ |= kGoodsCounters;
+}
+
+void Mali_BaState::AdjustRareGood(Player player, int good_id, int delta) {
+    SPIEL_CHECK_GE(good_id, 0);
+    SPIEL_CHECK_LT(good_id, kNumGoodTypes);
+    JournalGood(UndoEntry::Kind::kRareGood, player, good_id);
+    int& count = rare_goods_[player][good_id];
+    if (!(hash_stale_ & kGoodsHash)) {
+        goods_hash_ ^= ZobristGoodKey(true, player, good_id, count) ^
+                       ZobristGoodKey(true, player, good_id, count + delta);
+    }
+    count += delta;
+    score_counters_dirty_ |= kGoodsCounters;
+}
+
+GoodCounts Mali_BaState::GoodsBeforeLastAction(Player player, bool rare) const {
+    GoodCounts goods = rare ? rare_goods_[player] : common_goods_[player];
+    if (undo_journal_.empty()) return goods;
+
+    const UndoEntry::Kind kind = rare ? UndoEntry::Kind::kRareGood : UndoEntry::Kind::kCommonGood;
+    const auto& entries = undo_journal_.back().entries;
+    for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+        if (it->kind != kind || it->player != player) continue;
+        goods[it->index] = it->count;
+    }
+    return goods;
+}
+
+// =====================================================================
+// Replay
+// =====================================================================
+void Mali_BaState::RevertUndoFrame(const UndoFrame& frame) {
+    for (auto it = frame.entries.rbegin(); it != frame.entries.rend(); ++it) {
+        const UndoEntry& entry = *it;
+        switch (entry.kind) {
+            case UndoEntry::Kind::kCell:
+                WritableCell(entry.index) = entry.cell;
+                break;
+            case UndoEntry::Kind::kCommonGood:
+            case UndoEntry::Kind::kRareGood: {
+                const bool rare = entry.kind == UndoEntry::Kind::kRareGood;
+                int& count = (rare ? rare_goods_ : common_goods_)[entry.player][entry.index];
+                if (!(hash_stale_ & kGoodsHash)) {
+                    goods_hash_ ^= ZobristGoodKey(rare, entry.player, entry.index, count) ^
+                                   ZobristGoodKey(rare, entry.player, entry.index, entry.count);
+                }
+                count = entry.count;
+                score_counters_dirty_ |= kGoodsCounters;
+                break;
+            }
+            case UndoEntry::Kind::kPostsSupply:
+                player_posts_supply_[entry.player] = entry.count;
+                break;
+            case UndoEntry::Kind::kRouteAdded:
+                SPIEL_CHECK_FALSE(trade_routes_.empty());
+                trade_routes_.pop_back();
+                OnTradeRoutesChanged();
+                break;
+            case UndoEntry::Kind::kRouteRemoved:
+                trade_routes_.insert(trade_routes_.begin() + entry.index,
+                                     frame.removed_routes[entry.count]);
+                OnTradeRoutesChanged();
+                break;
+            case UndoEntry::Kind::kRouteActive:
+                trade_routes_[entry.index].active = (entry.count != 0);
+                OnTradeRoutesChanged();
+                break;
+        }
+    }
+
+    current_player_id_ = frame.current_player_id_;
+    current_player_color_ = frame.current_player_color_;
+    current_phase_ = frame.current_phase_;
+    next_route_id_ = frame.next_route_id_;
+    pending_route_declaration_ = frame.pending_route_declaration_;
+    current_mancala_hex_ = frame.current_mancala_hex_;
+    last_action_hex_ = frame.last_action_hex_;
+    meeples_in_hand_ = frame.meeples_in_hand_;
+    current_mancala_path_ = frame.current_mancala_path_;
+    if (moves_history_.size() > frame.moves_history_size_) {
+        moves_history_.resize(frame.moves_history_size_);
+    }
+}
+
+void Mali_BaState::UndoAction(Player player, Action action) {
+    MALI_BA_PERF_SCOPE(kUndoAction);
+    SPIEL_CHECK_FALSE(undo_journal_.empty());
+    RevertUndoFrame(undo_journal_.back());
+    undo_journal_.pop_back();
+
+    if (!history_.empty()) {
+        history_.pop_back();
+    }
+    if (move_number_ > 0) {
+        move_number_--;
+    }
+
+    ClearCaches();
+    SyncHashKey();
+    is_terminal_ = false;
+    RequestChangeFeedSnapshot();
+}
+
+// Undoes the most recent action without the caller having to know it.
+void Mali_BaState::UndoLastAction() {
+    SPIEL_CHECK_FALSE(undo_journal_.empty());
+    SPIEL_CHECK_FALSE(history_.empty());
+    const PlayerAction last = history_.back();
+    UndoAction(last.player, last.action);
+}
+
+// Undoes every action the current player has taken since their turn began
+// (back to the kPlay phase). Does nothing at the start of a turn.
+void Mali_BaState::UndoToTurnStart() {
+    const Player player = current_player_id_;
+    while (!undo_journal_.empty() && current_phase_ != Phase::kPlay &&
+           undo_journal_.back().current_player_id_ == player) {
+        UndoLastAction();
+    }
+}
+
+}  // namespace mali_ba
+}  // namespace open_spiel
@@ -1,6 +1,32 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <random>
+#include <thread>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "open_spiel/games/mali_ba/mali_ba_archive.h"
+#include "open_spiel/games/mali_ba/mali_ba_board_config.h"
+#include "open_spiel/games/mali_ba/mali_ba_board_kernels.h"
 #include "open_spiel/games/mali_ba/mali_ba_game.h"
 #include "open_spiel/games/mali_ba/mali_ba_state.h"
 #include "open_spiel/games/mali_ba/mali_ba_common.h"
+#include "open_spiel/games/mali_ba/mali_ba_mcts.h"
+#include "open_spiel/games/mali_ba/mali_ba_memory.h"
+#include "open_spiel/games/mali_ba/mali_ba_move_log.h"
+#include "open_spiel/games/mali_ba/mali_ba_observer.h"
+#include "open_spiel/games/mali_ba/mali_ba_rng.h"
+#include "open_spiel/games/mali_ba/mali_ba_perf.h"
+#include "open_spiel/games/mali_ba/mali_ba_replay_buffer.h"
+#include "open_spiel/games/mali_ba/mali_ba_selfplay.h"
+#include "open_spiel/games/mali_ba/mali_ba_transposition.h"
+#include "open_spiel/games/mali_ba/mali_ba_vector_env.h"
 #include "open_spiel/spiel.h"
 #include "open_spiel/game_parameters.h"
 #include "open_spiel/tests/basic_tests.h"
@@ -89,6 +115,38 @@ namespace open_spiel
                     }
                     state->ApplyAction(action);
                 }
+
+                // Each generator's Move output must be its packed output unpacked,
+                // and each packed move must survive a trip through Move.
+                void CheckPackedGenerators() const
+                {
+                    std::vector<PackedMove> packed;
+                    auto check = [&](const std::vector<Move> &moves)
+                    {
+                        SPIEL_CHECK_EQ(moves.size(), packed.size());
+                        for (size_t i = 0; i < packed.size(); ++i)
+                        {
+                            SPIEL_CHECK_TRUE(mali_ba_state->UnpackMove(packed[i]) == moves[i]);
+                            SPIEL_CHECK_TRUE(mali_ba_state->PackMove(moves[i]) == packed[i]);
+                        }
+                    };
+                    mali_ba_state->GeneratePlaceTokenMoves(&packed);
+                    check(mali_ba_state->GeneratePlaceTokenMoves());
+                    mali_ba_state->GenerateTradePostUpgradeMoves(&packed);
+                    check(mali_ba_state->GenerateTradePostUpgradeMoves());
+                    mali_ba_state->GenerateTradeRouteMoves(&packed);
+                    check(mali_ba_state->GenerateTradeRouteMoves());
+
+                    // Mancala moves come out sorted and distinct without a sort pass.
+                    mali_ba_state->GenerateMancalaMoves(&packed);
+                    std::vector<Move> mancala = mali_ba_state->GenerateMancalaMoves();
+                    check(mancala);
+                    for (size_t i = 1; i < mancala.size(); ++i)
+                    {
+                        SPIEL_CHECK_TRUE(mancala[i - 1] < mancala[i]);
+                        SPIEL_CHECK_TRUE(packed[i - 1] < packed[i]);
+                    }
+                }
             };
 
             // =============================================================================
@@ -255,6 +313,1560 @@ namespace open_spiel
                 LOG_INFO("UndoActionTest passed.");
             }
 
+            // Plays a stretch of actions and rewinds them through the undo
+            // journal; every intermediate serialization must be restored exactly.
+            void UndoJournalTest_MultiStep(std::shared_ptr<const Game> game)
+            {
+                LOG_INFO("--- UndoJournalTest_MultiStep ---");
+                MaliBaTest test(game);
+                test.AdvanceToPlayPhase();
+
+                // UndoToTurnStart rewinds a partially played turn back to kPlay.
+                std::string turn_start = test.mali_ba_state->Serialize();
+                Player turn_player = test.mali_ba_state->CurrentPlayer();
+                while (!test.state->IsTerminal() &&
+                       test.mali_ba_state->CurrentPlayer() == turn_player)
+                {
+                    test.state->ApplyAction(test.mali_ba_state->LegalActions()[0]);
+                    if (test.mali_ba_state->CurrentPhase() == Phase::kPlay) break;
+                }
+                if (test.mali_ba_state->CurrentPhase() != Phase::kPlay)
+                {
+                    test.mali_ba_state->UndoToTurnStart();
+                    SPIEL_CHECK_EQ(test.mali_ba_state->Serialize(), turn_start);
+                }
+
+                std::vector<std::string> snapshots;
+                for (int i = 0; i < 40 && !test.state->IsTerminal(); ++i)
+                {
+                    snapshots.push_back(test.mali_ba_state->Serialize());
+                    std::vector<Action> legal_actions = test.mali_ba_state->LegalActions();
+                    SPIEL_CHECK_FALSE(legal_actions.empty());
+                    test.state->ApplyAction(legal_actions.back());
+                }
+
+                while (!snapshots.empty())
+                {
+                    test.mali_ba_state->UndoLastAction();
+                    SPIEL_CHECK_EQ(test.mali_ba_state->Serialize(), snapshots.back());
+                    snapshots.pop_back();
+                }
+
+                LOG_INFO("UndoJournalTest_MultiStep passed.");
+            }
+
+            // The binary encoding must round-trip everything the JSON form
+            // carries, plus the OpenSpiel history, and be much smaller.
+            void BinarySerializationTest(std::shared_ptr<const Game> game)
+            {
+                LOG_INFO("--- BinarySerializationTest ---");
+                MaliBaTest test(game);
+                test.AdvanceToPlayPhase();
+                std::mt19937 rng(5);
+                for (int i = 0; i < 40 && !test.state->IsTerminal(); ++i)
+                {
+                    std::vector<Action> actions = test.state->LegalActions();
+                    test.state->ApplyAction(actions[rng() % actions.size()]);
+                }
+
+                const auto *mali_ba_game = static_cast<const Mali_BaGame *>(game.get());
+                std::string binary = test.mali_ba_state->SerializeBinary();
+                std::unique_ptr<State> restored = mali_ba_game->DeserializeBinary(binary);
+                SPIEL_CHECK_EQ(restored->Serialize(), test.state->Serialize());
+                SPIEL_CHECK_EQ(restored->History(), test.state->History());
+                SPIEL_CHECK_EQ(restored->MoveNumber(), test.state->MoveNumber());
+                SPIEL_CHECK_EQ(restored->LegalActions(), test.state->LegalActions());
+                SPIEL_CHECK_LT(binary.size(), test.state->Serialize().size() / 4);
+
+                LOG_INFO("BinarySerializationTest passed (", binary.size(), " bytes vs ",
+                         test.state->Serialize().size(), " JSON).");
+            }
+
+            // The weight buffer must agree with the map form, and sampling must
+            // only pick legal actions the heuristic gives weight to.
+            void HeuristicWeightsTest(std::shared_ptr<const Game> game)
+            {
+                LOG_INFO("--- HeuristicWeightsTest ---");
+                MaliBaTest test(game);
+                test.AdvanceToPlayPhase();
+                std::vector<double> weights;
+                for (int i = 0; i < 40 && !test.state->IsTerminal(); ++i)
+                {
+                    if (test.mali_ba_state->CurrentPhase() == Phase::kPlay)
+                    {
+                        absl::Span<const Action> actions = test.mali_ba_state->HeuristicActionWeights(&weights);
+                        SPIEL_CHECK_EQ(std::vector<Action>(actions.begin(), actions.end()), test.state->LegalActions());
+                        SPIEL_CHECK_EQ(weights.size(), actions.size());
+                        const std::map<Action, double> by_action = test.mali_ba_state->GetHeuristicActionWeights();
+                        SPIEL_CHECK_EQ(by_action.size(), actions.size());
+                        bool any_positive = false;
+                        for (size_t a = 0; a < actions.size(); ++a)
+                        {
+                            SPIEL_CHECK_GE(weights[a], 0.0);
+                            SPIEL_CHECK_EQ(by_action.at(actions[a]), weights[a]);
+                            any_positive |= weights[a] > 1e-6;
+                        }
+                        for (int draw = 0; draw < 10; ++draw)
+                        {
+                            const Action chosen = test.mali_ba_state->SelectHeuristicRandomAction();
+                            SPIEL_CHECK_TRUE(by_action.count(chosen));
+                            if (any_positive) SPIEL_CHECK_GT(by_action.at(chosen), 0.0);
+                        }
+                    }
+                    else
+                    {
+                        SPIEL_CHECK_TRUE(test.mali_ba_state->HeuristicActionWeights(&weights).empty());
+                        SPIEL_CHECK_TRUE(weights.empty());
+                    }
+                    test.state->ApplyAction(test.mali_ba_state->SelectHeuristicRandomAction());
+                }
+
+                // Same seed, same game.
+                auto play = [&](uint32_t seed)
+                {
+                    std::unique_ptr<State> state = test.mali_ba_state->Clone();
+                    static_cast<Mali_BaState *>(state.get())->GetRNG().seed(seed);
+                    for (int i = 0; i < 30 && !state->IsTerminal(); ++i)
+                    {
+                        state->ApplyAction(static_cast<Mali_BaState *>(state.get())->SelectHeuristicRandomAction());
+                    }
+                    return state->History();
+                };
+                SPIEL_CHECK_EQ(play(11), play(11));
+                LOG_INFO("HeuristicWeightsTest passed.");
+            }
+
+            // Counters count only while enabled, sum over threads, and reset.
+            void PerfCountersTest(std::shared_ptr<const Game> game)
+            {
+                LOG_INFO("--- PerfCountersTest ---");
+                MaliBaTest test(game);
+                test.AdvanceToPlayPhase();
+                auto apply_calls = [] {
+                    return GetPerfStats()[static_cast<int>(PerfSection::kApplyAction)].calls;
+                };
+                auto play = [](State *state, int num_moves)
+                {
+                    for (int i = 0; i < num_moves && !state->IsTerminal(); ++i)
+                    {
+                        state->ApplyAction(state->LegalActions()[0]);
+                    }
+                };
+
+                SetPerfCountersEnabled(true);
+                ResetPerfStats();
+                SPIEL_CHECK_EQ(apply_calls(), 0);
+                std::unique_ptr<State> state = test.state->Clone();
+                const int start = state->MoveNumber();
+                play(state.get(), 5);
+                const int applied = state->MoveNumber() - start;
+                SPIEL_CHECK_EQ(apply_calls(), applied);
+
+                std::unique_ptr<State> other = test.state->Clone();
+                std::thread worker([&] { play(other.get(), 3); });
+                worker.join();
+                const int other_applied = other->MoveNumber() - start;
+                SPIEL_CHECK_EQ(apply_calls(), applied + other_applied);
+                for (const PerfSectionStats &stats : GetPerfStats())
+                {
+                    uint64_t bucketed = 0;
+                    for (uint64_t count : stats.histogram) bucketed += count;
+                    SPIEL_CHECK_EQ(bucketed, stats.calls);
+                    if (stats.calls > 0) SPIEL_CHECK_GE(stats.ApproxQuantileNs(1.0), stats.max_ns);
+                }
+                SPIEL_CHECK_GT(GetPerfStats()[static_cast<int>(PerfSection::kLegalActions)].calls, 0);
+
+                SetPerfCountersEnabled(false);
+                play(state.get(), 3);
+                SPIEL_CHECK_EQ(apply_calls(), applied + other_applied);
+                ResetPerfStats();
+                SPIEL_CHECK_EQ(apply_calls(), 0);
+                LOG_INFO("PerfCountersTest passed.");
+            }
+
+            // The batched writer must match per-state ObservationTensor() and the
+            // generic Observer path, row for row.
+            void ObservationTensorBatchTest(std::shared_ptr<const Game> game)
+            {
+                LOG_INFO("--- ObservationTensorBatchTest ---");
+                MaliBaTest test(game);
+                test.AdvanceToPlayPhase();
+                std::vector<std::unique_ptr<State>> states;
+                for (int i = 0; i < 3 && !test.state->IsTerminal(); ++i)
+                {
+                    states.push_back(test.state->Clone());
+                    test.state->ApplyAction(test.state->LegalActions()[0]);
+                }
+
+                const int obs_size = game->ObservationTensorSize();
+                std::vector<const Mali_BaState *> batch_states;
+                for (const auto &state : states) batch_states.push_back(static_cast<const Mali_BaState *>(state.get()));
+                std::vector<float> batch(batch_states.size() * obs_size);
+                ObservationTensorBatch(batch_states, absl::MakeSpan(batch));
+
+                Observation observation(*game, game->MakeObserver(absl::nullopt, {}));
+                for (size_t i = 0; i < states.size(); ++i)
+                {
+                    const Player player = states[i]->CurrentPlayer();
+                    std::vector<float> single = states[i]->ObservationTensor(player);
+                    SPIEL_CHECK_TRUE(std::equal(single.begin(), single.end(), batch.begin() + i * obs_size));
+                    observation.SetFrom(*states[i], player);
+                    SPIEL_CHECK_TRUE(std::equal(single.begin(), single.end(), observation.Tensor().begin()));
+                }
+
+                LOG_INFO("ObservationTensorBatchTest passed.");
+            }
+
+            // The dense mask must mark exactly LegalActions(), per state and in
+            // the batched form, and be all zeros once the game is over.
+            void LegalActionsMaskTest(std::shared_ptr<const Game> game)
+            {
+                LOG_INFO("--- LegalActionsMaskTest ---");
+                MaliBaTest test(game);
+                test.AdvanceToPlayPhase();
+                const int num_actions = game->NumDistinctActions();
+                std::vector<std::unique_ptr<State>> states;
+                std::mt19937 rng(5);
+                for (int i = 0; i < 10 && !test.state->IsTerminal(); ++i)
+                {
+                    states.push_back(test.state->Clone());
+                    std::vector<Action> actions = test.state->LegalActions();
+                    test.state->ApplyAction(actions[rng() % actions.size()]);
+                }
+
+                std::vector<const Mali_BaState *> batch_states;
+                for (const auto &state : states) batch_states.push_back(static_cast<const Mali_BaState *>(state.get()));
+                std::vector<uint8_t> batch(batch_states.size() * num_actions, 7);
+                LegalActionsMaskBatch(batch_states, absl::MakeSpan(batch));
+
+                std::vector<uint8_t> mask(num_actions, 7);
+                for (size_t i = 0; i < batch_states.size(); ++i)
+                {
+                    batch_states[i]->LegalActionsMask(absl::MakeSpan(mask));
+                    std::vector<uint8_t> expected(num_actions, 0);
+                    for (Action action : batch_states[i]->LegalActions()) expected[action] = 1;
+                    SPIEL_CHECK_EQ(mask, expected);
+                    SPIEL_CHECK_TRUE(std::equal(mask.begin(), mask.end(), batch.begin() + i * num_actions));
+                }
+
+                std::unique_ptr<State> terminal = test.mali_ba_state->Clone();
+                while (!terminal->IsTerminal())
+                {
+                    std::vector<Action> actions = terminal->LegalActions();
+                    terminal->ApplyAction(actions[rng() % actions.size()]);
+                }
+                SPIEL_CHECK_TRUE(terminal->LegalActions().empty());
+                static_cast<const Mali_BaState *>(terminal.get())->LegalActionsMask(absl::MakeSpan(mask));
+                SPIEL_CHECK_EQ(std::count(mask.begin(), mask.end(), 0), num_actions);
+                LOG_INFO("LegalActionsMaskTest passed.");
+            }
+
+            // Precomputed board tables must agree with coordinate arithmetic.
+            void BoardLookupTablesTest(std::shared_ptr<const Game> game)
+            {
+                LOG_INFO("--- BoardLookupTablesTest ---");
+                const auto *mali_ba_game = static_cast<const Mali_BaGame *>(game.get());
+                const int num_hexes = mali_ba_game->NumHexes();
+                const std::vector<City> &cities = mali_ba_game->GetCities();
+                for (int i = 0; i < num_hexes; ++i)
+                {
+                    const HexCoord hex = mali_ba_game->IndexToCoord(i);
+                    const auto &neighbors = mali_ba_game->NeighborIndices(i);
+                    for (int dir = 0; dir < 6; ++dir)
+                    {
+                        SPIEL_CHECK_EQ(neighbors[dir], mali_ba_game->CoordToIndex(hex + kHexDirections[dir]));
+                        if (neighbors[dir] >= 0) SPIEL_CHECK_EQ(mali_ba_game->HopDistance(i, neighbors[dir]), 1);
+                    }
+                    SPIEL_CHECK_EQ(mali_ba_game->HopDistance(i, i), 0);
+                    for (int j = 0; j < num_hexes; ++j)
+                    {
+                        const int hops = mali_ba_game->HopDistance(i, j);
+                        SPIEL_CHECK_EQ(hops, mali_ba_game->HopDistance(j, i));
+                        if (hops >= 0) SPIEL_CHECK_GE(hops, hex.Distance(mali_ba_game->IndexToCoord(j)));
+                        SPIEL_CHECK_EQ(mali_ba_game->CubeDistance(i, j), hex.Distance(mali_ba_game->IndexToCoord(j)));
+                    }
+                    const City *city_here = mali_ba_game->GetCityAt(hex);
+                    const int city_id = mali_ba_game->CityIdAtIndex(i);
+                    SPIEL_CHECK_EQ(city_id < 0 ? nullptr : &cities[city_id], city_here);
+
+                    int min_distance = std::numeric_limits<int>::max();
+                    for (const City &city : cities) min_distance = std::min(min_distance, hex.Distance(city.location));
+                    for (int city_id : mali_ba_game->NearestCityIds(i))
+                    {
+                        SPIEL_CHECK_EQ(hex.Distance(cities[city_id].location), min_distance);
+                    }
+                }
+                LOG_INFO("BoardLookupTablesTest passed.");
+            }
+
+            // Routes offered after an upgrade must match a brute-force sweep over
+            // subsets of the player's centers under the shared-center and
+            // duplicate rules.
+            void TradeRouteEnumerationTest(std::shared_ptr<const Game> game)
+            {
+                LOG_INFO("--- TradeRouteEnumerationTest ---");
+                MaliBaTest test(game);
+                test.AdvanceToPlayPhase();
+                const auto *mali_ba_game = static_cast<const Mali_BaGame *>(game.get());
+                const GameRules &rules = mali_ba_game->GetRules();
+                Player p0 = 0;
+                PlayerColor p0_color = test.mali_ba_state->GetPlayerColor(p0);
+                test.mali_ba_state->SetCurrentPhase(Phase::kPlay);
+                test.mali_ba_state->TestOnly_SetCurrentPlayer(p0);
+
+                std::vector<HexCoord> free_hexes;
+                for (const HexCoord &hex : mali_ba_game->GetValidHexes())
+                {
+                    if (test.mali_ba_state->GetPlayerPostType(hex, p0_color) == TradePostType::kNone) free_hexes.push_back(hex);
+                    if (free_hexes.size() == 5) break;
+                }
+                SPIEL_CHECK_EQ(free_hexes.size(), 5);
+                for (int i = 0; i < 4; ++i) test.mali_ba_state->TestOnly_SetTradePost(free_hexes[i], p0_color, TradePostType::kCenter);
+                const HexCoord upgrade_hex = free_hexes[4];
+                test.mali_ba_state->TestOnly_SetTradePost(upgrade_hex, p0_color, TradePostType::kPost);
+                SPIEL_CHECK_TRUE(test.mali_ba_state->CreateTradeRoute({free_hexes[0], free_hexes[1], free_hexes[2]}, p0_color));
+                test.mali_ba_state->TestOnly_SetRareGood(p0, mali_ba_game->GetCities()[0].rare_good, rules.upgrade_cost_rare + 1);
+
+                test.state->ApplyAction(kUpgradeBase + mali_ba_game->CoordToIndex(upgrade_hex));
+                SPIEL_CHECK_EQ(test.mali_ba_state->CurrentPhase(), Phase::kOptionalRoute);
+
+                std::vector<HexCoord> centers;
+                for (const HexCoord &hex : mali_ba_game->GetValidHexes())
+                {
+                    if (test.mali_ba_state->GetPlayerPostType(hex, p0_color) == TradePostType::kCenter) centers.push_back(hex);
+                }
+                SPIEL_CHECK_LE(centers.size(), 16);
+                const int required = std::find(centers.begin(), centers.end(), upgrade_hex) - centers.begin();
+                SPIEL_CHECK_LT(required, centers.size());
+                const int min_len = std::max(2, rules.min_hexes_for_trade_route);
+                const int max_len = std::min(5, static_cast<int>(centers.size()));
+
+                int expected = 0;
+                for (uint32_t mask = 0; mask < (1u << centers.size()); ++mask)
+                {
+                    const int size = __builtin_popcount(mask);
+                    if (!(mask & (1u << required)) || size < min_len || size > max_len) continue;
+                    bool valid = true;
+                    for (const TradeRoute &route : test.mali_ba_state->GetTradeRoutes())
+                    {
+                        if (route.owner != p0_color || !route.active) continue;
+                        int shared = 0;
+                        for (const HexCoord &hex : route.hexes)
+                        {
+                            const auto it = std::find(centers.begin(), centers.end(), hex);
+                            if (it != centers.end() && (mask & (1u << (it - centers.begin())))) shared++;
+                        }
+                        if (rules.max_shared_centers_between_routes >= 0 && shared > rules.max_shared_centers_between_routes) valid = false;
+                        if (shared == size && static_cast<int>(route.hexes.size()) == size) valid = false;
+                    }
+                    if (valid) expected++;
+                }
+
+                std::vector<Action> legal = test.state->LegalActions();
+                const int route_actions = std::count_if(legal.begin(), legal.end(), [](Action a) { return a >= kRouteBase; });
+                SPIEL_CHECK_EQ(route_actions, std::min(expected, 300));
+
+                // Decoding the last route action must reproduce a route through the upgraded hex.
+                if (route_actions > 0)
+                {
+                    const size_t routes_before = test.mali_ba_state->GetTradeRoutes().size();
+                    test.state->ApplyAction(legal.back());
+                    SPIEL_CHECK_EQ(test.mali_ba_state->GetTradeRoutes().size(), routes_before + 1);
+                    const TradeRoute &created = test.mali_ba_state->GetTradeRoutes().back();
+                    SPIEL_CHECK_TRUE(std::find(created.hexes.begin(), created.hexes.end(), upgrade_hex) != created.hexes.end());
+                    SPIEL_CHECK_TRUE(std::is_sorted(created.hexes.begin(), created.hexes.end()));
+                }
+                LOG_INFO("TradeRouteEnumerationTest passed.");
+            }
+
+            // A what-if view must answer exactly like a state copy with the same
+            // change applied.
+            void WhatIfOverlayTest(std::shared_ptr<const Game> game)
+            {
+                LOG_INFO("--- WhatIfOverlayTest ---");
+                MaliBaTest test(game);
+                test.AdvanceToPlayPhase();
+                const auto *mali_ba_game = static_cast<const Mali_BaGame *>(game.get());
+                Player p0 = 0;
+                PlayerColor p0_color = test.mali_ba_state->GetPlayerColor(p0);
+                test.mali_ba_state->SetCurrentPhase(Phase::kPlay);
+                test.mali_ba_state->TestOnly_SetCurrentPlayer(p0);
+
+                std::vector<HexCoord> hexes;
+                for (const HexCoord &hex : mali_ba_game->GetValidHexes())
+                {
+                    if (test.mali_ba_state->GetPlayerPostType(hex, p0_color) == TradePostType::kNone) hexes.push_back(hex);
+                    if (hexes.size() == 6) break;
+                }
+                SPIEL_CHECK_EQ(hexes.size(), 6);
+                for (int i = 0; i < 3; ++i) test.mali_ba_state->TestOnly_SetTradePost(hexes[i], p0_color, TradePostType::kCenter);
+                test.mali_ba_state->TestOnly_SetTradePost(hexes[3], p0_color, TradePostType::kPost);
+
+                auto check_same = [&](const Mali_BaWhatIf &what_if, const Mali_BaState &copy, const HexCoord &hex)
+                {
+                    const Mali_BaWhatIf unchanged(copy);
+                    SPIEL_CHECK_EQ(what_if.FindPossibleTradeRoutes(p0_color, true, &hex, 5),
+                                   unchanged.FindPossibleTradeRoutes(p0_color, true, &hex, 5));
+                    SPIEL_CHECK_EQ(what_if.PostsSupply(p0), unchanged.PostsSupply(p0));
+                    for (const HexCoord &other : mali_ba_game->GetValidHexes())
+                    {
+                        SPIEL_CHECK_EQ(what_if.CanPlaceTradingPostAt(other, p0_color), copy.CanPlaceTradingPostAt(other, p0_color));
+                        SPIEL_CHECK_EQ(what_if.CellAt(other)->post_mask, unchanged.CellAt(other)->post_mask);
+                        SPIEL_CHECK_EQ(what_if.CellAt(other)->center_mask, unchanged.CellAt(other)->center_mask);
+                        SPIEL_CHECK_EQ(what_if.CellAt(other)->num_meeples, unchanged.CellAt(other)->num_meeples);
+                    }
+                };
+
+                {
+                    Mali_BaWhatIf what_if(*test.mali_ba_state);
+                    what_if.UpgradeTradingPost(hexes[3], p0_color);
+                    Mali_BaState copy = *test.mali_ba_state;
+                    copy.UpgradeTradingPost(hexes[3], p0_color);
+                    check_same(what_if, copy, hexes[3]);
+                }
+                if (test.mali_ba_state->CanPlaceTradingPostAt(hexes[4], p0_color))
+                {
+                    Mali_BaWhatIf what_if(*test.mali_ba_state);
+                    what_if.AddTradingPost(hexes[4], p0_color, TradePostType::kPost);
+                    what_if.AddTradingPost(hexes[5], p0_color, TradePostType::kCenter);
+                    Mali_BaState copy = *test.mali_ba_state;
+                    copy.AddTradingPost(hexes[4], p0_color, TradePostType::kPost);
+                    copy.AddTradingPost(hexes[5], p0_color, TradePostType::kCenter);
+                    check_same(what_if, copy, hexes[5]);
+                }
+
+                // The underlying state is untouched.
+                SPIEL_CHECK_EQ(test.mali_ba_state->GetPlayerPostType(hexes[3], p0_color), TradePostType::kPost);
+                SPIEL_CHECK_EQ(test.mali_ba_state->GetPlayerPostType(hexes[5], p0_color), TradePostType::kNone);
+                LOG_INFO("WhatIfOverlayTest passed.");
+            }
+
+            // The cached route connectivity must follow route creation and
+            // deactivation, and match a scan of the routes and cities.
+            void RouteConnectivityTest(std::shared_ptr<const Game> game)
+            {
+                LOG_INFO("--- RouteConnectivityTest ---");
+                MaliBaTest test(game);
+                test.AdvanceToPlayPhase();
+                const auto *mali_ba_game = static_cast<const Mali_BaGame *>(game.get());
+                Mali_BaState &state = *test.mali_ba_state;
+                const PlayerColor p0_color = state.GetPlayerColor(0);
+
+                auto expected = [&](const HexCoord &hex, PlayerColor color)
+                {
+                    std::vector<int> ids;
+                    for (const TradeRoute &route : state.GetTradeRoutes())
+                    {
+                        if (route.owner != color || !route.active ||
+                            std::find(route.hexes.begin(), route.hexes.end(), hex) == route.hexes.end())
+                            continue;
+                        for (const HexCoord &route_hex : route.hexes)
+                        {
+                            const int city = mali_ba_game->CityIdAtIndex(mali_ba_game->CoordToIndex(route_hex));
+                            if (city >= 0 && std::find(ids.begin(), ids.end(), city) == ids.end()) ids.push_back(city);
+                        }
+                    }
+                    return ids;
+                };
+                auto check = [&]()
+                {
+                    for (const HexCoord &hex : mali_ba_game->GetValidHexes())
+                        for (Player p = 0; p < state.NumPlayers(); ++p)
+                        {
+                            const PlayerColor color = state.GetPlayerColor(p);
+                            SPIEL_CHECK_EQ(state.ConnectedCityIds(mali_ba_game->CoordToIndex(hex), color), expected(hex, color));
+                        }
+                };
+
+                // One city hex and two plain hexes, all free of p0's posts.
+                std::vector<HexCoord> hexes;
+                for (const City &city : mali_ba_game->GetCities())
+                {
+                    if (mali_ba_game->CoordToIndex(city.location) >= 0 &&
+                        state.GetPlayerPostType(city.location, p0_color) == TradePostType::kNone)
+                    {
+                        hexes.push_back(city.location);
+                        break;
+                    }
+                }
+                for (const HexCoord &hex : mali_ba_game->GetValidHexes())
+                {
+                    if (hexes.size() == 3) break;
+                    if (mali_ba_game->GetCityAt(hex) == nullptr &&
+                        state.GetPlayerPostType(hex, p0_color) == TradePostType::kNone)
+                        hexes.push_back(hex);
+                }
+                SPIEL_CHECK_EQ(hexes.size(), 3);
+                check();
+                for (const HexCoord &hex : hexes) state.TestOnly_SetTradePost(hex, p0_color, TradePostType::kCenter);
+                SPIEL_CHECK_TRUE(state.CreateTradeRoute(hexes, p0_color));
+                const int plain_index = mali_ba_game->CoordToIndex(hexes[1]);
+                SPIEL_CHECK_EQ(state.ConnectedCityIds(plain_index, p0_color).size(), 1);
+                check();
+
+                // A copy shares the cache; losing a center deactivates the route.
+                Mali_BaState copy = state;
+                state.TestOnly_SetTradePost(hexes[2], p0_color, TradePostType::kNone);
+                state.ValidateTradeRoutes();
+                SPIEL_CHECK_TRUE(state.ConnectedCityIds(plain_index, p0_color).empty());
+                SPIEL_CHECK_EQ(copy.ConnectedCityIds(plain_index, p0_color).size(), 1);
+                check();
+                LOG_INFO("RouteConnectivityTest passed.");
+            }
+
+            void LegalActionCategoriesTest(std::shared_ptr<const Game> game)
+            {
+                LOG_INFO("--- LegalActionCategoriesTest ---");
+                std::unique_ptr<State> state = game->NewInitialState();
+                Mali_BaState &mali_ba_state = *static_cast<Mali_BaState *>(state.get());
+                std::set<Phase> phases_seen;
+                for (int move = 0; move < 200 && !state->IsTerminal(); ++move)
+                {
+                    phases_seen.insert(mali_ba_state.CurrentPhase());
+                    // Each category is its slice of LegalActions(), in order.
+                    const std::vector<Action> legal = state->LegalActions();
+                    const LegalActionCategoryCounts counts = mali_ba_state.CountLegalActionCategories();
+                    std::vector<Action> concatenated;
+                    for (int c = 0; c < kNumLegalActionCategories; ++c)
+                    {
+                        const LegalActionCategory category = static_cast<LegalActionCategory>(c);
+                        std::vector<Action> in_category;
+                        mali_ba_state.AppendLegalActionsInCategory(category, &in_category);
+                        SPIEL_CHECK_EQ(counts[category], static_cast<int>(in_category.size()));
+                        for (int n = 0; n < counts[category]; ++n)
+                            SPIEL_CHECK_EQ(mali_ba_state.LegalActionInCategory(category, n), in_category[n]);
+                        SPIEL_CHECK_EQ(mali_ba_state.LegalActionInCategory(category, counts[category]), kInvalidAction);
+                        const Action sampled = mali_ba_state.SampleLegalActionInCategory(category);
+                        if (in_category.empty())
+                            SPIEL_CHECK_EQ(sampled, kInvalidAction);
+                        else
+                            SPIEL_CHECK_TRUE(std::find(in_category.begin(), in_category.end(), sampled) != in_category.end());
+                        concatenated.insert(concatenated.end(), in_category.begin(), in_category.end());
+                    }
+                    SPIEL_CHECK_EQ(concatenated, legal);
+                    SPIEL_CHECK_EQ(counts.Total(), static_cast<int>(legal.size()));
+
+                    auto is_legal = [&](Action action)
+                    { return std::find(legal.begin(), legal.end(), action) != legal.end(); };
+                    SPIEL_CHECK_TRUE(is_legal(mali_ba_state.SampleLegalAction(counts)));
+                    SPIEL_CHECK_TRUE(is_legal(mali_ba_state.SelectTrainingAwareRandomAction()));
+                    SPIEL_CHECK_TRUE(is_legal(Mali_BaTurnBasedWrapper::SelectSingleRandomAction(&mali_ba_state)));
+
+                    // SampleLegalAction() draws what a uniform pick from LegalActions() would.
+                    Mali_BaRng saved_rng = mali_ba_state.GetRNG();
+                    const Action drawn = mali_ba_state.SampleLegalAction(counts);
+                    std::uniform_int_distribution<> dist(0, legal.size() - 1);
+                    SPIEL_CHECK_EQ(drawn, legal[dist(saved_rng)]);
+
+                    state->ApplyAction(mali_ba_state.SelectHeuristicRandomAction());
+                }
+                SPIEL_CHECK_TRUE(phases_seen.count(Phase::kPlay));
+                std::vector<Action> none;
+                if (state->IsTerminal())
+                {
+                    mali_ba_state.AppendLegalActionsInCategory(LegalActionCategory::kPass, &none);
+                    SPIEL_CHECK_TRUE(none.empty());
+                    SPIEL_CHECK_EQ(mali_ba_state.CountLegalActionCategories().Total(), 0);
+                }
+                LOG_INFO("LegalActionCategoriesTest passed.");
+            }
+
+            // A viewer that rebuilds the Serialize() view of the state from
+            // the change feed stays in step with the state itself.
+            void ChangeFeedTest(std::shared_ptr<const Game> game)
+            {
+                LOG_INFO("--- ChangeFeedTest ---");
+                std::unique_ptr<State> state = game->NewInitialState();
+                Mali_BaState &mali_ba_state = *static_cast<Mali_BaState *>(state.get());
+                SPIEL_CHECK_FALSE(mali_ba_state.ChangeFeedEnabled());
+                mali_ba_state.EnableChangeFeed(/*snapshot_interval=*/10);
+
+                json view;
+                int64_t next_seq = 0;
+                int snapshots = 0;
+                int deltas = 0;
+                auto set_or_erase = [](json &object, const std::string &key, const json &value)
+                {
+                    if (value.empty())
+                        object.erase(key);
+                    else
+                        object[key] = value;
+                };
+                auto apply_feed = [&]()
+                {
+                    for (const std::string &text : mali_ba_state.DrainChangeFeed())
+                    {
+                        const json entry = json::parse(text);
+                        SPIEL_CHECK_EQ(entry["seq"].get<int64_t>(), next_seq);
+                        ++next_seq;
+                        if (entry["type"] == "snapshot")
+                        {
+                            view = entry["state"];
+                            ++snapshots;
+                            continue;
+                        }
+                        SPIEL_CHECK_EQ(entry["type"], "delta");
+                        ++deltas;
+                        for (const auto &[hex, cell] : entry.value("cells", json::object()).items())
+                        {
+                            set_or_erase(view["playerTokens"], hex, cell["tokens"]);
+                            set_or_erase(view["hexMeeples"], hex, cell["meeples"]);
+                            set_or_erase(view["tradePosts"], hex, cell["posts"]);
+                        }
+                        for (const json &goods : entry.value("goods", json::array()))
+                        {
+                            const int p = goods["player"];
+                            for (const char *kind : {"common", "rare"})
+                            {
+                                json &held = view[std::string(kind) + "Goods"][p];
+                                for (const auto &[name, count] : goods[kind].items())
+                                {
+                                    if (count == 0)
+                                        held.erase(name);
+                                    else
+                                        held[name] = count;
+                                }
+                            }
+                        }
+                        if (entry.contains("postsSupply"))
+                            view["playerPostsSupply"] = entry["postsSupply"];
+                        json &routes = view["tradeRoutes"];
+                        for (const json &id : entry.value("routesRemoved", json::array()))
+                        {
+                            for (auto it = routes.begin(); it != routes.end();)
+                                it = ((*it)["id"] == id) ? routes.erase(it) : it + 1;
+                        }
+                        for (const auto &[id, active] : entry.value("routesActive", json::object()).items())
+                        {
+                            for (json &route : routes)
+                                if (route["id"] == std::stoi(id))
+                                    route["active"] = active;
+                        }
+                        for (const json &route : entry.value("routesAdded", json::array()))
+                            routes.push_back(route);
+                        view["currentPlayerId"] = entry["currentPlayerId"];
+                        view["currentPhase"] = entry["currentPhase"];
+                        view["midTurnState"] = entry["midTurnState"];
+                    }
+                };
+                auto check_view = [&]()
+                {
+                    apply_feed();
+                    json expected = json::parse(mali_ba_state.Serialize());
+                    for (const char *key : {"playerTokens", "hexMeeples", "tradePosts", "commonGoods",
+                                            "rareGoods", "playerPostsSupply", "tradeRoutes",
+                                            "currentPlayerId", "currentPhase", "midTurnState"})
+                        SPIEL_CHECK_EQ(view[key], expected[key]);
+                };
+
+                check_view();
+                SPIEL_CHECK_EQ(snapshots, 1);
+                for (int move = 0; move < 150 && !state->IsTerminal(); ++move)
+                {
+                    state->ApplyAction(state->IsChanceNode() ? state->LegalActions()[0]
+                                                             : mali_ba_state.SelectHeuristicRandomAction());
+                    check_view();
+                }
+                SPIEL_CHECK_GT(deltas, 10);
+                SPIEL_CHECK_GE(snapshots, 1 + deltas / 10);
+
+                // Undo and explicit requests queue snapshots.
+                const int before_undo = snapshots;
+                mali_ba_state.UndoLastAction();
+                mali_ba_state.RequestChangeFeedSnapshot();
+                check_view();
+                SPIEL_CHECK_EQ(snapshots, before_undo + 2);
+
+                // Clones do not inherit the feed; disabling drops the queue.
+                std::unique_ptr<State> clone = state->Clone();
+                SPIEL_CHECK_FALSE(static_cast<Mali_BaState *>(clone.get())->ChangeFeedEnabled());
+                mali_ba_state.DisableChangeFeed();
+                SPIEL_CHECK_TRUE(mali_ba_state.DrainChangeFeed().empty());
+                LOG_INFO("ChangeFeedTest passed.");
+            }
+
+            void MemoryFootprintTest(std::shared_ptr<const Game> game)
+            {
+                LOG_INFO("--- MemoryFootprintTest ---");
+                std::unique_ptr<State> state = game->NewInitialState();
+                Mali_BaState &mali_ba_state = *static_cast<Mali_BaState *>(state.get());
+                auto component = [](const MemoryBreakdown &breakdown, const std::string &name)
+                {
+                    for (const MemoryComponent &c : breakdown.components)
+                        if (c.name == name)
+                            return c;
+                    SpielFatalError("Missing memory component: " + name);
+                };
+
+                MemoryBreakdown before = mali_ba_state.MemoryFootprint();
+                SPIEL_CHECK_GT(component(before, "board").bytes, 0);
+                SPIEL_CHECK_FALSE(component(before, "board").shared);
+                SPIEL_CHECK_EQ(before.TotalBytes(), before.OwnedBytes());
+
+                // Allocations are counted only while counting is enabled.
+                SetAllocationCountingEnabled(true);
+                ResetThreadAllocationCounts();
+                for (int move = 0; move < 20 && !state->IsTerminal(); ++move)
+                {
+                    state->ApplyAction(state->IsChanceNode() ? state->LegalActions()[0]
+                                                             : mali_ba_state.SelectHeuristicRandomAction());
+                }
+#ifndef MALI_BA_NO_PERF
+                SPIEL_CHECK_GT(ThreadAllocationCounts().allocations, 0);
+#endif
+                SetAllocationCountingEnabled(false);
+                ResetThreadAllocationCounts();
+                if (!state->IsTerminal())
+                    state->ApplyAction(state->IsChanceNode() ? state->LegalActions()[0]
+                                                             : mali_ba_state.SelectHeuristicRandomAction());
+                SPIEL_CHECK_EQ(ThreadAllocationCounts().allocations, 0);
+
+                MemoryBreakdown after = mali_ba_state.MemoryFootprint();
+                SPIEL_CHECK_GT(component(after, "undo_journal").bytes,
+                               component(before, "undo_journal").bytes);
+
+                // A clone shares the board until either side writes to it.
+                std::unique_ptr<State> clone = state->Clone();
+                MemoryBreakdown shared = mali_ba_state.MemoryFootprint();
+                SPIEL_CHECK_TRUE(component(shared, "board").shared);
+                SPIEL_CHECK_GE(shared.TotalBytes() - shared.OwnedBytes(), component(shared, "board").bytes);
+                clone.reset();
+                SPIEL_CHECK_FALSE(component(mali_ba_state.MemoryFootprint(), "board").shared);
+
+                MemoryBreakdown game_footprint = static_cast<const Mali_BaGame *>(game.get())->MemoryFootprint();
+                SPIEL_CHECK_GT(component(game_footprint, "board_topology").bytes, 0);
+                SPIEL_CHECK_GE(game_footprint.TotalBytes(), game_footprint.OwnedBytes());
+                LOG_INFO("MemoryFootprintTest passed.");
+            }
+
+            void RngStreamTest(std::shared_ptr<const Game> game)
+            {
+                LOG_INFO("--- RngStreamTest ---");
+                SPIEL_CHECK_LE(sizeof(Mali_BaRng), 32);
+                Mali_BaRng a, b;
+                a.SeedStream(7, 3);
+                b.SeedStream(7, 3);
+                SPIEL_CHECK_EQ(a(), b());
+                b.SeedStream(7, 4);
+                SPIEL_CHECK_NE(a(), b());
+                a.SetMove(12);
+                SPIEL_CHECK_EQ(a.key(), Mali_BaRng::StreamKey(7, 3, 12));
+                SPIEL_CHECK_EQ(a.counter(), 0);
+                Mali_BaRng skipped = a;
+                for (int i = 0; i < 5; ++i) a();
+                skipped.discard(5);
+                SPIEL_CHECK_EQ(a(), skipped());
+                SPIEL_CHECK_NE(a.Fork(1).key(), a.key());
+                SPIEL_CHECK_NE(a.Fork(1).key(), a.Fork(2).key());
+                SPIEL_CHECK_EQ(a.Fork(1).key(), a.Fork(1).key());
+                SPIEL_CHECK_EQ(a.Fork(1).move(), 12);
+
+                // A position's draws depend on the stream and the move number,
+                // not on the draws made earlier in the game.
+                std::unique_ptr<State> played = game->NewInitialState();
+                auto &played_state = static_cast<Mali_BaState &>(*played);
+                played_state.GetRNG().SeedStream(21, 5);
+                for (int move = 0; move < 40 && !played->IsTerminal(); ++move)
+                {
+                    if (!played->IsChanceNode())
+                        played_state.SelectHeuristicRandomAction();  // An extra draw per move
+                    played->ApplyAction(played->IsChanceNode() ? played->LegalActions()[0]
+                                                               : played_state.SelectHeuristicRandomAction());
+                }
+                std::unique_ptr<State> replayed = game->NewInitialState();
+                auto &replayed_state = static_cast<Mali_BaState &>(*replayed);
+                replayed_state.GetRNG().SeedStream(21, 5);
+                for (Action action : played->History())
+                    replayed->ApplyAction(action);
+                SPIEL_CHECK_EQ(replayed_state.GetRNG().key(), played_state.GetRNG().key());
+                SPIEL_CHECK_EQ(replayed_state.GetRNG().move(), played->MoveNumber());
+                if (!played->IsTerminal())
+                    SPIEL_CHECK_EQ(replayed_state.SelectHeuristicRandomAction(),
+                                   played_state.SelectHeuristicRandomAction());
+
+                // Serialized states carry the stream and keep drawing where the
+                // original would.
+                if (!played->IsTerminal())
+                    played_state.SelectHeuristicRandomAction();  // Leaves the counter mid-move
+                const auto *mali_ba_game = static_cast<const Mali_BaGame *>(game.get());
+                auto check_copy = [&](std::unique_ptr<State> copy)
+                {
+                    auto &copy_state = static_cast<Mali_BaState &>(*copy);
+                    SPIEL_CHECK_TRUE(copy_state.GetRNG() == played_state.GetRNG());
+                    Mali_BaRng expected = played_state.GetRNG();
+                    SPIEL_CHECK_EQ(copy_state.GetRNG()(), expected());
+                };
+                check_copy(mali_ba_game->DeserializeBinary(played_state.SerializeBinary()));
+                check_copy(game->DeserializeState(played->Serialize()));
+
+                // Undo returns to the draws of the earlier move.
+                if (!replayed->IsTerminal() && !replayed->IsChanceNode())
+                {
+                    const Mali_BaRng before = replayed_state.GetRNG();
+                    const Player player = replayed->CurrentPlayer();
+                    const Action action = replayed_state.SelectHeuristicRandomAction();
+                    replayed->ApplyAction(action);
+                    SPIEL_CHECK_NE(replayed_state.GetRNG().key(), before.key());
+                    replayed->UndoAction(player, action);
+                    SPIEL_CHECK_EQ(replayed_state.GetRNG().key(), before.key());
+                    SPIEL_CHECK_EQ(replayed_state.GetRNG().counter(), 0);
+                }
+                LOG_INFO("RngStreamTest passed.");
+            }
+
+            // The incrementally kept score counters must match a rebuild from
+            // scratch after actions, undo and test-only setup.
+            void ScoreCountersTest(std::shared_ptr<const Game> game)
+            {
+                LOG_INFO("--- ScoreCountersTest ---");
+                MaliBaTest test(game);
+                test.AdvanceToPlayPhase();
+                const auto *mali_ba_game = static_cast<const Mali_BaGame *>(game.get());
+                Player p0 = 0;
+                PlayerColor p0_color = test.mali_ba_state->GetPlayerColor(p0);
+                test.mali_ba_state->SetCurrentPhase(Phase::kPlay);
+                test.mali_ba_state->TestOnly_SetCurrentPlayer(p0);
+
+                auto check = [&](const Mali_BaState &state)
+                {
+                    std::unique_ptr<State> fresh = game->DeserializeState(state.Serialize());
+                    const auto &expected = static_cast<const Mali_BaState *>(fresh.get())->ScoreCounters();
+                    const auto &actual = state.ScoreCounters();
+                    SPIEL_CHECK_EQ(actual.size(), expected.size());
+                    for (size_t p = 0; p < actual.size(); ++p)
+                    {
+                        SPIEL_CHECK_EQ(actual[p].active_routes, expected[p].active_routes);
+                        SPIEL_CHECK_EQ(actual[p].active_route_hexes, expected[p].active_route_hexes);
+                        SPIEL_CHECK_EQ(actual[p].longest_route, expected[p].longest_route);
+                        SPIEL_CHECK_EQ(actual[p].regions_crossed_score, expected[p].regions_crossed_score);
+                        SPIEL_CHECK_EQ(actual[p].timbuktu_to_coast, expected[p].timbuktu_to_coast);
+                        SPIEL_CHECK_EQ(actual[p].unique_rare_goods, expected[p].unique_rare_goods);
+                        SPIEL_CHECK_EQ(actual[p].rare_goods_total, expected[p].rare_goods_total);
+                        SPIEL_CHECK_EQ(actual[p].unique_common_goods, expected[p].unique_common_goods);
+                        SPIEL_CHECK_EQ(actual[p].rare_good_regions, expected[p].rare_good_regions);
+                        SPIEL_CHECK_EQ(actual[p].centers, expected[p].centers);
+                        SPIEL_CHECK_EQ(actual[p].centers_per_region, expected[p].centers_per_region);
+                    }
+                };
+
+                check(*test.mali_ba_state);
+                std::vector<HexCoord> hexes;
+                for (const HexCoord &hex : mali_ba_game->GetValidHexes())
+                {
+                    if (test.mali_ba_state->GetPlayerPostType(hex, p0_color) == TradePostType::kNone) hexes.push_back(hex);
+                    if (hexes.size() == 3) break;
+                }
+                SPIEL_CHECK_EQ(hexes.size(), 3);
+                for (const HexCoord &hex : hexes) test.mali_ba_state->TestOnly_SetTradePost(hex, p0_color, TradePostType::kCenter);
+                SPIEL_CHECK_EQ(test.mali_ba_state->ScoreCounters()[p0].centers, 3);
+                SPIEL_CHECK_TRUE(test.mali_ba_state->CreateTradeRoute(hexes, p0_color));
+                SPIEL_CHECK_EQ(test.mali_ba_state->ScoreCounters()[p0].active_routes, 1);
+                SPIEL_CHECK_EQ(test.mali_ba_state->ScoreCounters()[p0].longest_route, 3);
+                test.mali_ba_state->TestOnly_SetRareGood(p0, mali_ba_game->GetCities()[0].rare_good, 2);
+                SPIEL_CHECK_EQ(test.mali_ba_state->ScoreCounters()[p0].unique_rare_goods, 1);
+                check(*test.mali_ba_state);
+
+                std::mt19937 rng(5);
+                int applied = 0;
+                for (; applied < 40 && !test.state->IsTerminal(); ++applied)
+                {
+                    std::vector<Action> actions = test.state->LegalActions();
+                    test.state->ApplyAction(actions[rng() % actions.size()]);
+                    check(*test.mali_ba_state);
+                }
+                Mali_BaState copy = *test.mali_ba_state;
+                check(copy);
+                for (int i = 0; i < applied; ++i)
+                {
+                    test.mali_ba_state->UndoLastAction();
+                    check(*test.mali_ba_state);
+                }
+                SPIEL_CHECK_EQ(test.mali_ba_state->ScoreCounters()[p0].active_routes, 1);
+                LOG_INFO("ScoreCountersTest passed.");
+            }
+
+            // Inventories are indexed by GoodsManager id; names only appear at
+            // the JSON/text boundary and must round-trip through it.
+            void InternedGoodsTest(std::shared_ptr<const Game> game)
+            {
+                LOG_INFO("--- InternedGoodsTest ---");
+                MaliBaTest test(game);
+                test.AdvanceToPlayPhase();
+                const auto *mali_ba_game = static_cast<const Mali_BaGame *>(game.get());
+                const GoodsManager &goods_manager = GoodsManager::GetInstance();
+                for (int id = 0; id < kNumGoodTypes; ++id)
+                {
+                    SPIEL_CHECK_EQ(goods_manager.GetCommonGoodIndex(goods_manager.GetCommonGoodName(id)), id);
+                    SPIEL_CHECK_EQ(goods_manager.GetRareGoodIndex(goods_manager.GetRareGoodName(id)), id);
+                }
+                for (const City &city : mali_ba_game->GetCities())
+                {
+                    SPIEL_CHECK_EQ(goods_manager.GetCommonGoodName(city.common_good_id), city.common_good);
+                    SPIEL_CHECK_EQ(goods_manager.GetRareGoodName(city.rare_good_id), city.rare_good);
+                }
+
+                Player p0 = 0;
+                const City &city = mali_ba_game->GetCities()[0];
+                test.mali_ba_state->TestOnly_SetCommonGood(p0, city.common_good, 3);
+                test.mali_ba_state->TestOnly_SetRareGood(p0, city.rare_good, 1);
+                SPIEL_CHECK_EQ(test.mali_ba_state->GetCommonGoodCount(p0, city.common_good), 3);
+                SPIEL_CHECK_EQ(test.mali_ba_state->GetCommonGoodCount(p0, city.common_good_id), 3);
+                SPIEL_CHECK_EQ(test.mali_ba_state->GetPlayerRareGoods(p0)[city.rare_good_id], 1);
+                SPIEL_CHECK_EQ(test.mali_ba_state->GetCommonGoodCount(p0, "Not A Good"), 0);
+
+                std::unique_ptr<State> fresh = game->DeserializeState(test.mali_ba_state->Serialize());
+                const auto *fresh_state = static_cast<const Mali_BaState *>(fresh.get());
+                SPIEL_CHECK_EQ(fresh_state->GetCommonGoods(), test.mali_ba_state->GetCommonGoods());
+                SPIEL_CHECK_EQ(fresh_state->GetRareGoods(), test.mali_ba_state->GetRareGoods());
+
+                std::map<std::string, int> named = GoodCountsToMap(test.mali_ba_state->GetPlayerCommonGoods(p0), /*rare=*/false);
+                SPIEL_CHECK_EQ(named.size(), 1);
+                SPIEL_CHECK_EQ(named[city.common_good], 3);
+                named["Not A Good"] = 7;
+                SPIEL_CHECK_EQ(GoodCountsFromMap(named, /*rare=*/false), test.mali_ba_state->GetPlayerCommonGoods(p0));
+
+                // The array formatter must match the map-based one it replaces.
+                GoodsCounts counts;
+                SPIEL_CHECK_EQ(FormatGoodsCountsCompact(counts), FormatGoodsCollectionCompact(ToGoodsCollection(counts)));
+                counts.common_goods[0] = 2;
+                counts.common_goods[kNumGoodTypes - 1] = 1;
+                SPIEL_CHECK_EQ(FormatGoodsCountsCompact(counts), FormatGoodsCollectionCompact(ToGoodsCollection(counts)));
+                counts.rare_goods[3] = 1;
+                SPIEL_CHECK_EQ(FormatGoodsCountsCompact(counts), FormatGoodsCollectionCompact(ToGoodsCollection(counts)));
+                counts.common_goods.fill(0);
+                SPIEL_CHECK_EQ(FormatGoodsCountsCompact(counts), FormatGoodsCollectionCompact(ToGoodsCollection(counts)));
+                SPIEL_CHECK_EQ(ToGoodsCounts(ToGoodsCollection(counts)).rare_goods, counts.rare_goods);
+                LOG_INFO("InternedGoodsTest passed.");
+            }
+
+            // The cached board planes must always equal a from-scratch write,
+            // across actions, undo and clones that share the cache.
+            void IncrementalObservationTest(std::shared_ptr<const Game> game)
+            {
+                LOG_INFO("--- IncrementalObservationTest ---");
+                MaliBaTest test(game);
+                test.AdvanceToPlayPhase();
+                const auto *mali_ba_game = static_cast<const Mali_BaGame *>(game.get());
+                const MaliBaObserver &observer = mali_ba_game->GetDefaultObserver();
+                std::vector<float> full(game->ObservationTensorSize());
+                auto check = [&](const Mali_BaState &state)
+                {
+                    const Player player = std::max<Player>(0, state.CurrentPlayer());
+                    observer.WriteTo(state, player, absl::MakeSpan(full));
+                    SPIEL_CHECK_EQ(static_cast<const State &>(state).ObservationTensor(player), full);
+                };
+
+                std::mt19937 rng(3);
+                check(*test.mali_ba_state);
+                for (int i = 0; i < 30 && !test.state->IsTerminal(); ++i)
+                {
+                    std::vector<Action> actions = test.state->LegalActions();
+                    test.state->ApplyAction(actions[rng() % actions.size()]);
+                    check(*test.mali_ba_state);
+                }
+
+                std::unique_ptr<State> clone = test.mali_ba_state->CloneForSearch();
+                if (!clone->IsTerminal()) clone->ApplyAction(clone->LegalActions()[0]);
+                check(*static_cast<Mali_BaState *>(clone.get()));
+                check(*test.mali_ba_state);
+
+                for (int i = 0; i < 10 && !test.state->History().empty(); ++i)
+                {
+                    test.mali_ba_state->UndoLastAction();
+                    check(*test.mali_ba_state);
+                }
+
+                LOG_INFO("IncrementalObservationTest passed.");
+            }
+
+            void PackedMoveTest(std::shared_ptr<const Game> game)
+            {
+                LOG_INFO("--- PackedMoveTest ---");
+                MaliBaTest test(game);
+                test.AdvanceToPlayPhase();
+
+                std::mt19937 rng(22);
+                for (int i = 0; i < 60 && !test.state->IsTerminal(); ++i)
+                {
+                    test.CheckPackedGenerators();
+                    std::vector<Action> legal_actions = test.state->LegalActions();
+                    if (legal_actions.empty())
+                        break;
+                    test.state->ApplyAction(legal_actions[rng() % legal_actions.size()]);
+                }
+
+                LOG_INFO("PackedMoveTest passed.");
+            }
+
+            // The specialized scans must agree with the generic ones and with
+            // the cells themselves, on every board state of a random game.
+            void BoardKernelsTest(std::shared_ptr<const Game> game)
+            {
+                LOG_INFO("--- BoardKernelsTest ---");
+                const Mali_BaGame &mali_ba_game = static_cast<const Mali_BaGame &>(*game);
+                const BoardKernels &kernels = mali_ba_game.GetBoardKernels();
+                std::set<HexCoord> regular;
+                for (int x = -4; x <= 4; ++x)
+                    for (int y = -4; y <= 4; ++y)
+                        if (std::abs(x + y) <= 4) regular.insert(HexCoord(x, y, -x - y));
+                SPIEL_CHECK_EQ(BoardKernels(*GetBoardTopology(regular)).SpecializedRadius(), 4);
+                regular.erase(HexCoord(0, 0, 0));
+                SPIEL_CHECK_EQ(BoardKernels(*GetBoardTopology(regular)).SpecializedRadius(), 0);
+
+                std::shared_ptr<const BoardTopology> topology = GetBoardTopology(mali_ba_game.GetValidHexes());
+                const BoardKernels generic(*topology, /*specialize=*/false);
+                const int num_hexes = mali_ba_game.NumHexes();
+                MaliBaTest test(game);
+                test.AdvanceToPlayPhase();
+                std::mt19937 rng(25);
+                for (int i = 0; i < 60 && !test.state->IsTerminal(); ++i)
+                {
+                    const BoardCells &cells = test.mali_ba_state->GetBoard();
+                    for (int c = 0; c < kNumPlayerColors; ++c)
+                    {
+                        const PlayerColor color = static_cast<PlayerColor>(c);
+                        const HexMask tokens = kernels.TokenHexes(cells, color);
+                        const HexMask posts = kernels.PostHexes(cells, color);
+                        SPIEL_CHECK_TRUE(tokens == generic.TokenHexes(cells, color));
+                        SPIEL_CHECK_TRUE(posts == generic.PostHexes(cells, color));
+                        for (int h = 0; h < num_hexes; ++h)
+                        {
+                            SPIEL_CHECK_EQ(tokens.Test(h), cells[h].HasToken(color));
+                            SPIEL_CHECK_EQ(posts.Test(h), cells[h].HasPost(color));
+                        }
+                    }
+                    const HexMask occupied = kernels.OccupiedHexes(cells);
+                    SPIEL_CHECK_TRUE(occupied == generic.OccupiedHexes(cells));
+                    SPIEL_CHECK_TRUE(kernels.TokenFreeHexes(cells) == generic.TokenFreeHexes(cells));
+                    for (int h = 0; h < num_hexes; ++h)
+                    {
+                        SPIEL_CHECK_EQ(occupied.Test(h), cells[h].num_tokens > 0 || cells[h].num_meeples > 0 ||
+                                                             cells[h].HasAnyPost());
+                    }
+                    std::vector<Action> legal_actions = test.state->LegalActions();
+                    if (legal_actions.empty())
+                        break;
+                    test.state->ApplyAction(legal_actions[rng() % legal_actions.size()]);
+                }
+
+                for (int start = 0; start < num_hexes; ++start)
+                {
+                    for (int hops : {0, 1, 3, 2 * kMaxHexes})
+                    {
+                        const HexMask &reach = kernels.WithinHops(start, hops);
+                        for (int to = 0; to < num_hexes; ++to)
+                        {
+                            const int distance = mali_ba_game.HopDistance(start, to);
+                            SPIEL_CHECK_EQ(reach.Test(to), distance >= 1 && distance <= hops);
+                        }
+                    }
+                }
+                LOG_INFO("BoardKernelsTest passed.");
+            }
+
+            // A search clone must match the original and must not leak its
+            // writes back into the board it shares with the original.
+            void CloneForSearchTest(std::shared_ptr<const Game> game)
+            {
+                LOG_INFO("--- CloneForSearchTest ---");
+                MaliBaTest test(game);
+                test.AdvanceToPlayPhase();
+
+                std::string original = test.mali_ba_state->Serialize();
+                std::unique_ptr<State> clone = test.mali_ba_state->CloneForSearch();
+                Mali_BaState *search_state = static_cast<Mali_BaState *>(clone.get());
+                SPIEL_CHECK_EQ(search_state->ToString(), test.mali_ba_state->ToString());
+                SPIEL_CHECK_EQ(search_state->LegalActions(), test.mali_ba_state->LegalActions());
+
+                for (int i = 0; i < 10 && !clone->IsTerminal(); ++i)
+                {
+                    clone->ApplyAction(clone->LegalActions()[0]);
+                }
+                SPIEL_CHECK_EQ(test.mali_ba_state->Serialize(), original);
+
+                LOG_INFO("CloneForSearchTest passed.");
+            }
+
+            // Runs the native search with a uniform evaluator and checks the
+            // visit policy is a distribution over the root's legal actions.
+            void MctsSearchTest(std::shared_ptr<const Game> game)
+            {
+                LOG_INFO("--- MctsSearchTest ---");
+                MaliBaTest test(game);
+                test.AdvanceToPlayPhase();
+
+                MctsConfig config;
+                config.num_simulations = 32;
+                config.batch_size = 4;
+                config.seed = 7;
+                int leaves_evaluated = 0;
+                Mali_BaMcts engine(config,
+                    [&](absl::Span<const float> observations, int batch_size,
+                        absl::Span<float> priors, absl::Span<float> values)
+                    {
+                        SPIEL_CHECK_EQ(observations.size(), batch_size * game->ObservationTensorSize());
+                        SPIEL_CHECK_LE(batch_size, 4);
+                        std::fill(priors.begin(), priors.end(), 1.0f);
+                        std::fill(values.begin(), values.end(), 0.0f);
+                        leaves_evaluated += batch_size;
+                    });
+
+                std::string before = test.mali_ba_state->Serialize();
+                MctsResult result = engine.Search(*test.mali_ba_state);
+                SPIEL_CHECK_EQ(test.mali_ba_state->Serialize(), before);
+
+                SPIEL_CHECK_EQ(result.actions, test.mali_ba_state->LegalActions());
+                SPIEL_CHECK_LE(leaves_evaluated, config.num_simulations);
+                SPIEL_CHECK_LT(result.num_evaluator_calls, config.num_simulations);
+                double policy_sum = 0.0;
+                for (double p : result.policy) policy_sum += p;
+                SPIEL_CHECK_FLOAT_NEAR(policy_sum, 1.0, 1e-6);
+                SPIEL_CHECK_GT(result.policy[result.best_action], 0.0);
+
+                LOG_INFO("MctsSearchTest passed.");
+            }
+
+            // HashKey() must match a from-scratch hash of the same position
+            // after every action and undo, and a search with a transposition
+            // table must still answer every simulation.
+            void ZobristHashTest(std::shared_ptr<const Game> game)
+            {
+                LOG_INFO("--- ZobristHashTest ---");
+                MaliBaTest test(game);
+                test.AdvanceToPlayPhase();
+                const auto *mali_ba_game = static_cast<const Mali_BaGame *>(game.get());
+                auto fresh_hash = [&](const Mali_BaState &state)
+                {
+                    std::unique_ptr<State> fresh = mali_ba_game->DeserializeBinary(state.SerializeBinary());
+                    return static_cast<const Mali_BaState *>(fresh.get())->HashKey();
+                };
+
+                std::mt19937 rng(11);
+                std::vector<uint64_t> hashes = {test.mali_ba_state->HashKey()};
+                SPIEL_CHECK_EQ(hashes.back(), fresh_hash(*test.mali_ba_state));
+                for (int i = 0; i < 40 && !test.state->IsTerminal(); ++i)
+                {
+                    std::vector<Action> actions = test.state->LegalActions();
+                    test.state->ApplyAction(actions[rng() % actions.size()]);
+                    hashes.push_back(test.mali_ba_state->HashKey());
+                    SPIEL_CHECK_EQ(hashes.back(), fresh_hash(*test.mali_ba_state));
+                }
+                std::unique_ptr<State> clone = test.mali_ba_state->CloneForSearch();
+                SPIEL_CHECK_EQ(static_cast<Mali_BaState *>(clone.get())->HashKey(), hashes.back());
+                while (hashes.size() > 1)
+                {
+                    hashes.pop_back();
+                    test.mali_ba_state->UndoLastAction();
+                    SPIEL_CHECK_EQ(test.mali_ba_state->HashKey(), hashes.back());
+                }
+
+                Mali_BaTranspositionTable table(100);
+                SPIEL_CHECK_EQ(table.num_slots(), 128);
+                uint64_t data = 0;
+                SPIEL_CHECK_FALSE(table.Probe(hashes[0], &data));
+                table.Store(hashes[0], 42);
+                SPIEL_CHECK_TRUE(table.Probe(hashes[0], &data));
+                SPIEL_CHECK_EQ(data, 42);
+                SPIEL_CHECK_FALSE(table.Probe(hashes[0] + 128, &data));  // Same slot, other key
+                table.Store(0, 1);
+                SPIEL_CHECK_FALSE(table.Probe(0, &data));
+                table.Clear();
+                SPIEL_CHECK_FALSE(table.Probe(hashes[0], &data));
+
+                MctsConfig config;
+                config.num_simulations = 64;
+                config.batch_size = 4;
+                config.transposition_slots = 1 << 12;
+                int leaves_evaluated = 0;
+                Mali_BaMcts engine(config,
+                    [&](absl::Span<const float> observations, int batch_size,
+                        absl::Span<float> priors, absl::Span<float> values)
+                    {
+                        std::fill(priors.begin(), priors.end(), 1.0f);
+                        std::fill(values.begin(), values.end(), 0.0f);
+                        leaves_evaluated += batch_size;
+                    });
+                for (int search = 0; search < 2; ++search)
+                {
+                    leaves_evaluated = 0;
+                    MctsResult result = engine.Search(*test.mali_ba_state);
+                    SPIEL_CHECK_EQ(result.actions, test.mali_ba_state->LegalActions());
+                    SPIEL_CHECK_LE(leaves_evaluated + result.num_transposition_hits, config.num_simulations);
+                    int total_visits = 0;
+                    for (int visits : result.visit_counts) total_visits += visits;
+                    SPIEL_CHECK_GT(total_visits, 0);
+                }
+                LOG_INFO("ZobristHashTest passed.");
+            }
+
+            // Plays a few heuristic games on two threads and checks the buffer
+            // layout: contiguous per-game rows and normalized policy targets.
+            void SelfPlayRunnerTest(std::shared_ptr<const Game> game)
+            {
+                LOG_INFO("--- SelfPlayRunnerTest ---");
+                SelfPlayConfig config;
+                config.num_games = 3;
+                config.num_threads = 2;
+                config.policy = SelfPlayPolicy::kHeuristic;
+                config.seed = 11;
+                Mali_BaSelfPlayRunner runner(game, config);
+                std::shared_ptr<SelfPlayBuffer> buffer = runner.Run();
+
+                SPIEL_CHECK_EQ(buffer->num_dropped_games, 0);
+                int total_rows = 0;
+                for (int length : buffer->game_lengths) total_rows += length;
+                SPIEL_CHECK_EQ(total_rows, buffer->num_records);
+
+                int row = 0;
+                while (row < buffer->num_records)
+                {
+                    const int game_id = buffer->game_ids[row];
+                    const int length = buffer->game_lengths[game_id];
+                    SPIEL_CHECK_GT(length, 0);
+                    for (int i = row; i < row + length; ++i)
+                    {
+                        SPIEL_CHECK_EQ(buffer->game_ids[i], game_id);
+                        SPIEL_CHECK_GE(buffer->players[i], 0);
+                        double policy_sum = 0.0;
+                        for (int a = 0; a < buffer->num_actions; ++a)
+                            policy_sum += buffer->policies[static_cast<size_t>(i) * buffer->num_actions + a];
+                        SPIEL_CHECK_FLOAT_NEAR(policy_sum, 1.0, 1e-4);
+                    }
+                    row += length;
+                }
+
+                // Games are seeded by index, not by the worker that plays them.
+                config.num_threads = 1;
+                std::shared_ptr<SelfPlayBuffer> serial = Mali_BaSelfPlayRunner(game, config).Run();
+                SPIEL_CHECK_EQ(serial->game_lengths, buffer->game_lengths);
+                SPIEL_CHECK_EQ(serial->game_returns, buffer->game_returns);
+
+                // One simulation expands only the root, so no child has a
+                // visit; moves are then picked uniformly.
+                SelfPlayConfig mcts_config;
+                mcts_config.num_games = 1;
+                mcts_config.policy = SelfPlayPolicy::kMcts;
+                mcts_config.seed = 11;
+                mcts_config.mcts.num_simulations = 1;
+                std::shared_ptr<SelfPlayBuffer> mcts_buffer = Mali_BaSelfPlayRunner(
+                    game, mcts_config,
+                    [](absl::Span<const float>, int, absl::Span<float> priors, absl::Span<float> values)
+                    {
+                        std::fill(priors.begin(), priors.end(), 1.0f);
+                        std::fill(values.begin(), values.end(), 0.0f);
+                    }).Run();
+                SPIEL_CHECK_GT(mcts_buffer->num_records, 0);
+                for (int i = 0; i < mcts_buffer->num_records; ++i)
+                {
+                    double policy_sum = 0.0;
+                    for (int a = 0; a < mcts_buffer->num_actions; ++a)
+                        policy_sum += mcts_buffer->policies[static_cast<size_t>(i) * mcts_buffer->num_actions + a];
+                    SPIEL_CHECK_FLOAT_NEAR(policy_sum, 1.0, 1e-4);
+                }
+
+                LOG_INFO("SelfPlayRunnerTest passed.");
+            }
+
+            // Every row of the batch must match its env's own state, a done env
+            // must report its returns and restart, and equal seeds must replay.
+            void VectorEnvTest(std::shared_ptr<const Game> game)
+            {
+                LOG_INFO("--- VectorEnvTest ---");
+                VectorEnvConfig config;
+                config.num_envs = 2;
+                config.seed = 5;
+                Mali_BaVectorEnv env(game, config);
+                Mali_BaVectorEnv twin(game, config);
+                const int obs_size = env.ObservationSize();
+                const int num_actions = env.NumActions();
+                const int num_players = env.NumPlayers();
+                std::mt19937 rng(17);
+                std::vector<float> observation(obs_size);
+                std::vector<uint8_t> mask(num_actions);
+                std::vector<Action> actions(config.num_envs);
+
+                const int max_steps = 4 * game->MaxGameLength();
+                int steps = 0;
+                for (; steps < max_steps && env.EpisodeCounts()[0] < 2; ++steps)
+                {
+                    for (int i = 0; i < config.num_envs; ++i)
+                    {
+                        const Mali_BaState &state = env.GetState(i);
+                        SPIEL_CHECK_FALSE(state.IsTerminal());
+                        SPIEL_CHECK_FALSE(state.IsChanceNode());
+                        SPIEL_CHECK_EQ(env.CurrentPlayers()[i], state.CurrentPlayer());
+                        state.ObservationTensor(state.CurrentPlayer(), absl::MakeSpan(observation));
+                        SPIEL_CHECK_TRUE(std::equal(observation.begin(), observation.end(),
+                                                    env.Observations().begin() + static_cast<size_t>(i) * obs_size));
+                        state.LegalActionsMask(absl::MakeSpan(mask));
+                        SPIEL_CHECK_TRUE(std::equal(mask.begin(), mask.end(),
+                                                    env.LegalMasks().begin() + static_cast<size_t>(i) * num_actions));
+                        SPIEL_CHECK_TRUE(std::equal(observation.begin(), observation.end(),
+                                                    twin.Observations().begin() + static_cast<size_t>(i) * obs_size));
+
+                        const std::vector<Action> legal_actions = state.LegalActions();
+                        SPIEL_CHECK_FALSE(legal_actions.empty());
+                        actions[i] = legal_actions[std::uniform_int_distribution<size_t>(
+                            0, legal_actions.size() - 1)(rng)];
+                    }
+                    env.Step(actions);
+                    twin.Step(actions);
+                    for (int i = 0; i < config.num_envs; ++i)
+                    {
+                        SPIEL_CHECK_EQ(env.Dones()[i], twin.Dones()[i]);
+                        if (!env.Dones()[i]) continue;
+                        SPIEL_CHECK_GT(env.EpisodeLengths()[i], 0);
+                        for (int p = 0; p < num_players; ++p)
+                        {
+                            SPIEL_CHECK_EQ(env.FinalReturns()[static_cast<size_t>(i) * num_players + p],
+                                           twin.FinalReturns()[static_cast<size_t>(i) * num_players + p]);
+                            SPIEL_CHECK_EQ(env.Rewards()[static_cast<size_t>(i) * num_players + p],
+                                           twin.Rewards()[static_cast<size_t>(i) * num_players + p]);
+                        }
+                    }
+                }
+                SPIEL_CHECK_LT(steps, max_steps);
+                SPIEL_CHECK_EQ(env.EpisodeCounts()[0], 2);
+
+                // Without auto-reset a finished env stays done and ignores its action.
+                config.num_envs = 1;
+                config.auto_reset = false;
+                Mali_BaVectorEnv single(game, config);
+                for (steps = 0; steps < max_steps && !single.Dones()[0]; ++steps)
+                {
+                    const std::vector<Action> legal_actions = single.GetState(0).LegalActions();
+                    single.Step({legal_actions[legal_actions.size() / 2]});
+                }
+                SPIEL_CHECK_TRUE(single.Dones()[0]);
+                // The terminal transition still reports its rewards.
+                const std::vector<double> last_rewards = single.GetState(0).Rewards();
+                for (int p = 0; p < num_players; ++p)
+                    SPIEL_CHECK_EQ(single.Rewards()[p], static_cast<float>(last_rewards[p]));
+                const int length = single.EpisodeLengths()[0];
+                single.Step({kInvalidAction});
+                SPIEL_CHECK_TRUE(single.Dones()[0]);
+                SPIEL_CHECK_EQ(single.EpisodeLengths()[0], length);
+                SPIEL_CHECK_EQ(single.EpisodeCounts()[0], 1);
+                single.Reset();
+                SPIEL_CHECK_FALSE(single.Dones()[0]);
+                SPIEL_CHECK_EQ(single.EpisodeCounts()[0], 2);
+
+                LOG_INFO("VectorEnvTest passed.");
+            }
+
+            // Records written through one handle of a named segment are sampled
+            // intact through another, and priorities steer the prioritized draw.
+            void ReplayBufferTest(std::shared_ptr<const Game> game)
+            {
+                LOG_INFO("--- ReplayBufferTest ---");
+                ReplayBufferConfig config;
+                config.capacity = 16;
+                config.observation_size = game->ObservationTensorSize();
+                config.num_actions = game->NumDistinctActions();
+                config.num_players = game->NumPlayers();
+                config.max_policy_entries = 4;
+                const std::string name = absl::StrCat("/mali_ba_test_replay_", getpid());
+                std::unique_ptr<SharedReplayBuffer> owner = SharedReplayBuffer::Create(name, config);
+                std::unique_ptr<SharedReplayBuffer> writer = SharedReplayBuffer::Attach(name);
+                SPIEL_CHECK_EQ(writer->Config().observation_size, config.observation_size);
+                SPIEL_CHECK_EQ(writer->Config().max_policy_entries, 4);
+
+                // Record n: observation of a real state, all policy mass on
+                // actions n..n+5 (more than fit), values[0] = n.
+                MaliBaTest test(game);
+                test.AdvanceToPlayPhase();
+                std::vector<float> observation(config.observation_size);
+                test.mali_ba_state->ObservationTensor(test.mali_ba_state->CurrentPlayer(),
+                                                      absl::MakeSpan(observation));
+                std::vector<float> policy(config.num_actions, 0.0f);
+                std::vector<float> values(config.num_players, 0.0f);
+                const int num_records = 24;  // Wraps the ring once
+                for (int n = 0; n < num_records; ++n)
+                {
+                    std::fill(policy.begin(), policy.end(), 0.0f);
+                    for (int k = 0; k < 6; ++k) policy[n + k] = (6 - k) / 21.0f;
+                    values[0] = static_cast<float>(n);
+                    SPIEL_CHECK_EQ(writer->Add(observation, policy, values, n % config.num_players), n);
+                }
+                SPIEL_CHECK_EQ(owner->TotalAdded(), num_records);
+                SPIEL_CHECK_EQ(owner->Size(), config.capacity);
+
+                owner->Seed(3);
+                const int drawn = owner->Sample(32);
+                SPIEL_CHECK_EQ(drawn, 32);
+                for (int row = 0; row < drawn; ++row)
+                {
+                    const int64_t n = owner->BatchIndices()[row];
+                    SPIEL_CHECK_GE(n, num_records - config.capacity);  // Only the newest survive
+                    SPIEL_CHECK_LT(n, num_records);
+                    SPIEL_CHECK_EQ(owner->BatchValues()[row * config.num_players], static_cast<float>(n));
+                    SPIEL_CHECK_EQ(owner->BatchPlayers()[row], n % config.num_players);
+                    SPIEL_CHECK_TRUE(std::equal(observation.begin(), observation.end(),
+                                                owner->BatchObservations().begin() + row * config.observation_size));
+                    // The four largest entries are kept and renormalized.
+                    const float* row_policy = &owner->BatchPolicies()[row * config.num_actions];
+                    SPIEL_CHECK_FLOAT_NEAR(std::accumulate(row_policy, row_policy + config.num_actions, 0.0f), 1.0f, 1e-5);
+                    SPIEL_CHECK_FLOAT_NEAR(row_policy[n], 6.0f / 18.0f, 1e-5);
+                    SPIEL_CHECK_EQ(row_policy[n + 4], 0.0f);
+                    SPIEL_CHECK_EQ(owner->BatchWeights()[row], 1.0f);
+                }
+
+                // Zero every priority but one record's.
+                std::vector<int64_t> records;
+                for (int64_t n = num_records - config.capacity; n < num_records; ++n) records.push_back(n);
+                std::vector<float> priorities(records.size(), 0.0f);
+                priorities[5] = 2.0f;
+                writer->UpdatePriorities(records, priorities);
+                SPIEL_CHECK_EQ(owner->Sample(8, /*prioritized=*/true), 8);
+                for (int row = 0; row < 8; ++row)
+                {
+                    SPIEL_CHECK_EQ(owner->BatchIndices()[row], records[5]);
+                    SPIEL_CHECK_EQ(owner->BatchWeights()[row], 1.0f);
+                }
+
+                // Sparse records and the private, unshared form.
+                std::unique_ptr<SharedReplayBuffer> local = SharedReplayBuffer::Create("", config);
+                const std::vector<Action> actions = {3, 7};
+                const std::vector<float> probabilities = {0.75f, 0.25f};
+                local->AddSparse(observation, actions, probabilities, values, 1);
+                SPIEL_CHECK_EQ(local->Sample(2), 2);
+                SPIEL_CHECK_EQ(local->BatchPolicies()[3], 0.75f);
+                SPIEL_CHECK_EQ(local->BatchPolicies()[config.num_actions + 7], 0.25f);
+
+                LOG_INFO("ReplayBufferTest passed.");
+            }
+
+            // Every move from the first keyframe on must seek back to the state
+            // that was recorded live, in a closed archive and an unclosed one.
+            void GameArchiveTest(std::shared_ptr<const Game> game)
+            {
+                LOG_INFO("--- GameArchiveTest ---");
+                const Mali_BaGame &mali_ba_game = static_cast<const Mali_BaGame &>(*game);
+                const std::string path = absl::StrCat("/tmp/mali_ba_archive_test_", getpid(), ".mba");
+                const std::string torn_path = path + ".torn";
+                constexpr int kGames = 2;
+                constexpr int kMaxMoves = 120;
+                std::vector<std::vector<std::string>> live(kGames);  // Serialize() after each move
+                std::vector<std::vector<Action>> actions(kGames);
+                {
+                    GameArchiveWriter writer(path, *game);
+                    GameArchiveRecorder recorder(/*keyframe_interval=*/5);
+                    std::mt19937 rng(17);
+                    for (int g = 0; g < kGames; ++g)
+                    {
+                        std::unique_ptr<State> state = game->NewInitialState();
+                        Mali_BaState &mali_ba_state = static_cast<Mali_BaState &>(*state);
+                        mali_ba_state.GetRNG().seed(100 + g);
+                        recorder.Begin(mali_ba_state, g);
+                        live[g].push_back(state->Serialize());
+                        while (!state->IsTerminal() && static_cast<int>(actions[g].size()) < kMaxMoves)
+                        {
+                            std::vector<Action> legal = state->LegalActions();
+                            if (legal.empty()) break;
+                            const Action action = state->IsChanceNode()
+                                ? legal[0]
+                                : legal[std::uniform_int_distribution<size_t>(0, legal.size() - 1)(rng)];
+                            state->ApplyAction(action);
+                            recorder.Update(mali_ba_state);
+                            actions[g].push_back(action);
+                            live[g].push_back(state->Serialize());
+                        }
+                        SPIEL_CHECK_EQ(writer.Add(recorder), g);
+                    }
+                    writer.Flush();
+
+                    // A crash image: the flushed games plus half a game header.
+                    std::ifstream in(path, std::ios::binary);
+                    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+                    std::ofstream out(torn_path, std::ios::binary);
+                    out.write(bytes.data(), bytes.size());
+                    out.write("MBGM\0\0\0\0\0\0\0\0", 12);
+                }
+
+                for (const std::string &archive_path : {path, torn_path})
+                {
+                    GameArchiveReader reader(archive_path);
+                    SPIEL_CHECK_EQ(reader.NumGames(), kGames);
+                    SPIEL_CHECK_EQ(reader.GameString(), game->ToString());
+                    for (int g = 0; g < kGames; ++g)
+                    {
+                        SPIEL_CHECK_EQ(reader.GameId(g), g);
+                        SPIEL_CHECK_EQ(reader.NumMoves(g), static_cast<int>(actions[g].size()));
+                        SPIEL_CHECK_EQ(reader.FirstSeekableMove(g), 0);
+                        absl::Span<const int32_t> recorded = reader.Actions(g);
+                        SPIEL_CHECK_TRUE(std::equal(recorded.begin(), recorded.end(), actions[g].begin()));
+                        SPIEL_CHECK_FALSE(reader.SetupJson(g).empty());
+                        for (int move = reader.NumMoves(g); move >= 0; --move)
+                        {
+                            SPIEL_CHECK_EQ(reader.StateAt(mali_ba_game, g, move)->Serialize(), live[g][move]);
+                        }
+                    }
+                }
+                std::remove(path.c_str());
+                std::remove(torn_path.c_str());
+                LOG_INFO("GameArchiveTest passed.");
+            }
+
+            // Several threads share one JSON-lines sink; every record must land
+            // exactly once and each game's moves must stay in order.
+            void MoveLogSinkTest()
+            {
+                LOG_INFO("--- MoveLogSinkTest ---");
+                constexpr int kThreads = 4;
+                constexpr int kMovesPerGame = 200;
+                MoveLogConfig config;
+                config.path = "/tmp/mali_ba_move_log_test.jsonl";
+                config.format = MoveLogFormat::kJsonLines;
+                config.queue_capacity = 64;
+                config.batch_size = 16;
+                {
+                    MoveLogSink sink(config);
+                    SPIEL_CHECK_TRUE(sink.ok());
+                    std::vector<std::thread> threads;
+                    for (int t = 0; t < kThreads; ++t)
+                    {
+                        threads.emplace_back([&sink]()
+                        {
+                            const int64_t game_id = sink.NewGameId();
+                            sink.LogSetup(game_id, "{\"num_players\":3}");
+                            for (int m = 1; m <= kMovesPerGame; ++m)
+                                sink.LogMove(game_id, m, "pass \"quoted\"", "{}");
+                        });
+                    }
+                    for (std::thread &thread : threads) thread.join();
+                    sink.Flush();
+                    SPIEL_CHECK_EQ(sink.records_written(), kThreads * (kMovesPerGame + 1));
+                    SPIEL_CHECK_EQ(sink.records_dropped(), 0);
+                }
+
+                std::ifstream in(config.path);
+                std::map<int64_t, int> last_move;
+                std::string line;
+                int num_lines = 0;
+                while (std::getline(in, line))
+                {
+                    json record = json::parse(line);
+                    const int64_t game_id = record["game"];
+                    if (record.contains("setup"))
+                    {
+                        SPIEL_CHECK_EQ(last_move.count(game_id), 0);
+                        last_move[game_id] = 0;
+                    }
+                    else
+                    {
+                        SPIEL_CHECK_EQ(record["move"].get<int>(), last_move.at(game_id) + 1);
+                        SPIEL_CHECK_EQ(record["action"].get<std::string>(), "pass \"quoted\"");
+                        last_move[game_id] = record["move"];
+                    }
+                    ++num_lines;
+                }
+                SPIEL_CHECK_EQ(num_lines, kThreads * (kMovesPerGame + 1));
+                for (const auto &[game_id, moves] : last_move) SPIEL_CHECK_EQ(moves, kMovesPerGame);
+                std::remove(config.path.c_str());
+
+                LOG_INFO("MoveLogSinkTest passed.");
+            }
+
             void IniFileConfigTest()
             {
                 LOG_INFO("--- IniFileConfigTest ---");
@@ -523,6 +2135,147 @@ namespace open_spiel
                 LOG_INFO("RegionalBoardConfigTest passed.");
             }
 
+            void BoardConfigCacheTest()
+            {
+                LOG_INFO("--- BoardConfigCacheTest ---");
+
+                const std::string config_content =
+                    "[Board]\n"
+                    "custom_hexes1 = 0,0,0:1,-1,0:-1,1,0:2,-2,0\n"
+                    "custom_hexes2 = 0,1,-1:1,0,-1:0,-1,1\n"
+                    "coastal_hexes = 2,-2,0\n"
+                    "[Regions]\n"
+                    "region1 = West\n"
+                    "region2 = East\n"
+                    "[Cities]\n"
+                    "city1 = Timbuktu,0,0,0\n"
+                    "city2 = Agadez,1,0,-1\n"
+                    "[Heuristics]\n"
+                    "weight_pass = 0.5\n"
+                    "[Rules]\n"
+                    "posts_per_player = 5\n";
+                const std::string config_path = "/tmp/mali_ba_board_cache_test.ini";
+                const std::string cache_dir = absl::StrCat("/tmp/mali_ba_board_cache_test_", getpid());
+                {
+                    std::ofstream out(config_path);
+                    out << config_content;
+                }
+                ClearBoardConfigCache();
+                const std::shared_ptr<const BoardConfig> parsed = ParseBoardConfig(config_content);
+                const std::string cache_path = BoardCacheFilePath(cache_dir, parsed->content_hash);
+                std::remove(cache_path.c_str());
+
+                auto check_same_config = [&](const BoardConfig &config)
+                {
+                    SPIEL_CHECK_EQ(config.content_hash, parsed->content_hash);
+                    SPIEL_CHECK_TRUE(config.params == parsed->params);
+                    SPIEL_CHECK_TRUE(config.board_section == parsed->board_section);
+                    SPIEL_CHECK_TRUE(config.heuristics_section == parsed->heuristics_section);
+                    SPIEL_CHECK_TRUE(config.training_section == parsed->training_section);
+                    SPIEL_CHECK_EQ(config.custom_cities, parsed->custom_cities);
+                    SPIEL_CHECK_TRUE(config.region_names == parsed->region_names);
+                    SPIEL_CHECK_TRUE(config.custom_board_defined);
+                    SPIEL_CHECK_TRUE(config.valid_hexes == parsed->valid_hexes);
+                    SPIEL_CHECK_TRUE(config.hex_regions == parsed->hex_regions);
+                    SPIEL_CHECK_TRUE(config.coastal_hexes == parsed->coastal_hexes);
+                    SPIEL_CHECK_TRUE(config.topology != nullptr);
+                    SPIEL_CHECK_TRUE(config.topology->hexes == parsed->topology->hexes);
+                    SPIEL_CHECK_TRUE(config.topology->hop_distances == parsed->topology->hop_distances);
+                };
+
+                // 1. A first load parses and writes the cache file; a second is the same instance.
+                std::shared_ptr<const BoardConfig> first = LoadBoardConfig(config_path, cache_dir);
+                SPIEL_CHECK_TRUE(first != nullptr);
+                check_same_config(*first);
+                SPIEL_CHECK_TRUE(std::ifstream(cache_path).good());
+                SPIEL_CHECK_TRUE(LoadBoardConfig(config_path, cache_dir) == first);
+                SPIEL_CHECK_EQ(first->params.at("posts_per_player"), "5");
+                SPIEL_CHECK_EQ(first->custom_cities, "Timbuktu,0,0,0:Agadez,1,0,-1");
+                SPIEL_CHECK_EQ(first->hex_regions.at(HexCoord(0, -1, 1)), 2);
+
+                // 2. With the in-process cache dropped, the file alone rebuilds it.
+                ClearBoardConfigCache();
+                std::shared_ptr<const BoardConfig> from_disk = LoadBoardConfig(config_path, cache_dir);
+                SPIEL_CHECK_TRUE(from_disk != nullptr);
+                SPIEL_CHECK_TRUE(from_disk != first);
+                check_same_config(*from_disk);
+
+                // 3. A corrupt cache file is ignored and rewritten.
+                {
+                    std::ofstream out(cache_path, std::ios::binary | std::ios::trunc);
+                    out << "MBBC garbage";
+                }
+                ClearBoardConfigCache();
+                check_same_config(*LoadBoardConfig(config_path, cache_dir));
+                ClearBoardConfigCache();
+                check_same_config(*LoadBoardConfig(config_path, cache_dir));
+
+                // 4. A symlink in place of the cache file is not followed, and a directory
+                // others can write to is not used at all.
+                const std::string decoy_path = absl::StrCat(cache_dir, "_decoy.bin");
+                std::rename(cache_path.c_str(), decoy_path.c_str());
+                SPIEL_CHECK_EQ(symlink(decoy_path.c_str(), cache_path.c_str()), 0);
+                ClearBoardConfigCache();
+                check_same_config(*LoadBoardConfig(config_path, cache_dir));
+                struct stat info;
+                SPIEL_CHECK_EQ(lstat(cache_path.c_str(), &info), 0);
+                SPIEL_CHECK_TRUE(S_ISREG(info.st_mode));
+                std::remove(cache_path.c_str());
+                std::remove(decoy_path.c_str());
+                SPIEL_CHECK_EQ(chmod(cache_dir.c_str(), 0777), 0);
+                ClearBoardConfigCache();
+                check_same_config(*LoadBoardConfig(config_path, cache_dir));
+                SPIEL_CHECK_FALSE(std::ifstream(cache_path).good());
+                SPIEL_CHECK_EQ(chmod(cache_dir.c_str(), 0700), 0);
+
+                // 5. Games on the INI share one topology and answer lookups from it.
+                open_spiel::GameParameters params;
+                params["config_file"] = open_spiel::GameParameter(config_path);
+                params["board_cache_dir"] = open_spiel::GameParameter(cache_dir);
+                std::shared_ptr<const Game> game = open_spiel::LoadGame("mali_ba", params);
+                params["board_cache_dir"] = open_spiel::GameParameter(std::string("none"));
+                std::shared_ptr<const Game> uncached_game = open_spiel::LoadGame("mali_ba", params);
+                const auto *mali_ba_game = static_cast<const Mali_BaGame *>(game.get());
+                const auto *uncached = static_cast<const Mali_BaGame *>(uncached_game.get());
+                SPIEL_CHECK_EQ(mali_ba_game->GetRules().posts_per_player, 5);
+                SPIEL_CHECK_FLOAT_EQ(mali_ba_game->GetHeuristicWeights().weight_pass, 0.5);
+                SPIEL_CHECK_EQ(mali_ba_game->GetRegionName(1), "West");
+                SPIEL_CHECK_EQ(mali_ba_game->GetCoastalHexes().size(), 1);
+                SPIEL_CHECK_EQ(mali_ba_game->NumHexes(), 7);
+                SPIEL_CHECK_EQ(uncached->NumHexes(), 7);
+                int index = 0;
+                for (const HexCoord &hex : mali_ba_game->GetValidHexes())
+                {
+                    SPIEL_CHECK_EQ(mali_ba_game->CoordToIndex(hex), index);
+                    SPIEL_CHECK_EQ(uncached->CoordToIndex(hex), index);
+                    SPIEL_CHECK_TRUE(mali_ba_game->IndexToCoord(index) == hex);
+                    SPIEL_CHECK_EQ(mali_ba_game->GetRegionForHex(hex), parsed->hex_regions.at(hex));
+                    SPIEL_CHECK_EQ(uncached->HopDistance(index, 0), mali_ba_game->HopDistance(index, 0));
+                    const City *expected = nullptr;
+                    for (const City &city : mali_ba_game->GetCities())
+                    {
+                        if (city.location == hex)
+                        {
+                            expected = &city;
+                            break;
+                        }
+                    }
+                    SPIEL_CHECK_TRUE(mali_ba_game->GetCityAt(hex) == expected);
+                    ++index;
+                }
+                SPIEL_CHECK_EQ(mali_ba_game->CoordToIndex(HexCoord(3, -3, 0)), -1);
+                SPIEL_CHECK_EQ(mali_ba_game->CoordToIndex(HexCoord(10, 10, -20)), -1);
+                SPIEL_CHECK_EQ(mali_ba_game->CoordToIndex(HexCoord(0, 0, 1)), -1);
+                SPIEL_CHECK_TRUE(mali_ba_game->GetCityAt(HexCoord(0, 0, 0)) != nullptr);
+                SPIEL_CHECK_EQ(mali_ba_game->GetCityAt(HexCoord(0, 0, 0))->name, "Timbuktu");
+                SPIEL_CHECK_TRUE(mali_ba_game->GetCityAt(HexCoord(10, 10, -20)) == nullptr);
+
+                std::remove(cache_path.c_str());
+                rmdir(cache_dir.c_str());
+                std::remove(config_path.c_str());
+                LOG_INFO("BoardConfigCacheTest passed.");
+            }
+
             // A simplified version of ApplyActionTestClone that does NOT test the clone.
             // It applies the action only once.
             void ApplyActionNoClone(open_spiel::State *state, open_spiel::Action action)
@@ -665,11 +2418,39 @@ int main(int argc, char **argv)
     // open_spiel::mali_ba::MancalaMoveTest_OneMeeple(game);
     // open_spiel::mali_ba::UpgradePostTest_ResourceCost(game);
     // open_spiel::mali_ba::UndoActionTest(game);
+    open_spiel::mali_ba::UndoJournalTest_MultiStep(game);
+    open_spiel::mali_ba::BinarySerializationTest(game);
+    open_spiel::mali_ba::ObservationTensorBatchTest(game);
+    open_spiel::mali_ba::LegalActionsMaskTest(game);
+    open_spiel::mali_ba::PerfCountersTest(game);
+    open_spiel::mali_ba::HeuristicWeightsTest(game);
+    open_spiel::mali_ba::IncrementalObservationTest(game);
+    open_spiel::mali_ba::BoardLookupTablesTest(game);
+    open_spiel::mali_ba::TradeRouteEnumerationTest(game);
+    open_spiel::mali_ba::WhatIfOverlayTest(game);
+    open_spiel::mali_ba::RouteConnectivityTest(game);
+    open_spiel::mali_ba::LegalActionCategoriesTest(game);
+    open_spiel::mali_ba::ScoreCountersTest(game);
+    open_spiel::mali_ba::InternedGoodsTest(game);
+    open_spiel::mali_ba::PackedMoveTest(game);
+    open_spiel::mali_ba::BoardKernelsTest(game);
+    open_spiel::mali_ba::CloneForSearchTest(game);
+    open_spiel::mali_ba::MctsSearchTest(game);
+    open_spiel::mali_ba::ZobristHashTest(game);
+    open_spiel::mali_ba::SelfPlayRunnerTest(game);
+    open_spiel::mali_ba::VectorEnvTest(game);
+    open_spiel::mali_ba::ReplayBufferTest(game);
+    open_spiel::mali_ba::GameArchiveTest(game);
+    open_spiel::mali_ba::ChangeFeedTest(game);
+    open_spiel::mali_ba::MemoryFootprintTest(game);
+    open_spiel::mali_ba::RngStreamTest(game);
+    open_spiel::mali_ba::MoveLogSinkTest();
     // open_spiel::mali_ba::SerializationTest_MidGame(game);
     // open_spiel::mali_ba::IniFileConfigTest();
     open_spiel::mali_ba::EndGameRequirementTest(game);
     open_spiel::mali_ba::EndGameTriggerAndScoringTest(game);
     open_spiel::mali_ba::RegionalBoardConfigTest();
+    open_spiel::mali_ba::BoardConfigCacheTest();
 
     // NOW THE RANDOM MOVES TESTS
     /*
@@ -692,7 +2473,7 @@ int main(int argc, char **argv)
 
     // // Show log file location if logging was enabled
     // if (move_logging) {
-    //     std::string log_file = open_spiel::mali_ba::Mali_BaState::GetMoveLogFilename();
+    //     std::string log_file = static_cast<const open_spiel::mali_ba::Mali_BaGame *>(game.get())->GetMoveLogSink()->path();
     //     if (!log_file.empty()) {
     //         std::cout << "Replay file created: " << log_file << std::endl;
     //         std::cout << "To replay: python main.py --mode gui_replay --replay_file " << log_file << std::endl;
@@ -0,0 +1,44 @@
+// mali_ba_transposition.cc
+// Lock-free transposition table
+
+#include "open_spiel/games/mali_ba/mali_ba_transposition.h"
+
+#include "open_spiel/spiel_utils.h"
+
+namespace open_spiel {
+namespace mali_ba {
+
+Mali_BaTranspositionTable::Mali_BaTranspositionTable(int num_slots) {
+  SPIEL_CHECK_GT(num_slots, 0);
+  uint64_t size = 1;
+  while (size < static_cast<uint64_t>(num_slots)) size <<= 1;
+  slots_ = std::make_unique<Slot[]>(size);
+  mask_ = size - 1;
+}
+
+// Keys come from a Zobrist hash, so their low bits are already well mixed.
+bool Mali_BaTranspositionTable::Probe(uint64_t key, uint64_t* data) const {
+  const Slot& slot = slots_[key & mask_];
+  const uint64_t value = slot.data.load(std::memory_order_relaxed);
+  const uint64_t check = slot.check.load(std::memory_order_relaxed);
+  if (key == 0 || (check ^ value) != key) return false;
+  *data = value;
+  return true;
+}
+
+void Mali_BaTranspositionTable::Store(uint64_t key, uint64_t data) {
+  if (key == 0) return;
+  Slot& slot = slots_[key & mask_];
+  slot.data.store(data, std::memory_order_relaxed);
+  slot.check.store(key ^ data, std::memory_order_relaxed);
+}
+
+void Mali_BaTranspositionTable::Clear() {
+  for (uint64_t i = 0; i <= mask_; ++i) {
+    slots_[i].check.store(0, std::memory_order_relaxed);
+    slots_[i].data.store(0, std::memory_order_relaxed);
+  }
+}
+
+}  // namespace mali_ba
+}  // namespace open_spiel
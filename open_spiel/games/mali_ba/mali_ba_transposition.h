@@ -0,0 +1,50 @@
+// mali_ba_transposition.h
+// Fixed-size, lock-free transposition table keyed by Mali_BaState::HashKey().
+//
+// Each slot holds a 64-bit payload next to key ^ payload (the lockless
+// hashing scheme of Hyatt and Mann). Writers never wait: a store simply
+// overwrites its slot. A probe that races with a store may read half of one
+// entry and half of another; the key check then fails and the probe misses
+// instead of returning a torn entry. Any number of threads may probe and
+// store at once.
+#ifndef OPEN_SPIEL_GAMES_MALI_BA_TRANSPOSITION_H_
+#define OPEN_SPIEL_GAMES_MALI_BA_TRANSPOSITION_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace open_spiel {
+namespace mali_ba {
+
+class Mali_BaTranspositionTable {
+ public:
+  // `num_slots` is rounded up to a power of two.
+  explicit Mali_BaTranspositionTable(int num_slots);
+
+  Mali_BaTranspositionTable(const Mali_BaTranspositionTable&) = delete;
+  Mali_BaTranspositionTable& operator=(const Mali_BaTranspositionTable&) = delete;
+
+  // True, with *data set, if `key` was stored and not overwritten since.
+  bool Probe(uint64_t key, uint64_t* data) const;
+  // Replaces whatever the slot for `key` held. Key 0 is reserved for empty
+  // slots and is not stored.
+  void Store(uint64_t key, uint64_t data);
+  // Not safe against concurrent probes or stores.
+  void Clear();
+
+  int num_slots() const { return static_cast<int>(mask_ + 1); }
+
+ private:
+  struct Slot {
+    std::atomic<uint64_t> check{0};  // key ^ data; 0 ^ 0 marks an empty slot
+    std::atomic<uint64_t> data{0};
+  };
+  std::unique_ptr<Slot[]> slots_;
+  uint64_t mask_ = 0;
+};
+
+}  // namespace mali_ba
+}  // namespace open_spiel
+
+#endif  // OPEN_SPIEL_GAMES_MALI_BA_TRANSPOSITION_H_
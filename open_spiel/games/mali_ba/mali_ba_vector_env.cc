@@ -0,0 +1,133 @@
+// mali_ba_vector_env.cc
+// Batched environment stepping
+
+#include "open_spiel/games/mali_ba/mali_ba_vector_env.h"
+
+#include <algorithm>
+#include <random>
+#include <utility>
+
+#include "open_spiel/games/mali_ba/mali_ba_game.h"
+#include "open_spiel/games/mali_ba/mali_ba_rng.h"
+#include "open_spiel/games/mali_ba/mali_ba_state.h"
+#include "open_spiel/spiel_utils.h"
+
+namespace open_spiel {
+namespace mali_ba {
+namespace {
+
+Mali_BaState& AsMaliBa(State& state) { return static_cast<Mali_BaState&>(state); }
+
+}  // namespace
+
+Mali_BaVectorEnv::Mali_BaVectorEnv(std::shared_ptr<const Game> game,
+                                   const VectorEnvConfig& config)
+    : game_(std::move(game)), config_(config) {
+  SPIEL_CHECK_TRUE(game_ != nullptr);
+  SPIEL_CHECK_TRUE(dynamic_cast<const Mali_BaGame*>(game_.get()) != nullptr);
+  SPIEL_CHECK_GT(config_.num_envs, 0);
+  observation_size_ = game_->ObservationTensorSize();
+  num_actions_ = game_->NumDistinctActions();
+  num_players_ = game_->NumPlayers();
+
+  const size_t k = config_.num_envs;
+  states_.resize(k);
+  observations_.assign(k * observation_size_, 0.0f);
+  legal_masks_.assign(k * num_actions_, 0);
+  current_players_.assign(k, kTerminalPlayerId);
+  rewards_.assign(k * num_players_, 0.0f);
+  dones_.assign(k, 0);
+  final_returns_.assign(k * num_players_, 0.0f);
+  episode_lengths_.assign(k, 0);
+  episode_counts_.assign(k, 0);
+  moves_this_episode_.assign(k, 0);
+  Reset();
+}
+
+void Mali_BaVectorEnv::Reset() {
+  std::fill(rewards_.begin(), rewards_.end(), 0.0f);
+  std::fill(dones_.begin(), dones_.end(), 0);
+  std::fill(final_returns_.begin(), final_returns_.end(), 0.0f);
+  std::fill(episode_lengths_.begin(), episode_lengths_.end(), 0);
+  for (int env = 0; env < config_.num_envs; ++env) {
+    ResetEnv(env);
+    WriteRows(env);
+  }
+}
+
+// A fresh state rather than ResetToInitialState(): that goes straight to the
+// play phase without token placement and keeps the old history.
+void Mali_BaVectorEnv::ResetEnv(int env) {
+  states_[env] = game_->NewInitialState();
+  AsMaliBa(*states_[env]).GetRNG().SeedStream(MixSeed(config_.seed, env), episode_counts_[env]++);
+  moves_this_episode_[env] = 0;
+  AdvanceChance(env);
+}
+
+void Mali_BaVectorEnv::AdvanceChance(int env) {
+  State& state = *states_[env];
+  while (state.IsChanceNode()) state.ApplyAction(state.LegalActions()[0]);
+}
+
+void Mali_BaVectorEnv::Step(absl::Span<const Action> actions) {
+  SPIEL_CHECK_EQ(actions.size(), static_cast<size_t>(config_.num_envs));
+  for (int env = 0; env < config_.num_envs; ++env) {
+    State& state = *states_[env];
+    float* rewards = &rewards_[static_cast<size_t>(env) * num_players_];
+    float* final_returns = &final_returns_[static_cast<size_t>(env) * num_players_];
+    std::fill(rewards, rewards + num_players_, 0.0f);
+    if (!config_.auto_reset && (dones_[env] || state.IsTerminal())) {
+      dones_[env] = 1;  // Stays done until Reset()
+      continue;
+    }
+
+    const Action action = actions[env];
+    SPIEL_CHECK_GE(action, 0);
+    SPIEL_CHECK_LT(action, num_actions_);
+    SPIEL_CHECK_TRUE(legal_masks_[static_cast<size_t>(env) * num_actions_ + action]);
+    state.ApplyAction(action);
+    ++moves_this_episode_[env];
+    AdvanceChance(env);
+
+    // A live state with nothing to play ends the episode as well.
+    const bool done = state.IsTerminal() || AsMaliBa(state).LegalActions().empty();
+    dones_[env] = done ? 1 : 0;
+    const std::vector<double> step_rewards = state.Rewards();
+    std::copy(step_rewards.begin(), step_rewards.end(), rewards);
+    if (!done) {
+      WriteRows(env);
+      continue;
+    }
+    const std::vector<double> returns = state.Returns();
+    std::copy(returns.begin(), returns.end(), final_returns);
+    episode_lengths_[env] = moves_this_episode_[env];
+    if (config_.auto_reset) ResetEnv(env);
+    WriteRows(env);
+  }
+}
+
+void Mali_BaVectorEnv::WriteRows(int env) {
+  const Mali_BaState& state = GetState(env);
+  absl::Span<float> observation =
+      absl::MakeSpan(observations_).subspan(static_cast<size_t>(env) * observation_size_,
+                                            observation_size_);
+  absl::Span<uint8_t> mask =
+      absl::MakeSpan(legal_masks_).subspan(static_cast<size_t>(env) * num_actions_, num_actions_);
+  current_players_[env] = state.CurrentPlayer();
+  if (state.IsTerminal()) {
+    std::fill(observation.begin(), observation.end(), 0.0f);
+    std::fill(mask.begin(), mask.end(), 0);
+    return;
+  }
+  state.ObservationTensor(state.CurrentPlayer(), observation);
+  state.LegalActionsMask(mask);
+}
+
+const Mali_BaState& Mali_BaVectorEnv::GetState(int env) const {
+  SPIEL_CHECK_GE(env, 0);
+  SPIEL_CHECK_LT(env, config_.num_envs);
+  return static_cast<const Mali_BaState&>(*states_[env]);
+}
+
+}  // namespace mali_ba
+}  // namespace open_spiel
@@ -0,0 +1,96 @@
+// mali_ba_vector_env.h
+// Steps K Mali-Ba games with one call, writing every env's outputs into
+// flat per-batch arrays.
+//
+// Env i's rows are the i-th rows of observations, legal masks, rewards and
+// the other arrays, so a caller (or Python, through zero-copy NumPy views)
+// feeds a whole batch to a model and hands back K actions. Each env is a
+// full Mali_BaState and reuses its cached observation planes and legal
+// actions; the rules are the ones DoApplyAction() applies. Chance nodes are
+// resolved inside the env, so every live env is at a decision node.
+//
+// An env whose game ends reports done = 1, the Rewards() of its last
+// transition and its final Returns() for that step. With auto_reset it then
+// starts a new episode straight away, and its observation and mask rows
+// already describe the new game.
+#ifndef OPEN_SPIEL_GAMES_MALI_BA_VECTOR_ENV_H_
+#define OPEN_SPIEL_GAMES_MALI_BA_VECTOR_ENV_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "open_spiel/abseil-cpp/absl/types/span.h"
+#include "open_spiel/spiel.h"
+
+namespace open_spiel {
+namespace mali_ba {
+
+class Mali_BaState;
+
+struct VectorEnvConfig {
+  int num_envs = 1;
+  uint64_t seed = 0;        // Episode e of env i is seeded from (seed, i, e)
+  bool auto_reset = true;   // Otherwise a done env stays terminal until Reset()
+};
+
+class Mali_BaVectorEnv {
+ public:
+  Mali_BaVectorEnv(std::shared_ptr<const Game> game, const VectorEnvConfig& config);
+
+  // Starts a new episode in every env.
+  void Reset();
+  // Applies actions[i] to env i. An action must be legal in its env's mask;
+  // the action of an env that is done and not auto-reset is ignored.
+  void Step(absl::Span<const Action> actions);
+
+  int NumEnvs() const { return config_.num_envs; }
+  int ObservationSize() const { return observation_size_; }
+  int NumActions() const { return num_actions_; }
+  int NumPlayers() const { return num_players_; }
+
+  // Refreshed by Reset() and Step(). Rows of terminal envs (only without
+  // auto_reset) are zero.
+  const std::vector<float>& Observations() const { return observations_; }  // K x obs size
+  const std::vector<uint8_t>& LegalMasks() const { return legal_masks_; }   // K x actions
+  const std::vector<int32_t>& CurrentPlayers() const { return current_players_; }  // K
+  // Refreshed by Step(); zero after Reset().
+  const std::vector<float>& Rewards() const { return rewards_; }       // K x players, Rewards()
+  const std::vector<uint8_t>& Dones() const { return dones_; }         // K
+  const std::vector<float>& FinalReturns() const { return final_returns_; }  // K x players, if done
+  const std::vector<int32_t>& EpisodeLengths() const { return episode_lengths_; }  // K, if done
+  // Cumulative per env, including the episode in progress.
+  const std::vector<int64_t>& EpisodeCounts() const { return episode_counts_; }
+
+  // The live state of env i, for inspection.
+  const Mali_BaState& GetState(int env) const;
+
+ private:
+  // Starts env i's next episode and resolves its chance nodes.
+  void ResetEnv(int env);
+  void AdvanceChance(int env);
+  // Rewrites env i's observation, mask and player rows.
+  void WriteRows(int env);
+
+  std::shared_ptr<const Game> game_;
+  VectorEnvConfig config_;
+  int observation_size_ = 0;
+  int num_actions_ = 0;
+  int num_players_ = 0;
+
+  std::vector<std::unique_ptr<State>> states_;
+  std::vector<float> observations_;
+  std::vector<uint8_t> legal_masks_;
+  std::vector<int32_t> current_players_;
+  std::vector<float> rewards_;
+  std::vector<uint8_t> dones_;
+  std::vector<float> final_returns_;
+  std::vector<int32_t> episode_lengths_;
+  std::vector<int64_t> episode_counts_;
+  std::vector<int32_t> moves_this_episode_;
+};
+
+}  // namespace mali_ba
+}  // namespace open_spiel
+
+#endif  // OPEN_SPIEL_GAMES_MALI_BA_VECTOR_ENV_H_
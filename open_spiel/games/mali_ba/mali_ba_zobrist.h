@@ -0,0 +1,98 @@
+// mali_ba_zobrist.h
+// Zobrist keys for Mali_BaState::HashKey().
+//
+// Every (hex index, feature, value) pair of the board, every (player, good,
+// count) of the goods and every trade route maps to a fixed pseudo-random
+// 64-bit key; a state's hash is the XOR of the keys of what it holds, so a
+// change is applied by XOR-ing the old key out and the new one in. Keys are
+// derived on the fly with a SplitMix64 finalizer instead of being stored in
+// tables: token and meeple counts are unbounded, and the mix is as cheap as
+// a table lookup that misses the cache. Keys do not depend on the game seed,
+// so equal positions hash equally across games with the same board.
+#ifndef OPEN_SPIEL_GAMES_MALI_BA_ZOBRIST_H_
+#define OPEN_SPIEL_GAMES_MALI_BA_ZOBRIST_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "open_spiel/games/mali_ba/mali_ba_board.h"
+#include "open_spiel/games/mali_ba/mali_ba_common.h"
+
+namespace open_spiel {
+namespace mali_ba {
+
+// Feature domains; each one gets its own key space.
+enum class ZobristDomain : uint64_t {
+  kToken = 1,
+  kMeeple,
+  kPosts,
+  kCenters,
+  kCommonGood,
+  kRareGood,
+  kRoute,
+  kTurn,
+};
+
+inline uint64_t ZobristMix(uint64_t z) {
+  z += 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+inline uint64_t ZobristKey(ZobristDomain domain, uint64_t a, uint64_t b, uint64_t c = 0) {
+  uint64_t z = ZobristMix(static_cast<uint64_t>(domain));
+  z = ZobristMix(z ^ a);
+  z = ZobristMix(z ^ b);
+  return ZobristMix(z ^ c);
+}
+
+inline uint64_t ZobristHexKey(const HexCoord& hex) {
+  return static_cast<uint64_t>(static_cast<uint32_t>(hex.x)) << 32 | static_cast<uint32_t>(hex.y);
+}
+
+// Key of one cell's contents; an empty cell contributes nothing.
+inline uint64_t ZobristCellKey(int index, const HexCell& cell) {
+  uint64_t key = 0;
+  if (cell.num_tokens > 0) {
+    for (int c = 0; c < kNumPlayerColors; ++c) {
+      if (cell.token_counts[c] > 0) {
+        key ^= ZobristKey(ZobristDomain::kToken, index, c, cell.token_counts[c]);
+      }
+    }
+  }
+  if (cell.num_meeples > 0) {
+    for (int m = 0; m < kNumMeepleColors; ++m) {
+      if (cell.meeple_counts[m] > 0) {
+        key ^= ZobristKey(ZobristDomain::kMeeple, index, m, cell.meeple_counts[m]);
+      }
+    }
+  }
+  if (cell.post_mask) key ^= ZobristKey(ZobristDomain::kPosts, index, cell.post_mask);
+  if (cell.center_mask) key ^= ZobristKey(ZobristDomain::kCenters, index, cell.center_mask);
+  return key;
+}
+
+// Key of `count` of one good (GoodsManager id) held by a player; zero
+// contributes nothing.
+inline uint64_t ZobristGoodKey(bool rare, int player, int good_id, int count) {
+  if (count == 0) return 0;
+  return ZobristKey(rare ? ZobristDomain::kRareGood : ZobristDomain::kCommonGood,
+                    player, good_id, static_cast<uint32_t>(count));
+}
+
+// Key of a route by owner, hexes (in order) and active flag; the route id is
+// left out so routes declared in a different order still transpose.
+inline uint64_t ZobristRouteKey(const TradeRoute& route) {
+  uint64_t z = ZobristKey(ZobristDomain::kRoute, static_cast<uint64_t>(route.owner),
+                          route.active ? 1 : 0);
+  for (const HexCoord& hex : route.hexes) {
+    z = ZobristMix(z ^ ZobristHexKey(hex));
+  }
+  return z;
+}
+
+}  // namespace mali_ba
+}  // namespace open_spiel
+
+#endif  // OPEN_SPIEL_GAMES_MALI_BA_ZOBRIST_H_
@@ -28,6 +28,7 @@ class GameStateCache:
         self.game_player_colors: List[PlayerColor] = list(PlayerColor)[1:num_players+1] # Exclude EMPTY
         self.trade_routes: List[TradeRoute] = []
         self.next_route_id: int = 1
+        self.change_feed_seq: int = -1 # Last C++ change feed entry applied; -1 = none
 
 
     def update_num_players(self, num_players):
@@ -22,15 +22,17 @@ WEIGHTS_UPDATE_INTERVAL_SECONDS = 15
 
 # --- Child Process Functions ---
 
-def trainer_process(args, initial_game_params, replay_buffer_queue, weights_queue, stats_queue):
-    """A dedicated process for training the model."""
+def trainer_process(args, initial_game_params, replay_buffer_name, shutdown_event, weights_queue, stats_queue):
+    """A dedicated process for training the model.
+
+    Experiences arrive through the shared-memory replay buffer the learner
+    created under `replay_buffer_name`; minibatches are sampled from it in C++
+    and reach the model as NumPy views, without pickling."""
     # --- IMPORTS ARE THE VERY FIRST THING ---
     import tensorflow as tf
     import pyspiel
     from mali_ba.training_utils import SimpleAgent
     from pyspiel.mali_ba import log, LogLevel
-    # This import can be removed, as the ReplayBuffer is local now
-    # from mali_ba.classes.classes_other import ReplayBuffer
 
     os.environ['TF_CPP_MIN_LOG_LEVEL'] = '2'
     gpus = tf.config.experimental.list_physical_devices('GPU')
@@ -64,56 +66,46 @@ def trainer_process(args, initial_game_params, replay_buffer_queue, weights_queu
     # ### <<< CORRECTION 1: Put a TUPLE of weights on the queue.
     weights_queue.put((agent.policy_model.get_weights(), agent.value_model.get_weights()))
 
-    # Re-importing here is fine, or just remove the one at the top.
-    from mali_ba.classes.classes_other import ReplayBuffer
-
-    local_replay_buffer = ReplayBuffer(args.replay_buffer_size)
-    training_counter = 0
+    replay_buffer = pyspiel.mali_ba.SharedReplayBuffer.attach(replay_buffer_name)
+    if args.random_seed is not None:
+        replay_buffer.seed(args.random_seed)
+    last_trained_total = 0
     last_save_time = time.time()
     
     while True:
-        # Process all available experiences without blocking
-        experiences_processed = 0
-        max_experiences_per_cycle = args.batch_size * 4  # Process in chunks
-        
-        try:
-            while experiences_processed < max_experiences_per_cycle:
-                experience = replay_buffer_queue.get_nowait()  # Non-blocking get
-                if experience is None:
-                    log(LogLevel.INFO, "Trainer received shutdown signal. Saving final model.")
-                    agent.save_model(args.save_model_path)
-                    return
-                local_replay_buffer.add(experience)
-                experiences_processed += 1
-        except:  # Queue empty - this is normal and expected
-            pass
-        
-        if experiences_processed > 0:
-             # Log less frequently to reduce log spam
-            if len(local_replay_buffer) % 100 < experiences_processed:
-                log(LogLevel.INFO, f"Trainer processed {experiences_processed} new experiences. Buffer size: {len(local_replay_buffer)}")
-
-        # Train in batches
-        if len(local_replay_buffer) >= args.batch_size:
-            # Check if we have enough new data to warrant a training step
-            if experiences_processed > args.batch_size // 2 or len(local_replay_buffer) % (args.batch_size * 2) == 0 :
-                log(LogLevel.INFO, f"Trainer: Starting training with buffer size {len(local_replay_buffer)}")
-                try:
-                    loss = agent.train(local_replay_buffer, args.batch_size) # Use the configured batch size
-                    if loss is not None:
-                        log(LogLevel.INFO, f"Trainer: Training successful, loss = {loss:.4f}")
-                        stats_queue.put({"loss": loss})
-                    else:
-                        log(LogLevel.WARN, "Trainer: agent.train() returned None")
-                except Exception as e:
-                    log(LogLevel.ERROR, f"Trainer: Training failed with error: {e}")
-                    import traceback
-                    log(LogLevel.ERROR, f"Trainer: Full traceback: {traceback.format_exc()}")
-                
-                # Update weights for actors after a successful training step
-                if weights_queue.empty():
-                    # ### <<< CORRECTION 2: Put a TUPLE of weights on the queue here as well.
-                    weights_queue.put((agent.policy_model.get_weights(), agent.value_model.get_weights()))
+        if shutdown_event.is_set():
+            log(LogLevel.INFO, "Trainer received shutdown signal. Saving final model.")
+            agent.save_model(args.save_model_path)
+            return
+
+        # The ring keeps the newest replay_buffer_size records; older ones are
+        # overwritten in place, so there is nothing to drain or prune here.
+        total_added = replay_buffer.total_added
+        experiences_processed = total_added - last_trained_total
+        buffer_size = len(replay_buffer)
+
+        # Train in batches, once there is enough new data to warrant a step
+        if buffer_size >= args.batch_size and experiences_processed > args.batch_size // 2:
+            last_trained_total = total_added
+            log(LogLevel.INFO, f"Trainer: Starting training with buffer size {buffer_size} "
+                               f"({experiences_processed} new experiences)")
+            try:
+                observations, policies, values, _, _, _ = replay_buffer.sample(args.batch_size)
+                loss = agent.train_on_batch(observations, policies, values)
+                if loss is not None:
+                    log(LogLevel.INFO, f"Trainer: Training successful, loss = {loss:.4f}")
+                    stats_queue.put({"loss": loss})
+                else:
+                    log(LogLevel.WARN, "Trainer: agent.train_on_batch() returned None")
+            except Exception as e:
+                log(LogLevel.ERROR, f"Trainer: Training failed with error: {e}")
+                import traceback
+                log(LogLevel.ERROR, f"Trainer: Full traceback: {traceback.format_exc()}")
+            
+            # Update weights for actors after a successful training step
+            if weights_queue.empty():
+                # ### <<< CORRECTION 2: Put a TUPLE of weights on the queue here as well.
+                weights_queue.put((agent.policy_model.get_weights(), agent.value_model.get_weights()))
 
         # Periodic model saving
         current_time = time.time()
@@ -126,16 +118,8 @@ def trainer_process(args, initial_game_params, replay_buffer_queue, weights_queu
                 # The agent's save_model will also log, but we add one here too.
                 log(LogLevel.ERROR, f"Trainer: agent.save_model failed inside periodic save. Error: {e}")
 
-        # Prune the buffer if it's almost full
-        if len(local_replay_buffer) > args.replay_buffer_size * 0.95:
-            log(LogLevel.INFO, "Pruning replay buffer...")
-            remove_count = int(args.replay_buffer_size * 0.1)
-            for _ in range(remove_count):
-                if len(local_replay_buffer) > 0:
-                    local_replay_buffer.buffer.popleft()
-
         # If there's nothing to do, sleep briefly to prevent busy-waiting
-        if experiences_processed == 0 and len(local_replay_buffer) < args.batch_size:
+        if experiences_processed <= args.batch_size // 2:
             time.sleep(0.1)
 
 
@@ -148,7 +132,7 @@ def actor_process(actor_id, game_params, args, job_queue, result_queue, games_pe
     from pyspiel import mali_ba
     from pyspiel.mali_ba import log, LogLevel
     import tensorflow as tf
-    from mali_ba.training_utils import AlphaZeroEvaluator, create_mali_ba_policy_network, create_mali_ba_value_network
+    from mali_ba.training_utils import AlphaZeroEvaluator, BatchedAlphaZeroEvaluator, create_mali_ba_policy_network, create_mali_ba_value_network
 
     os.environ["CUDA_VISIBLE_DEVICES"] = "-1"
     tf.config.set_visible_devices([], 'GPU')
@@ -164,6 +148,8 @@ def actor_process(actor_id, game_params, args, job_queue, result_queue, games_pe
     # Create instances of both networks
     policy_model = create_mali_ba_policy_network(game.observation_tensor_shape(), game.num_distinct_actions())
     value_model = create_mali_ba_value_network(game.observation_tensor_shape(), game.num_players())
+    if args.perf_counters:
+        mali_ba.set_perf_counters_enabled(True)
 
     for _ in range(args.games_per_actor):
         job = job_queue.get()
@@ -187,12 +173,12 @@ def actor_process(actor_id, game_params, args, job_queue, result_queue, games_pe
         # INSTEAD:
         state = game.new_initial_state()
 
-        # NOTE: For MCTS, if you need the C++ RNG to be different for each game,
-        # you would need a way to re-seed the game object's internal RNG.
-        # A simple `game.set_rng_state(str(game_rng_seed))` exposed via pybind11
-        # would be the proper way to handle this. For now, we proceed as the
-        # MCTS bot's own randomness (dirichlet noise, policy sampling) will
-        # provide sufficient exploration.
+        # The C++ draws of this game come from its own stream, keyed by
+        # (game_rng_seed, episode_num), so the game does not depend on which
+        # actor plays it. The Python search noise takes channel 1 of it.
+        state.seed_rng_stream(game_rng_seed, episode_num)
+        search_random_state = np.random.RandomState(
+            state.fork_rng(1).key % (2**32))
 
         # Pass both models to the evaluator
         evaluator = AlphaZeroEvaluator(game, policy_model, value_model)
@@ -204,9 +190,24 @@ def actor_process(actor_id, game_params, args, job_queue, result_queue, games_pe
             # alpha creates more "spiky" noise, forcing exploration of
             # a few non-policy moves. The default is 0.3. Let's make it stronger.
             dirichlet_noise=(0.2, 0.25), 
-            child_selection_fn=mcts.SearchNode.puct_value, verbose=False)
+            child_selection_fn=mcts.SearchNode.puct_value, verbose=False,
+            random_state=search_random_state)
+
+        # Optional native search: one C++ call per move, leaves batched into the models
+        cpp_engine = None
+        if args.cpp_mcts:
+            mcts_config = mali_ba.MctsConfig()
+            mcts_config.num_simulations = args.max_simulations
+            mcts_config.batch_size = args.mcts_batch_size
+            mcts_config.c_puct = args.uct_c
+            mcts_config.dirichlet_alpha = 0.2
+            mcts_config.dirichlet_epsilon = 0.25
+            mcts_config.seed = game_rng_seed
+            cpp_engine = mali_ba.MctsEngine(
+                mcts_config, BatchedAlphaZeroEvaluator(game, policy_model, value_model))
 
         state = game.new_initial_state()
+        state.seed_rng_stream(game_rng_seed, episode_num)
         
         # Chance node startup
         episode_trajectory = []
@@ -251,7 +252,12 @@ def actor_process(actor_id, game_params, args, job_queue, result_queue, games_pe
             # # END DEBUG ======================================================================
             player = state.current_player()
             
-            root = bot.mcts_search(state)
+            if cpp_engine is not None:
+                search_result = cpp_engine.search(state)
+                root_visits = list(zip(search_result.actions, search_result.visit_counts))
+            else:
+                root = bot.mcts_search(state)
+                root_visits = [(child.action, child.explore_count) for child in root.children]
             
             temperature = 1.0 if move_count < 100 else 0.5
 
@@ -344,9 +350,9 @@ def actor_process(actor_id, game_params, args, job_queue, result_queue, games_pe
             action_map = {action: i for i, action in enumerate(legal_actions)}
 
             visit_counts = np.zeros(len(legal_actions))
-            for child in root.children:
-                if child.action in action_map:
-                    visit_counts[action_map[child.action]] = child.explore_count
+            for child_action, child_visits in root_visits:
+                if child_action in action_map:
+                    visit_counts[action_map[child_action]] = child_visits
 
             if np.sum(visit_counts) > 0:
                 powered_policy = np.power(visit_counts, 1.0 / temperature)
@@ -365,8 +371,8 @@ def actor_process(actor_id, game_params, args, job_queue, result_queue, games_pe
                 log(LogLevel.INFO, f"  MCTS chose: {chosen_action_str} (action {action})")
                 
                 # Show MCTS visit counts for top actions
-                if hasattr(root, 'children') and len(root.children) > 0:
-                    visit_counts = [(child.action, child.explore_count) for child in root.children]
+                if len(root_visits) > 0:
+                    visit_counts = list(root_visits)
                     visit_counts.sort(key=lambda x: x[1], reverse=True)
                     top_visits = []
                     for act, count in visit_counts[:3]:
@@ -379,9 +385,9 @@ def actor_process(actor_id, game_params, args, job_queue, result_queue, games_pe
 
             # For the replay buffer, we need the policy over the FULL action space
             mcts_policy_full = np.zeros(game.num_distinct_actions())
-            for child in root.children:
-                 if 0 <= child.action < game.num_distinct_actions():
-                    mcts_policy_full[child.action] = child.explore_count
+            for child_action, child_visits in root_visits:
+                 if 0 <= child_action < game.num_distinct_actions():
+                    mcts_policy_full[child_action] = child_visits
             if np.sum(mcts_policy_full) > 0:
                 mcts_policy_full /= np.sum(mcts_policy_full)
             else: # Fallback for states with no visits (should be rare)
@@ -442,7 +448,7 @@ def actor_process(actor_id, game_params, args, job_queue, result_queue, games_pe
                 f"Rewarded Steps: {non_zero_reward_steps}"
                 )
             
-        result_queue.put((episode_trajectory, returns))
+        result_queue.put((episode_trajectory, returns, take_perf_stats() if args.perf_counters else None))
 
     log(LogLevel.INFO, f"Actor {actor_id} completed its quota of {games_per_actor} games and is terminating.")
 
@@ -470,6 +476,8 @@ def heuristic_actor_process(actor_id, game_params, args, job_queue, result_queue
     # Get the max game length
     max_game_length = game.get_max_game_length()
     log(LogLevel.INFO, f"Using max game length: {max_game_length}")
+    if args.perf_counters:
+        mali_ba.set_perf_counters_enabled(True)
     
     for _ in range(args.games_per_actor):
         job = job_queue.get()
@@ -485,11 +493,9 @@ def heuristic_actor_process(actor_id, game_params, args, job_queue, result_queue
         # --- FIX: Use the existing game object to create a new state ---
         # We do NOT need to reload the game. We create a fresh state from the template.
         state = game.new_initial_state()
-        
-        # The C++ state's internal RNG will be seeded by the game object's RNG state,
-        # which is usually set once at creation. For true per-game randomness from C++,
-        # you might need a game.set_rng_state() method if the initial seed isn't sufficient.
-        # However, for the heuristic actor, this is less critical.
+        # The C++ heuristic draws from this game's own stream, so the game does
+        # not depend on which actor plays it.
+        state.seed_rng_stream(game_rng_seed, episode_num)
 
         # --- Play the full game to generate a trajectory ---
         
@@ -583,9 +589,9 @@ def heuristic_actor_process(actor_id, game_params, args, job_queue, result_queue
             f"Heuristic Actor {actor_id}, Game {episode_num}: FINISHED in {move_count} moves. "
             f"Final Returns: {returns}")
 
-        # The result queue expects a trajectory and the returns.
+        # The result queue expects a trajectory, the returns and the perf stats.
         # This format is identical to what the MCTS actor produces.
-        result_queue.put((temp_trajectory, returns))
+        result_queue.put((temp_trajectory, returns, take_perf_stats() if args.perf_counters else None))
 
     log(LogLevel.INFO, f"Heuristic Actor {actor_id} completed its quota and is terminating.")
 
@@ -600,6 +606,42 @@ def spawn_actor(actor_id, initial_game_params, args, job_queue, result_queue, ac
     actor_pool[p] = actor_id # Associates the process object with its ID
     print(f"Main: Spawned new actor (type: {actor_function.__name__}) with ID {actor_id}.")
 
+def take_perf_stats():
+    """Returns this process's C++ hot-path counters (sections with calls only) and resets them."""
+    from pyspiel import mali_ba
+    stats = {name: entry for name, entry in mali_ba.get_perf_stats().items() if entry["calls"] > 0}
+    mali_ba.reset_perf_stats()
+    return stats
+
+def merge_perf_stats(totals, stats):
+    """Adds one take_perf_stats() snapshot into `totals` (same layout)."""
+    for name, entry in stats.items():
+        total = totals.setdefault(name, {"calls": 0, "total_ns": 0, "max_ns": 0,
+                                         "histogram": [0] * len(entry["histogram"])})
+        total["calls"] += entry["calls"]
+        total["total_ns"] += entry["total_ns"]
+        total["max_ns"] = max(total["max_ns"], entry["max_ns"])
+        total["histogram"] = [a + b for a, b in zip(total["histogram"], entry["histogram"])]
+
+def format_perf_stats(totals):
+    """One line per section, slowest total first. Quantiles are histogram bucket upper bounds."""
+    def quantile_us(entry, q):
+        target = max(1, int(q * entry["calls"] + 0.999999))
+        seen = 0
+        for bucket, count in enumerate(entry["histogram"]):
+            seen += count
+            if seen >= target:
+                return (1 << (bucket + 1)) / 1000.0
+        return entry["max_ns"] / 1000.0
+
+    lines = []
+    for name, entry in sorted(totals.items(), key=lambda item: -item[1]["total_ns"]):
+        lines.append(f"  {name:<18} calls={entry['calls']:<9} total={entry['total_ns'] / 1e9:8.3f}s "
+                     f"mean={entry['total_ns'] / entry['calls'] / 1000.0:9.1f}us "
+                     f"p50<={quantile_us(entry, 0.5):.1f}us p99<={quantile_us(entry, 0.99):.1f}us "
+                     f"max={entry['max_ns'] / 1000.0:.1f}us")
+    return lines
+
 def log_game_outcome_debug(total_games_processed, returns, game_length, max_game_length):
     try:
         from pyspiel.mali_ba import log, LogLevel
@@ -663,18 +705,24 @@ def main(args):
     max_results = args.num_actors 
     result_queue = mp.Queue(maxsize=max_results)
 
-    # The replay buffer queue is the biggest memory consumer.
-    # Limit it to a few batches worth of experiences.
-    # batch_size * num_moves_per_game * num_games
-    # A fixed large number is simpler. Let's allow 20 batches.
-    max_replay_items = args.batch_size * 50
-    replay_buffer_queue = mp.Queue(maxsize=max_replay_items)
+    # The replay buffer is a fixed-size ring in shared memory: the learner
+    # writes experiences into it and the trainer samples from it in place.
+    temp_game = pyspiel.load_game(args.game_name, initial_game_params)
+    replay_config = pyspiel.mali_ba.ReplayBufferConfig()
+    replay_config.capacity = args.replay_buffer_size
+    replay_config.observation_size = temp_game.observation_tensor_size()
+    replay_config.num_actions = temp_game.num_distinct_actions()
+    replay_config.num_players = temp_game.num_players()
+    del temp_game
+    replay_buffer = pyspiel.mali_ba.SharedReplayBuffer.create(
+        f"/mali_ba_replay_{os.getpid()}", replay_config)
+    trainer_shutdown = mp.Event()
 
     weights_queue = mp.Queue()
     stats_queue = mp.Queue()
 
     trainer = mp.Process(target=trainer_process, args=(
-        args, initial_game_params, replay_buffer_queue, weights_queue, stats_queue))
+        args, initial_game_params, replay_buffer.name, trainer_shutdown, weights_queue, stats_queue))
     trainer.start()
     log(LogLevel.INFO, "Launched trainer process.")
 
@@ -685,6 +733,7 @@ def main(args):
     jobs_dispatched = 0
     start_time = time.time()
     last_weights_update_time = time.time()
+    perf_totals = {}  # Actors' hot-path counters since the last stats report
     
     if args.random_seed is None:
         master_seed = int(time.time() * 1000) % (2**32 - 1)
@@ -707,7 +756,7 @@ def main(args):
         if total_games_processed % 10 == 0:
             log(LogLevel.DEBUG, f"Queue sizes - Jobs: {job_queue.qsize()}, "
                             f"Results: {result_queue.qsize()}, "
-                            f"Replay: {replay_buffer_queue.qsize()}")
+                            f"Replay: {len(replay_buffer)}")
 
         # --- A. Actor & Job Management ---
         
@@ -753,7 +802,9 @@ def main(args):
 
         # --- B. Try to process a result ---
         try:
-            trajectory, returns = result_queue.get(timeout=1.0)
+            trajectory, returns, perf_stats = result_queue.get(timeout=1.0)
+            if perf_stats:
+                merge_perf_stats(perf_totals, perf_stats)
             
             # Process the game result
             total_games_processed += 1
@@ -792,17 +843,10 @@ def main(args):
             trajectory_with_values.reverse()
 
             # Now, add the correctly calculated experiences to the replay buffer.
+            # The value target for the network is the full vector of expected returns for all players.
+            # A full ring overwrites its oldest experiences.
             for observation, player, policy_target, value_target_vector in trajectory_with_values:
-                # The value target for the network is the full vector of expected returns for all players.
-                # The player_value is just one element of that vector, used for logging/debugging if needed.
-                player_value = value_target_vector[player]
-                value_data = (player, player_value, value_target_vector)
-                
-                if not replay_buffer_queue.full():
-                    replay_buffer_queue.put((observation, policy_target, value_data))
-                else:
-                    log(LogLevel.WARN, "Replay buffer queue is full during data insertion.")
-                    break
+                replay_buffer.add(observation, policy_target, value_target_vector, player)
 
             # Add detailed outcome logging
             # log_game_outcome_debug(total_games_processed, discounted_returns, game_length, max_game_length)
@@ -853,13 +897,19 @@ def main(args):
                     if "loss" in stats:
                         log(LogLevel.INFO, f"Trainer reported loss: {stats['loss']:.4f} at game #{total_games_processed}")
                 except: break
+
+            if perf_totals:
+                log(LogLevel.INFO, f"Actor hot-path counters at game #{total_games_processed}:")
+                for line in format_perf_stats(perf_totals):
+                    log(LogLevel.INFO, line)
+                perf_totals.clear()
             
             last_weights_update_time = time.time()
 
     # --- 4. Final Shutdown (Same) ---
     log(LogLevel.INFO, "All episodes processed. Sending shutdown signals...")
     # ... (shutdown code is correct) ...
-    replay_buffer_queue.put(None)
+    trainer_shutdown.set()
     
     while not job_queue.empty():
         try: job_queue.get_nowait()
@@ -917,6 +967,12 @@ if __name__ == "__main__":
                     help="Number of games each actor process plays before self-terminating to free memory.")
     parser.add_argument('--bootstrap_episodes', type=int, default=0,
                     help="Number of initial episodes to generate using the C++ heuristic for bootstrapping.")
+    parser.add_argument('--cpp_mcts', action='store_true',
+                    help="Use the native C++ MCTS engine instead of open_spiel.python.algorithms.mcts.")
+    parser.add_argument('--mcts_batch_size', type=int, default=8,
+                    help="Leaves per evaluator call for the native MCTS engine.")
+    parser.add_argument('--perf_counters', action='store_true',
+                    help="Collect C++ hot-path counters in the actors and log them with the trainer stats.")
 
     
     parsed_args = parser.parse_args()
@@ -142,9 +142,6 @@ class SimpleAgent:
 
             # --- Data Preparation ---
             observations_flat = np.array(observations)
-            target_shape_3d = self.policy_model.input_shape[1:]
-            observations_reshaped = observations_flat.reshape((-1, *target_shape_3d))
-
             policy_targets = np.array(policy_targets)
             
             full_value_targets = np.zeros((batch_size, self.num_players))
@@ -153,6 +150,21 @@ class SimpleAgent:
                 for p in range(self.num_players):
                     if p < len(all_discounted_returns):
                         full_value_targets[i, p] = all_discounted_returns[p]
+        except Exception as e:
+            log(LogLevel.ERROR, f"Trainer: An unexpected error occurred while preparing a batch: {e}")
+            import traceback
+            log(LogLevel.ERROR, f"Trainer: Full traceback: {traceback.format_exc()}")
+            return None
+
+        return self.train_on_batch(observations_flat, policy_targets, full_value_targets)
+
+    def train_on_batch(self, observations_flat, policy_targets, full_value_targets):
+        """One policy and one value step on [batch, observation_size] observations,
+        [batch, num_actions] policy targets and [batch, num_players] value targets.
+        Takes the arrays SharedReplayBuffer.sample() returns as they are."""
+        try:
+            target_shape_3d = self.policy_model.input_shape[1:]
+            observations_reshaped = np.asarray(observations_flat).reshape((-1, *target_shape_3d))
             
             # --- Input Sanity Checks ---
             if np.any(np.isnan(observations_reshaped)) or np.any(np.isinf(observations_reshaped)):
@@ -292,6 +304,52 @@ class AlphaZeroEvaluator:
             return [(action, uniform_prob) for action in legal_actions]
 
 
+class BatchedAlphaZeroEvaluator:
+    """Leaf evaluator for the native pyspiel.mali_ba.MctsEngine.
+
+    The engine calls this once per batch of leaves with a float32 array of
+    shape [batch, observation_size] and expects (priors, values) back. Only
+    observations reach Python, so the heuristic prior mixing done by
+    AlphaZeroEvaluator.prior() is not applied here.
+    """
+
+    def __init__(self, game, policy_model, value_model):
+        self._policy_model = policy_model
+        self._value_model = value_model
+        self._shape = [-1] + list(game.observation_tensor_shape())
+
+    def __call__(self, observations):
+        obs_batch = np.reshape(observations, self._shape)
+        priors = self._policy_model(obs_batch, training=False).numpy()
+        values = self._value_model(obs_batch, training=False).numpy()
+        return priors, values
+
+
+def selfplay_buffer_to_trajectories(buffer):
+    """Splits a pyspiel.mali_ba.SelfPlayBuffer into the (trajectory, returns)
+    pairs the learner takes off result_queue. Each trajectory is a list of
+    (observation, player, policy, reward_vector) tuples; the arrays are views
+    into the buffer, so keep the buffer alive while they are in use."""
+    observations = buffer.observations
+    players = buffer.players
+    policies = buffer.policies
+    rewards = buffer.rewards
+    game_ids = buffer.game_ids
+    game_returns = buffer.game_returns
+    game_lengths = buffer.game_lengths
+    results = []
+    row = 0
+    # Games are stored contiguously, in the order they finished.
+    while row < buffer.num_records:
+        game_id = int(game_ids[row])
+        length = int(game_lengths[game_id])
+        trajectory = [(observations[i], int(players[i]), policies[i], list(rewards[i]))
+                      for i in range(row, row + length)]
+        results.append((trajectory, list(game_returns[game_id])))
+        row += length
+    return results
+
+
 # ** Accept num_players to build the correct output shape **
 def create_mali_ba_policy_network(observation_shape, num_actions):
     """Creates the policy network."""
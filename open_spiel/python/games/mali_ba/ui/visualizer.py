@@ -5,7 +5,7 @@ from mali_ba.classes.classes_other import TradePost, City, HexCoord, TradePostTy
 from mali_ba.classes.game_state import GameStateCache
 from mali_ba.ui.gui_other import InteractiveObject, InteractiveObjectManager, ControlPanel, Sidebar, DialogBox
 from mali_ba.utils.cpp_interface import GameInterface
-from mali_ba.ui.visualizer_other import BoardVisualizerHelpers, parse_and_update_state_from_json, can_start_mancala_at, is_valid_mancala_step, can_select_for_upgrade, can_add_to_trade_route
+from mali_ba.ui.visualizer_other import BoardVisualizerHelpers, parse_and_update_state_from_json, apply_change_feed_to_cache, can_start_mancala_at, is_valid_mancala_step, can_select_for_upgrade, can_add_to_trade_route
 
 # Import the new drawing and parsing modules
 from mali_ba.ui.visualizer_drawing import draw_board_state, load_background_map
@@ -134,10 +134,19 @@ class BoardVisualizer:
             raise RuntimeError("FATAL: Could not parse initial state.")
 
 
-    def parse_and_update_state(self, state_string: str) -> bool:
-        """Parses the authoritative state string and updates the cache."""
-        # This now calls the correctly imported function
-        success = parse_and_update_state_from_json(state_string, self.state_cache)
+    def parse_and_update_state(self, state_update) -> bool:
+        """
+        Updates the cache from a full JSON state string, or from a list of C++ change
+        feed entries (see GameInterface.apply_action). A feed that has fallen out of
+        step is resynced from the full state.
+        """
+        if isinstance(state_update, list):
+            success = apply_change_feed_to_cache(state_update, self.state_cache)
+            if not success and self.game_interface:
+                success = parse_and_update_state_from_json(
+                    self.game_interface.get_current_state_string(), self.state_cache)
+        else:
+            success = parse_and_update_state_from_json(state_update, self.state_cache)
         if success:
             self.helpers.update_status_from_cache()
             # IF WE have machine players, play their turn automatically
@@ -2,7 +2,7 @@
 import sys
 sys.path.append("/media/robp/UD/Projects/mali_ba/open_spiel/python/games") # allow debugging in vs code
 import json
-from typing import List
+from typing import List, Optional
 from mali_ba.config import PlayerColor, MeepleColor, TradePostType, Phase
 from mali_ba.classes.game_state import GameStateCache
 from mali_ba.classes.classes_other import TradePost, City, HexCoord, TradeRoute
@@ -62,7 +62,6 @@ def can_add_to_trade_route(hex_coord: HexCoord, player_color: PlayerColor, cache
 def parse_and_update_state_from_json(state_str: str, cache: GameStateCache) -> bool:
     """
     Parses the authoritative C++ JSON state string and completely updates the cache.
-    This is now the ONLY way the GameStateCache is modified.
     
     Args:
         state_str: The JSON string from C++'s `serialize()`.
@@ -79,6 +78,87 @@ def parse_and_update_state_from_json(state_str: str, cache: GameStateCache) -> b
         print(f"Error: Invalid JSON received: {e}")
         return False
 
+    # A full state supersedes whatever the change feed delivered so far.
+    cache.change_feed_seq = -1
+    return _load_state_dict(data, cache)
+
+
+def apply_change_feed_to_cache(entries: List[str], cache: GameStateCache) -> bool:
+    """
+    Applies entries drained from the C++ change feed (`drain_change_feed()`) to the cache.
+    Snapshots replace the cache; deltas only touch the hexes, goods and routes they list.
+    
+    Returns:
+        False if an entry could not be parsed or a delta does not follow the last applied
+        entry. The cache is then out of step and must be reloaded from a full state.
+    """
+    for entry_str in entries:
+        try:
+            entry = json.loads(entry_str)
+        except json.JSONDecodeError as e:
+            print(f"Error: Invalid change feed entry: {e}")
+            return False
+
+        seq = entry.get("seq", -1)
+        if entry.get("type") == "snapshot":
+            if not _load_state_dict(entry.get("state", {}), cache):
+                return False
+            cache.change_feed_seq = seq
+            continue
+
+        # After a full state string (change_feed_seq == -1) any delta follows: the
+        # interface drains the feed whenever it serializes the whole state.
+        if cache.change_feed_seq >= 0 and seq != cache.change_feed_seq + 1:
+            print(f"Change feed gap: expected seq {cache.change_feed_seq + 1}, got {seq}")
+            return False
+        try:
+            _apply_delta(entry, cache)
+        except (KeyError, TypeError, ValueError, AttributeError) as e:
+            print(f"❌ Error applying change feed delta: {e}")
+            return False
+        cache.change_feed_seq = seq
+    return True
+
+
+def _set_turn_state(data: dict, cache: GameStateCache):
+    num_players = len(cache.game_player_colors)
+    cache.current_player_id = data.get("currentPlayerId", -1)
+    cache.current_phase = Phase.from_int(data.get("currentPhase", -1))
+    cache.is_terminal = data.get("isTerminal", False) or cache.current_player_id == -2 # pyspiel.kTerminalPlayerId
+    
+    if 0 <= cache.current_player_id < num_players:
+        cache.current_player_color = cache.game_player_colors[cache.current_player_id]
+    else:
+        cache.current_player_color = PlayerColor.EMPTY
+
+
+def _set_hex_contents(hex_coord: HexCoord, tokens: list, meeples: list, posts: list, cache: GameStateCache):
+    """Replaces what the cache holds for one hex; empty lists clear it."""
+    if tokens:
+        cache.player_token_locations[hex_coord] = [PlayerColor.from_int(pid) for pid in tokens]
+    else:
+        cache.player_token_locations.pop(hex_coord, None)
+    if meeples:
+        cache.hex_meeples[hex_coord] = [MeepleColor.from_int(mid) for mid in meeples]
+    else:
+        cache.hex_meeples.pop(hex_coord, None)
+    if posts:
+        cache.trade_posts_locations[hex_coord] = [TradePost(PlayerColor.from_int(p["owner"]), TradePostType.from_int(p["type"])) for p in posts]
+    else:
+        cache.trade_posts_locations.pop(hex_coord, None)
+
+
+def _route_from_json(route_data: dict) -> Optional[TradeRoute]:
+    owner = PlayerColor.from_int(route_data.get("owner", -1))
+    hexes = [HexCoord.from_string(s) for s in route_data.get("hexes", [])]
+    if owner == PlayerColor.EMPTY or not all(hexes):
+        return None
+    route = TradeRoute(route_data["id"], owner, hexes, route_data.get("goods", {}))
+    route.active = route_data.get("active", False)
+    return route
+
+
+def _load_state_dict(data: dict, cache: GameStateCache) -> bool:
     try:
         # Clear all dynamic content from the cache.
         # Board structure (valid_hexes, cities, grid_radius) is static and not cleared.
@@ -92,14 +172,7 @@ def parse_and_update_state_from_json(state_str: str, cache: GameStateCache) -> b
         cache.rare_goods = [{} for _ in range(num_players)]
 
         # Parse basic game state
-        cache.current_player_id = data.get("currentPlayerId", -1)
-        cache.current_phase = Phase.from_int(data.get("currentPhase", -1))
-        cache.is_terminal = cache.current_player_id == -2 # pyspiel.kTerminalPlayerId
-        
-        if 0 <= cache.current_player_id < num_players:
-            cache.current_player_color = cache.game_player_colors[cache.current_player_id]
-        else:
-            cache.current_player_color = PlayerColor.EMPTY
+        _set_turn_state(data, cache)
 
         # Player Post Supply
         cache.player_posts_supply = data.get("playerPostsSupply", [6] * num_players)
@@ -130,11 +203,8 @@ def parse_and_update_state_from_json(state_str: str, cache: GameStateCache) -> b
 
         # Trade Routes
         for route_data in data.get("tradeRoutes", []):
-            owner = PlayerColor.from_int(route_data.get("owner", -1))
-            hexes = [HexCoord.from_string(s) for s in route_data.get("hexes", [])]
-            if owner != PlayerColor.EMPTY and all(hexes):
-                route = TradeRoute(route_data["id"], owner, hexes, route_data.get("goods", {}))
-                route.active = route_data.get("active", False)
+            route = _route_from_json(route_data)
+            if route:
                 cache.trade_routes.append(route)
         
         print(f"✅ State cache successfully updated. Player: {cache.current_player_id}, Phase: {cache.current_phase.name}")
@@ -146,6 +216,41 @@ def parse_and_update_state_from_json(state_str: str, cache: GameStateCache) -> b
         traceback.print_exc()
         return False
 
+
+def _apply_delta(delta: dict, cache: GameStateCache):
+    """Applies one change feed delta. Cells and goods carry their new values."""
+    for hex_str, cell in delta.get("cells", {}).items():
+        hex_coord = HexCoord.from_string(hex_str)
+        if hex_coord and hex_coord in cache.valid_hexes:
+            _set_hex_contents(hex_coord, cell.get("tokens", []), cell.get("meeples", []), cell.get("posts", []), cache)
+
+    for goods in delta.get("goods", []):
+        player = goods["player"]
+        for held, changed in ((cache.common_goods[player], goods.get("common", {})),
+                              (cache.rare_goods[player], goods.get("rare", {}))):
+            for name, count in changed.items():
+                if count:
+                    held[name] = count
+                else:
+                    held.pop(name, None)
+
+    if "postsSupply" in delta:
+        cache.player_posts_supply = delta["postsSupply"]
+
+    removed = set(delta.get("routesRemoved", []))
+    if removed:
+        cache.trade_routes = [r for r in cache.trade_routes if r.id not in removed]
+    for route_id, active in delta.get("routesActive", {}).items():
+        for route in cache.trade_routes:
+            if route.id == int(route_id):
+                route.active = active
+    for route_data in delta.get("routesAdded", []):
+        route = _route_from_json(route_data)
+        if route:
+            cache.trade_routes.append(route)
+
+    _set_turn_state(delta, cache)
+
 # def _parse_cities_from_json(json_cities: list) -> List[City]:
 #     """Parse cities from JSON array."""
 #     cities = []
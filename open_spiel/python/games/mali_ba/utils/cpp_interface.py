@@ -5,7 +5,11 @@ Follows a client-server model where C++ is the engine and Python is the client.
 """
 import sys
 import json
-from typing import Dict, List, Optional, Tuple, Set
+from typing import Dict, List, Optional, Tuple, Set, Union
+
+# What apply_action() and play_heuristic_move() hand back for the GUI: a full JSON state
+# string, or the entries drained from the C++ change feed when it is enabled.
+StateUpdate = Union[str, List[str]]
 
 # Ensure pyspiel is available
 try:
@@ -30,13 +34,16 @@ class GameInterface:
     # For individual games kicked off by the Python front end I want to have move logging for replay
     # on as the default
     def __init__(self, config_file_path: Optional[str] = None, enable_move_logging: bool = True, 
-                 prune_moves_for_ai: bool = True, player_types: str = "ai,ai,ai"):
+                 prune_moves_for_ai: bool = True, player_types: str = "ai,ai,ai",
+                 use_change_feed: bool = True):
         """
         Initializes the GameInterface by loading the C++ game engine.
         
         Args:
             config_file_path: Path to the .ini configuration file.
             player_types: Comma-separated string of player types (human, ai, heuristic).
+            use_change_feed: Hand back per-move deltas from the C++ change feed instead of
+                serializing the whole state after every move.
         """
         self.spiel_game: Optional['pyspiel.Game'] = None
         self.spiel_state: Optional['pyspiel.State'] = None
@@ -45,6 +52,7 @@ class GameInterface:
         self.enable_move_logging = enable_move_logging
         self.prune_moves_for_ai = prune_moves_for_ai
         self.player_types = player_types 
+        self.use_change_feed = use_change_feed
 
         if self.is_bypassing:
             print("🐍 C++ backend not available or bypassed. Running in Python-only mode is not supported by this refactor.")
@@ -79,6 +87,9 @@ class GameInterface:
                 if chance_actions:
                     self.spiel_state.apply_action(chance_actions[0])
                 print("✅ Initial board state is ready.")
+
+            if self.use_change_feed:
+                self.spiel_state.enable_change_feed()
         
         except Exception as e:
             print(f"❌ FATAL ERROR: C++ game engine initialization failed: {e}")
@@ -88,7 +99,7 @@ class GameInterface:
             raise
 
 
-    def apply_action(self, action_string: str) -> Tuple[bool, str, Optional[str]]:
+    def apply_action(self, action_string: str) -> Tuple[bool, str, Optional[StateUpdate]]:
         """
         Applies an action to the C++ game state.
         Handles a special command "play_random_move" for cpp_sync_gui mode.
@@ -102,8 +113,10 @@ class GameInterface:
                 if self.spiel_state.is_terminal():
                     return False, "Game is terminal.", None
                 
+                if self.use_change_feed:
+                    self.spiel_state.play_random_move()
+                    return True, "Random move applied.", self._state_update()
                 # C++ State has a method to play a random move and serialize the result
-                # We need to expose this via pybind11
                 new_state_json = self.spiel_state.play_random_move_and_serialize()
                 return True, "Random move applied.", new_state_json
 
@@ -114,8 +127,7 @@ class GameInterface:
                 return False, f"Invalid action: {action_string}", None
             
             self.spiel_state.apply_action(action_id)
-            new_state_json = self.spiel_state.serialize()
-            return True, "Action applied successfully.", new_state_json
+            return True, "Action applied successfully.", self._state_update()
             
         except Exception as e:
             # ... (exception handling as before) ...
@@ -126,6 +138,16 @@ class GameInterface:
         """Gets the complete, authoritative game state as a JSON string from C++."""
         if self.is_bypassing:
             return "{}"
+        # The full state supersedes any queued deltas.
+        if self.use_change_feed:
+            self.spiel_state.drain_change_feed()
+        return self.spiel_state.serialize()
+
+
+    def _state_update(self) -> StateUpdate:
+        """The changes since the last update: change feed entries, or the full state."""
+        if self.use_change_feed:
+            return self.spiel_state.drain_change_feed()
         return self.spiel_state.serialize()
 
 
@@ -160,7 +182,7 @@ class GameInterface:
         return valid_hexes, cities, grid_radius
 
 
-    def play_heuristic_move(self) -> Tuple[bool, str, Optional[str]]:
+    def play_heuristic_move(self) -> Tuple[bool, str, Optional[StateUpdate]]:
         """
         Asks the C++ engine to select and apply one heuristic move for the current player.
         Used by the GUI for non-human players.
@@ -175,8 +197,7 @@ class GameInterface:
                 return False, "Heuristic found no valid action.", None
             
             self.spiel_state.apply_action(action_id)
-            new_state_json = self.spiel_state.serialize()
-            return True, "Heuristic move applied.", new_state_json
+            return True, "Heuristic move applied.", self._state_update()
         except Exception as e:
             print(f"ERROR in play_heuristic_move: {e}")
             return False, f"C++ Error: {e}", None
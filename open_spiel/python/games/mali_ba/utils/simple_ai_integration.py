@@ -96,7 +96,7 @@ def add_ai_support(game_interface, player_config):
                     ai_action = ai_manager.get_ai_action(current_player, game_interface.spiel_state)
                     if ai_action is not None:
                         game_interface.spiel_state.apply_action(ai_action)
-                        state_json = game_interface.spiel_state.serialize()
+                        state_json = game_interface.get_current_state_string()
                         message += f" AI Player {current_player + 1} played action {ai_action}."
                 except Exception as e:
                     print(f"Error in AI move: {e}")
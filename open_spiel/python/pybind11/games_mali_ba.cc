@@ -5,11 +5,24 @@
 #include "open_spiel/games/mali_ba/mali_ba_game.h"
 #include "open_spiel/games/mali_ba/mali_ba_state.h"
 #include "open_spiel/games/mali_ba/hex_grid.h"
+#include "open_spiel/games/mali_ba/mali_ba_archive.h"
 #include "open_spiel/games/mali_ba/mali_ba_common.h"
+#include "open_spiel/games/mali_ba/mali_ba_mcts.h"
+#include "open_spiel/games/mali_ba/mali_ba_memory.h"
+#include "open_spiel/games/mali_ba/mali_ba_observer.h"
+#include "open_spiel/games/mali_ba/mali_ba_perf.h"
+#include "open_spiel/games/mali_ba/mali_ba_replay_buffer.h"
+#include "open_spiel/games/mali_ba/mali_ba_rng.h"
+#include "open_spiel/games/mali_ba/mali_ba_selfplay.h"
+#include "open_spiel/games/mali_ba/mali_ba_vector_env.h"
 #include "open_spiel/spiel.h"
 #include "open_spiel/spiel_globals.h"
 #include "open_spiel/spiel_utils.h"
 
+#include <map>
+#include <mutex>
+
+#include <pybind11/numpy.h>
 #include <pybind11/stl.h>
 #include <pybind11/stl_bind.h>
 
@@ -25,6 +38,85 @@ namespace open_spiel {
 // For clarity, let's use using declarations *inside* this function if needed,
 // or just use the fully qualified names.
 
+namespace {
+
+// {"components": {name: {"bytes", "shared"}}, "total_bytes", "owned_bytes"}
+py::dict MemoryBreakdownToDict(const mali_ba::MemoryBreakdown& breakdown) {
+    py::dict components;
+    for (const mali_ba::MemoryComponent& c : breakdown.components) {
+        py::dict entry;
+        entry["bytes"] = c.bytes;
+        entry["shared"] = c.shared;
+        components[py::str(c.name)] = entry;
+    }
+    py::dict out;
+    out["components"] = components;
+    out["total_bytes"] = breakdown.TotalBytes();
+    out["owned_bytes"] = breakdown.OwnedBytes();
+    return out;
+}
+
+// Wraps a Python callable as a BatchedEvaluator. The callable gets a float32
+// array [batch, observation_size] and returns (priors, values). The wrapper
+// may be copied and called from worker threads: the py::function lives behind
+// a shared_ptr whose deleter takes the GIL, and each call takes the GIL.
+mali_ba::BatchedEvaluator MakePythonEvaluator(py::function evaluator) {
+    std::shared_ptr<py::function> fn(
+        new py::function(std::move(evaluator)),
+        [](py::function* f) { py::gil_scoped_acquire acquire; delete f; });
+    return [fn](absl::Span<const float> observations, int batch_size,
+                absl::Span<float> priors, absl::Span<float> values) {
+        py::gil_scoped_acquire acquire;
+        const py::ssize_t obs_size = observations.size() / batch_size;
+        py::array_t<float> obs_array({static_cast<py::ssize_t>(batch_size), obs_size});
+        std::copy(observations.begin(), observations.end(), obs_array.mutable_data());
+
+        py::tuple out = (*fn)(obs_array).cast<py::tuple>();
+        auto prior_array = py::array_t<float, py::array::c_style | py::array::forcecast>(out[0]);
+        auto value_array = py::array_t<float, py::array::c_style | py::array::forcecast>(out[1]);
+        if (prior_array.size() != static_cast<py::ssize_t>(priors.size()) ||
+            value_array.size() != static_cast<py::ssize_t>(values.size())) {
+            throw std::runtime_error("Mali-Ba evaluator returned arrays of the wrong size.");
+        }
+        std::copy(prior_array.data(), prior_array.data() + priors.size(), priors.begin());
+        std::copy(value_array.data(), value_array.data() + values.size(), values.begin());
+    };
+}
+
+// Zero-copy [rows, cols] NumPy view of a SelfPlayBuffer, VectorEnv or replay batch array; `owner` keeps
+// the buffer alive for as long as the view exists.
+template <typename T>
+py::array_t<T> BufferView(py::object owner, const std::vector<T>& data, int rows, int cols) {
+    std::vector<py::ssize_t> shape = {rows};
+    if (cols > 0) shape.push_back(cols);
+    return py::array_t<T>(shape, data.data(), owner);
+}
+
+// Copies the first `rows` rows of `data` into a new array. For buffers that
+// the next call overwrites or resizes, where a view would go stale.
+template <typename T>
+py::array_t<T> BufferCopy(const std::vector<T>& data, int rows, int cols) {
+    std::vector<py::ssize_t> shape = {rows};
+    if (cols > 0) shape.push_back(cols);
+    return py::array_t<T>(shape, data.data());
+}
+
+// Unpickling a state needs its game. Actors unpickle many states of the same
+// game, so loaded games are kept by their ToString() instead of re-parsing
+// the parameters (and any INI file) every time.
+std::shared_ptr<const Game> LoadGameCached(const std::string& game_string) {
+    static std::mutex mutex;
+    static std::map<std::string, std::shared_ptr<const Game>> games;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = games.find(game_string);
+    if (it == games.end()) {
+        it = games.emplace(game_string, LoadGame(game_string)).first;
+    }
+    return it->second;
+}
+
+}  // namespace
+
 void init_pyspiel_games_mali_ba(::pybind11::module &m) {
     // Create a submodule
     py::module_ mali_ba = m.def_submodule("mali_ba");
@@ -85,17 +177,42 @@ void init_pyspiel_games_mali_ba(::pybind11::module &m) {
         .def_readonly("id", &mali_ba::TradeRoute::id)
         .def_readonly("owner", &mali_ba::TradeRoute::owner)
         .def_readonly("hexes", &mali_ba::TradeRoute::hexes)
-        .def_readonly("goods", &mali_ba::TradeRoute::goods)
+        .def_property_readonly("goods", [](const mali_ba::TradeRoute& route) {
+            return mali_ba::GoodCountsToMap(route.goods, /*rare=*/false);
+        })
         .def_readonly("active", &mali_ba::TradeRoute::active);
 
+    // Counter-based random stream (mali_ba_rng.h). A copy taken from a state
+    // draws what the state would, so Python noise should use a fork.
+    py::class_<mali_ba::Mali_BaRng>(mali_ba, "Rng")
+        .def(py::init<uint64_t>(), py::arg("seed") = mali_ba::Mali_BaRng::kDefaultSeed)
+        .def("seed", &mali_ba::Mali_BaRng::seed, py::arg("seed"))
+        .def("seed_stream", &mali_ba::Mali_BaRng::SeedStream, py::arg("run_seed"), py::arg("game_id"))
+        .def("set_move", &mali_ba::Mali_BaRng::SetMove, py::arg("move"))
+        .def("fork", &mali_ba::Mali_BaRng::Fork, py::arg("channel"))
+        .def("next_uint64", [](mali_ba::Mali_BaRng& rng) { return rng(); })
+        .def("uniform", &mali_ba::Mali_BaRng::Uniform)
+        .def("discard", &mali_ba::Mali_BaRng::discard, py::arg("n"))
+        .def_property_readonly("stream", &mali_ba::Mali_BaRng::stream)
+        .def_property_readonly("move", &mali_ba::Mali_BaRng::move)
+        .def_property_readonly("key", &mali_ba::Mali_BaRng::key)
+        .def_property_readonly("counter", &mali_ba::Mali_BaRng::counter)
+        .def_static("stream_key", &mali_ba::Mali_BaRng::StreamKey,
+                    py::arg("run_seed"), py::arg("game_id"), py::arg("move"));
+
 
 
         // State class - with pickle support
         py::class_<mali_ba::Mali_BaState, open_spiel::State, std::shared_ptr<mali_ba::Mali_BaState>> state_class_binder(m, "Mali_BaState");
         state_class_binder // Use the named variable to chain .def calls
             .def("play_random_move_and_serialize", &mali_ba::Mali_BaState::PlayRandomMoveAndSerialize)
-            .def("get_player_common_goods", &mali_ba::Mali_BaState::GetPlayerCommonGoods, py::return_value_policy::reference_internal)
-            .def("get_player_rare_goods", &mali_ba::Mali_BaState::GetPlayerRareGoods, py::return_value_policy::reference_internal)
+            .def("play_random_move", &mali_ba::Mali_BaState::PlayRandomMove)
+            .def("get_player_common_goods", [](const mali_ba::Mali_BaState& state, Player player) {
+                return mali_ba::GoodCountsToMap(state.GetPlayerCommonGoods(player), /*rare=*/false);
+            })
+            .def("get_player_rare_goods", [](const mali_ba::Mali_BaState& state, Player player) {
+                return mali_ba::GoodCountsToMap(state.GetPlayerRareGoods(player), /*rare=*/true);
+            })
             .def("parse_move_string_to_action", &mali_ba::Mali_BaState::ParseMoveStringToAction)
             .def("create_trade_route", &mali_ba::Mali_BaState::CreateTradeRoute)
             .def("update_trade_route", &mali_ba::Mali_BaState::UpdateTradeRoute)
@@ -103,18 +220,67 @@ void init_pyspiel_games_mali_ba(::pybind11::module &m) {
             .def("validate_trade_routes", &mali_ba::Mali_BaState::ValidateTradeRoutes)
             .def("apply_income_collection", &mali_ba::Mali_BaState::ApplyIncomeCollection)
             .def("serialize", &mali_ba::Mali_BaState::Serialize)
+            .def("hash_key", &mali_ba::Mali_BaState::HashKey)
+            .def("seed_rng", [](mali_ba::Mali_BaState& state, uint64_t seed) {
+                state.GetRNG().seed(seed);
+            }, py::arg("seed"))
+            .def("seed_rng_stream", [](mali_ba::Mali_BaState& state, uint64_t run_seed, uint64_t game_id) {
+                state.GetRNG().SeedStream(run_seed, game_id);
+            }, py::arg("run_seed"), py::arg("game_id"))
+            // Channel `channel` of the state's stream at its current move;
+            // the state's own draws are not affected.
+            .def("fork_rng", [](const mali_ba::Mali_BaState& state, uint64_t channel) {
+                return state.GetRNG().Fork(channel);
+            }, py::arg("channel"))
+            .def("memory_footprint", [](const mali_ba::Mali_BaState& state) {
+                return MemoryBreakdownToDict(state.MemoryFootprint());
+            })
+            // Writes the dense uint8 legal-action mask into `out` in place
+            .def("legal_actions_mask_into", [](const mali_ba::Mali_BaState& state,
+                                               py::array_t<uint8_t, py::array::c_style> out) {
+                if (out.size() != mali_ba::NumDistinctActions()) {
+                    throw std::runtime_error("legal_actions_mask_into: out must have num_distinct_actions() entries.");
+                }
+                state.LegalActionsMask(absl::MakeSpan(out.mutable_data(), out.size()));
+            }, py::arg("out").noconvert())
+            .def("serialize_binary", [](const mali_ba::Mali_BaState& state) {
+                return py::bytes(state.SerializeBinary());
+            })
+            // Change feed for the GUI: JSON snapshots and per-action deltas
+            .def("enable_change_feed", &mali_ba::Mali_BaState::EnableChangeFeed,
+                py::arg("snapshot_interval") = 50)
+            .def("disable_change_feed", &mali_ba::Mali_BaState::DisableChangeFeed)
+            .def("change_feed_enabled", &mali_ba::Mali_BaState::ChangeFeedEnabled)
+            .def("drain_change_feed", &mali_ba::Mali_BaState::DrainChangeFeed)
+            .def("request_change_feed_snapshot", &mali_ba::Mali_BaState::RequestChangeFeedSnapshot)
+            // Cheap copy for MCTS rollouts; clone() stays a full copy for the GUI
+            .def("clone_for_search", &mali_ba::Mali_BaState::CloneForSearch,
+                py::return_value_policy::move)
             // Pickle support for Mali_BaState
             .def(py::pickle(
-                [](const mali_ba::Mali_BaState& state) -> std::string { // __getstate__
-                    return SerializeGameAndState(*state.GetGame(), state);
+                // __getstate__: (game string, binary state)
+                [](const mali_ba::Mali_BaState& state) -> py::tuple {
+                    return py::make_tuple(state.GetGame()->ToString(),
+                                          py::bytes(state.SerializeBinary()));
                 },
-                [](const std::string& data) -> std::shared_ptr<mali_ba::Mali_BaState> { // __setstate__
-                    std::pair<std::shared_ptr<const Game>, std::unique_ptr<State>> game_and_state_pair = 
-                        DeserializeGameAndState(data);
+                // __setstate__: also accepts the older SerializeGameAndState() string
+                [](const py::object& data) -> std::shared_ptr<mali_ba::Mali_BaState> {
+                    std::unique_ptr<State> state;
+                    if (py::isinstance<py::tuple>(data)) {
+                        py::tuple parts = data.cast<py::tuple>();
+                        std::shared_ptr<const Game> game = LoadGameCached(parts[0].cast<std::string>());
+                        const auto* mali_ba_game = dynamic_cast<const mali_ba::Mali_BaGame*>(game.get());
+                        if (!mali_ba_game) {
+                            throw std::runtime_error("Mali_BaState pickle does not hold a mali_ba game.");
+                        }
+                        state = mali_ba_game->DeserializeBinary(parts[1].cast<std::string>());
+                    } else {
+                        state = DeserializeGameAndState(data.cast<std::string>()).second;
+                    }
                     mali_ba::Mali_BaState* raw_state_ptr = 
-                        dynamic_cast<mali_ba::Mali_BaState*>(game_and_state_pair.second.release());
+                        dynamic_cast<mali_ba::Mali_BaState*>(state.release());
                     if (!raw_state_ptr) {
-                        throw std::runtime_error("DeserializeGameAndState did not return a Mali_BaState for State pickle.");
+                        throw std::runtime_error("Unpickling did not produce a Mali_BaState.");
                     }
                     return std::shared_ptr<mali_ba::Mali_BaState>(raw_state_ptr);
                 }
@@ -125,7 +291,13 @@ void init_pyspiel_games_mali_ba(::pybind11::module &m) {
             game_class_binder // Use the named variable to chain .def calls
                 /*.def("get_type_copy", &mali_ba::Mali_BaGame::GetTypeCopy) */ // This method seems to be commented out
                 .def("deserialize_state", &mali_ba::Mali_BaGame::DeserializeState) // This is a Mali_BaGame method
+                .def("deserialize_binary", [](const mali_ba::Mali_BaGame& game, const py::bytes& data) {
+                    return game.DeserializeBinary(std::string(data));
+                }, py::return_value_policy::move)
                 .def("get_grid_radius", &mali_ba::Mali_BaGame::GetGridRadius)     // This is a Mali_BaGame method
+                .def("memory_footprint", [](const mali_ba::Mali_BaGame& game) {
+                    return MemoryBreakdownToDict(game.MemoryFootprint());
+                })
                 // Bind the no-argument NewInitialState
                 .def("new_initial_state",
                     // Explicitly cast to the (std::unique_ptr<State> (YourClass::*)() const) version
@@ -157,7 +329,366 @@ void init_pyspiel_games_mali_ba(::pybind11::module &m) {
                     }
                 )); // End of .def chain for game_class_binder (add semicolon if no more .def calls for it)
 
-        
+
+    // Native MCTS engine. The Python evaluator is called with a float32 array
+    // of shape [batch, observation_size] and must return (priors, values) of
+    // shapes [batch, num_distinct_actions] and [batch, num_players].
+    py::class_<mali_ba::MctsConfig>(mali_ba, "MctsConfig")
+        .def(py::init<>())
+        .def_readwrite("num_simulations", &mali_ba::MctsConfig::num_simulations)
+        .def_readwrite("batch_size", &mali_ba::MctsConfig::batch_size)
+        .def_readwrite("c_puct", &mali_ba::MctsConfig::c_puct)
+        .def_readwrite("virtual_loss", &mali_ba::MctsConfig::virtual_loss)
+        .def_readwrite("dirichlet_alpha", &mali_ba::MctsConfig::dirichlet_alpha)
+        .def_readwrite("dirichlet_epsilon", &mali_ba::MctsConfig::dirichlet_epsilon)
+        .def_readwrite("seed", &mali_ba::MctsConfig::seed)
+        .def_readwrite("transposition_slots", &mali_ba::MctsConfig::transposition_slots);
+
+    py::class_<mali_ba::MctsResult>(mali_ba, "MctsResult")
+        .def_readonly("actions", &mali_ba::MctsResult::actions)
+        .def_readonly("visit_counts", &mali_ba::MctsResult::visit_counts)
+        .def_readonly("policy", &mali_ba::MctsResult::policy)
+        .def_readonly("best_action", &mali_ba::MctsResult::best_action)
+        .def_readonly("root_value", &mali_ba::MctsResult::root_value)
+        .def_readonly("num_evaluator_calls", &mali_ba::MctsResult::num_evaluator_calls)
+        .def_readonly("num_transposition_hits", &mali_ba::MctsResult::num_transposition_hits);
+
+    py::class_<mali_ba::Mali_BaMcts>(mali_ba, "MctsEngine")
+        .def(py::init([](const mali_ba::MctsConfig& config, py::function evaluator) {
+            return std::make_unique<mali_ba::Mali_BaMcts>(config, MakePythonEvaluator(std::move(evaluator)));
+        }), py::arg("config"), py::arg("evaluator"))
+        .def("search", [](mali_ba::Mali_BaMcts& engine, const State& state) {
+            const auto* mali_ba_state = dynamic_cast<const mali_ba::Mali_BaState*>(&state);
+            if (!mali_ba_state) {
+                throw std::runtime_error("MctsEngine.search requires a Mali_BaState.");
+            }
+            // Tree work runs without the GIL; the evaluator re-acquires it.
+            py::gil_scoped_release release;
+            return engine.Search(*mali_ba_state);
+        }, py::arg("state"));
+
+    // Multithreaded self-play. run() plays every game without the GIL and
+    // returns a SelfPlayBuffer whose arrays are zero-copy NumPy views.
+    py::enum_<mali_ba::SelfPlayPolicy>(mali_ba, "SelfPlayPolicy")
+        .value("HEURISTIC", mali_ba::SelfPlayPolicy::kHeuristic)
+        .value("MCTS", mali_ba::SelfPlayPolicy::kMcts)
+        .export_values();
+
+    py::class_<mali_ba::SelfPlayConfig>(mali_ba, "SelfPlayConfig")
+        .def(py::init<>())
+        .def_readwrite("num_games", &mali_ba::SelfPlayConfig::num_games)
+        .def_readwrite("num_threads", &mali_ba::SelfPlayConfig::num_threads)
+        .def_readwrite("policy", &mali_ba::SelfPlayConfig::policy)
+        .def_readwrite("seed", &mali_ba::SelfPlayConfig::seed)
+        .def_readwrite("max_records", &mali_ba::SelfPlayConfig::max_records)
+        .def_readwrite("temperature_drop_move", &mali_ba::SelfPlayConfig::temperature_drop_move)
+        .def_readwrite("mcts", &mali_ba::SelfPlayConfig::mcts)
+        .def_readwrite("archive_path", &mali_ba::SelfPlayConfig::archive_path)
+        .def_readwrite("archive_keyframe_interval",
+                       &mali_ba::SelfPlayConfig::archive_keyframe_interval);
+
+    py::class_<mali_ba::SelfPlayBuffer, std::shared_ptr<mali_ba::SelfPlayBuffer>>(mali_ba, "SelfPlayBuffer")
+        .def_readonly("num_records", &mali_ba::SelfPlayBuffer::num_records)
+        .def_readonly("num_dropped_games", &mali_ba::SelfPlayBuffer::num_dropped_games)
+        .def_property_readonly("observations", [](py::object self) {
+            auto& b = self.cast<mali_ba::SelfPlayBuffer&>();
+            return BufferView(self, b.observations, b.num_records, b.observation_size);
+        })
+        .def_property_readonly("players", [](py::object self) {
+            auto& b = self.cast<mali_ba::SelfPlayBuffer&>();
+            return BufferView(self, b.players, b.num_records, 0);
+        })
+        .def_property_readonly("policies", [](py::object self) {
+            auto& b = self.cast<mali_ba::SelfPlayBuffer&>();
+            return BufferView(self, b.policies, b.num_records, b.num_actions);
+        })
+        .def_property_readonly("rewards", [](py::object self) {
+            auto& b = self.cast<mali_ba::SelfPlayBuffer&>();
+            return BufferView(self, b.rewards, b.num_records, b.num_players);
+        })
+        .def_property_readonly("game_ids", [](py::object self) {
+            auto& b = self.cast<mali_ba::SelfPlayBuffer&>();
+            return BufferView(self, b.game_ids, b.num_records, 0);
+        })
+        .def_property_readonly("game_returns", [](py::object self) {
+            auto& b = self.cast<mali_ba::SelfPlayBuffer&>();
+            return BufferView(self, b.game_returns, static_cast<int>(b.game_lengths.size()), b.num_players);
+        })
+        .def_property_readonly("game_lengths", [](py::object self) {
+            auto& b = self.cast<mali_ba::SelfPlayBuffer&>();
+            return BufferView(self, b.game_lengths, static_cast<int>(b.game_lengths.size()), 0);
+        });
+
+    py::class_<mali_ba::Mali_BaSelfPlayRunner>(mali_ba, "SelfPlayRunner")
+        .def(py::init([](std::shared_ptr<const Game> game, const mali_ba::SelfPlayConfig& config,
+                         py::object evaluator) {
+            mali_ba::BatchedEvaluator callback = nullptr;
+            if (!evaluator.is_none()) callback = MakePythonEvaluator(evaluator.cast<py::function>());
+            return std::make_unique<mali_ba::Mali_BaSelfPlayRunner>(game, config, std::move(callback));
+        }), py::arg("game"), py::arg("config"), py::arg("evaluator") = py::none())
+        .def("run", [](mali_ba::Mali_BaSelfPlayRunner& runner) {
+            py::gil_scoped_release release;
+            return runner.Run();
+        });
+
+    py::class_<mali_ba::VectorEnvConfig>(mali_ba, "VectorEnvConfig")
+        .def(py::init<>())
+        .def_readwrite("num_envs", &mali_ba::VectorEnvConfig::num_envs)
+        .def_readwrite("seed", &mali_ba::VectorEnvConfig::seed)
+        .def_readwrite("auto_reset", &mali_ba::VectorEnvConfig::auto_reset);
+
+    // The array properties are zero-copy views that step() and reset()
+    // overwrite in place; copy them to keep a step's values.
+    py::class_<mali_ba::Mali_BaVectorEnv>(mali_ba, "VectorEnv")
+        .def(py::init<std::shared_ptr<const Game>, const mali_ba::VectorEnvConfig&>(),
+             py::arg("game"), py::arg("config"))
+        .def("reset", [](mali_ba::Mali_BaVectorEnv& env) {
+            py::gil_scoped_release release;
+            env.Reset();
+        })
+        .def("step", [](mali_ba::Mali_BaVectorEnv& env,
+                        py::array_t<int64_t, py::array::c_style | py::array::forcecast> actions) {
+            if (actions.size() != env.NumEnvs()) {
+                throw std::runtime_error("VectorEnv.step: need one action per env.");
+            }
+            absl::Span<const Action> values(actions.data(), actions.size());
+            py::gil_scoped_release release;
+            env.Step(values);
+        }, py::arg("actions"))
+        .def_property_readonly("num_envs", &mali_ba::Mali_BaVectorEnv::NumEnvs)
+        .def_property_readonly("observations", [](py::object self) {
+            auto& env = self.cast<mali_ba::Mali_BaVectorEnv&>();
+            return BufferView(self, env.Observations(), env.NumEnvs(), env.ObservationSize());
+        })
+        .def_property_readonly("legal_masks", [](py::object self) {
+            auto& env = self.cast<mali_ba::Mali_BaVectorEnv&>();
+            return BufferView(self, env.LegalMasks(), env.NumEnvs(), env.NumActions());
+        })
+        .def_property_readonly("current_players", [](py::object self) {
+            auto& env = self.cast<mali_ba::Mali_BaVectorEnv&>();
+            return BufferView(self, env.CurrentPlayers(), env.NumEnvs(), 0);
+        })
+        .def_property_readonly("rewards", [](py::object self) {
+            auto& env = self.cast<mali_ba::Mali_BaVectorEnv&>();
+            return BufferView(self, env.Rewards(), env.NumEnvs(), env.NumPlayers());
+        })
+        .def_property_readonly("dones", [](py::object self) {
+            auto& env = self.cast<mali_ba::Mali_BaVectorEnv&>();
+            return BufferView(self, env.Dones(), env.NumEnvs(), 0);
+        })
+        .def_property_readonly("final_returns", [](py::object self) {
+            auto& env = self.cast<mali_ba::Mali_BaVectorEnv&>();
+            return BufferView(self, env.FinalReturns(), env.NumEnvs(), env.NumPlayers());
+        })
+        .def_property_readonly("episode_lengths", [](py::object self) {
+            auto& env = self.cast<mali_ba::Mali_BaVectorEnv&>();
+            return BufferView(self, env.EpisodeLengths(), env.NumEnvs(), 0);
+        })
+        // A copy of env `env`'s live state.
+        .def("state", [](const mali_ba::Mali_BaVectorEnv& env, int index) {
+            return std::shared_ptr<mali_ba::Mali_BaState>(
+                static_cast<mali_ba::Mali_BaState*>(env.GetState(index).Clone().release()));
+        }, py::arg("env"));
+
+    py::class_<mali_ba::ReplayBufferConfig>(mali_ba, "ReplayBufferConfig")
+        .def(py::init<>())
+        .def_readwrite("capacity", &mali_ba::ReplayBufferConfig::capacity)
+        .def_readwrite("observation_size", &mali_ba::ReplayBufferConfig::observation_size)
+        .def_readwrite("num_actions", &mali_ba::ReplayBufferConfig::num_actions)
+        .def_readwrite("num_players", &mali_ba::ReplayBufferConfig::num_players)
+        .def_readwrite("max_policy_entries", &mali_ba::ReplayBufferConfig::max_policy_entries);
+
+    // Shared-memory replay ring. One process create()s it by name and the
+    // others attach() to it. sample() returns zero-copy views of this
+    // handle's batch arrays, which the next sample() overwrites.
+    using FloatArray = py::array_t<float, py::array::c_style | py::array::forcecast>;
+    py::class_<mali_ba::SharedReplayBuffer>(mali_ba, "SharedReplayBuffer")
+        .def_static("create", &mali_ba::SharedReplayBuffer::Create,
+                    py::arg("name"), py::arg("config"))
+        .def_static("attach", &mali_ba::SharedReplayBuffer::Attach, py::arg("name"))
+        .def("add", [](mali_ba::SharedReplayBuffer& buffer, FloatArray observation,
+                       FloatArray policy, FloatArray values, int player, float priority) {
+            absl::Span<const float> obs(observation.data(), observation.size());
+            absl::Span<const float> pol(policy.data(), policy.size());
+            absl::Span<const float> val(values.data(), values.size());
+            py::gil_scoped_release release;
+            return buffer.Add(obs, pol, val, player, priority);
+        }, py::arg("observation"), py::arg("policy"), py::arg("values"), py::arg("player"),
+           py::arg("priority") = 1.0f)
+        .def("add_sparse", [](mali_ba::SharedReplayBuffer& buffer, FloatArray observation,
+                              py::array_t<int64_t, py::array::c_style | py::array::forcecast> actions,
+                              FloatArray probabilities, FloatArray values, int player, float priority) {
+            absl::Span<const float> obs(observation.data(), observation.size());
+            absl::Span<const Action> act(actions.data(), actions.size());
+            absl::Span<const float> prob(probabilities.data(), probabilities.size());
+            absl::Span<const float> val(values.data(), values.size());
+            py::gil_scoped_release release;
+            return buffer.AddSparse(obs, act, prob, val, player, priority);
+        }, py::arg("observation"), py::arg("actions"), py::arg("probabilities"), py::arg("values"),
+           py::arg("player"), py::arg("priority") = 1.0f)
+        // (observations, policies, values, players, record_numbers, weights),
+        // with as many rows as were drawn. The arrays are copies: the next
+        // Sample() overwrites the batch, and may reallocate it.
+        .def("sample", [](mali_ba::SharedReplayBuffer& buffer, int batch_size, bool prioritized,
+                          double alpha, double beta) {
+            int rows = 0;
+            {
+                py::gil_scoped_release release;
+                rows = buffer.Sample(batch_size, prioritized, alpha, beta);
+            }
+            const mali_ba::ReplayBufferConfig& config = buffer.Config();
+            return py::make_tuple(
+                BufferCopy(buffer.BatchObservations(), rows, config.observation_size),
+                BufferCopy(buffer.BatchPolicies(), rows, config.num_actions),
+                BufferCopy(buffer.BatchValues(), rows, config.num_players),
+                BufferCopy(buffer.BatchPlayers(), rows, 0),
+                BufferCopy(buffer.BatchIndices(), rows, 0),
+                BufferCopy(buffer.BatchWeights(), rows, 0));
+        }, py::arg("batch_size"), py::arg("prioritized") = false, py::arg("alpha") = 0.6,
+           py::arg("beta") = 0.4)
+        .def("update_priorities", [](mali_ba::SharedReplayBuffer& buffer,
+                                     py::array_t<int64_t, py::array::c_style | py::array::forcecast> record_numbers,
+                                     FloatArray priorities) {
+            buffer.UpdatePriorities(absl::MakeConstSpan(record_numbers.data(), record_numbers.size()),
+                                    absl::MakeConstSpan(priorities.data(), priorities.size()));
+        }, py::arg("record_numbers"), py::arg("priorities"))
+        .def("seed", &mali_ba::SharedReplayBuffer::Seed, py::arg("seed"))
+        .def("__len__", &mali_ba::SharedReplayBuffer::Size)
+        .def_property_readonly("total_added", &mali_ba::SharedReplayBuffer::TotalAdded)
+        .def_property_readonly("name", &mali_ba::SharedReplayBuffer::Name)
+        .def_property_readonly("config", &mali_ba::SharedReplayBuffer::Config);
+
+    // Game archives: record games with a GameArchiveRecorder, append them to a
+    // GameArchiveWriter file, and seek into any game with a GameArchiveReader.
+    py::class_<mali_ba::GameArchiveRecorder>(mali_ba, "GameArchiveRecorder")
+        .def(py::init<int>(), py::arg("keyframe_interval") = 32)
+        .def("begin", &mali_ba::GameArchiveRecorder::Begin, py::arg("state"),
+             py::arg("game_id") = -1)
+        .def("update", &mali_ba::GameArchiveRecorder::Update, py::arg("state"))
+        .def_property_readonly("game_id", &mali_ba::GameArchiveRecorder::game_id)
+        .def_property_readonly("num_moves", &mali_ba::GameArchiveRecorder::num_moves);
+
+    py::class_<mali_ba::GameArchiveWriter>(mali_ba, "GameArchiveWriter")
+        .def(py::init([](const std::string& path, std::shared_ptr<const Game> game) {
+            return std::make_unique<mali_ba::GameArchiveWriter>(path, *game);
+        }), py::arg("path"), py::arg("game"))
+        .def("add", &mali_ba::GameArchiveWriter::Add, py::arg("recorder"),
+             py::call_guard<py::gil_scoped_release>())
+        .def("close", &mali_ba::GameArchiveWriter::Close)
+        .def_property_readonly("path", &mali_ba::GameArchiveWriter::path)
+        .def_property_readonly("num_games", &mali_ba::GameArchiveWriter::num_games);
+
+    py::class_<mali_ba::GameArchiveReader>(mali_ba, "GameArchiveReader")
+        .def(py::init<const std::string&>(), py::arg("path"))
+        .def_property_readonly("game_string", &mali_ba::GameArchiveReader::GameString)
+        .def("__len__", &mali_ba::GameArchiveReader::NumGames)
+        .def("game_id", &mali_ba::GameArchiveReader::GameId, py::arg("game"))
+        .def("num_moves", &mali_ba::GameArchiveReader::NumMoves, py::arg("game"))
+        .def("first_seekable_move", &mali_ba::GameArchiveReader::FirstSeekableMove,
+             py::arg("game"))
+        .def("is_terminal", &mali_ba::GameArchiveReader::IsTerminal, py::arg("game"))
+        .def("returns", &mali_ba::GameArchiveReader::Returns, py::arg("game"))
+        .def("setup_json", [](const mali_ba::GameArchiveReader& reader, int game) {
+            return std::string(reader.SetupJson(game));
+        }, py::arg("game"))
+        .def("actions", [](const mali_ba::GameArchiveReader& reader, int game) {
+            absl::Span<const int32_t> actions = reader.Actions(game);
+            return py::array_t<int32_t>(actions.size(), actions.data());
+        }, py::arg("game"))
+        .def("players", [](const mali_ba::GameArchiveReader& reader, int game) {
+            absl::Span<const int8_t> players = reader.Players(game);
+            return py::array_t<int8_t>(players.size(), players.data());
+        }, py::arg("game"))
+        // The state after `move` moves of `game`, for stepping a replay
+        // forwards or backwards without replaying from the start.
+        .def("state_at", [](const mali_ba::GameArchiveReader& reader,
+                            std::shared_ptr<const Game> game, int game_index, int move) {
+            const auto* mali_ba_game = dynamic_cast<const mali_ba::Mali_BaGame*>(game.get());
+            SPIEL_CHECK_TRUE(mali_ba_game != nullptr);
+            return std::shared_ptr<mali_ba::Mali_BaState>(static_cast<mali_ba::Mali_BaState*>(
+                reader.StateAt(*mali_ba_game, game_index, move).release()));
+        }, py::arg("game"), py::arg("game_index"), py::arg("move"));
+
+    // Fills a [len(states), observation_size] float32 array in one call.
+    // `players` defaults to each state's current player.
+    mali_ba.def("observation_tensor_batch",
+        [](const std::vector<const mali_ba::Mali_BaState*>& states, const std::vector<Player>& players) {
+            if (states.empty()) return py::array_t<float>(std::vector<py::ssize_t>{0, 0});
+            const py::ssize_t obs_size = states[0]->GetGame()->ObservationTensorSize();
+            py::array_t<float> out({static_cast<py::ssize_t>(states.size()), obs_size});
+            absl::Span<float> values = absl::MakeSpan(out.mutable_data(), out.size());
+            {
+                py::gil_scoped_release release;
+                mali_ba::ObservationTensorBatch(states, values, players);
+            }
+            return out;
+        }, py::arg("states"), py::arg("players") = std::vector<Player>{});
+
+    // Fills a [len(states), num_distinct_actions] uint8 legal-action mask in
+    // one call, into `out` when given (a C-contiguous uint8 array of that
+    // shape), otherwise into a new array.
+    mali_ba.def("legal_actions_mask_batch",
+        [](const std::vector<const mali_ba::Mali_BaState*>& states, py::object out) {
+            const py::ssize_t num_actions = mali_ba::NumDistinctActions();
+            const py::ssize_t num_states = static_cast<py::ssize_t>(states.size());
+            using MaskArray = py::array_t<uint8_t, py::array::c_style>;
+            MaskArray masks;
+            if (out.is_none()) {
+                masks = MaskArray({num_states, num_actions});
+            } else {
+                if (!MaskArray::check_(out)) {
+                    throw std::runtime_error("legal_actions_mask_batch: out must be a C-contiguous uint8 array.");
+                }
+                masks = py::reinterpret_borrow<MaskArray>(out);
+                if (masks.size() != num_states * num_actions) {
+                    throw std::runtime_error("legal_actions_mask_batch: out must hold len(states) * num_distinct_actions() entries.");
+                }
+            }
+            absl::Span<uint8_t> values = absl::MakeSpan(masks.mutable_data(), masks.size());
+            {
+                py::gil_scoped_release release;
+                mali_ba::LegalActionsMaskBatch(states, values);
+            }
+            return masks;
+        }, py::arg("states"), py::arg("out") = py::none());
+
+    // Hot-path counters (see mali_ba_perf.h). Counts are per process: each
+    // actor reads its own.
+    mali_ba.def("set_perf_counters_enabled", &mali_ba::SetPerfCountersEnabled, py::arg("enabled"));
+    mali_ba.def("perf_counters_enabled", &mali_ba::PerfCountersEnabled);
+    mali_ba.def("reset_perf_stats", &mali_ba::ResetPerfStats);
+    // {section: {calls, total_ns, mean_ns, max_ns, p50_ns, p99_ns, histogram}};
+    // histogram[b] counts calls that took [2^b, 2^(b+1)) ns.
+    mali_ba.def("get_perf_stats", []() {
+        py::dict out;
+        for (const mali_ba::PerfSectionStats& stats : mali_ba::GetPerfStats()) {
+            py::dict entry;
+            entry["calls"] = stats.calls;
+            entry["total_ns"] = stats.total_ns;
+            entry["mean_ns"] = stats.MeanNs();
+            entry["max_ns"] = stats.max_ns;
+            entry["p50_ns"] = stats.ApproxQuantileNs(0.5);
+            entry["p99_ns"] = stats.ApproxQuantileNs(0.99);
+            entry["histogram"] = std::vector<uint64_t>(stats.histogram.begin(), stats.histogram.end());
+            out[py::str(stats.name)] = entry;
+        }
+        return out;
+    });
+
+    // Allocation counting for the undo journal containers (see
+    // mali_ba_memory.h). Counts are per thread.
+    mali_ba.def("set_allocation_counting_enabled", &mali_ba::SetAllocationCountingEnabled,
+                py::arg("enabled"));
+    mali_ba.def("allocation_counting_enabled", &mali_ba::AllocationCountingEnabled);
+    mali_ba.def("reset_thread_allocation_counts", &mali_ba::ResetThreadAllocationCounts);
+    mali_ba.def("thread_allocation_counts", []() {
+        const mali_ba::AllocationCounts counts = mali_ba::ThreadAllocationCounts();
+        py::dict out;
+        out["allocations"] = counts.allocations;
+        out["bytes"] = counts.bytes;
+        return out;
+    });
+
     // Utility functions
     mali_ba.def("player_color_to_string", &mali_ba::PlayerColorToString);
     mali_ba.def("string_to_player_color", &mali_ba::StringToPlayerColor);